@@ -13,6 +13,9 @@
 void analyze_data(char *, ssize_t);
 void process_udp_payload(char * src_ip, uint16_t src_port, char* dst_ip, uint16_t dst_port, char * buffer, uint16_t len);
 
+// one context for all the packets, we reset it for each one
+sdns_context * ctx = NULL;
+
 int main(int argc, char** argv){
     struct sockaddr saddr;
     int sock_addr_len = sizeof(saddr);
@@ -28,6 +31,8 @@ int main(int argc, char** argv){
         fprintf(stderr, "Can not allocate buffer with malloc()\n");
         return 1;
     }
+    ctx = sdns_init_context();
+    ctx->flags |= SDNS_CTX_ARENA;
     ssize_t recv_data;
     do{
         // capture packets, process and repeat
@@ -39,6 +44,7 @@ int main(int argc, char** argv){
         analyze_data(buffer, recv_data);
     }while(1);
     // clean up memory
+    sdns_free_context(ctx);
     free(buffer);
     close(sockfd);
     return 0;
@@ -102,7 +108,7 @@ void analyze_data(char * ethbuffer, ssize_t ethbuffer_len){
 void process_udp_payload(char * src_ip, uint16_t src_port, char* dst_ip, uint16_t dst_port, char * buffer, uint16_t len){
     // if we can successfully parse the packet, it's probably DNS packet 
     // and we print information otherwise, we just return
-    sdns_context * ctx = sdns_init_context();
+    sdns_context_reset(ctx);
     ctx->raw = buffer;
     ctx->raw_len = len;
     int res = sdns_from_wire(ctx);
@@ -119,7 +125,6 @@ void process_udp_payload(char * src_ip, uint16_t src_port, char* dst_ip, uint16_
     }
     ctx->raw = NULL;
     ctx->raw_len = 0;
-    sdns_free_context(ctx);
     return;
 
 }
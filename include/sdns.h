@@ -1,5 +1,7 @@
 /** @file */
 #include <stdint.h>
+#include <stddef.h>
+#include <sdns_arena.h>
 
 #ifndef __SDNS_H
 #define __SDNS_H
@@ -8,6 +10,7 @@
 
 #define UDP_PAYLOAD_SIZE 1232   ///< Default UDP payload size for EDNS0
 #define DNS_HEADER_LENGTH 12    ///< Standard DNS Header length
+#define SDNS_NAME_BUFFER_SIZE 256   ///< Size of a buffer that can keep any decoded domain name
 
 // define some error code constant
 #define SDNS_ERROR_MEMORY_ALLOC_FAILED -1                ///< memory allocation using malloc() failed
@@ -40,12 +43,34 @@
 #define SDNS_ERROR_NO_AUTHORITY_FOUND        -24       ///< This error shows that the DNS context has no authority section
 #define SDNS_ERROR_NO_ADDITIONAL_FOUND       -25       ///< This error shows that the DNS context has no additional section
 #define SDNS_ERROR_ADDITIONAL_RR_OPT        -26       ///< Additional section is of type OPT. Use the relevant function to fetch it.
+#define SDNS_ERROR_NO_QUESTION_FOUND        -27       ///< The DNS packet has no question section
 // define the section types
 #define DNS_SECTION_ANSWER 1                           ///< Macro defining the answer section
 #define DNS_SECTION_AUTHORITY 2                        ///< Macro defining the authority section
 #define DNS_SECTION_ADDITIONAL 3                       ///< Macro defining the additional section
 #define DNS_SECTION_QUESTION 4                         ///< Macro defining the question section
 
+// define the context flags (sdns_context::flags)
+/** sdns_from_wire() does not allocate the names of the question and RRs. It only validates them
+ *  and keeps their offset in the raw buffer. Use sdns_get_qname() and sdns_get_rr_name() to get them. */
+#define SDNS_CTX_NAME_VIEW 0x01
+/** The RRs, names and the question created for the message of the context are allocated
+ *  from the context arena (sdns_context::arena) and they are released all together by sdns_free_context(). */
+#define SDNS_CTX_ARENA 0x02
+/** sdns_from_wire() only decodes the header and the question. Each of the other sections is decoded
+ *  on the first access (sdns_decode_section(), sdns_section_rr(), sdns_get_answer(), etc.). */
+#define SDNS_CTX_LAZY 0x04
+/** sdns_from_wire() computes a case-insensitive hash of the qname and the owner names while it decodes them
+ *  (sdns_question::qname_hash and sdns_rr::name_hash). It's the same value sdns_name_hash() returns. */
+#define SDNS_CTX_NAME_HASH 0x08
+/** sdns_to_wire_into() drops the RRsets that do not fit in the buffer (like sdns_to_wire_limit())
+ *  instead of failing. */
+#define SDNS_CTX_TRUNCATE 0x10
+/** **raw** is the buffer of the caller (see sdns_from_network_borrow()). The context only reads it: sdns_free_context()
+ *  and sdns_context_reset() do not free it and sdns_to_wire() writes the packet to a new buffer. The buffer must live
+ *  as long as the context refers to it, use sdns_context_detach() if the context must outlive it. */
+#define SDNS_CTX_BORROWED 0x20
+
 // define DNS masks
 #define SDNS_QR_MASK     0x8000
 #define SDNS_OPCODE_MASK 0x7800
@@ -122,6 +147,9 @@ typedef struct {
     char * qname;                   ///< RFC1035 - the domain name
     uint16_t qtype;                 ///< RFC1035 - two octet, type of the query
     uint16_t qclass;                ///< RFC1035 - two octet, class of the query
+    uint16_t qname_offset;          ///< non-rfc: offset of the qname in the raw buffer (see ::SDNS_CTX_NAME_VIEW)
+    uint16_t qname_len;             ///< non-rfc: number of bytes the (compressed) qname takes in the raw buffer
+    uint64_t qname_hash;            ///< non-rfc: hash of the qname (see ::SDNS_CTX_NAME_HASH), 0 if not computed
 } sdns_question;
 
 
@@ -177,6 +205,58 @@ typedef struct{
 } sdns_opt_ttl;
 
 
+/** Structure to hold the data of RR type */
+typedef struct {
+    uint32_t address;           ///< IPv4 address (only one address)
+} sdns_rr_A;
+
+/** Structure to hold the data of RR type AAAA */
+typedef struct {
+    char * address;             ///< IPv6 address but we keep it as a sequence of bytes (exactly 16 bytes)
+} sdns_rr_AAAA;
+
+/**
+ * This is the structure of the NID RR based on RFC 6742
+ */
+typedef struct{
+    uint16_t Preference;        ///< indicates the owner name's relative preference
+    char * NodeId;              ///< NodeID field is an unsigned 64-bit value in network byte order (len=8bytes)
+} sdns_rr_NID;
+
+/**
+ * this is the structure of the L32 RR based on RFC 6742
+ */
+typedef struct{
+    uint16_t Preference;   ///< a 16-bit preference field
+    uint32_t Locator32;    ///< locator32 is exactly 32 bit so we can have a uint32 type to cover it
+}sdns_rr_L32;
+
+/**
+ * this is the structure of the L64 RR based on RFC 6742
+ */
+typedef struct{
+    uint16_t Preference;    ///< a 16-bit Preference field
+    char * Locator64;       ///< Locator64 is exactly 64 bit (8bytes)
+}sdns_rr_L64;
+
+/**
+ * non-rfc: room for the decoded rdata of A, AAAA, L32, L64 and NID. The library allocates it right
+ * after the ::_sdns_rr of these types (see **has_inline**), other RRs don't have it.
+ * The pointers of AAAA, L64 and NID point to **bytes** of the same structure.
+ * See sdns_rr_inline_rdata() and sdns_decode_rr_inline().
+ */
+typedef struct {
+    union {
+        sdns_rr_A A;            ///< rdata of A
+        sdns_rr_AAAA AAAA;      ///< rdata of AAAA (address is **bytes**)
+        sdns_rr_L32 L32;        ///< rdata of L32
+        sdns_rr_L64 L64;        ///< rdata of L64 (Locator64 is **bytes**)
+        sdns_rr_NID NID;        ///< rdata of NID (NodeId is **bytes**)
+    };
+    char bytes[16];             ///< the IPv6 address of AAAA, Locator64 of L64 or NodeId of NID
+} sdns_rr_inline;
+
+
 /**
  * Each resource record of a DNS packet has the following format.
  * This is the standard format of **answer** section, **authority** section 
@@ -224,10 +304,24 @@ typedef struct{
  * then we can use **psdns_rr** pointer and cast it to the correct structure and use it.
  * when the _rdata_ is not decoded (decoded=0), we should treat it as a pointer to char*.
  * 2. **next**: a pointer to the same structure for creating a link-list of RRs.
+ * 3. **name_offset** and **name_len**: the position and the compressed length of the
+ * owner name in the raw buffer. These are only set by sdns_from_wire(). When the context
+ * is parsed with ::SDNS_CTX_NAME_VIEW, **name** is NULL and must be fetched by sdns_get_rr_name().
+ * 4. **in_arena**: the structure itself and its **name** are allocated from the arena of the context
+ * (see ::SDNS_CTX_ARENA) and must not be passed to free(). The decoded rdata (**psdns_rr**) is never part of the arena
+ * unless it is inline (see **has_inline**).
+ * 5. **name_hash**: the hash of the owner name computed by sdns_from_wire() with ::SDNS_CTX_NAME_HASH (0 otherwise).
+ * 6. **has_inline**: sdns_init_rr() and sdns_context_init_rr() allocate a ::sdns_rr_inline right after the
+ * structure of A, AAAA, L32, L64 and NID (same allocation). The decoded rdata of these RRs lives there and
+ * **psdns_rr** points to it (see sdns_rr_inline_rdata()). It goes away with the RR; never free() it.
+ * For the same reason, an RR must not be copied by value: the copy would point to the rdata of the original.
  *
  */
 struct _sdns_rr{
     char * name;                     ///< RFC1035 - domain name
+    uint16_t name_offset;           ///< non-rfc: offset of the owner name in the raw buffer
+    uint16_t name_len;              ///< non-rfc: number of bytes the (compressed) owner name takes in the raw buffer
+    uint64_t name_hash;             ///< non-rfc: hash of the owner name (see ::SDNS_CTX_NAME_HASH)
     uint16_t type;                  ///< RFC1035 - RR type code
     union {
         uint16_t class;             ///< RFC1035 - class of the data in rdata
@@ -244,6 +338,8 @@ struct _sdns_rr{
         void * psdns_rr;   ///< this is not DNS-RFC. It's just a reference for our library
     };
     uint8_t decoded;       ///< this is not DNS-RFC. it's just a flag to know if the rdata is decoded or not
+    uint8_t in_arena;      ///< this is not DNS-RFC. 1 if the RR and its name belong to the context arena
+    uint8_t has_inline;    ///< this is not DNS-RFC. 1 if a ::sdns_rr_inline follows the structure in the same allocation
     struct _sdns_rr * next;     ///< non-rfc field, just keep the reference to the next structure (linked-list)
 };
 
@@ -481,6 +577,48 @@ typedef enum {
     sdns_ede_code_Synthesized=29                         ///< Synthesized
 }sdns_ede_code;
 
+/**
+ * Index of a section of the DNS packet (used internally).
+ *
+ * The sections are still linked lists (sdns_rr::next), this structure keeps the last RR and an array
+ * of all the RRs so that appending an RR and sdns_section_rr() are O(1). The library rebuilds the index
+ * whenever it does not match the list (e.g., **count** is not the same as the header count).
+ */
+typedef struct {
+    sdns_rr * tail;                 ///< The last RR of the section
+    sdns_rr ** rrs;                 ///< All the RRs of the section in order
+    uint16_t count;                 ///< Number of RRs in **rrs**
+    uint16_t cap;                   ///< Capacity of **rrs**
+} sdns_section_index;
+
+/** Position of one RR in the raw buffer (filled by sdns_scan_message()). */
+typedef struct {
+    uint16_t offset;            ///< Start of the RR (owner name) in the buffer
+    uint16_t rdata_offset;      ///< Start of the rdata in the buffer
+    uint16_t rdlength;          ///< Length of the rdata
+    uint16_t type;              ///< Type of the RR
+    uint8_t section;            ///< One of DNS_SECTION_ANSWER, DNS_SECTION_AUTHORITY or DNS_SECTION_ADDITIONAL
+} sdns_rr_span;
+
+/** A read-only view of one RR in the raw buffer of a context (filled by sdns_iter_next()).
+ *  Nothing is copied: the view is valid as long as the raw buffer of the context. */
+typedef struct {
+    int section;                ///< The section of the RR (DNS_SECTION_*)
+    uint16_t name_offset;       ///< Offset of the owner name in the raw buffer (see sdns_view_name())
+    uint16_t type;              ///< RR type
+    uint16_t class;             ///< RR class (UDP payload size for OPT)
+    uint32_t ttl;               ///< TTL as it is on the wire
+    uint16_t rdlength;          ///< Length of the rdata
+    const char * rdata;         ///< The rdata in the raw buffer (NULL if rdlength is 0)
+} sdns_rr_view;
+
+/** Layout of a DNS packet (filled by sdns_scan_message()). */
+typedef struct {
+    uint16_t section_offset[5]; ///< Start of each section in the buffer (index is DNS_SECTION_*)
+    uint16_t end;               ///< End of the DNS message (there might be more bytes in the buffer after it)
+    uint32_t rr_count;          ///< Number of RRs in the answer, authority and additional sections
+} sdns_message_layout;
+
 /** This is the structure of a DNS packet. */
 typedef struct {
     sdns_header header;             ///< See ::sdns_header for more info
@@ -488,18 +626,11 @@ typedef struct {
     sdns_rr *answer;                ///< Answer section of a DNS packet
     sdns_rr *authority;             ///< Authority section of a DNS packet
     sdns_rr *additional;            ///< Additional section of a DNS packet
+    sdns_section_index answer_index;        ///< Index of the answer section (internal)
+    sdns_section_index authority_index;     ///< Index of the authority section (internal)
+    sdns_section_index additional_index;    ///< Index of the additional section (internal)
 } sdns_message;
 
-/** Structure to hold the data of RR type */
-typedef struct {
-    uint32_t address;           ///< IPv4 address (only one address)
-} sdns_rr_A;
-
-/** Structure to hold the data of RR type AAAA */
-typedef struct {
-    char * address;             ///< IPv6 address but we keep it as a sequence of bytes (exactly 16 bytes)
-} sdns_rr_AAAA;
-
 /**
  * Structure to hold the data of RR type TXT.
  * The data part of a TXT RR has one bytes of length
@@ -521,6 +652,16 @@ struct _sdns_rr_TXT {
 /** check the definition of ::_sdns_rr_TXT. */
 typedef struct _sdns_rr_TXT sdns_rr_TXT;
 
+/**
+ * non-rfc: one character-string of the rdata of a TXT RR without copying it.
+ * The string is **len** bytes starting at **offset** of the rdata (after its length byte).
+ * See sdns_txt_spans() and sdns_view_TXT().
+ */
+typedef struct {
+    uint16_t offset;    ///< offset of the first byte of the string in the rdata
+    uint8_t len;        ///< length of the string
+} sdns_txt_span;
+
 
 /** The structure of SOA RR based on RFC1035 */
 typedef struct {
@@ -622,14 +763,6 @@ typedef struct{
     uint16_t target_len;    ///< non-rfc filed. Just used as a helper to know the length of the Target filed
 } sdns_rr_URI;
 
-/**
- * This is the structure of the NID RR based on RFC 6742
- */
-typedef struct{
-    uint16_t Preference;        ///< indicates the owner name's relative preference
-    char * NodeId;              ///< NodeID field is an unsigned 64-bit value in network byte order (len=8bytes)
-} sdns_rr_NID;
-
 /**
  * This is the structure of the HINFO RR based on RFC 1035
  */
@@ -640,24 +773,6 @@ typedef struct{
     char * os;                  ///< OS information
 }sdns_rr_HINFO;
 
-/**
- * this is the structure of the L32 RR based on RFC 6742
- */
-typedef struct{
-    uint16_t Preference;   ///< a 16-bit preference field
-    uint32_t Locator32;    ///< locator32 is exactly 32 bit so we can have a uint32 type to cover it
-}sdns_rr_L32;
-
-
-/**
- * this is the structure of the L64 RR based on RFC 6742
- */
-typedef struct{
-    uint16_t Preference;    ///< a 16-bit Preference field
-    char * Locator64;       ///< Locator64 is exactly 64 bit (8bytes)
-}sdns_rr_L64;
-
-
 /**
  * this is the structure of the LP RR based on RFC 6742
  */
@@ -684,6 +799,10 @@ typedef struct{
  *
  * This is structure is used to parse a sequence of bytes to a DNS packet and vice versa.
  * **raw_len** and **cursor** are used internally and should not be used by callers.
+ *
+ * When **flags** has ::SDNS_CTX_ARENA, the library creates **arena** on the first allocation
+ * and keeps the RRs of the message there. The RRs you add yourself by sdns_add_answer_section() and
+ * friends are still freed one by one; the arena part is released at once.
  */
 typedef struct {
     sdns_message * msg;         ///< This is the DNS packet
@@ -691,8 +810,57 @@ typedef struct {
     uint16_t raw_len;           ///< Length of the raw data we received from socket
     char * cursor;              ///< This cursor keeps the position of the pointer in raw data
     int err;                    ///< This shows the last error code after any operation on the context
+    unsigned int flags;         ///< Options of the context (a combination of SDNS_CTX_* macros)
+    sdns_arena * arena;         ///< Arena allocator of the message (only used with ::SDNS_CTX_ARENA)
+    unsigned int heap_rrs;      ///< Number of RRs in the message that are not (fully) allocated from the arena
+    uint8_t pending;            ///< Sections not decoded yet (bit 1 << DNS_SECTION_*), only used with ::SDNS_CTX_LAZY
+    uint16_t section_offset[4]; ///< Start of each section in raw (index is DNS_SECTION_*, 0 if unknown)
+    struct _sdns_name_memo * memo;  ///< Decoded name suffixes of raw by their offset (internal)
+    struct _sdns_compress_table * compress; ///< Labels written by sdns_to_wire() for name compression (internal)
+    struct _sdns_qname_wire * qname_wire;   ///< The question name copied from the query by sdns_make_response() (internal)
+    const sdns_allocator * allocator;       ///< Allocator of the arena and the internal tables, NULL is the one of sdns_set_allocator() (see sdns_context_set_allocator())
 }sdns_context;
 
+/** Walks the RRs of all the sections of a context in order (see sdns_iter_begin()). */
+typedef struct {
+    sdns_context * ctx;         ///< The context we walk
+    uint32_t at;                ///< Start of the next RR in the raw buffer
+    uint16_t left[3];           ///< Number of RRs not seen yet in answer, authority and additional sections
+} sdns_rr_iter;
+
+/**
+ * @brief Writes a DNS packet directly to a buffer without an ::sdns_message (see sdns_writer_begin()).
+ */
+typedef struct {
+    sdns_context * ctx;         ///< Keeps the labels we wrote for name compression (can be reused for many packets)
+    char * buff;                ///< The buffer of the packet
+    uint16_t buff_len;          ///< Size of the buffer
+    uint16_t len;               ///< Length of the packet written so far
+    uint16_t qdcount;           ///< Number of questions written so far
+    uint16_t count[3];          ///< Number of RRs written to answer, authority and additional sections
+    int section;                ///< The last section we wrote to (the sections are written in order)
+}sdns_writer;
+
+/**
+ * @brief A response in wire format that is sent for many queries (see sdns_template_create()).
+ */
+typedef struct {
+    char * raw;                 ///< The packet
+    uint16_t raw_len;           ///< Length of the packet
+    uint16_t qname_len;         ///< Length of the question name (it starts right after the header)
+    uint16_t opt_offset;        ///< Start of the OPT RR (always the last RR) or 0 if there is no OPT RR
+    uint16_t ttl_count;         ///< Number of entries in **ttl_offset**
+    uint16_t * ttl_offset;      ///< Offset of the TTL of each RR (except OPT) in the packet
+}sdns_template;
+
+/**
+ * @brief One packet of sdns_to_wire_batch(). It has the fields of struct iovec (sys/uio.h) in the same order.
+ */
+typedef struct {
+    void * iov_base;            ///< Start of the packet
+    size_t iov_len;             ///< Length of the packet
+}sdns_iovec;
+
 
 
 // list of function declarations
@@ -746,6 +914,24 @@ typedef struct {
 int sdns_make_query(sdns_context * ctx, sdns_rr_type qtype,
                      sdns_q_class cls, char * qname, int enable_edns0);
 
+/**
+ * @brief Makes the response of a query we received from the wire.
+ * @param ctx A pointer to the ::sdns_context structure created by sdns_init_context()
+ * @param query The query created by sdns_from_wire() (or sdns_from_network()).
+ *
+ * The header is the header of a query (like sdns_make_query()) with QR=1 and the ID, opcode, RD and CD
+ * of the query. The question is the question of the query: the name is copied from the raw bytes of the
+ * query (the case of the letters is kept) and sdns_to_wire() writes these bytes and compresses the names
+ * of the RRs to it without encoding the question again. If the query has an OPT RR, the response has an
+ * empty OPT RR with the same DO bit. The other sections are empty.
+ *
+ * question.qname of **ctx** is set too. If you change it, sdns_to_wire() encodes the new name.
+ *
+ * @return 0 on success. ::SDNS_ERROR_NO_QUESTION_FOUND if **query** does not have its raw bytes
+ * or its question.
+ */
+int sdns_make_response(sdns_context * ctx, sdns_context * query);
+
 
 
 /**
@@ -762,6 +948,242 @@ int sdns_make_query(sdns_context * ctx, sdns_rr_type qtype,
  */
 int sdns_to_wire(sdns_context * ctx);
 
+/**
+ * @brief Converts a DNS context to binary format that is not longer than max_size bytes.
+ * @param ctx A pointer to DNS context created by sdns_init_context().
+ * @param max_size Maximum size of the packet (e.g., sdns_max_udp_response() of the query). 0 means no limit.
+ *
+ * Same as sdns_to_wire() but the RRs are written in order until the packet is full. The RRset
+ * that does not fit is dropped completely with all the RRs after it, so the additional section is dropped
+ * first, then the authority. If an RRset of the answer section is dropped, the TC bit is set in the packet.
+ * The OPT RR is always kept. The counts of the header of the packet are the RRs we really wrote, the
+ * message of the context is not changed.
+ *
+ * @return 0 on success, ::SDNS_ERROR_BUFFER_IS_SMALL if the header, the question and the OPT RR
+ * do not fit in max_size or other values for failure.
+ */
+int sdns_to_wire_limit(sdns_context * ctx, uint16_t max_size);
+
+/**
+ * @brief Returns the maximum size of the UDP response to the query.
+ * @param query A pointer to the DNS context of the query.
+ *
+ * @return the UDP payload size of the OPT RR of the query or 512 if it has no OPT RR (or a smaller size).
+ */
+uint16_t sdns_max_udp_response(sdns_context * query);
+
+/**
+ * @brief Converts a DNS context to binary format in a buffer of the caller.
+ * @param ctx A pointer to DNS context created by sdns_init_context().
+ * @param buff The buffer that receives the packet.
+ * @param buff_len Size of the buffer.
+ * @param len Receives the length of the packet.
+ *
+ * Same as sdns_to_wire() but the packet is written directly to **buff** and nothing is allocated
+ * for it. ctx->raw is not changed. sdns_wire_size_estimate() gives a size that is always enough.
+ * With ::SDNS_CTX_TRUNCATE, the packet is truncated to buff_len like sdns_to_wire_limit().
+ *
+ * @return 0 on success, ::SDNS_ERROR_BUFFER_IS_SMALL if the packet does not fit in the buffer (the content of
+ * the buffer is not valid then) or other values for failure.
+ */
+int sdns_to_wire_into(sdns_context * ctx, char * buff, uint16_t buff_len, uint16_t * len);
+
+/**
+ * @brief Converts many DNS contexts to binary format in one buffer.
+ * @param ctx Array of the contexts.
+ * @param n Number of the contexts.
+ * @param out Array of **n** entries that receives the packet of each context.
+ * @param arena The arena that the buffer of the packets is allocated from (see sdns_arena_init()).
+ *
+ * The packets are written one after the other to one buffer allocated from **arena** (::UDP_PAYLOAD_SIZE bytes
+ * for each context, a bigger packet gets its own buffer) and out[i] is the packet of ctx[i], ready for
+ * sendmmsg() or writev(). They are valid until the arena is reset or freed.
+ * ctx->raw is not changed. All the contexts use the same compression table, so there is no per-packet
+ * setup like sdns_to_wire(). ::SDNS_CTX_TRUNCATE is not used here (see sdns_to_wire_into()).
+ *
+ * @return 0 on success or the error of the first context that can not be encoded. Its entry in **out**
+ * and the ones after it are empty.
+ */
+int sdns_to_wire_batch(sdns_context ** ctx, unsigned int n, sdns_iovec * out, sdns_arena * arena);
+
+/**
+ * @brief Returns an upper bound of the size of the packet sdns_to_wire() creates from the context.
+ * @param ctx A pointer to DNS context created by sdns_init_context().
+ *
+ * The names are counted without compression, so the real packet is usually smaller. sdns_to_wire()
+ * uses it to allocate the whole packet at once.
+ *
+ * @return the size in bytes or 0 if the context has no message.
+ */
+unsigned long int sdns_wire_size_estimate(sdns_context * ctx);
+
+/**
+ * @brief Starts writing a packet directly to a buffer of the caller.
+ * @param w The writer to initialize.
+ * @param ctx A DNS context created by sdns_init_context(). Only its name compression table is used, so
+ * one context can be used for many packets.
+ * @param buff The buffer that receives the packet.
+ * @param buff_len Size of the buffer.
+ * @param header The header of the packet. The counts are ignored, sdns_writer_end() writes them.
+ *
+ * The writer is the fast way to build a response: the records are written to **buff** with name
+ * compression as they are added and nothing is allocated for them. The order of the calls is
+ * sdns_writer_begin(), sdns_writer_question(), sdns_writer_add_*() for the answer, authority and
+ * additional sections (in this order) and sdns_writer_end().
+ *
+ * If a record does not fit in the buffer, the add function returns ::SDNS_ERROR_BUFFER_IS_SMALL and
+ * nothing of the record is kept, so the packet is still valid after sdns_writer_end().
+ *
+ * @code
+ * char buff[512];
+ * uint16_t len;
+ * sdns_writer w;
+ * sdns_writer_begin(&w, ctx, buff, sizeof(buff), &query->msg->header);
+ * sdns_writer_question(&w, "example.com", sdns_rr_type_A, sdns_q_class_IN);
+ * sdns_writer_add_A(&w, DNS_SECTION_ANSWER, "example.com", 300, 0x01020304);
+ * sdns_writer_end(&w);
+ * // the packet is w.len bytes of buff
+ * @endcode
+ *
+ * @return 0 on success or other values for failure.
+ */
+int sdns_writer_begin(sdns_writer * w, sdns_context * ctx, char * buff, uint16_t buff_len, sdns_header * header);
+
+/**
+ * @brief Writes a question to the packet. Questions must be written before any RR.
+ * @param w The writer initialized by sdns_writer_begin().
+ * @param qname The question name.
+ * @param qtype Type of the question.
+ * @param qclass Class of the question.
+ *
+ * @return 0 on success or other values for failure.
+ */
+int sdns_writer_question(sdns_writer * w, char * qname, uint16_t qtype, uint16_t qclass);
+
+/**
+ * @brief Writes an A record to a section of the packet.
+ * @param w The writer initialized by sdns_writer_begin().
+ * @param section One of ::DNS_SECTION_ANSWER, ::DNS_SECTION_AUTHORITY or ::DNS_SECTION_ADDITIONAL.
+ * @param name Owner name of the record.
+ * @param ttl TTL of the record.
+ * @param address IPv4 address (like ::sdns_rr_A, e.g., 0x01020304 for 1.2.3.4).
+ *
+ * The other sdns_writer_add_*() functions take the same first four parameters and the rdata of their type.
+ *
+ * @return 0 on success, ::SDNS_ERROR_BUFFER_IS_SMALL if the record does not fit in the buffer,
+ * ::SDNS_ERROR_WRONG_INPUT_PARAMETER if the section is before the section of the last record or
+ * other values for failure.
+ */
+int sdns_writer_add_A(sdns_writer * w, int section, char * name, uint32_t ttl, uint32_t address);
+
+/** @brief Writes an AAAA record (**address** is 16 bytes), see sdns_writer_add_A(). */
+int sdns_writer_add_AAAA(sdns_writer * w, int section, char * name, uint32_t ttl, char * address);
+
+/** @brief Writes an NS record, see sdns_writer_add_A(). */
+int sdns_writer_add_NS(sdns_writer * w, int section, char * name, uint32_t ttl, char * nsdname);
+
+/** @brief Writes a CNAME record, see sdns_writer_add_A(). */
+int sdns_writer_add_CNAME(sdns_writer * w, int section, char * name, uint32_t ttl, char * cname);
+
+/** @brief Writes a PTR record, see sdns_writer_add_A(). */
+int sdns_writer_add_PTR(sdns_writer * w, int section, char * name, uint32_t ttl, char * ptrdname);
+
+/** @brief Writes an MX record, see sdns_writer_add_A(). */
+int sdns_writer_add_MX(sdns_writer * w, int section, char * name, uint32_t ttl, uint16_t preference, char * exchange);
+
+/** @brief Writes an SOA record (same order of the parameters as sdns_add_rr_authority_SOA()), see sdns_writer_add_A(). */
+int sdns_writer_add_SOA(sdns_writer * w, int section, char * name, uint32_t ttl, char * mname, char * rname,
+                        uint32_t expire, uint32_t minimum, uint32_t refresh, uint32_t retry, uint32_t serial);
+
+/**
+ * @brief Writes a TXT record, see sdns_writer_add_A().
+ *
+ * **text** is split to character-strings of 255 bytes like sdns_add_rr_answer_TXT().
+ */
+int sdns_writer_add_TXT(sdns_writer * w, int section, char * name, uint32_t ttl, char * text, uint16_t text_len);
+
+/**
+ * @brief Writes an OPT record (without options) to the additional section.
+ * @param w The writer initialized by sdns_writer_begin().
+ * @param udp_size The UDP payload size.
+ * @param DO The DNSSEC OK bit.
+ *
+ * @return 0 on success or other values for failure.
+ */
+int sdns_writer_add_OPT(sdns_writer * w, uint16_t udp_size, uint8_t DO);
+
+/**
+ * @brief Writes a record of any type with its rdata already in wire format, see sdns_writer_add_A().
+ *
+ * The names in **rdata** are written as they are (not compressed).
+ */
+int sdns_writer_add_rr(sdns_writer * w, int section, char * name, uint16_t type, uint16_t cls, uint32_t ttl,
+                       char * rdata, uint16_t rdlength);
+
+/**
+ * @brief Finishes the packet: writes the number of questions and RRs to the header.
+ * @param w The writer initialized by sdns_writer_begin().
+ *
+ * The packet is the first w->len bytes of the buffer.
+ *
+ * @return 0 on success or other values for failure.
+ */
+int sdns_writer_end(sdns_writer * w);
+
+/**
+ * @brief Creates a template from the response in a DNS context.
+ * @param ctx A pointer to the DNS context of the response (with exactly one question).
+ *
+ * The response is converted to binary format once. sdns_template_render() then creates the response
+ * to a query by copying the packet and changing the ID, the RD and CD bits and the question name (so the
+ * case of the name of the query is kept). The OPT RR is moved to the end of the packet so that it can
+ * be removed for queries without EDNS. The context is not changed and can be freed after this call.
+ *
+ * @code
+ * sdns_template * t = sdns_template_create(response);
+ * // for each query received in buff
+ * if (sdns_template_render(t, buff, received, out, sizeof(out), &len) == 0)
+ *     sendto(socketfd, out, len, ......);
+ * @endcode
+ *
+ * @return the template or NULL on failure (the error code is in ctx->err). Free it with sdns_template_free().
+ */
+sdns_template * sdns_template_create(sdns_context * ctx);
+
+/**
+ * @brief Frees a template created by sdns_template_create().
+ * @param t The template.
+ */
+void sdns_template_free(sdns_template * t);
+
+/**
+ * @brief Changes the TTL of the RRs of a template.
+ * @param t The template.
+ * @param index Index of the RR in the packet (OPT is not counted) or -1 for all the RRs.
+ * @param ttl The new TTL.
+ *
+ * @return 0 on success or ::SDNS_ERROR_WRONG_INPUT_PARAMETER if there is no such RR.
+ */
+int sdns_template_set_ttl(sdns_template * t, int index, uint32_t ttl);
+
+/**
+ * @brief Writes the response of a template for a query.
+ * @param t The template.
+ * @param query The raw bytes of the query.
+ * @param query_len Length of the query.
+ * @param out The buffer that receives the response.
+ * @param out_len Size of **out**.
+ * @param len Receives the length of the response.
+ *
+ * The query must be a standard query (QR=0, opcode=0) and its question must be the same as the question
+ * of the template (the case of the name can be different). The rest of the query is only read to find
+ * out if it has an OPT RR.
+ *
+ * @return 0 on success, ::SDNS_ERROR_WRONG_INPUT_PARAMETER if the template does not answer the query,
+ * ::SDNS_ERROR_BUFFER_IS_SMALL if **out** is too small or other values for failure.
+ */
+int sdns_template_render(sdns_template * t, char * query, uint16_t query_len, char * out, uint16_t out_len, uint16_t * len);
+
 
 /**
  * @brief Converts the raw data received from socket (bytes) to a DNS packet.
@@ -794,6 +1216,134 @@ int sdns_to_wire(sdns_context * ctx);
 int sdns_from_wire(sdns_context * ctx);
 
 
+/**
+ * @brief Decodes a section of a packet parsed with ::SDNS_CTX_LAZY.
+ * @param ctx A pointer to the DNS context parsed by sdns_from_wire().
+ * @param section One of ::DNS_SECTION_ANSWER, ::DNS_SECTION_AUTHORITY or ::DNS_SECTION_ADDITIONAL.
+ *
+ * In lazy mode, ctx->msg->answer, authority and additional are NULL until their section is decoded.
+ * The library functions (sdns_get_answer(), sdns_section_rr(), sdns_to_wire(), etc.) call this function
+ * themselves; you only need it if you read the sections directly. The sections before the requested one
+ * are only skipped (not decoded) if they are still pending.
+ *
+ * Calling this function for a section that is already decoded (or without lazy mode) does nothing.
+ *
+ * @return sdns_rcode_NoError on success, the error of decoding the section on failure.
+ */
+int sdns_decode_section(sdns_context * ctx, int section);
+
+
+/**
+ * @brief Reads the header of a DNS packet without creating a context.
+ * @param buff The raw bytes of the DNS packet.
+ * @param buff_len Length of **buff**.
+ * @param header A pointer to the header structure to fill.
+ *
+ * Nothing is allocated and only the first 12 bytes of the packet are read.
+ *
+ * @return sdns_rcode_NoError on success, SDNS_ERROR_BUFFER_IS_NULL or SDNS_ERROR_INVALID_DNS_PACKET on failure.
+ */
+int sdns_peek_header(char * buff, uint16_t buff_len, sdns_header * header);
+
+
+/**
+ * @brief Reads the question section of a DNS packet without creating a context.
+ * @param buff The raw bytes of the DNS packet.
+ * @param buff_len Length of **buff**.
+ * @param question A pointer to the question structure to fill.
+ * @param qname A buffer of at least ::SDNS_NAME_BUFFER_SIZE bytes for the decoded name or NULL.
+ *
+ * Nothing is allocated: question->qname points to **qname** (or it's NULL if **qname** is NULL, in which case
+ * you only get qname_offset, qname_len and qname_hash). The header, the name, qtype and qclass are validated the same
+ * way sdns_from_wire() does, but the rest of the packet is not read at all. question->qname_hash is always
+ * computed (see sdns_name_hash()).
+ *
+ * ~~~~~~~~~~~~~~~~{.c}
+ * sdns_question q;
+ * char qname[SDNS_NAME_BUFFER_SIZE];
+ * if (sdns_peek_question(buff, received, &q, qname) == sdns_rcode_NoError)
+ *     route_packet(q.qname, q.qtype);
+ * ~~~~~~~~~~~~~~~~
+ *
+ * @return sdns_rcode_NoError on success, an error code on failure (e.g., SDNS_ERROR_NO_QUESTION_FOUND).
+ */
+int sdns_peek_question(char * buff, uint16_t buff_len, sdns_question * question, char * qname);
+
+
+/**
+ * @brief Checks the structure of a whole DNS packet in one pass without allocating memory.
+ * @param buff The raw bytes of the DNS packet.
+ * @param buff_len Length of **buff**.
+ * @param layout Where each section starts and how many RRs we have (can be NULL).
+ * @param spans A table to fill with the position of each RR in order (can be NULL).
+ * @param spans_len Number of entries in **spans**. Only the first **spans_len** RRs are written.
+ *
+ * The function checks the header, the question, all the names (label length, total length and
+ * compression pointers, same as sdns_from_wire()) and makes sure the fixed part and the rdata
+ * of each RR are inside the buffer. The content of the rdata, types and classes are not checked.
+ *
+ * It's a lot cheaper than sdns_from_wire() when you only need to know if a packet is well-formed.
+ *
+ * @return sdns_rcode_NoError if the packet is well-formed, an error code otherwise.
+ */
+int sdns_scan_message(char * buff, uint16_t buff_len, sdns_message_layout * layout,
+                      sdns_rr_span * spans, uint32_t spans_len);
+
+/**
+ * @brief Changes the ID of a DNS packet in place.
+ * @param buff The raw bytes of the DNS packet.
+ * @param buff_len Length of **buff**.
+ * @param id The new ID.
+ *
+ * @return sdns_rcode_NoError on success, SDNS_ERROR_BUFFER_IS_NULL or SDNS_ERROR_INVALID_DNS_PACKET on failure.
+ */
+int sdns_patch_id(char * buff, uint16_t buff_len, uint16_t id);
+
+/**
+ * @brief Changes the flags of the header of a DNS packet in place.
+ * @param buff The raw bytes of the DNS packet.
+ * @param buff_len Length of **buff**.
+ * @param mask The bits to change (a combination of SDNS_*_MASK macros, e.g., ::SDNS_RA_MASK | ::SDNS_TC_MASK).
+ * @param flags The new value of the bits in **mask** (the other bits are ignored).
+ *
+ * @code
+ * // RA=1 and AA=0
+ * sdns_patch_flags(buff, len, SDNS_RA_MASK | SDNS_AA_MASK, SDNS_RA_MASK);
+ * @endcode
+ *
+ * @return sdns_rcode_NoError on success, SDNS_ERROR_BUFFER_IS_NULL or SDNS_ERROR_INVALID_DNS_PACKET on failure.
+ */
+int sdns_patch_flags(char * buff, uint16_t buff_len, uint16_t mask, uint16_t flags);
+
+/**
+ * @brief Decreases the TTL of all the RRs of a DNS packet in place (e.g., by the time the packet was in a cache).
+ * @param buff The raw bytes of the DNS packet.
+ * @param buff_len Length of **buff**.
+ * @param elapsed The value to subtract from each TTL. A TTL smaller than it becomes 0.
+ * @param min_ttl Receives the smallest TTL after the change (0 if the packet has no RR). Can be NULL.
+ *
+ * The packet is not decoded: the names are only skipped (compression pointers are not followed) to find
+ * the fixed part of each RR. The TTL of the OPT RR is not changed. The packet is changed up to the RR
+ * that is malformed, so it's better to check the packet once (e.g., sdns_scan_message()) before you cache it.
+ *
+ * @return sdns_rcode_NoError on success, an error code if the packet is malformed.
+ */
+int sdns_patch_ttl(char * buff, uint16_t buff_len, uint32_t elapsed, uint32_t * min_ttl);
+
+/**
+ * @brief Changes the UDP payload size of the OPT RR of a DNS packet in place.
+ * @param buff The raw bytes of the DNS packet.
+ * @param buff_len Length of **buff**.
+ * @param udp_size The new UDP payload size.
+ *
+ * The RRs are walked the same way as sdns_patch_ttl().
+ *
+ * @return sdns_rcode_NoError on success, ::SDNS_ERROR_NO_ADDITIONAL_FOUND if the packet has no OPT RR or
+ * an error code if the packet is malformed.
+ */
+int sdns_patch_udp_size(char * buff, uint16_t buff_len, uint16_t udp_size);
+
+
 /**
  * @brief Coverts error codes to a string
  * @param err the error code you received from one of the functions or any DNS defined error.
@@ -813,12 +1363,33 @@ void sdns_error_string(int err, char ** err_buff);
  *
  * This function is responsible for creating a new context for DNS.
  *
- * For **each** DNS packet, you **must** create a new context. This function does nothing
- * more than creating a structure and allocating the necessary memories.
+ * For **each** DNS packet, you **must** create a new context (or reuse one by sdns_context_reset()).
+ * This function does nothing more than creating a structure and allocating the necessary memories.
+ *
+ * @return A new context or NULL if we can not allocate memory.
  */
 sdns_context * sdns_init_context(void);
 
 
+/**
+ * @brief Sets the allocator of the memory that only this context uses.
+ * @param ctx A pointer to the context created by sdns_init_context().
+ * @param allocator The allocator, NULL goes back to the one of sdns_set_allocator().
+ *
+ * The arena (::SDNS_CTX_ARENA), the section indexes, the name cache and the compression table
+ * of the context come from **allocator**, so a thread can keep them in its own pool. The message,
+ * the RRs outside the arena and the buffers returned to the caller (e.g., sdns_to_network()) still
+ * use the allocator of the library as they can be moved between contexts.
+ *
+ * Call it right after sdns_init_context(), before the context allocates anything. **allocator** is
+ * not copied and must be valid until sdns_free_context().
+ *
+ * @return 0 on success, ::SDNS_ERROR_WRONG_INPUT_PARAMETER if the context already has some memory of
+ * the old allocator or only some of the functions are given.
+ */
+int sdns_context_set_allocator(sdns_context * ctx, const sdns_allocator * allocator);
+
+
 /**
  * @brief Frees the context allocated by sdns_init_context().
  * @param ctx A pointer to the context.
@@ -830,6 +1401,190 @@ sdns_context * sdns_init_context(void);
 void sdns_free_context(sdns_context* ctx);
 
 
+/**
+ * @brief Makes the context ready for the next packet without freeing it.
+ * @param ctx A pointer to the DNS context created by sdns_init_context().
+ *
+ * This function frees the current message (all the sections and RRs) but keeps the context,
+ * the message structure, the arena chunks (::SDNS_CTX_ARENA) and the **raw** buffer, so one context
+ * can be used for many packets without allocating memory for each one. **flags** is not changed.
+ *
+ * If **raw** points to your own buffer, set it to NULL before calling this function (same as sdns_free_context())
+ * or use ::SDNS_CTX_BORROWED, then the function sets it to NULL for you.
+ *
+ * ~~~~~~~~~~~~~~~~{.c}
+ * sdns_context * ctx = sdns_init_context();
+ * ctx->flags |= SDNS_CTX_ARENA;
+ * while (1){
+ *     sdns_context_reset(ctx);
+ *     ctx->raw = buffer;
+ *     ctx->raw_len = recv(sockfd, buffer, 65535, 0);
+ *     if (sdns_from_wire(ctx) == sdns_rcode_NoError){
+ *         // do something with ctx->msg
+ *     }
+ *     ctx->raw = NULL;
+ * }
+ * sdns_free_context(ctx);
+ * ~~~~~~~~~~~~~~~~
+ */
+void sdns_context_reset(sdns_context * ctx);
+
+/**
+ * @brief Makes the context own its raw buffer (see ::SDNS_CTX_BORROWED).
+ * @param ctx A pointer to the DNS context.
+ *
+ * The raw bytes are copied to a buffer of the context and everything that refers to the buffer of the
+ * caller (the rdata of the RRs that are not decoded yet, the cursor) is moved to the copy. After this call,
+ * the buffer of the caller can be reused or freed. Nothing happens if the context already owns **raw**.
+ *
+ * @return 0 on success, ::SDNS_ERROR_MEMORY_ALLOC_FAILED on failure (the context still borrows the buffer then).
+ */
+int sdns_context_detach(sdns_context * ctx);
+
+
+/**
+ * @brief Returns an RR of a section by its position in O(1).
+ * @param ctx A pointer to the DNS context created by sdns_init_context().
+ * @param section One of ::DNS_SECTION_ANSWER, ::DNS_SECTION_AUTHORITY or ::DNS_SECTION_ADDITIONAL.
+ * @param num The position of the RR in the section (starts from 0).
+ *
+ * The returned RR belongs to the context (do not free it). Unlike sdns_get_answer() and friends,
+ * this function does not copy or decode anything.
+ *
+ * @return A pointer to the RR or NULL if there is no such RR.
+ */
+sdns_rr * sdns_section_rr(sdns_context * ctx, int section, uint16_t num);
+
+/**
+ * @brief Starts to walk the RRs of the raw buffer of a context without decoding or allocating anything.
+ * @param ctx A context that has its raw buffer (e.g., after sdns_from_wire()).
+ * @param it The iterator to initialize.
+ *
+ * The RRs are read from **raw** (not from the message, changes to ctx->msg are not seen). It works the same
+ * with ::SDNS_CTX_LAZY and ::SDNS_CTX_NAME_VIEW, the sections are not decoded.
+ *
+ * ~~~~~~~~~~~~~~~~{.c}
+ * sdns_rr_iter it;
+ * sdns_rr_view rr;
+ * uint32_t ip;
+ * sdns_iter_begin(ctx, &it);
+ * while (sdns_iter_next(&it, &rr) == 1){
+ *     if (rr.section == DNS_SECTION_ANSWER && sdns_view_A(&rr, &ip) == sdns_rcode_NoError)
+ *         use_ip(ip);
+ * }
+ * ~~~~~~~~~~~~~~~~
+ *
+ * @return sdns_rcode_NoError on success, ::SDNS_ERROR_BUFFER_IS_NULL if the context has no raw buffer
+ * or an error code if the question is malformed.
+ */
+int sdns_iter_begin(sdns_context * ctx, sdns_rr_iter * it);
+
+/**
+ * @brief Reads the next RR of the iterator (see sdns_iter_begin()).
+ * @param it The iterator.
+ * @param view Receives the RR.
+ *
+ * The owner name and rdata are only skipped, use sdns_view_name() and sdns_view_*() to read them.
+ *
+ * @return 1 if **view** has the next RR, 0 if there are no more RRs or an error code if the RR is malformed.
+ */
+int sdns_iter_next(sdns_rr_iter * it, sdns_rr_view * view);
+
+/**
+ * @brief Decodes the owner name of an RR view.
+ * @param ctx The context of the view.
+ * @param view The RR view.
+ * @param name A buffer of at least ::SDNS_NAME_BUFFER_SIZE bytes for the name.
+ *
+ * @return sdns_rcode_NoError on success or an error code if the name is malformed.
+ */
+int sdns_view_name(sdns_context * ctx, const sdns_rr_view * view, char * name);
+
+/**
+ * @brief Reads the address of an A RR view.
+ * @param view The RR view.
+ * @param address Receives the IPv4 address (the same value as sdns_rr_A::address).
+ *
+ * @return sdns_rcode_NoError on success, ::SDNS_ERROR_WRONG_INPUT_PARAMETER if it's not an A RR or
+ * ::SDNS_ERROR_RR_SECTION_MALFORMED if the rdata is not 4 bytes.
+ */
+int sdns_view_A(const sdns_rr_view * view, uint32_t * address);
+
+/**
+ * @brief Copies the address of an AAAA RR view.
+ * @param view The RR view.
+ * @param address A buffer of 16 bytes for the IPv6 address.
+ *
+ * @return sdns_rcode_NoError on success, ::SDNS_ERROR_WRONG_INPUT_PARAMETER if it's not an AAAA RR or
+ * ::SDNS_ERROR_RR_SECTION_MALFORMED if the rdata is not 16 bytes.
+ */
+int sdns_view_AAAA(const sdns_rr_view * view, char * address);
+
+/**
+ * @brief Decodes the domain name in the rdata of an RR view.
+ * @param ctx The context of the view.
+ * @param view The RR view (NS, CNAME, PTR, DNAME, MX or SRV).
+ * @param name A buffer of at least ::SDNS_NAME_BUFFER_SIZE bytes for the name.
+ *
+ * The name is the NSDNAME of NS, CNAME of CNAME, PTRDNAME of PTR, target of DNAME and SRV and exchange of MX.
+ * Use the first two bytes of the rdata for the preference of MX.
+ *
+ * @return sdns_rcode_NoError on success, ::SDNS_ERROR_WRONG_INPUT_PARAMETER for the other types
+ * or an error code if the rdata is malformed.
+ */
+int sdns_view_target(sdns_context * ctx, const sdns_rr_view * view, char * name);
+
+/**
+ * @brief Finds the character-strings of a TXT RR view.
+ * @param view The RR view.
+ * @param spans An array of **max** spans to fill (can be NULL if **max** is 0).
+ * @param max The number of spans we have in **spans**.
+ * @param count Receives the number of character-strings of the RR.
+ *
+ * The spans are offsets into view->rdata (see ::sdns_txt_span), nothing is copied or allocated.
+ * If the RR has more than **max** strings, the first **max** ones are filled and **count** still
+ * has the number of all of them, so calling it with **max**=0 just counts the strings.
+ *
+ * @return sdns_rcode_NoError on success, ::SDNS_ERROR_BUFFER_TOO_SHORT if **max** is less than **count**,
+ * ::SDNS_ERROR_WRONG_INPUT_PARAMETER if it's not a TXT RR or ::SDNS_ERROR_RR_SECTION_MALFORMED.
+ */
+int sdns_view_TXT(const sdns_rr_view * view, sdns_txt_span * spans, uint16_t max, uint16_t * count);
+
+
+/**
+ * @brief Finds the character-strings of a TXT RR without decoding it
+ * @param ctx A pointer to the DNS context the RR belongs to
+ * @param rr A TXT RR that is not decoded (rr->rdata points to the raw buffer)
+ * @param spans An array of **max** spans to fill (can be NULL if **max** is 0).
+ * @param max The number of spans we have in **spans**.
+ * @param count Receives the number of character-strings of the RR.
+ *
+ * This is the flat form of sdns_decode_rr_TXT(): the spans are offsets into rr->rdata (see ::sdns_txt_span)
+ * and nothing is allocated. It works the same as sdns_view_TXT().
+ *
+ * @return sdns_rcode_NoError on success, ::SDNS_ERROR_BUFFER_TOO_SHORT if **max** is less than **count**,
+ * ::SDNS_ERROR_WRONG_INPUT_PARAMETER if it's not an undecoded TXT RR or ::SDNS_ERROR_RR_SECTION_MALFORMED.
+ */
+int sdns_txt_spans(sdns_context * ctx, sdns_rr * rr, sdns_txt_span * spans, uint16_t max, uint16_t * count);
+
+/**
+ * @brief Copies all the character-strings of a TXT RR to one buffer
+ * @param ctx A pointer to the DNS context the RR belongs to
+ * @param rr A TXT RR (decoded or not)
+ * @param buffer The buffer that receives the strings one after the other and a NUL at the end
+ * @param buffer_len The size of **buffer**. rr->rdlength bytes is always enough.
+ * @param len Receives the length of the joined string (without the NUL)
+ *
+ * This is how SPF, DKIM and most of the other TXT records are read (RFC7208#section-3.3).
+ * If **buffer** is too short, **len** still has the length we need.
+ *
+ * @return sdns_rcode_NoError on success, ::SDNS_ERROR_BUFFER_TOO_SHORT if **buffer** is too short,
+ * ::SDNS_ERROR_CHARACTER_STRING_TOO_LONG if the strings of a decoded RR are more than 65535 bytes
+ * or the error code of sdns_txt_spans().
+ */
+int sdns_txt_join(sdns_context * ctx, sdns_rr * rr, char * buffer, uint32_t buffer_len, uint16_t * len);
+
+
 /**
  * @brief Creates an answer section for the DNS packet
  * @param ctx A pointer to the DNS context created by sdns_init_context().
@@ -963,6 +1718,7 @@ sdns_message * sdns_init_message(void);
  * One can use this method to add a resource record to a DNS packet that is not supported by 
  * this library. For all RRs that this library support, we have a sdns_init_rr_*() function.
  * If you have a new type to add, you can use this method to create it.
+ * For A, AAAA, L32, L64 and NID, the RR has room for its rdata (see sdns_rr_inline_rdata()).
  *
  * @return an instance of ::sdns_rr structure on success. NULL on fail.
  */
@@ -1426,6 +2182,99 @@ int sdns_convert_type_to_int(char * type);
 int sdns_convert_class_to_int(char * cls);
 
 
+/**
+ * @brief Creates an RR that belongs to the message of the given context.
+ * @param ctx A pointer to the DNS context
+ * @param name the name of the RR (the function makes a copy of it, can be NULL)
+ * @param type the type of the resource record
+ * @param class the class of the resource record
+ * @param ttl the ttl of the resource record
+ * @param rdlength the length of the rdata section of this resource record
+ * @param decoded if resource record is decoded (1) or not (0).
+ * @param rdata a pointer to the raw data (if decode = 0) or a structure (decoded =1)
+ *
+ * This is the same as sdns_init_rr() but the RR and its name are allocated from the arena
+ * of the context when ::SDNS_CTX_ARENA is set. The **rdata** is not copied and it's still owned
+ * by the RR (freed with the context if **decoded** is 1).
+ *
+ * @return an instance of ::sdns_rr structure on success. NULL on fail.
+ */
+sdns_rr * sdns_context_init_rr(sdns_context * ctx, char * name, uint16_t type, uint16_t class, uint32_t ttl,
+                               uint16_t rdlength, uint8_t decoded, void * rdata);
+
+
+/**
+ * @brief Uses the inline storage of an RR for its rdata
+ * @param rr A pointer to a resource record of type A, AAAA, L32, L64 or NID
+ *
+ * Points **psdns_rr** to the ::sdns_rr_inline after the RR, marks the RR as decoded and returns the structure to fill
+ * (::sdns_rr_A, ::sdns_rr_AAAA, ::sdns_rr_L32, ::sdns_rr_L64 or ::sdns_rr_NID based on the type of the RR).
+ * The pointer fields of AAAA, L64 and NID already point to its **bytes**, so the caller copies the
+ * bytes there. Nothing is allocated and sdns_free_rr() does not free the rdata.
+ *
+ * @return a pointer to the rdata structure on success, NULL if **rr** is NULL or has no room for the rdata
+ * (it was not created by sdns_init_rr() or sdns_context_init_rr() with one of the types above).
+ */
+void * sdns_rr_inline_rdata(sdns_rr * rr);
+
+
+/**
+ * @brief Decodes the rdata of a fixed-size RR into the RR itself
+ * @param ctx A pointer to the DNS context the RR belongs to
+ * @param rr A pointer to a resource record of type A, AAAA, L32, L64 or NID
+ *
+ * This is the same as sdns_decode_rr_A() (and the other ones) but the result is kept in
+ * the room after the RR (see sdns_rr_inline_rdata()) instead of a new structure. Once it's done, **decoded** is 1 and
+ * **psdns_rr** can be used as if the RR was built by the library. Calling it on an RR that is already
+ * decoded does nothing.
+ *
+ * @return 0 on success or the error code on failure.
+ */
+int sdns_decode_rr_inline(sdns_context * ctx, sdns_rr * rr);
+
+
+/**
+ * @brief Returns the name of a resource record
+ * @param ctx A pointer to the DNS context the RR belongs to
+ * @param rr A pointer to the resource record
+ *
+ * If the context is parsed with ::SDNS_CTX_NAME_VIEW flag, the name is decoded from the
+ * raw buffer the first time this function is called and it's cached in rr->name. Otherwise
+ * this function just returns rr->name.
+ *
+ * The returned pointer belongs to the RR and will be freed by sdns_free_context(). The raw buffer
+ * of the context must be still available when the name is decoded.
+ *
+ * @return a pointer to the name on success, NULL on failure (ctx->err has the error code).
+ */
+char * sdns_get_rr_name(sdns_context * ctx, sdns_rr * rr);
+
+
+/**
+ * @brief Returns the qname of the question section of the context
+ * @param ctx A pointer to the DNS context
+ *
+ * This is the same as sdns_get_rr_name() but for the question section.
+ *
+ * @return a pointer to the qname on success, NULL on failure (ctx->err has the error code).
+ */
+char * sdns_get_qname(sdns_context * ctx);
+
+
+/**
+ * @brief Returns the case-insensitive hash of a domain name
+ * @param name The domain name (e.g., "www.Example.com." or "www.example.com")
+ *
+ * The hash is the 64-bit FNV-1a of the lower-case name with the trailing dot. It's the same value
+ * sdns_from_wire() puts in qname_hash and name_hash (::SDNS_CTX_NAME_HASH) and sdns_peek_question()
+ * puts in qname_hash, so a cache or a block list can use it as a key without hashing the parsed names again.
+ * Only ASCII letters are folded to lower-case.
+ *
+ * @return the hash of the name, 0 if **name** is NULL.
+ */
+uint64_t sdns_name_hash(const char * name);
+
+
 /**
  * @brief free a DNS resource record no matter of the type
  * @param rr a pointer to the memory of ::sdns_rr which holds the resource record section to be freed
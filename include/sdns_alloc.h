@@ -0,0 +1,39 @@
+#include <stddef.h>
+
+#ifndef SDNS_ALLOC_H
+#define SDNS_ALLOC_H
+
+// the functions every allocation of the library goes through. 'userdata' is the one given to sdns_set_allocator()
+typedef void * (*sdns_malloc_fn)(size_t size, void * userdata);
+typedef void * (*sdns_realloc_fn)(void * ptr, size_t size, void * userdata);
+typedef void (*sdns_free_fn)(void * ptr, void * userdata);
+
+typedef struct {
+    sdns_malloc_fn malloc_fn;
+    sdns_realloc_fn realloc_fn;
+    sdns_free_fn free_fn;
+    void * userdata;
+} sdns_allocator;
+
+// replaces malloc()/realloc()/free() of the library. All NULL goes back to the default ones.
+// call it before using the library: the memory we already have must be freed with the same allocator.
+// 0 on success, fail if only some of the functions are NULL
+int sdns_set_allocator(sdns_malloc_fn malloc_fn, sdns_realloc_fn realloc_fn, sdns_free_fn free_fn, void * userdata);
+// the allocator in use (never NULL)
+const sdns_allocator * sdns_get_allocator(void);
+
+// the library's malloc(), calloc(), realloc(), free() and strdup(). They never abort, NULL means no memory.
+// the memory the library returns to the caller (e.g., sdns_to_network()) must be freed with sdns_free()
+// and the memory the caller gives to the library (e.g., a qname) must come from sdns_malloc() or sdns_strdup().
+void * sdns_malloc(size_t size);
+void * sdns_calloc(size_t n, size_t size);
+void * sdns_realloc(void * ptr, size_t size);
+void sdns_free(void * ptr);
+char * sdns_strdup(const char * s);
+
+// the same with a given allocator (NULL means the allocator of the library)
+void * sdns_malloc_with(const sdns_allocator * allocator, size_t size);
+void * sdns_realloc_with(const sdns_allocator * allocator, void * ptr, size_t size);
+void sdns_free_with(const sdns_allocator * allocator, void * ptr);
+
+#endif
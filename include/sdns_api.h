@@ -24,6 +24,19 @@
  */
 sdns_context * sdns_from_network(char * buff, uint16_t buff_len);
 
+/**
+ * @brief Same as sdns_from_network() but the context refers to the buffer instead of copying it.
+ * @param buff A pointer to the buffer we received the data from socket
+ * @param buff_len an unsigned 16-bit integer showing the size of the buffer
+ *
+ * The context has ::SDNS_CTX_BORROWED, so the buffer must not be changed or freed while the context is
+ * in use. sdns_free_context() does not free the buffer. Call sdns_context_detach() if the context must live
+ * longer than the buffer.
+ *
+ * @return A pointer to ::sdns_context structure on success or NULL on fail
+ */
+sdns_context * sdns_from_network_borrow(char * buff, uint16_t buff_len);
+
 
 /**
  * @brief Converts the dns packet to the binary form ready to be sent by the socket
@@ -717,6 +730,9 @@ sdns_question * sdns_get_question(sdns_context * dns);
  * to make the packet of type response. if the 'query' context is edns0-aware, the response will be 
  * also edns0-aware. Other sections are all empty.
  *
+ * If the query has its raw bytes (it's from sdns_from_network()), the response is made by
+ * sdns_make_response() which copies the question from the wire instead.
+ *
  *
  * @return a new ::sdns_context on success or NULL on failure
  */
@@ -0,0 +1,38 @@
+#ifndef SDNS_ARENA_H
+#define SDNS_ARENA_H
+
+#include <sdns_alloc.h>
+
+#define SDNS_ARENA_CHUNK_SIZE 4096
+
+// one block of memory of the arena. allocations are served from 'data'
+typedef struct _sdns_arena_chunk{
+    struct _sdns_arena_chunk * next;
+    unsigned long int len;
+    unsigned long int used;
+    char data[];
+} sdns_arena_chunk;
+
+typedef struct {
+    sdns_arena_chunk * chunks;      // list of all the chunks (first one is the oldest)
+    sdns_arena_chunk * current;     // the chunk we are allocating from
+    unsigned long int chunk_size;
+    const sdns_allocator * allocator;   // where the chunks come from (NULL is the allocator of the library)
+} sdns_arena;
+
+// creates a new arena, chunk_size=0 means SDNS_ARENA_CHUNK_SIZE
+sdns_arena * sdns_arena_init(unsigned long int chunk_size);
+// the same but the memory comes from 'allocator' (it must be valid until sdns_arena_free())
+sdns_arena * sdns_arena_init_with(unsigned long int chunk_size, const sdns_allocator * allocator);
+// returns 'size' bytes (aligned) from the arena, NULL if we can not allocate memory
+void * sdns_arena_alloc(sdns_arena * arena, unsigned long int size);
+// copies a nul-terminated string to the arena
+char * sdns_arena_strdup(sdns_arena * arena, const char * s);
+// 1 if the pointer is allocated by the arena, 0 otherwise
+int sdns_arena_owns(sdns_arena * arena, const void * p);
+// drops all the allocations but keeps the chunks for later use
+void sdns_arena_reset(sdns_arena * arena);
+// frees all the chunks and the arena itself
+void sdns_arena_free(sdns_arena * arena);
+
+#endif
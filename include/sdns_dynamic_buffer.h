@@ -7,11 +7,17 @@ typedef struct {
     char * buffer;
     unsigned long int len;
     unsigned long int cursor;
+    int fixed;                  // the buffer is not ours and can not grow
+    int failed;                 // an append failed (no memory or no space)
 } dyn_buffer;
 
 // initialize a buffer structure from a given buff, if buff is NULL, creates a new 128 bytes buffer
 dyn_buffer * dyn_buffer_init(char * buff, unsigned long int len, unsigned long int cursor);
+// initialize a buffer structure of the caller on a fixed-size buff that is never reallocated or freed
+void dyn_buffer_init_fixed(dyn_buffer * ctx, char * buff, unsigned long int len);
 int dyn_buffer_append(dyn_buffer * ctx, char * data, unsigned long int data_len);
+// makes sure we can append 'len' more bytes without allocating. 0 on success, fail otherwise
+int dyn_buffer_reserve(dyn_buffer * ctx, unsigned long int len);
 void dyn_buffer_free(dyn_buffer * ctx);
 void dyn_buffer_reset(dyn_buffer * ctx);
 char * dyn_buffer_copy(dyn_buffer * ctx);
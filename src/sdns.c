@@ -11,7 +11,10 @@
 #include <sdns_print.h>
 //compile: gcc -g -o sdns.o dns_utils.c sdns.c neat_print.c dynamic_buffer.c -I. -DLOG_DEBUG -DLOG_INFO && ./sdns.o
 
-static void sdns_free_message(sdns_message * msg);
+static void sdns_free_message(sdns_context * ctx, sdns_message * msg);
+static int _section_index_build(sdns_context * ctx, sdns_rr * head, sdns_section_index * idx);
+static int _section_parts(sdns_message * msg, int section, sdns_rr *** head, sdns_section_index ** idx, uint16_t ** count);
+static void _section_index_reset(sdns_section_index * idx);
 
 /****************end of static functions declaration************/
 
@@ -102,7 +105,225 @@ static inline int read_buffer(char * buf, char * upper_bound, uint8_t num_bytes,
 }
 
 
-static int decode_name(sdns_context * ctx, char ** decoded_name){
+// returns the arena of the context (creates it if necessary) or NULL if the arena is disabled
+static sdns_arena * _ctx_arena(sdns_context * ctx){
+    if (!(ctx->flags & SDNS_CTX_ARENA))
+        return NULL;
+    if (NULL == ctx->arena)
+        ctx->arena = sdns_arena_init_with(0, ctx->allocator);
+    return ctx->arena;
+}
+
+// the memory that only the context uses (memo, compression table, indexes) comes from its allocator
+static void * _ctx_malloc(sdns_context * ctx, size_t size){
+    return sdns_malloc_with(ctx->allocator, size);
+}
+
+static void _ctx_free(sdns_context * ctx, void * ptr){
+    sdns_free_with(ctx->allocator, ptr);
+}
+
+// copies the string to the context arena or to the heap if the arena is disabled
+static char * _ctx_strdup(sdns_context * ctx, const char * s){
+    sdns_arena * arena = _ctx_arena(ctx);
+    return arena == NULL?safe_strdup(s):sdns_arena_strdup(arena, s);
+}
+
+// the types that have a sdns_rr_inline after their sdns_rr
+static uint8_t _rr_type_is_inline(uint16_t type){
+    return type == sdns_rr_type_A || type == sdns_rr_type_AAAA || type == sdns_rr_type_L32 ||
+           type == sdns_rr_type_L64 || type == sdns_rr_type_NID;
+}
+
+// 1 if psdns_rr is the sdns_rr_inline of the same allocation (not a copy of another RR)
+static int _rr_rdata_is_inline(sdns_rr * rr){
+    return rr->has_inline && rr->decoded && rr->psdns_rr == (void*) (rr + 1);
+}
+
+// FNV-1a (64 bit) over the lower-case text of the name
+#define NAME_HASH_INIT 0xcbf29ce484222325ULL
+#define NAME_HASH_PRIME 0x100000001b3ULL
+
+static inline uint64_t _name_hash_update(uint64_t hash, const char * s, int len){
+    for (int i = 0; i < len; ++i){
+        uint8_t c = (uint8_t) s[i];
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        hash = (hash ^ c) * NAME_HASH_PRIME;
+    }
+    return hash;
+}
+
+// the memo of the decoded names: maps the offset of a label in the raw buffer to the decoded name
+// from that label to the end (the suffix). Compression pointers jump to these offsets all the time.
+#define NAME_MEMO_SLOTS 512     // must be a power of 2
+#define NAME_MEMO_PROBES 8
+#define NAME_MEMO_TEXT_SIZE 4096
+#define NAME_MEMO_NO_TEXT 0xFFFF    // 'text' was full, we only know the suffix is valid
+#define NAME_MEMO_MIN_RRS 8         // small messages are faster without the memo
+
+typedef struct {
+    uint32_t generation;    // the entry is only valid if it's the same as the memo generation
+    uint16_t offset;
+    uint16_t pos;           // position of the suffix in 'text' or NAME_MEMO_NO_TEXT
+    uint16_t len;           // length of the decoded suffix (with the dots)
+    uint16_t max_target;    // the biggest pointer target in the suffix (it must be before the name we decode)
+    uint16_t end;           // one past the last byte we read for the suffix
+    uint8_t jumps;          // number of pointers we follow to decode the suffix
+} _name_memo_slot;
+
+// what we see while decoding one name, to fill the memo at the end
+typedef struct {
+    int labels;
+    uint16_t label_offset[128];     // offset of each label in the raw buffer
+    uint8_t label_pos[128];         // where the label starts in the decoded name
+    uint8_t label_jumps[128];       // number of jumps before reading the label
+    int jumps;
+    uint16_t jump_target[257];      // offset (or the max_target of the memo entry) of each jump
+    uint16_t jump_end[257];         // one past the pointer (or the end of the memo entry)
+    uint8_t jump_labels[257];       // number of labels before the jump
+} _name_trace;
+
+struct _sdns_name_memo{
+    uint32_t generation;
+    uint16_t text_used;
+    _name_trace trace;      // of the name we are decoding now
+    _name_memo_slot slots[NAME_MEMO_SLOTS];
+    char text[NAME_MEMO_TEXT_SIZE];
+};
+
+// forgets all the names (raw buffer is changed). creates the memo if we don't have it
+static void _name_memo_invalidate(sdns_context * ctx, int create){
+    if (NULL == ctx->memo){
+        if (!create)
+            return;
+        // no memo is not an error, we just decode everything
+        ctx->memo = (struct _sdns_name_memo*) _ctx_malloc(ctx, sizeof(struct _sdns_name_memo));
+        if (NULL == ctx->memo)
+            return;
+        // only the slots must be empty, the trace and the text are written before we read them
+        ctx->memo->generation = 0;
+        memset(ctx->memo->slots, 0x00, sizeof(ctx->memo->slots));
+    }
+    ctx->memo->generation += 1;
+    if (ctx->memo->generation == 0){    // wrapped around, old entries may look valid
+        memset(ctx->memo->slots, 0x00, sizeof(ctx->memo->slots));
+        ctx->memo->generation = 1;
+    }
+    ctx->memo->text_used = 0;
+}
+
+static _name_memo_slot * _name_memo_find(struct _sdns_name_memo * memo, uint16_t offset){
+    for (uint16_t i = 0; i < NAME_MEMO_PROBES; ++i){
+        _name_memo_slot * slot = &memo->slots[(offset + i) & (NAME_MEMO_SLOTS - 1)];
+        if (slot->generation != memo->generation)
+            return NULL;
+        if (slot->offset == offset)
+            return slot;
+    }
+    return NULL;
+}
+
+static void _name_memo_add(struct _sdns_name_memo * memo, uint16_t offset, uint16_t pos, uint16_t len,
+                           uint16_t max_target, uint16_t end, uint8_t jumps){
+    for (uint16_t i = 0; i < NAME_MEMO_PROBES; ++i){
+        _name_memo_slot * slot = &memo->slots[(offset + i) & (NAME_MEMO_SLOTS - 1)];
+        if (slot->generation != memo->generation){
+            slot->generation = memo->generation;
+            slot->offset = offset;
+            slot->pos = pos;
+            slot->len = len;
+            slot->max_target = max_target;
+            slot->end = end;
+            slot->jumps = jumps;
+            return;
+        }
+        if (slot->offset == offset){
+            if (slot->pos == NAME_MEMO_NO_TEXT)     // now we have the text as well
+                slot->pos = pos;
+            return;
+        }
+    }
+    // the table is full around this offset, we just don't keep it
+}
+
+// keeps the suffixes of a decoded name of length l ('text' is where we wrote it in the memo or NULL).
+// 'end' is one past the last byte we read. we only keep the whole name and the suffixes we reached
+// by a pointer, others are rarely used
+static void _name_memo_keep(sdns_context * ctx, char * text, int l, int num_of_jumps, uint16_t end){
+    struct _sdns_name_memo * memo = ctx->memo;
+    _name_trace * trace = &memo->trace;
+    if (trace->labels == 0)
+        return;
+    uint16_t base = NAME_MEMO_NO_TEXT;
+    if (text != NULL){
+        // all the suffixes are part of the whole name
+        base = text - memo->text;
+        memo->text_used += l;
+    }
+    // from the last label to the first one, so we see the jumps after each label only once
+    uint16_t max_target = 0;
+    int j = trace->jumps - 1;
+    for (int i = trace->labels - 1; i >= 0; --i){
+        while (j >= 0 && trace->jump_labels[j] > i){
+            if (trace->jump_target[j] > max_target)
+                max_target = trace->jump_target[j];
+            if (trace->jump_end[j] > end)
+                end = trace->jump_end[j];
+            j--;
+        }
+        uint16_t label_end = trace->label_offset[i] + 1 + (uint8_t) ctx->raw[trace->label_offset[i]];
+        if (label_end > end)
+            end = label_end;
+        if (i > 0 && (j < 0 || trace->jump_labels[j] != i))    // not reached by a pointer
+            continue;
+        if (trace->label_offset[i] > 0x3FFF)  // a pointer can not refer to this label
+            continue;
+        uint16_t pos = base == NAME_MEMO_NO_TEXT?NAME_MEMO_NO_TEXT:base + trace->label_pos[i];
+        _name_memo_add(memo, trace->label_offset[i], pos, l - trace->label_pos[i],
+                       max_target, end, num_of_jumps - trace->label_jumps[i]);
+    }
+}
+
+// uses the memo for the suffix at 'offset' of the name that starts at 'start'. returns 1 if the suffix is
+// copied to the name (and added to the hash), 0 if we don't have it (or it's not valid here) and an error code otherwise.
+// 'sofar' is the furthest byte we have read: the bytes of the suffix must be before it, otherwise
+// decoding it counts more bytes for the name (see 'consumed' in decode_name_to_buffer()).
+// not inlined: it makes the label loop of decode_name_to_buffer() much slower
+__attribute__((noinline))
+static int _name_memo_use(sdns_context * ctx, uint16_t offset, unsigned int start, unsigned int sofar,
+                          char * result, char * text, uint64_t * hash, int * l, int * num_of_jumps){
+    struct _sdns_name_memo * memo = ctx->memo;
+    _name_memo_slot * slot = _name_memo_find(memo, offset);
+    if (NULL == slot || slot->max_target >= start || slot->end >= sofar)
+        return 0;
+    if (slot->pos == NAME_MEMO_NO_TEXT && (result != NULL || text != NULL || hash != NULL))
+        return 0;
+    if (*num_of_jumps + slot->jumps > 255)
+        return SDNS_ERROR_ILLEGAL_COMPRESSION;
+    if (*l + slot->len > 255){
+        ERROR("Qname length is more than 255 character");
+        return SDNS_ERROR_HOSTNAME_TOO_LONG;
+    }
+    if (result != NULL)
+        memcpy(result + *l, memo->text + slot->pos, slot->len);
+    if (text != NULL)
+        memcpy(text + *l, memo->text + slot->pos, slot->len);
+    if (hash != NULL)
+        *hash = _name_hash_update(*hash, memo->text + slot->pos, slot->len);
+    *l += slot->len;
+    *num_of_jumps += slot->jumps;
+    memo->trace.jump_target[memo->trace.jumps] = slot->max_target;
+    memo->trace.jump_end[memo->trace.jumps] = slot->end;
+    memo->trace.jump_labels[memo->trace.jumps] = memo->trace.labels;
+    memo->trace.jumps++;
+    return 1;
+}
+
+// decodes the name at ctx->cursor into 'result' (at least 256 bytes).
+// if 'result' is NULL, the name is only validated and skipped (no copy at all).
+// if 'hash' is not NULL, it gets the hash of the name (see sdns_name_hash()).
+static int decode_name_to_buffer(sdns_context * ctx, char * result, uint64_t * hash){
     DEBUG("Starting to decode the name part...");
     unsigned int consumed = ctx->cursor - ctx->raw;
     DEBUG("'consumed' initial value: %d\n", consumed);
@@ -110,19 +331,27 @@ static int decode_name(sdns_context * ctx, char ** decoded_name){
         // there is nothing to decode
         return SDNS_ERROR_BUFFER_TOO_SHORT;
     }
-    // max length of a label is 255 (is it?)
-    char qname_result[256] = {0x00};
     char * upper_bound = ctx->raw + ctx->raw_len;
     uint32_t to_read = 0;
-    char bytes[4] = {0x00};
+    char bytes[1] = {0x00};
     char * sofar = ctx->cursor;
     char * tmp_buff = ctx->cursor;
     // I guess we can never have more than 255 jumps as this is the 
     // maximum possible length of a name (one jump per character)
     int num_of_jumps = 0;
     char * start_from = ctx->cursor;
-    int label_char_count = 0;
     int l = 0; // this tracks qname_result position to fill
+    uint64_t h = NAME_HASH_INIT;
+    _name_trace * trace = NULL;     // only used if we have a memo
+    char * text = NULL;             // the name is written here as well to keep it in the memo
+    if (ctx->memo != NULL){
+        trace = &ctx->memo->trace;
+        trace->labels = 0;
+        trace->jumps = 0;
+        // we copy from the raw buffer (and old names) as reading 'result' back is slow
+        if (ctx->memo->text_used + SDNS_NAME_BUFFER_SIZE <= NAME_MEMO_TEXT_SIZE)
+            text = ctx->memo->text + ctx->memo->text_used;
+    }
     int success_read = 0;    // at the end of the code, after a successful reading this must be 1
     while (consumed <= ctx->raw_len){        // make sure it's not an infinite loop!
 
@@ -131,11 +360,10 @@ static int decode_name(sdns_context * ctx, char ** decoded_name){
             return SDNS_ERROR_HOSTNAME_TOO_LONG;
         }
 
-        to_read = (uint8_t)tmp_buff[0];
-        if (read_buffer(tmp_buff, upper_bound, 1, bytes) != 0){
+        if (tmp_buff >= upper_bound){
             return SDNS_ERROR_BUFFER_TOO_SHORT;
         }
-        to_read = (uint8_t) bytes[0] & 0x000000FF;
+        to_read = (uint8_t) tmp_buff[0];
         if (tmp_buff > sofar){      // only increase consume if we read forward in the packet raw data
             consumed += 1;
             sofar += 1;
@@ -150,7 +378,7 @@ static int decode_name(sdns_context * ctx, char ** decoded_name){
         if (to_read >= 192){       // the first 2bits are 11-> it is compressed
             DEBUG("We entered the compressin algorithm section\n");
             // as it's compressed, we need to read another bytes for the offset
-            if (tmp_buff + 1> upper_bound){
+            if (tmp_buff >= upper_bound){
                 return SDNS_ERROR_BUFFER_TOO_SHORT;
             }
             // read another byte from buffer
@@ -164,6 +392,12 @@ static int decode_name(sdns_context * ctx, char ** decoded_name){
             if (ctx->raw + offset >= start_from){ // we can not jump forward or on the same place
                 return SDNS_ERROR_ILLEGAL_COMPRESSION;
             }
+            if (trace != NULL){
+                trace->jump_target[trace->jumps] = offset;
+                trace->jump_end[trace->jumps] = tmp_buff - ctx->raw;
+                trace->jump_labels[trace->jumps] = trace->labels;
+                trace->jumps++;
+            }
 
             tmp_buff = ctx->raw + offset;
 
@@ -172,6 +406,18 @@ static int decode_name(sdns_context * ctx, char ** decoded_name){
             if (num_of_jumps > 255){
                 return SDNS_ERROR_ILLEGAL_COMPRESSION;
             }
+            if (NULL == trace)
+                continue;
+            // if we have already decoded the name at this offset (and it's valid here), just use it
+            int used = _name_memo_use(ctx, offset, start_from - ctx->raw, sofar - ctx->raw,
+                                      result, text, hash == NULL?NULL:&h, &l, &num_of_jumps);
+            if (used < 0)
+                return used;
+            if (used){
+                consumed += 1;      // same as reaching the NULL
+                success_read = 1;
+                break;
+            }
             continue;
         }else if (to_read <= 63){  // no compression as the first 2 bits are 00
             //read one-character at a time and add it to qname buffer
@@ -180,21 +426,29 @@ static int decode_name(sdns_context * ctx, char ** decoded_name){
                 return SDNS_ERROR_BUFFER_TOO_SHORT;
             }
             DEBUG("We must read %d characters...\n", to_read);
-            for (int i=0; i< to_read; ++i){
-                if (tmp_buff[i] == 0){
-                    ERROR("NULL character found in the middle of qname");
-                    return sdns_rcode_FormErr;
-                }
-                DEBUG("READ one byte: %c\n", tmp_buff[i]);
-                qname_result[l] = tmp_buff[i];
-                label_char_count++;
-                if (label_char_count > 63){  // can 't have a label > 63
-                    return sdns_rcode_FormErr;
-                }
-                l++;
+            if (trace != NULL){
+                trace->label_offset[trace->labels] = (tmp_buff - 1) - ctx->raw;
+                trace->label_pos[trace->labels] = l;
+                trace->label_jumps[trace->labels] = num_of_jumps;
+                trace->labels++;
             }
-            qname_result[l] = '.';
-            label_char_count = 0;
+            // check and copy the whole label at once instead of byte by byte
+            // (memchr() and memcpy() of the libc are vectorized)
+            if (memchr(tmp_buff, 0x00, to_read) != NULL){
+                ERROR("NULL character found in the middle of qname");
+                return sdns_rcode_FormErr;
+            }
+            if (result != NULL && l < 255)
+                memcpy(result + l, tmp_buff, l + to_read > 255?255 - l:to_read);
+            if (text != NULL && l < 255)
+                memcpy(text + l, tmp_buff, l + to_read > 255?255 - l:to_read);
+            l += to_read;
+            if (result != NULL && l < 255)
+                result[l] = '.';
+            if (text != NULL && l < 255)
+                text[l] = '.';
+            if (hash != NULL)
+                h = (_name_hash_update(h, tmp_buff, to_read) ^ '.') * NAME_HASH_PRIME;
             l++;
             tmp_buff += to_read;
             if (tmp_buff >= sofar){
@@ -212,17 +466,70 @@ static int decode_name(sdns_context * ctx, char ** decoded_name){
         return SDNS_ERROR_RR_SECTION_MALFORMED;
     }
     ctx->cursor = ctx->raw + consumed;
-    *decoded_name = strdup(qname_result);
+    if (result != NULL)
+        result[l] = '\0';
+    if (hash != NULL)
+        *hash = h;
+    if (trace != NULL)
+        _name_memo_keep(ctx, text, l, num_of_jumps, tmp_buff - ctx->raw);
     DEBUG("We have consumed %d bytes for reading qname\n", consumed);
+    return sdns_rcode_NoError;
+}
+
+static int decode_name(sdns_context * ctx, char ** decoded_name){
+    // max length of a label is 255 (is it?)
+    char qname_result[256] = {0x00};
+    int res = decode_name_to_buffer(ctx, qname_result, NULL);
+    if (res != sdns_rcode_NoError)
+        return res;
+    *decoded_name = sdns_strdup(qname_result);
+    if (NULL == *decoded_name)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     DEBUG("final qname is: %s\n", *decoded_name);
     return sdns_rcode_NoError;
 }
 
+// reads the name located at 'offset' of the raw buffer into 'result' (at least 256 bytes)
+// without touching ctx->cursor
+static int decode_name_at(sdns_context * ctx, uint16_t offset, char * result){
+    char * cursor = ctx->cursor;
+    ctx->cursor = ctx->raw + offset;
+    int res = decode_name_to_buffer(ctx, result, NULL);
+    ctx->cursor = cursor;
+    return res;
+}
+
+// decodes (or only skips if the context is in name-view mode) the name at ctx->cursor
+// and keeps its position in the raw buffer (and its hash with SDNS_CTX_NAME_HASH).
+// The name is allocated from the context arena if it's enabled
+static int decode_owner_name(sdns_context * ctx, char ** decoded_name, uint16_t * offset, uint16_t * len,
+                             uint64_t * hash){
+    char * start = ctx->cursor;
+    char qname_result[256] = {0x00};
+    int res;
+    *decoded_name = NULL;
+    *hash = 0;
+    uint64_t * h = (ctx->flags & SDNS_CTX_NAME_HASH)?hash:NULL;
+    if (ctx->flags & SDNS_CTX_NAME_VIEW){
+        res = decode_name_to_buffer(ctx, NULL, h);
+    }else{
+        res = decode_name_to_buffer(ctx, qname_result, h);
+        if (res == sdns_rcode_NoError && (*decoded_name = _ctx_strdup(ctx, qname_result)) == NULL)
+            res = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    if (res != sdns_rcode_NoError)
+        return res;
+    *offset = (uint16_t)(start - ctx->raw);
+    *len = (uint16_t)(ctx->cursor - start);
+    return sdns_rcode_NoError;
+}
+
 static int decode_question_from_buffer(sdns_context * ctx){
     DEBUG("Starting to decode question...");
     char * decoded_name = NULL;
     DEBUG("Starting to decode question name...");
-    int res = decode_name(ctx, &decoded_name);
+    int res = decode_owner_name(ctx, &decoded_name, &ctx->msg->question.qname_offset,
+                                &ctx->msg->question.qname_len, &ctx->msg->question.qname_hash);
     DEBUG("end decode question name...with result: %d", res);
     if (res != sdns_rcode_NoError){
         ERROR("We have and error code of %d from decode_name()\n", res);
@@ -267,9 +574,11 @@ static void _free_unknown_rr(sdns_rr* rr){
     sdns_rr * ttmp = tmp;
     DEBUG("in free unknown");
     while(tmp){
-        free(tmp->name);
         ttmp = tmp->next;
-        free(tmp);
+        if (!tmp->in_arena){    // the arena ones are released with the context
+            sdns_free(tmp->name);
+            sdns_free(tmp);
+        }
         tmp = ttmp;
     }
 }
@@ -280,37 +589,46 @@ static int decode_rr_from_buffer(sdns_context * ctx, sdns_rr ** result_section,
         return sdns_rcode_FormErr;
     }
     sdns_rr * tmp_rr_section = NULL;
-    sdns_rr *rr_section = sdns_init_rr(NULL, 0, 0, 0, 0, 0, NULL);
-    tmp_rr_section = rr_section;
-    sdns_rr *tmp_sdns_rr = NULL;
+    sdns_rr *rr_section = NULL;
+    sdns_rr *tail = NULL;     // last RR of the list
     int an_res;
     // for i in number of answers
     for (int i=0; i< num_entries; ++i){
-        if (tmp_rr_section == NULL){
-            tmp_rr_section = sdns_init_rr(NULL, 0, 0, 0, 0, 0, NULL);
-            tmp_sdns_rr = rr_section;
-            while (tmp_sdns_rr->next)
-                tmp_sdns_rr = tmp_sdns_rr->next;
-            tmp_sdns_rr->next = tmp_rr_section;
-            tmp_rr_section->next = NULL;
-        }
         DEBUG("Reading answer number #%d\n", i+1);
         char * qname_result;
-        an_res = decode_name(ctx, &qname_result);
+        uint16_t name_offset = 0, name_len = 0;
+        uint64_t name_hash = 0;
+        an_res = decode_owner_name(ctx, &qname_result, &name_offset, &name_len, &name_hash);
         if (an_res != sdns_rcode_NoError){
             DEBUG("We got error, let's free the memory.......");
             ERROR("There is an error here");
             _free_unknown_rr(rr_section);
             return an_res;
         }
-        tmp_rr_section->name = qname_result;
         INFO("NAME from answer #%d: %s", i+1, qname_result);
+        // the RR is allocated once we know the type (A and AAAA have room for the inline rdata)
+        uint16_t type = ctx->raw_len < (ctx->cursor - ctx->raw + 10)?0:read_uint16_from_buffer(ctx->cursor);
+        tmp_rr_section = sdns_context_init_rr(ctx, NULL, type, 0, 0, 0, 0, NULL);
+        if (NULL == tmp_rr_section){
+            if (!(ctx->flags & SDNS_CTX_ARENA) || NULL == ctx->arena)
+                sdns_free(qname_result);
+            _free_unknown_rr(rr_section);
+            return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        }
+        if (NULL == tail)
+            rr_section = tmp_rr_section;
+        else
+            tail->next = tmp_rr_section;
+        tail = tmp_rr_section;
+        tmp_rr_section->name = qname_result;
+        tmp_rr_section->name_offset = name_offset;
+        tmp_rr_section->name_len = name_len;
+        tmp_rr_section->name_hash = name_hash;
         if (ctx->raw_len < (ctx->cursor - ctx->raw + 10)){
             ERROR("we hit here");
             _free_unknown_rr(rr_section);
             return sdns_rcode_FormErr;
         }
-        tmp_rr_section->type = read_uint16_from_buffer(ctx->cursor);
         ctx->cursor += 2;
             
         if (! check_if_rrtype_is_valid(tmp_rr_section->type)){
@@ -350,128 +668,269 @@ static int decode_rr_from_buffer(sdns_context * ctx, sdns_rr ** result_section,
             tmp_rr_section->rdata = NULL;
         }
         ctx->cursor += tmp_rr_section->rdlength;
-        tmp_rr_section = tmp_rr_section->next;
     }
     *result_section = rr_section;
     return sdns_rcode_NoError;
 }
 
-static int _encode_label_simple(char * label, char * buffer){
-    // encode label to the buffer (user-provided and long enough)
-    // return sdns_error_elsimple on success and other values for failure
-    DEBUG("encode simple label: %s\n", label);
-    char * dotpos = NULL;
-    
-    int i = 0;
-    int len = strlen(label);
-    if (len > 255){
-        return SDNS_ERROR_HOSTNAME_TOO_LONG;
-    }
-    DEBUG("length of the actual label is %d", len);
-    // when input length < 255 then the worst possible output is 257
-    char tmp_buff[260] = {0x00};
-    strcpy(tmp_buff, label);
-    char * tmp = tmp_buff;
-    // handle the case where label is . or empty
-    if (len == 0 || (len == 1 && *tmp == '.')){
-        *buffer = '\0';
-        return SDNS_ERROR_ELSIMPLE;
+// the compression table of sdns_to_wire(): the labels we have written so far. each entry is the label at
+// 'offset' of the output followed by the suffix at 'parent' (COMPRESS_ROOT if it's the last label)
+#define COMPRESS_MIN_SLOTS 64           // must be a power of 2
+#define COMPRESS_ROOT 0xFFFF
+#define COMPRESS_MAX_OFFSET 0x3FFF      // the max value we can refer in 14 bits for compression
+
+typedef struct {
+    uint32_t hash;          // hash of the label and the parent, 0 for an empty slot
+    uint16_t offset;
+    uint16_t parent;
+} _compress_slot;
+
+struct _sdns_compress_table{
+    const sdns_allocator * allocator;   // allocator of the context that created the table
+    unsigned int size;      // number of slots
+    unsigned int used;
+    _compress_slot * slots;
+    unsigned int * added;   // slot of each entry in the order we added them
+};
+
+// the question name of sdns_make_response() as it was in the query. it's written instead of
+// question.qname as long as they are the same name (len is 0 if we don't have it)
+struct _sdns_qname_wire{
+    uint16_t len;
+    char wire[256];
+};
+
+// number of labels we have now. the ones we add after it can be forgotten by _compress_rewind()
+static unsigned int _compress_mark(sdns_context * ctx){
+    return ctx->compress == NULL?0:ctx->compress->used;
+}
+
+// forgets the labels added after 'mark' (the RRs we don't write anymore). they are removed in the
+// reverse order so the probes of the other entries still find them
+static void _compress_rewind(sdns_context * ctx, unsigned int mark){
+    struct _sdns_compress_table * table = ctx->compress;
+    if (NULL == table)
+        return;
+    while (table->used > mark){
+        table->used -= 1;
+        table->slots[table->added[table->used]].hash = 0;
     }
-    
-    // strip the last . if there is any
-    int rev_i = len - 1;
-    while (rev_i > 0){
-        if (tmp[rev_i] == '.'){
-            tmp[rev_i] = '\0';
-            rev_i--;
-            continue;
-        }else{break;}
+}
+
+// forgets all the labels (new message). creates the table if we don't have it
+static void _compress_reset(sdns_context * ctx){
+    if (NULL == ctx->compress){
+        // no table is not an error, we just don't compress the names
+        struct _sdns_compress_table * table = (struct _sdns_compress_table*) _ctx_malloc(ctx, sizeof(struct _sdns_compress_table));
+        if (NULL == table)
+            return;
+        table->allocator = ctx->allocator;
+        table->slots = (_compress_slot*) _ctx_malloc(ctx, COMPRESS_MIN_SLOTS * sizeof(_compress_slot));
+        table->added = (unsigned int*) _ctx_malloc(ctx, COMPRESS_MIN_SLOTS * sizeof(unsigned int));
+        if (NULL == table->slots || NULL == table->added){
+            _ctx_free(ctx, table->slots);
+            _ctx_free(ctx, table->added);
+            _ctx_free(ctx, table);
+            return;
+        }
+        memset(table->slots, 0x00, COMPRESS_MIN_SLOTS * sizeof(_compress_slot));
+        table->size = COMPRESS_MIN_SLOTS;
+        table->used = 0;
+        ctx->compress = table;
+        return;
     }
-    len = rev_i + 1;
-    if (len == 0){
-        *buffer = '\0';
-        return SDNS_ERROR_ELSIMPLE;
+    _compress_rewind(ctx, 0);
+}
+
+static void _compress_free(struct _sdns_compress_table * table){
+    if (NULL == table)
+        return;
+    sdns_free_with(table->allocator, table->slots);
+    sdns_free_with(table->allocator, table->added);
+    sdns_free_with(table->allocator, table);
+}
+
+// the labels are compared byte by byte (case-sensitive) so the names are written as they are
+static uint32_t _compress_hash(const char * label, uint8_t len, uint16_t parent){
+    uint32_t h = 0x811c9dc5;
+    for (int i=0; i< len; ++i)
+        h = (h ^ (uint8_t)label[i]) * 0x01000193;
+    h = (h ^ parent) * 0x01000193;
+    return h == 0?1:h;
+}
+
+// returns the offset of 'label' (length byte and the label) followed by the suffix at 'parent' or -1
+static int _compress_find(struct _sdns_compress_table * table, dyn_buffer * db, const char * label, uint16_t parent){
+    uint8_t len = (uint8_t)label[0];
+    uint32_t h = _compress_hash(label + 1, len, parent);
+    for (unsigned int i = h & (table->size - 1);; i = (i + 1) & (table->size - 1)){
+        _compress_slot * slot = &table->slots[i];
+        if (slot->hash == 0)
+            return -1;
+        if (slot->hash == h && slot->parent == parent && memcmp(db->buffer + slot->offset, label, len + 1) == 0)
+            return slot->offset;
     }
+}
 
-    while (1){
-        dotpos = strchr(tmp, '.');
-        if (NULL == dotpos){
-            // there is no more . in the label
-            // copy the rest and break
-            buffer[i++] = (uint8_t)(len - (tmp - tmp_buff));
-            
-            while(*tmp){
-                buffer[i++] = (uint8_t)*tmp;
-                tmp++;
-            }
-            buffer[i] = '\0';
-            // we used 254 because we need to append an extra null at the end
-            if (strlen(buffer) > 254){
-                return SDNS_ERROR_HOSTNAME_TOO_LONG;
-            }
-            return SDNS_ERROR_ELSIMPLE;
-        }
-        // here we have found a dot
-        // the length of the label is dotpos - tmp
+static unsigned int _compress_insert(_compress_slot * slots, unsigned int size, _compress_slot * entry){
+    unsigned int i = entry->hash & (size - 1);
+    while (slots[i].hash != 0)
+        i = (i + 1) & (size - 1);
+    slots[i] = *entry;
+    return i;
+}
 
-        // the label must be < 63
-        if (dotpos - tmp > 63){
-            buffer[0] = '\0';
-            return SDNS_ERROR_LABEL_MAX_63;
-        }
-        buffer[i++] = (uint8_t)(dotpos - tmp);
-        while (tmp < dotpos){
-            buffer[i++] = (uint8_t) *tmp;
-            tmp++;
+// remembers a label. the table is never more than 3/4 full
+static void _compress_add(struct _sdns_compress_table * table, uint32_t hash, uint16_t offset, uint16_t parent){
+    if ((table->used + 1) * 4 > table->size * 3){
+        unsigned int size = table->size * 2;
+        _compress_slot * slots = (_compress_slot*) sdns_malloc_with(table->allocator, size * sizeof(_compress_slot));
+        unsigned int * added = NULL;
+        if (NULL == slots || (added = (unsigned int*) sdns_realloc_with(table->allocator, table->added, size * sizeof(unsigned int))) == NULL){
+            sdns_free_with(table->allocator, slots);
+            return;     // we just don't compress to this label
         }
-        // skip the found dot and continue searching
-        tmp++;
-        continue;
+        memset(slots, 0x00, size * sizeof(_compress_slot));
+        // same order as before, so _compress_rewind() still works
+        for (unsigned int i=0; i< table->used; ++i)
+            added[i] = _compress_insert(slots, size, &table->slots[added[i]]);
+        sdns_free_with(table->allocator, table->slots);
+        table->slots = slots;
+        table->added = added;
+        table->size = size;
     }
+    _compress_slot entry = {hash, offset, parent};
+    table->added[table->used] = _compress_insert(table->slots, table->size, &entry);
+    table->used += 1;
 }
 
+// remembers the first k labels of the name at 'at' of the output, the rest is the suffix at 'parent'.
+// the last label has the largest offset, we can't refer to anything before it if it's too far
+static void _compress_add_labels(struct _sdns_compress_table * table, dyn_buffer * db, unsigned long int at,
+                                 uint16_t * label_pos, int k, int parent){
+    while (k > 0 && at + label_pos[k - 1] <= COMPRESS_MAX_OFFSET){
+        k--;
+        char * label = db->buffer + at + label_pos[k];
+        uint16_t offset = at + label_pos[k];
+        _compress_add(table, _compress_hash(label + 1, (uint8_t)label[0], parent), offset, parent);
+        parent = offset;
+    }
+}
 
-static int _encode_label_compressed(char * label, dyn_buffer * db, char * buffer){
-    if (NULL == label){
-        buffer[0] = '\0';
-        return SDNS_ERROR_ELSIMPLE;
+// encodes the dotted name to length-prefixed labels in 'out' (room for 256 bytes) in one pass. the trailing
+// dots are ignored, "" and "." are the root. 'label_pos' receives the start of each label in 'out'
+static int _encode_labels(const char * name, char * out, uint16_t * label_pos, int * labels, int * len){
+    int o = 0;
+    int n = 0;
+    const char * p = name;
+    while (*p != '\0'){
+        const char * start = p;
+        while (*p != '.' && *p != '\0')
+            p++;
+        int l = p - start;
+        if (l == 0){
+            // only dots to the end is the end of the name, anything else is an empty label
+            while (*p == '.')
+                p++;
+            if (*p != '\0')
+                return SDNS_ERROR_WRONG_LABEL_SPECIFIED;
+            break;
+        }
+        if (l > 63)
+            return SDNS_ERROR_LABEL_MAX_63;
+        // the length byte, the label and the final zero
+        if (o + l + 2 > 255)
+            return SDNS_ERROR_HOSTNAME_TOO_LONG;
+        label_pos[n++] = o;
+        out[o] = (uint8_t)l;
+        memcpy(out + o + 1, start, l);
+        o += l + 1;
+        if (*p == '.')
+            p++;
     }
-    
-    char simple[260] = {0x00};
-    int res = _encode_label_simple(label, simple);
-    if (res != SDNS_ERROR_ELSIMPLE){
+    out[o++] = '\0';
+    *labels = n;
+    *len = o;
+    return sdns_rcode_NoError;
+}
+
+// writes the name to 'db'. if 'compress' is 1, the longest suffix we have already written is replaced
+// by a pointer and the new labels are remembered for the next names. the labels are written directly to
+// the output if it has enough space
+static int _encode_name(sdns_context * ctx, dyn_buffer * db, char * name, int compress){
+    char scratch[256];
+    uint16_t label_pos[128];
+    int labels = 0;
+    int len = 0;
+    if (NULL == name)
+        name = "";
+    unsigned long int at = db->cursor;
+    int direct = !db->failed && db->len - db->cursor >= sizeof(scratch);
+    char * out = direct?db->buffer + at:scratch;
+    int res = _encode_labels(name, out, label_pos, &labels, &len);
+    if (res != sdns_rcode_NoError)
         return res;
+    struct _sdns_compress_table * table = compress?ctx->compress:NULL;
+    // from the last label: the suffix we know is the parent of the next one
+    int k = labels;
+    int parent = COMPRESS_ROOT;
+    while (k > 0 && table != NULL){
+        int found = _compress_find(table, db, out + label_pos[k - 1], parent);
+        if (found < 0)
+            break;
+        parent = found;
+        k--;
+    }
+    if (k < labels){
+        len = label_pos[k];
+        out[len++] = (uint8_t)(0xC0 | (parent >> 8));
+        out[len++] = (uint8_t)(parent & 0xFF);
     }
+    if (direct)
+        db->cursor += len;
+    else if (dyn_buffer_append(db, out, len) != 0)
+        return sdns_rcode_NoError;      // db->failed tells the caller
+    if (table != NULL)
+        _compress_add_labels(table, db, at, label_pos, k, parent);
+    return sdns_rcode_NoError;
+}
 
-    char * tmp = simple;
-    char * match = NULL;
-    int j=0;
-    size_t tmp_len = strlen(simple);
-
-    // 2^14 -1 = 16383. this is the max value we can refer in 14 bits for compression
-    size_t db_max_len = db->cursor < 16383?db->cursor:16383;
-    while (2){
-        match = (char *)memmem(db->buffer, db_max_len, tmp, tmp_len+1);
-        if (match != NULL){
-            // we found a match, we can compress it from here
-            DEBUG("We found a match in %ld", match - db->buffer);
-            uint16_t offset = 0xc000 | (uint16_t)(match - db->buffer);
-            buffer[j++] = (uint8_t)(offset >> 8 & 0xFF);
-            buffer[j++] = (uint8_t)(offset & 0xFF);
-            return SDNS_ERROR_ELCOMPRESSED;
-        }else{
-            // go one label further and start again if the remaining part is > 3
-            uint8_t to_read = *tmp;
-            buffer[j++] = *tmp;
-            tmp++;
-            for (int i=0;i<to_read; ++i){
-                buffer[j++] = *tmp;
-                tmp++;
-            }
-            tmp_len = tmp_len - 1 - to_read;
-            continue;
-        }
+// 1 if the dotted name is the name in the wire format (same case), without encoding it
+static int _qname_wire_matches(struct _sdns_qname_wire * qw, const char * name){
+    if (NULL == qw || qw->len == 0 || NULL == name)
+        return 0;
+    const char * p = name;
+    for (uint16_t i = 0; qw->wire[i] != 0; i += (uint8_t)qw->wire[i] + 1){
+        uint8_t l = (uint8_t)qw->wire[i];
+        for (uint8_t j = 0; j < l; ++j)
+            if (p[j] == '\0' || p[j] != qw->wire[i + 1 + j])
+                return 0;
+        if (p[l] != '.' && p[l] != '\0')
+            return 0;
+        p += p[l] == '.'?l + 1:l;
     }
+    return *p == '\0' || (p[0] == '.' && p[1] == '\0' && p == name);
+}
+
+// writes the question name of sdns_make_response() (labels without pointers) and remembers its labels
+static void _encode_qname_wire(sdns_context * ctx, dyn_buffer * db, struct _sdns_qname_wire * qw){
+    uint16_t label_pos[128];
+    int labels = 0;
+    unsigned long int at = db->cursor;
+    if (dyn_buffer_append(db, qw->wire, qw->len) != 0 || NULL == ctx->compress)
+        return;
+    for (uint16_t i = 0; qw->wire[i] != 0; i += (uint8_t)qw->wire[i] + 1)
+        label_pos[labels++] = i;
+    _compress_add_labels(ctx->compress, db, at, label_pos, labels, COMPRESS_ROOT);
+}
+
+// writes the rdlength of the RR whose rdlength field is at 'at' (the rdata is everything after it)
+static void _encode_patch_rdlength(dyn_buffer * db, unsigned long int at){
+    if (db->failed || db->cursor < at + 2)
+        return;
+    uint16_t rdlength = db->cursor - at - 2;
+    db->buffer[at] = (uint8_t)(rdlength >> 8 & 0xFF);
+    db->buffer[at + 1] = (uint8_t)(rdlength & 0xFF);
 }
 
 static int _encode_write_rr_A(sdns_context * ctx, dyn_buffer* db, sdns_rr* tmprr){
@@ -488,34 +947,26 @@ static int _encode_write_rr_A(sdns_context * ctx, dyn_buffer* db, sdns_rr* tmprr
 }
 
 static int _encode_write_rr_NS(sdns_context * ctx, dyn_buffer* db, sdns_rr* tmprr){
-    char buffer[260] = {0x00};
     char tmp_bytes[10] = {0x00};
     sdns_rr_NS * ns = (sdns_rr_NS*) tmprr->psdns_rr;
-    int res = _encode_label_compressed(ns->NSDNAME, db, buffer);
-    if (res != SDNS_ERROR_ELSIMPLE && res != SDNS_ERROR_ELCOMPRESSED)
+    unsigned long int at = db->cursor;
+    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength (we know it after the name)
+    int res = _encode_name(ctx, db, ns->NSDNAME, 1);
+    if (res != sdns_rcode_NoError)
         return res;
-    uint16_t rdlength = res == SDNS_ERROR_ELSIMPLE?strlen(buffer)+1:strlen(buffer);
-    tmp_bytes[0] = (uint8_t) (rdlength >> 8 & 0xFF);
-    tmp_bytes[1] = (uint8_t)(rdlength & 0xFF);
-    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength
-    int to_write = res == SDNS_ERROR_ELSIMPLE?strlen(buffer)+1:strlen(buffer);
-    dyn_buffer_append(db, buffer, to_write);
+    _encode_patch_rdlength(db, at);
     return sdns_rcode_NoError;
 }
 
 static int _encode_write_rr_PTR(sdns_context * ctx, dyn_buffer* db, sdns_rr* tmprr){
-    char buffer[260] = {0x00};
     char tmp_bytes[10] = {0x00};
     sdns_rr_PTR * ptr = (sdns_rr_PTR*) tmprr->psdns_rr;
-    int res = _encode_label_compressed(ptr->PTRDNAME, db, buffer);
-    if (res != SDNS_ERROR_ELSIMPLE && res != SDNS_ERROR_ELCOMPRESSED)
+    unsigned long int at = db->cursor;
+    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength (we know it after the name)
+    int res = _encode_name(ctx, db, ptr->PTRDNAME, 1);
+    if (res != sdns_rcode_NoError)
         return res;
-    uint16_t rdlength = res == SDNS_ERROR_ELSIMPLE?strlen(buffer)+1:strlen(buffer);
-    tmp_bytes[0] = (uint8_t) (rdlength >> 8 & 0xFF);
-    tmp_bytes[1] = (uint8_t)(rdlength & 0xFF);
-    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength
-    int to_write = res == SDNS_ERROR_ELSIMPLE?strlen(buffer)+1:strlen(buffer);
-    dyn_buffer_append(db, buffer, to_write);
+    _encode_patch_rdlength(db, at);
     return sdns_rcode_NoError;
 }
 
@@ -543,18 +994,14 @@ static int _encode_write_rr_CAA(sdns_context * ctx, dyn_buffer * db, sdns_rr *tm
 }
 
 static int _encode_write_rr_CNAME(sdns_context * ctx, dyn_buffer* db, sdns_rr* tmprr){
-    char buffer[260] = {0x00};
     char tmp_bytes[10] = {0x00};
     sdns_rr_CNAME * cname = (sdns_rr_CNAME*) tmprr->psdns_rr;
-    int res = _encode_label_compressed(cname->CNAME, db, buffer);
-    if (res != SDNS_ERROR_ELSIMPLE && res != SDNS_ERROR_ELCOMPRESSED)
+    unsigned long int at = db->cursor;
+    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength (we know it after the name)
+    int res = _encode_name(ctx, db, cname->CNAME, 1);
+    if (res != sdns_rcode_NoError)
         return res;
-    uint16_t rdlength = res == SDNS_ERROR_ELSIMPLE?strlen(buffer)+1:strlen(buffer);
-    tmp_bytes[0] = (uint8_t) (rdlength >> 8 & 0xFF);
-    tmp_bytes[1] = (uint8_t)(rdlength & 0xFF);
-    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength
-    int to_write = rdlength;
-    dyn_buffer_append(db, buffer, to_write);
+    _encode_patch_rdlength(db, at);
     return sdns_rcode_NoError;
 }
 
@@ -608,43 +1055,26 @@ static int _encode_write_rr_OPT(sdns_context * ctx, dyn_buffer* db, sdns_rr* tmp
 }
 
 static int _encode_write_rr_MX(sdns_context * ctx, dyn_buffer* db, sdns_rr* tmprr){
-    char buffer[260] = {0x00};
     char tmp_bytes[10] = {0x00};
     sdns_rr_MX * mx = (sdns_rr_MX*) tmprr->psdns_rr;
-    int res = _encode_label_compressed(mx->exchange, db, buffer);
-    if (res != SDNS_ERROR_ELSIMPLE && res != SDNS_ERROR_ELCOMPRESSED)
-        return res;
-    uint16_t rdlength = strlen(buffer) + 2;
-    rdlength += res == SDNS_ERROR_ELSIMPLE?1:0;
-    tmp_bytes[0] = (uint8_t) (rdlength >> 8 & 0xFF);
-    tmp_bytes[1] = (uint8_t)(rdlength & 0xFF);
-    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength
+    unsigned long int at = db->cursor;
+    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength (we know it after the name)
     tmp_bytes[0] = (uint8_t)(mx->preference >> 8 & 0xFF);
     tmp_bytes[1] = (uint8_t)(mx->preference & 0xFF);
     dyn_buffer_append(db, tmp_bytes, 2);
-    dyn_buffer_append(db, buffer, rdlength - 2);
+    int res = _encode_name(ctx, db, mx->exchange, 1);
+    if (res != sdns_rcode_NoError)
+        return res;
+    _encode_patch_rdlength(db, at);
     return sdns_rcode_NoError;
 }
 
 static int _encode_write_rr_RRSIG(sdns_context * ctx, dyn_buffer * db, sdns_rr * tmprr){
     DEBUG("******************Start encoding rrsig data");
     sdns_rr_RRSIG * rrsig = (sdns_rr_RRSIG*) tmprr->psdns_rr;
-    uint16_t rdlength = 0;
     char tmp_bytes[10] = {0x00};
-    // first we go for the name part since this is the only error-prone part
-    char sn_buffer[260] = {0x00};
-    int sn_result = _encode_label_simple(rrsig->signers_name, sn_buffer);
-    if (sn_result != SDNS_ERROR_ELSIMPLE){
-        // there is an error in encoding label
-        return sn_result;
-    }
-    rdlength = strlen(sn_buffer) + 1;       // len + null character (this is simple encoding)
-    rdlength += 2 + 1 + 1 + 4 + 4 + 4 + 2;  // typeCovered + algorithm + original ttl + expiration + inception + keytag
-    rdlength += rrsig->signature_len;
-    // write rdlength
-    tmp_bytes[0] = (uint8_t) ((rdlength >> 8) & 0xFF);
-    tmp_bytes[1] = (uint8_t)(rdlength & 0xFF);
-    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength
+    unsigned long int at = db->cursor;
+    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength (we know it after the name)
     // type covered
     tmp_bytes[0] = (uint8_t)((rrsig->type_covered  >> 8) & 0xFF);
     tmp_bytes[1] = (uint8_t)((rrsig->type_covered & 0xFF));
@@ -676,29 +1106,23 @@ static int _encode_write_rr_RRSIG(sdns_context * ctx, dyn_buffer * db, sdns_rr *
     tmp_bytes[0] = (uint8_t)((rrsig->key_tag >> 8) & 0xFF);
     tmp_bytes[1] = (uint8_t)((rrsig->key_tag & 0xFF));
     dyn_buffer_append(db, tmp_bytes, 2);
-    // append the signer's name
-    dyn_buffer_append(db, sn_buffer, strlen(sn_buffer) + 1);
+    // append the signer's name (never compressed, RFC4034)
+    int res = _encode_name(ctx, db, rrsig->signers_name, 0);
+    if (res != sdns_rcode_NoError)
+        return res;
     // append the signature
     dyn_buffer_append(db, rrsig->signature, rrsig->signature_len);
+    _encode_patch_rdlength(db, at);
     return sdns_rcode_NoError;
 }
 
 static int _encode_write_rr_SRV(sdns_context * ctx, dyn_buffer* db, sdns_rr * tmprr){
     // the 'target' field of SRV can not use compression based on RFC 2782
     int res_target = -1;
-    char target[260] = {0x00};
     char tmp_bytes[10] = {0x00};
-    uint16_t rdlength = 0;
     sdns_rr_SRV * srv = (sdns_rr_SRV*) tmprr->psdns_rr;
-    res_target = _encode_label_simple(srv->Target, target);
-    if (res_target != SDNS_ERROR_ELSIMPLE){
-        ctx->err = res_target;
-        return res_target;
-    }
-    rdlength = strlen(target) + 1 + 6; // len(target)+1+priority+weight+port
-    tmp_bytes[0] = (uint8_t) ((rdlength >> 8) & 0xFF);
-    tmp_bytes[1] = (uint8_t)(rdlength & 0xFF);
-    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength
+    unsigned long int at = db->cursor;
+    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength (we know it after the name)
     // priority
     tmp_bytes[0] = (uint8_t)((srv->Priority >> 8) & 0xFF);
     tmp_bytes[1] = (uint8_t)(srv->Priority & 0xFF);
@@ -713,7 +1137,12 @@ static int _encode_write_rr_SRV(sdns_context * ctx, dyn_buffer* db, sdns_rr * tm
     tmp_bytes[1] = (uint8_t)(srv->Port & 0xFF);
     dyn_buffer_append(db, tmp_bytes, 2);
     // target
-    dyn_buffer_append(db, target, strlen(target)+1);
+    res_target = _encode_name(ctx, db, srv->Target, 0);
+    if (res_target != sdns_rcode_NoError){
+        ctx->err = res_target;
+        return res_target;
+    }
+    _encode_patch_rdlength(db, at);
     return sdns_rcode_NoError;
 }
 
@@ -762,25 +1191,16 @@ static int _encode_write_rr_AAAA(sdns_context * ctx, dyn_buffer * db, sdns_rr* t
 static int _encode_write_rr_SOA(sdns_context * ctx, dyn_buffer* db, sdns_rr* tmprr){
     int res_mname = -1;
     int res_rname = -1;
-    char mname[260] = {0x00};
-    char rname[260] = {0x00};
     char tmp_bytes[10] = {0x00};
-    uint16_t rdlength = 0;
     sdns_rr_SOA * soa = (sdns_rr_SOA*) tmprr->psdns_rr;
-    res_mname = _encode_label_compressed(soa->mname, db, mname);
-    if (res_mname != SDNS_ERROR_ELSIMPLE && res_mname != SDNS_ERROR_ELCOMPRESSED)
+    unsigned long int at = db->cursor;
+    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength (we know it after the names)
+    res_mname = _encode_name(ctx, db, soa->mname, 1);
+    if (res_mname != sdns_rcode_NoError)
         return res_mname;
-    res_rname = _encode_label_compressed(soa->rname, db, rname);
-    if (res_rname != SDNS_ERROR_ELSIMPLE && res_rname != SDNS_ERROR_ELCOMPRESSED)
+    res_rname = _encode_name(ctx, db, soa->rname, 1);
+    if (res_rname != sdns_rcode_NoError)
         return res_rname;
-    rdlength = 20; // + strlen(mname) + strlen(rname);
-    rdlength += res_mname == SDNS_ERROR_ELSIMPLE?strlen(mname) + 1:strlen(mname);
-    rdlength += res_rname == SDNS_ERROR_ELSIMPLE?strlen(rname) + 1:strlen(rname);
-    tmp_bytes[0] = (uint8_t) ((rdlength >> 8) & 0xFF);
-    tmp_bytes[1] = (uint8_t)(rdlength & 0xFF);
-    dyn_buffer_append(db, tmp_bytes, 2);    // rdlength
-    dyn_buffer_append(db, mname, res_mname == SDNS_ERROR_ELSIMPLE?strlen(mname) +1:strlen(mname));
-    dyn_buffer_append(db, rname, res_rname == SDNS_ERROR_ELSIMPLE?strlen(rname) +1:strlen(rname));
     //serial
     tmp_bytes[0] = (uint8_t)((soa->serial >> 24) & 0xFF);
     tmp_bytes[1] = (uint8_t)((soa->serial >> 16) & 0xFF);
@@ -811,6 +1231,7 @@ static int _encode_write_rr_SOA(sdns_context * ctx, dyn_buffer* db, sdns_rr* tmp
     tmp_bytes[2] = (uint8_t)((soa->minimum >> 8) & 0xFF);
     tmp_bytes[3] = (uint8_t)(soa->minimum & 0xFF);
     dyn_buffer_append(db, tmp_bytes, 4);
+    _encode_patch_rdlength(db, at);
     return sdns_rcode_NoError;
 }
 
@@ -834,9 +1255,8 @@ static int _encode_write_rr_NID(sdns_context * ctx, dyn_buffer * db, sdns_rr* tm
 }
 
 static int _encode_write_rr_L32(sdns_context * ctx, dyn_buffer * db, sdns_rr* tmprr){
-    //TODO: need to be tested
     char tmp_bytes[10] = {0x00};
-    uint16_t rdlength = 48;     // it's always 10 (preference + locator32)
+    uint16_t rdlength = 6;      // it's always 6 (preference + locator32)
     sdns_rr_L32 * l32 = (sdns_rr_L32*) tmprr->psdns_rr;
     // rdlength
     tmp_bytes[0] = (uint8_t) ((rdlength >> 8) & 0xFF);
@@ -856,9 +1276,8 @@ static int _encode_write_rr_L32(sdns_context * ctx, dyn_buffer * db, sdns_rr* tm
 }
 
 static int _encode_write_rr_L64(sdns_context * ctx, dyn_buffer * db, sdns_rr* tmprr){
-    //TODO: need to be tested
     char tmp_bytes[10] = {0x00};
-    uint16_t rdlength = 16 + 64;     // it's always 10 (preference + locator64)
+    uint16_t rdlength = 10;     // it's always 10 (preference + locator64)
     sdns_rr_L64 * l64 = (sdns_rr_L64*) tmprr->psdns_rr;
     if (l64->Locator64 == NULL){
         ctx->err = SDNS_ERROR_BUFFER_IS_NULL;
@@ -1074,7 +1493,9 @@ int sdns_ends0_option_code_to_text(sdns_edns0_option_code oc, char * buffer){
 }
 
 sdns_rr_HINFO * sdns_init_rr_HINFO(uint8_t cpu_len, char * cpu, uint8_t os_len, char * os){
-    sdns_rr_HINFO * hinfo = (sdns_rr_HINFO*) malloc_or_abort(sizeof(sdns_rr_HINFO));
+    sdns_rr_HINFO * hinfo = (sdns_rr_HINFO*) sdns_malloc(sizeof(sdns_rr_HINFO));
+    if (NULL == hinfo)
+        return NULL;
     hinfo->cpu_len = cpu_len;
     hinfo->os_len = os_len;
     hinfo->cpu = cpu;
@@ -1085,63 +1506,69 @@ sdns_rr_HINFO * sdns_init_rr_HINFO(uint8_t cpu_len, char * cpu, uint8_t os_len,
 void sdns_free_rr_HINFO(sdns_rr_HINFO * hinfo){
     if (NULL == hinfo)
         return;
-    free(hinfo->os);
-    free(hinfo->cpu);
-    free(hinfo);
+    sdns_free(hinfo->os);
+    sdns_free(hinfo->cpu);
+    sdns_free(hinfo);
 }
 
 void sdns_free_rr_NID(sdns_rr_NID * nid){
     if (NULL == nid)
         return;
-    free(nid->NodeId);
-    free(nid);
+    sdns_free(nid->NodeId);
+    sdns_free(nid);
 }
 
 void sdns_free_rr_L32(sdns_rr_L32 * l32){
     if (NULL == l32)
         return;
-    free(l32);
+    sdns_free(l32);
 }
 
 
 void sdns_free_rr_L64(sdns_rr_L64 * l64){
     if (NULL == l64)
         return;
-    free(l64->Locator64);
-    free(l64);
+    sdns_free(l64->Locator64);
+    sdns_free(l64);
 }
 
 void sdns_free_rr_LP(sdns_rr_LP * lp){
     if (NULL == lp)
         return;
-    free(lp->FQDN);
-    free(lp);
+    sdns_free(lp->FQDN);
+    sdns_free(lp);
 }
 
 void sdns_free_rr_CAA(sdns_rr_CAA * caa){
     if (NULL == caa)
         return;
-    free(caa->tag);
-    free(caa->value);
-    free(caa);
+    sdns_free(caa->tag);
+    sdns_free(caa->value);
+    sdns_free(caa);
 }
 
 sdns_rr_NID * sdns_init_rr_NID(uint16_t preference, char * nodeid){
-    sdns_rr_NID * nid = (sdns_rr_NID *) malloc_or_abort(sizeof(sdns_rr_NID));
+    sdns_rr_NID * nid = (sdns_rr_NID *) sdns_malloc(sizeof(sdns_rr_NID));
+    if (NULL == nid)
+        return NULL;
     nid->Preference = preference;
     nid->NodeId = nodeid;
     return nid;
 }
 
 sdns_rr_L32 * sdns_init_rr_L32(uint16_t preference, uint32_t locator32){
-    sdns_rr_L32 * l32 = (sdns_rr_L32 *) malloc_or_abort(sizeof(sdns_rr_L32));
+    sdns_rr_L32 * l32 = (sdns_rr_L32 *) sdns_malloc(sizeof(sdns_rr_L32));
+    if (NULL == l32)
+        return NULL;
     l32->Preference = preference;
     l32->Locator32 = locator32;
     return l32;
 }
 
 sdns_rr_L64 * sdns_init_rr_L64(uint16_t preference, char* locator64){
-    sdns_rr_L64 * l64 = (sdns_rr_L64 *) malloc_or_abort(sizeof(sdns_rr_L64));
+    sdns_rr_L64 * l64 = (sdns_rr_L64 *) sdns_malloc(sizeof(sdns_rr_L64));
+    if (NULL == l64)
+        return NULL;
     l64->Preference = preference;
     l64->Locator64 = locator64;
     return l64;
@@ -1149,14 +1576,18 @@ sdns_rr_L64 * sdns_init_rr_L64(uint16_t preference, char* locator64){
 
 
 sdns_rr_LP * sdns_init_rr_LP(uint16_t preference, char* fqdn){
-    sdns_rr_LP * lp = (sdns_rr_LP *) malloc_or_abort(sizeof(sdns_rr_LP));
+    sdns_rr_LP * lp = (sdns_rr_LP *) sdns_malloc(sizeof(sdns_rr_LP));
+    if (NULL == lp)
+        return NULL;
     lp->Preference = preference;
     lp->FQDN = fqdn;
     return lp;
 }
 
 sdns_rr_CAA * sdns_init_rr_CAA(uint8_t flag, char * tag, uint8_t tag_len, char * value, uint16_t value_len){
-   sdns_rr_CAA * caa = (sdns_rr_CAA*) malloc_or_abort(sizeof(sdns_rr_CAA));
+   sdns_rr_CAA * caa = (sdns_rr_CAA*) sdns_malloc(sizeof(sdns_rr_CAA));
+   if (NULL == caa)
+       return NULL;
    caa->flag = flag;
    caa->tag = tag;
    caa->value = value;
@@ -1166,9 +1597,11 @@ sdns_rr_CAA * sdns_init_rr_CAA(uint8_t flag, char * tag, uint8_t tag_len, char *
 }
 
 //initialize a TXT record structure
-//it's either successfull or abort the code
+//returns NULL if we can not allocate memory (data is not freed then)
 sdns_rr_TXT * sdns_init_rr_TXT(char * data, uint16_t data_len){
-    sdns_rr_TXT * txt = (sdns_rr_TXT*) malloc_or_abort(sizeof(sdns_rr_TXT));
+    sdns_rr_TXT * txt = (sdns_rr_TXT*) sdns_malloc(sizeof(sdns_rr_TXT));
+    if (NULL == txt)
+        return NULL;
     txt->next = NULL;
     // we don't need to fragment it
     if (NULL == data || data_len == 0){
@@ -1189,7 +1622,16 @@ sdns_rr_TXT * sdns_init_rr_TXT(char * data, uint16_t data_len){
     while (2){  // why 2?
         data_len -= 255;
         data_tmp += 255;
-        sdns_rr_TXT * txt_tmp = (sdns_rr_TXT*) malloc_or_abort(sizeof(sdns_rr_TXT));
+        sdns_rr_TXT * txt_tmp = (sdns_rr_TXT*) sdns_malloc(sizeof(sdns_rr_TXT));
+        if (NULL == txt_tmp){
+            // free the parts but not the data of the caller
+            while (txt){
+                tmp = txt->next;
+                sdns_free(txt);
+                txt = tmp;
+            }
+            return NULL;
+        }
         txt_tmp->next = NULL;
         txt_tmp->character_string.content = data_tmp;
         txt_tmp->character_string.len = data_len < 255?data_len:255;
@@ -1203,7 +1645,9 @@ sdns_rr_TXT * sdns_init_rr_TXT(char * data, uint16_t data_len){
 
 // initialize NS structure
 sdns_rr_NS * sdns_init_rr_NS(char * nsdname){
-    sdns_rr_NS * ns = (sdns_rr_NS*) malloc_or_abort(sizeof(sdns_rr_NS));
+    sdns_rr_NS * ns = (sdns_rr_NS*) sdns_malloc(sizeof(sdns_rr_NS));
+    if (NULL == ns)
+        return NULL;
     ns->NSDNAME = nsdname;
     return ns;
 }
@@ -1211,22 +1655,28 @@ sdns_rr_NS * sdns_init_rr_NS(char * nsdname){
 
 // initialize PTR structure
 sdns_rr_PTR * sdns_init_rr_PTR(char * ptrdname){
-    sdns_rr_PTR * ptr = (sdns_rr_PTR*) malloc_or_abort(sizeof(sdns_rr_PTR));
+    sdns_rr_PTR * ptr = (sdns_rr_PTR*) sdns_malloc(sizeof(sdns_rr_PTR));
+    if (NULL == ptr)
+        return NULL;
     ptr->PTRDNAME = ptrdname;
     return ptr;
 }
 
 // initialize CNAME structure
 sdns_rr_CNAME * sdns_init_rr_CNAME(char * name){
-    sdns_rr_CNAME * cname = (sdns_rr_CNAME*) malloc_or_abort(sizeof(sdns_rr_CNAME));
+    sdns_rr_CNAME * cname = (sdns_rr_CNAME*) sdns_malloc(sizeof(sdns_rr_CNAME));
+    if (NULL == cname)
+        return NULL;
     cname->CNAME = name;
     return cname;
 }
 
-// either sucessful or abort the code
+// returns NULL if we can not allocate memory (mname and rname are not freed then)
 sdns_rr_SOA * sdns_init_rr_SOA(char * mname, char * rname, uint32_t expire, uint32_t minimum,
                                uint32_t refresh, uint32_t retry, uint32_t serial){
-    sdns_rr_SOA * soa = (sdns_rr_SOA*) malloc_or_abort(sizeof(sdns_rr_SOA));
+    sdns_rr_SOA * soa = (sdns_rr_SOA*) sdns_malloc(sizeof(sdns_rr_SOA));
+    if (NULL == soa)
+        return NULL;
     soa->mname = mname;
     soa->rname = rname;
     soa->expire = expire;
@@ -1247,7 +1697,9 @@ sdns_rr_RRSIG * sdns_init_rr_RRSIG(uint16_t type_covered, uint8_t algorithm, uin
                                    uint32_t signature_inception, uint8_t key_tag, char * signers_name,
                                    char * signature, uint16_t signature_len){
 
-    sdns_rr_RRSIG * rrsig = (sdns_rr_RRSIG*) malloc_or_abort(sizeof(sdns_rr_RRSIG));
+    sdns_rr_RRSIG * rrsig = (sdns_rr_RRSIG*) sdns_malloc(sizeof(sdns_rr_RRSIG));
+    if (NULL == rrsig)
+        return NULL;
     rrsig->type_covered = type_covered;
     rrsig->algorithm = algorithm;
     rrsig->labels = labels;
@@ -1262,7 +1714,9 @@ sdns_rr_RRSIG * sdns_init_rr_RRSIG(uint16_t type_covered, uint8_t algorithm, uin
 }
 
 sdns_rr_SRV * sdns_init_rr_SRV(uint16_t Priority, uint16_t Weight, uint16_t Port, char * target){
-    sdns_rr_SRV * srv = (sdns_rr_SRV*) malloc_or_abort(sizeof(sdns_rr_SRV));
+    sdns_rr_SRV * srv = (sdns_rr_SRV*) sdns_malloc(sizeof(sdns_rr_SRV));
+    if (NULL == srv)
+        return NULL;
     srv->Priority = Priority;
     srv->Weight = Weight;
     srv->Port = Port;
@@ -1271,7 +1725,9 @@ sdns_rr_SRV * sdns_init_rr_SRV(uint16_t Priority, uint16_t Weight, uint16_t Port
 }
 
 sdns_rr_URI * sdns_init_rr_URI(uint16_t Priority, uint16_t Weight, char * Target, uint16_t target_len){
-    sdns_rr_URI * uri = (sdns_rr_URI*) malloc_or_abort(sizeof(sdns_rr_URI));
+    sdns_rr_URI * uri = (sdns_rr_URI*) sdns_malloc(sizeof(sdns_rr_URI));
+    if (NULL == uri)
+        return NULL;
     uri->Priority = Priority;
     uri->Weight = Weight;
     uri->target_len = target_len;
@@ -1282,50 +1738,52 @@ sdns_rr_URI * sdns_init_rr_URI(uint16_t Priority, uint16_t Weight, char * Target
 void sdns_free_rr_URI(sdns_rr_URI * uri){
     if (NULL == uri)
         return;
-    free(uri->Target);
-    free(uri);
+    sdns_free(uri->Target);
+    sdns_free(uri);
 }
 
 void sdns_free_rr_NS(sdns_rr_NS* ns){
     if (NULL == ns)
         return;
-    free(ns->NSDNAME);
-    free(ns);
+    sdns_free(ns->NSDNAME);
+    sdns_free(ns);
 }
 
 void sdns_free_rr_RRSIG(sdns_rr_RRSIG* rrsig){
     if (NULL == rrsig)
         return;
-    free(rrsig->signers_name);
-    free(rrsig->signature);
-    free(rrsig);
+    sdns_free(rrsig->signers_name);
+    sdns_free(rrsig->signature);
+    sdns_free(rrsig);
 }
 
 void sdns_free_rr_SRV(sdns_rr_SRV* srv){
     if (NULL == srv)
         return;
-    free(srv->Target);
-    free(srv);
+    sdns_free(srv->Target);
+    sdns_free(srv);
 }
 
 void sdns_free_rr_PTR(sdns_rr_PTR* ptr){
     if (NULL == ptr)
         return;
-    free(ptr->PTRDNAME);
-    free(ptr);
+    sdns_free(ptr->PTRDNAME);
+    sdns_free(ptr);
 }
 
 void sdns_free_rr_CNAME(sdns_rr_CNAME* cname){
     if (NULL == cname)
         return;
-    free(cname->CNAME);
-    free(cname);
+    sdns_free(cname->CNAME);
+    sdns_free(cname);
 }
 
 //initialize an A record structure
-// this function either returns successfully or abort() the whole code
+// returns NULL if we can not allocate memory
 sdns_rr_A * sdns_init_rr_A(uint32_t ipaddress){
-    sdns_rr_A * a = (sdns_rr_A*) malloc_or_abort(sizeof(sdns_rr_A));
+    sdns_rr_A * a = (sdns_rr_A*) sdns_malloc(sizeof(sdns_rr_A));
+    if (NULL == a)
+        return NULL;
     a->address = ipaddress;
     return a;
 }
@@ -1333,18 +1791,18 @@ sdns_rr_A * sdns_init_rr_A(uint32_t ipaddress){
 void sdns_free_rr_TXT(sdns_rr_TXT * txt){
     if (NULL == txt)
         return;
-    free(txt->character_string.content);
+    sdns_free(txt->character_string.content);
     sdns_rr_TXT * tmp = txt->next;
-    free(txt);
+    sdns_free(txt);
     while (tmp){
         txt = tmp->next;
-        free(tmp);
+        sdns_free(tmp);
         tmp = txt;
     }
 }
 
 void sdns_free_rr_A(sdns_rr_A * a){
-    free(a);
+    sdns_free(a);
 }
 
 
@@ -1360,7 +1818,11 @@ sdns_rr_A * sdns_decode_rr_A(sdns_context * ctx, sdns_rr * rr){
         ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
         return NULL;
     }
-    sdns_rr_A * A = (sdns_rr_A*) malloc_or_abort(sizeof(sdns_rr_A));
+    sdns_rr_A * A = (sdns_rr_A*) sdns_malloc(sizeof(sdns_rr_A));
+    if (NULL == A){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     A->address = (((uint8_t)rr->rdata[0] & 0xFF) << 24) | ((uint8_t)rr->rdata[1] << 16);
     A->address += ((uint8_t)rr->rdata[2] << 8) | ((uint8_t)rr->rdata[3]);
     ctx->err = 0;   // success
@@ -1376,8 +1838,12 @@ sdns_rr_AAAA * sdns_decode_rr_AAAA(sdns_context * ctx, sdns_rr * rr){
         ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
         return NULL;
     }
-    sdns_rr_AAAA * aaaa = sdns_init_rr_AAAA(NULL);
-    aaaa->address = mem_copy(rr->rdata, 16);
+    sdns_rr_AAAA * aaaa = sdns_init_rr_AAAA(mem_copy(rr->rdata, 16));
+    if (NULL == aaaa || NULL == aaaa->address){
+        sdns_free_rr_AAAA(aaaa);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     ctx->err = 0;   //success
     return aaaa;
 }
@@ -1386,6 +1852,10 @@ sdns_rr_L32 * sdns_decode_rr_L32(sdns_context * ctx, sdns_rr * rr){
     if (rr == NULL || ctx == NULL)
         return NULL;        // we should never hit this!
     sdns_rr_L32 * l32 = sdns_init_rr_L32(0, 0);
+    if (NULL == l32){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     uint16_t rr_len = rr->rdlength;
     char * tmp = rr->rdata;
     uint16_t cnt = 0;
@@ -1410,6 +1880,10 @@ sdns_rr_L64 * sdns_decode_rr_L64(sdns_context * ctx, sdns_rr * rr){
     if (rr == NULL || ctx == NULL)
         return NULL;        // we should never hit this!
     sdns_rr_L64 * l64 = sdns_init_rr_L64(0, NULL);
+    if (NULL == l64){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     uint16_t rr_len = rr->rdlength;
     char * tmp = rr->rdata;
     uint16_t cnt = 0;
@@ -1422,6 +1896,11 @@ sdns_rr_L64 * sdns_decode_rr_L64(sdns_context * ctx, sdns_rr * rr){
     l64->Preference = (((uint8_t)tmp[cnt] << 8) & 0xFF00) | ((uint8_t)tmp[cnt + 1] & 0x00FF);
     cnt += 2;
     l64->Locator64 = mem_copy(tmp + cnt, 8);
+    if (NULL == l64->Locator64){
+        sdns_free_rr_L64(l64);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     // reset the error code and return the pointer
     ctx->err = sdns_rcode_NoError;
     return l64;
@@ -1451,7 +1930,12 @@ sdns_rr_LP * sdns_decode_rr_LP(sdns_context * ctx, sdns_rr * rr){
         ctx->err = sdns_rcode_FormErr;
         return NULL;
     }
-    lp->FQDN = strdup(buffer_label);
+    lp->FQDN = sdns_strdup(buffer_label);
+    if (NULL == lp->FQDN){
+        sdns_free_rr_LP(lp);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     ctx->err = 0;   // success
     return lp;
 }
@@ -1460,7 +1944,10 @@ sdns_rr_CAA * sdns_decode_rr_CAA(sdns_context * ctx, sdns_rr * rr){
     if (rr == NULL || ctx == NULL)
         return NULL;        // impossible to hit
     sdns_rr_CAA * caa = sdns_init_rr_CAA(0, NULL, 0, NULL, 0);
-    // don't need to check if caa is NULL or not. if it's null, the code breaks
+    if (NULL == caa){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     ctx->cursor = rr->rdata;
     if (ctx->raw_len - (ctx->cursor - ctx->raw) < rr->rdlength){
         ERROR("packet is not long enough.....");
@@ -1499,6 +1986,11 @@ sdns_rr_CAA * sdns_decode_rr_CAA(sdns_context * ctx, sdns_rr * rr){
         return NULL;
     }
     caa->tag = mem_copy(rdata + cnt, caa->tag_len);
+    if (NULL == caa->tag){
+        sdns_free_rr_CAA(caa);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     int val_len = rdlength - 2 - caa->tag_len;
     if (val_len < 0){
         ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
@@ -1508,6 +2000,11 @@ sdns_rr_CAA * sdns_decode_rr_CAA(sdns_context * ctx, sdns_rr * rr){
     if (val_len == 0)   // we are done
         return caa;
     caa->value = mem_copy(rdata + cnt + caa->tag_len, val_len);
+    if (NULL == caa->value){
+        sdns_free_rr_CAA(caa);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     caa->value_len = val_len;
     return caa;
 }   
@@ -1516,6 +2013,10 @@ sdns_rr_NID * sdns_decode_rr_NID(sdns_context * ctx, sdns_rr * rr){
     if (rr == NULL || ctx == NULL)
         return NULL;        // we should never hit this!
     sdns_rr_NID * nid = sdns_init_rr_NID(0, NULL);
+    if (NULL == nid){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     uint16_t rr_len = rr->rdlength;
     char * tmp = rr->rdata;
     uint16_t cnt = 0;
@@ -1528,14 +2029,21 @@ sdns_rr_NID * sdns_decode_rr_NID(sdns_context * ctx, sdns_rr * rr){
     nid->Preference = (((uint8_t)tmp[cnt] << 8) & 0xFF00) | ((uint8_t)tmp[cnt + 1] & 0x00FF);
     cnt += 2;
     nid->NodeId = mem_copy(tmp + cnt, 8);        // it's always 8 bytes so we don't need to keep the length
+    if (NULL == nid->NodeId){
+        sdns_free_rr_NID(nid);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     // reset the error code and return the pointer
     ctx->err = sdns_rcode_NoError;
     return nid;
 }
 
-// either is successful or abort the code
+// returns NULL if we can not allocate memory
 sdns_rr_AAAA* sdns_init_rr_AAAA(char * addr){
-    sdns_rr_AAAA * aaaa = (sdns_rr_AAAA*) malloc_or_abort(sizeof(sdns_rr_AAAA));
+    sdns_rr_AAAA * aaaa = (sdns_rr_AAAA*) sdns_malloc(sizeof(sdns_rr_AAAA));
+    if (NULL == aaaa)
+        return NULL;
     aaaa->address = addr;
     return aaaa;
 }
@@ -1544,12 +2052,16 @@ sdns_rr_AAAA* sdns_init_rr_AAAA(char * addr){
 void sdns_free_rr_AAAA(sdns_rr_AAAA * aaaa){
     if (NULL == aaaa)
         return;
-    free(aaaa->address);
-    free(aaaa);
+    sdns_free(aaaa->address);
+    sdns_free(aaaa);
 }
 
 sdns_rr_SRV * sdns_decode_rr_SRV(sdns_context * ctx, sdns_rr * rr){
     sdns_rr_SRV * srv = sdns_init_rr_SRV(0, 0, 0, NULL);
+    if (NULL == srv){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     uint16_t rr_len = rr->rdlength;
     if (rr_len < 6){  // priority + weight + port
         sdns_free_rr_SRV(srv);
@@ -1571,13 +2083,22 @@ sdns_rr_SRV * sdns_decode_rr_SRV(sdns_context * ctx, sdns_rr * rr){
         ctx->err = sdns_rcode_FormErr;
         return NULL;
     }
-    srv->Target = strdup(buffer_label);
+    srv->Target = sdns_strdup(buffer_label);
+    if (NULL == srv->Target){
+        sdns_free_rr_SRV(srv);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     ctx->err = 0;       // success
     return srv;
 }
 
 sdns_rr_URI * sdns_decode_rr_URI(sdns_context * ctx, sdns_rr* rr){
     sdns_rr_URI * uri = sdns_init_rr_URI(0, 0, NULL, 0);
+    if (NULL == uri){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     uint16_t rr_len = rr->rdlength;
     if (rr_len < 4){
         sdns_free_rr_URI(uri);
@@ -1595,7 +2116,12 @@ sdns_rr_URI * sdns_decode_rr_URI(sdns_context * ctx, sdns_rr* rr){
         return uri;
     }
     uri->target_len = rr_len - cnt;
-    char * target = (char*) malloc_or_abort(uri->target_len);
+    char * target = (char*) sdns_malloc(uri->target_len);
+    if (NULL == target){
+        sdns_free_rr_URI(uri);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     memcpy(target, tmp+cnt, uri->target_len);
     uri->Target = target;
     ctx->err = 0;   // success
@@ -1604,6 +2130,10 @@ sdns_rr_URI * sdns_decode_rr_URI(sdns_context * ctx, sdns_rr* rr){
 
 sdns_rr_RRSIG * sdns_decode_rr_RRSIG(sdns_context * ctx, sdns_rr * rr){
     sdns_rr_RRSIG * rrsig = sdns_init_rr_RRSIG(0, 0, 0, 0, 0, 0, 0, NULL, NULL, 0);
+    if (NULL == rrsig){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     uint16_t cnt = 0;
     uint16_t rr_len = rr->rdlength;
     if (rr_len < 18){
@@ -1636,14 +2166,24 @@ sdns_rr_RRSIG * sdns_decode_rr_RRSIG(sdns_context * ctx, sdns_rr * rr){
         ctx->err = sdns_rcode_FormErr;
         return NULL;
     }
-    rrsig->signers_name = strdup(buffer_label);
+    rrsig->signers_name = sdns_strdup(buffer_label);
+    if (NULL == rrsig->signers_name){
+        sdns_free_rr_RRSIG(rrsig);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     // RFC4034#section-3.1.7: A sender MUST NOT use DNS name compression on the 
     // Signer's Name field when transmitting a RRSIG RR. Therefore, the label
     // is not compressed => len(label) = strlen(buffer_label) + 1
     cnt += strlen(buffer_label) + 1;
     // the remaining len from rr->rdlength is for 'Signature'
     rrsig->signature_len = rr_len - cnt;
-    rrsig->signature = (char*) malloc_or_abort(rrsig->signature_len);
+    rrsig->signature = (char*) sdns_malloc(rrsig->signature_len);
+    if (NULL == rrsig->signature){
+        sdns_free_rr_RRSIG(rrsig);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     memcpy(rrsig->signature, tmp + cnt, rrsig->signature_len);
     ctx->err = 0;       // success
     return rrsig;
@@ -1662,12 +2202,28 @@ sdns_rr_TXT * sdns_decode_rr_TXT(sdns_context * ctx, sdns_rr * rr){
     uint8_t to_copy = 0;
     uint16_t cnt = 0;
     sdns_rr_TXT * last = original;
-    char * buffer = (char*)malloc_or_abort(rr->rdlength);
-    dyn_buffer * db = dyn_buffer_init(buffer, rr->rdlength, 0);
+    char * buffer = (char*)sdns_malloc(rr->rdlength);
+    dyn_buffer * db = NULL == buffer?NULL:dyn_buffer_init(buffer, rr->rdlength, 0);
+    if (NULL == original || NULL == db){
+        sdns_free_rr_TXT(original);
+        sdns_free(buffer);
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     char * offset = NULL;
     while (cnt < rr->rdlength){
         if (NULL == txt){
             txt = sdns_init_rr_TXT(NULL, 0);
+            if (NULL == txt){
+                // the buffer belongs to the first string if we have one
+                if (original->character_string.content == NULL)
+                    dyn_buffer_free(db);
+                else
+                    sdns_free(db);
+                sdns_free_rr_TXT(original);
+                ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+                return NULL;
+            }
         }
         offset = db->buffer + db->cursor;
         if (ctx->raw_len - ((rr->rdata + cnt) - ctx->raw) < 1){
@@ -1693,7 +2249,7 @@ sdns_rr_TXT * sdns_decode_rr_TXT(sdns_context * ctx, sdns_rr * rr){
             ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
             if (db != NULL){
                 db->buffer = NULL;
-                free(db);
+                sdns_free(db);
             }
             return NULL;
         }
@@ -1708,7 +2264,7 @@ sdns_rr_TXT * sdns_decode_rr_TXT(sdns_context * ctx, sdns_rr * rr){
             ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
             if (db != NULL){
                 db->buffer = NULL;
-                free(db);
+                sdns_free(db);
             }
             return NULL;
         }
@@ -1724,18 +2280,98 @@ sdns_rr_TXT * sdns_decode_rr_TXT(sdns_context * ctx, sdns_rr * rr){
         }
         txt = NULL;
     }
-    free(db);
+    sdns_free(db);
     ctx->err = 0;   // success
     return original;
 }
 
+// walks the character-strings of TXT rdata and fills the first 'max' spans
+static int _txt_spans(const char * rdata, uint16_t rdlength, sdns_txt_span * spans, uint16_t max, uint16_t * count){
+    if (rdata == NULL || rdlength == 0)      // empty txt is not allowed
+        return SDNS_ERROR_RR_SECTION_MALFORMED;
+    uint32_t cnt = 0;
+    uint16_t n = 0;
+    while (cnt < rdlength){
+        uint8_t len = (uint8_t) rdata[cnt];
+        if (rdlength - cnt - 1 < len)
+            return SDNS_ERROR_RR_SECTION_MALFORMED;
+        if (n < max){
+            spans[n].offset = cnt + 1;
+            spans[n].len = len;
+        }
+        n++;
+        cnt += 1 + len;
+    }
+    *count = n;
+    return n > max?SDNS_ERROR_BUFFER_TOO_SHORT:sdns_rcode_NoError;
+}
+
+int sdns_view_TXT(const sdns_rr_view * view, sdns_txt_span * spans, uint16_t max, uint16_t * count){
+    if (NULL == view || NULL == count || (NULL == spans && max > 0) || view->type != sdns_rr_type_TXT)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    return _txt_spans(view->rdata, view->rdlength, spans, max, count);
+}
+
+int sdns_txt_spans(sdns_context * ctx, sdns_rr * rr, sdns_txt_span * spans, uint16_t max, uint16_t * count){
+    if (NULL == ctx || NULL == rr || NULL == count || (NULL == spans && max > 0))
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (rr->type != sdns_rr_type_TXT || rr->decoded)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (ctx->raw != NULL && rr->rdata != NULL &&
+        (rr->rdata < ctx->raw || rr->rdata + rr->rdlength > ctx->raw + ctx->raw_len))
+        return SDNS_ERROR_RR_SECTION_MALFORMED;
+    return _txt_spans(rr->rdata, rr->rdlength, spans, max, count);
+}
+
+int sdns_txt_join(sdns_context * ctx, sdns_rr * rr, char * buffer, uint32_t buffer_len, uint16_t * len){
+    if (NULL == ctx || NULL == rr || NULL == buffer || NULL == len || rr->type != sdns_rr_type_TXT)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    uint32_t total = 0;
+    if (rr->decoded){
+        for (sdns_rr_TXT * txt = (sdns_rr_TXT*)rr->psdns_rr; txt; txt = txt->next)
+            total += txt->character_string.len;
+        // a decoded RR can have more than the 65535 bytes of an rdata
+        if (total > 0xFFFF)
+            return SDNS_ERROR_CHARACTER_STRING_TOO_LONG;
+        *len = (uint16_t) total;
+        if (total >= buffer_len)
+            return SDNS_ERROR_BUFFER_TOO_SHORT;
+        total = 0;
+        for (sdns_rr_TXT * txt = (sdns_rr_TXT*)rr->psdns_rr; txt; txt = txt->next){
+            memcpy(buffer + total, txt->character_string.content, txt->character_string.len);
+            total += txt->character_string.len;
+        }
+        buffer[total] = '\0';
+        return sdns_rcode_NoError;
+    }
+    uint16_t count = 0;
+    int res = sdns_txt_spans(ctx, rr, NULL, 0, &count);
+    if (res != sdns_rcode_NoError && res != SDNS_ERROR_BUFFER_TOO_SHORT)
+        return res;
+    // every string has one length byte
+    total = rr->rdlength - count;
+    *len = (uint16_t) total;
+    if (total >= buffer_len)
+        return SDNS_ERROR_BUFFER_TOO_SHORT;
+    uint32_t cnt = 0;
+    total = 0;
+    while (cnt < rr->rdlength){
+        uint8_t l = (uint8_t) rr->rdata[cnt];
+        memcpy(buffer + total, rr->rdata + cnt + 1, l);
+        total += l;
+        cnt += 1 + l;
+    }
+    buffer[total] = '\0';
+    return sdns_rcode_NoError;
+}
+
 
 void sdns_free_rr_SOA(sdns_rr_SOA * soa){
    if (NULL == soa)
        return;
-   free(soa->mname);
-   free(soa->rname);
-   free(soa);
+   sdns_free(soa->mname);
+   sdns_free(soa->rname);
+   sdns_free(soa);
 }
 
 sdns_rr_NS * sdns_decode_rr_NS(sdns_context * ctx, sdns_rr * rr){
@@ -1744,12 +2380,17 @@ sdns_rr_NS * sdns_decode_rr_NS(sdns_context * ctx, sdns_rr * rr){
         return NULL;
     }
     sdns_rr_NS * ns = sdns_init_rr_NS(NULL);
+    if (NULL == ns){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     char * name = NULL;
     ctx->cursor = rr->rdata;
     int res = decode_name(ctx, &name);
     if (res != sdns_rcode_NoError){
         ERROR("Error in parsing name of the NS record: %d\n", res);
-        ctx->err = sdns_rcode_FormErr;
+        ctx->err = res == SDNS_ERROR_MEMORY_ALLOC_FAILED?res:sdns_rcode_FormErr;
+        sdns_free(ns);
         return NULL;
     }
     INFO("parsed NSDNAME is: %s\n", name);
@@ -1763,12 +2404,17 @@ sdns_rr_PTR * sdns_decode_rr_PTR(sdns_context * ctx, sdns_rr * rr){
     if (ctx == NULL || rr == NULL)
         return NULL;
     sdns_rr_PTR * ptr = sdns_init_rr_PTR(NULL);
+    if (NULL == ptr){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     char * name = NULL;
     ctx->cursor = rr->rdata;
     int res = decode_name(ctx, &name);
     if (res != sdns_rcode_NoError){
-        ctx->err = sdns_rcode_FormErr;
+        ctx->err = res == SDNS_ERROR_MEMORY_ALLOC_FAILED?res:sdns_rcode_FormErr;
         ERROR("Error in parsing name of the PTR record: %d\n", res);
+        sdns_free(ptr);
         return NULL;
     }
     ptr->PTRDNAME = name;
@@ -1780,12 +2426,17 @@ sdns_rr_CNAME * sdns_decode_rr_CNAME(sdns_context * ctx, sdns_rr * rr){
     if (ctx == NULL || rr == NULL)
         return NULL;
     sdns_rr_CNAME * cname = sdns_init_rr_CNAME(NULL);
+    if (NULL == cname){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     char * name = NULL;
     ctx->cursor = rr->rdata;
     int res = decode_name(ctx, &name);
     if (res != sdns_rcode_NoError){
         ERROR("Error in parsing name of the NS record: %d\n", res);
-        ctx->err = sdns_rcode_FormErr;
+        ctx->err = res == SDNS_ERROR_MEMORY_ALLOC_FAILED?res:sdns_rcode_FormErr;
+        sdns_free(cname);
         return NULL;
     }
     cname->CNAME = name;
@@ -1798,6 +2449,10 @@ sdns_rr_SOA * sdns_decode_rr_SOA(sdns_context * ctx, sdns_rr * rr){
     if (ctx == NULL || rr == NULL)
         return NULL;
     sdns_rr_SOA * soa = sdns_init_rr_SOA(NULL, NULL, 0, 0, 0, 0, 0);
+    if (NULL == soa){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     // we assume that we have enough data in the `rr` as we have already parsed it as an rr
     char * name = NULL;
     ctx->cursor = rr->rdata;
@@ -1811,6 +2466,8 @@ sdns_rr_SOA * sdns_decode_rr_SOA(sdns_context * ctx, sdns_rr * rr){
     int res = decode_name(ctx, &name);
     if (res != sdns_rcode_NoError){
         ERROR("Error in parsing mname of soa record: %d\n", res);
+        sdns_free_rr_SOA(soa);
+        ctx->err = res == SDNS_ERROR_MEMORY_ALLOC_FAILED?res:sdns_rcode_FormErr;
         return NULL;
     }
     soa->mname = name;
@@ -1818,6 +2475,8 @@ sdns_rr_SOA * sdns_decode_rr_SOA(sdns_context * ctx, sdns_rr * rr){
     res = decode_name(ctx, &name);
     if (res != sdns_rcode_NoError){
         ERROR("Error in parsing rname of soa record: %d\n", res);
+        sdns_free_rr_SOA(soa);
+        ctx->err = res == SDNS_ERROR_MEMORY_ALLOC_FAILED?res:sdns_rcode_FormErr;
         return NULL;
     }
     soa->rname = name;
@@ -1838,6 +2497,412 @@ sdns_rr_SOA * sdns_decode_rr_SOA(sdns_context * ctx, sdns_rr * rr){
 }
 
 
+// decodes the RRs of the section from ctx->cursor and sets the start of the next section
+static int _decode_section(sdns_context * ctx, int section){
+    sdns_rr ** head = NULL;
+    sdns_section_index * idx = NULL;
+    uint16_t * count = NULL;
+    _section_parts(ctx->msg, section, &head, &idx, &count);
+    sdns_rr * rrs = NULL;
+    if (*count > 0){
+        int res = decode_rr_from_buffer(ctx, &rrs, *count);
+        if (res != sdns_rcode_NoError){
+            ERROR("Error happend in decoding section %d: %d", section, res);
+            return res;
+        }
+        if (section != DNS_SECTION_ADDITIONAL && check_if_section_is_valid(rrs, DNS_SECTION_ANSWER) != 0){
+            ERROR("Error invalid RR found in section %d", section);
+            _free_unknown_rr(rrs);
+            ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
+            return SDNS_ERROR_RR_SECTION_MALFORMED;
+        }
+    }
+    *head = rrs;
+    _section_index_build(ctx, *head, idx);
+    if (section < DNS_SECTION_ADDITIONAL)
+        ctx->section_offset[section + 1] = ctx->cursor - ctx->raw;
+    return sdns_rcode_NoError;
+}
+
+// skips 'count' RRs from ctx->cursor and only checks their structure (nothing is allocated)
+static int _skip_section(sdns_context * ctx, uint16_t count){
+    for (uint16_t i = 0; i < count; ++i){
+        int res = decode_name_to_buffer(ctx, NULL, NULL);
+        if (res != sdns_rcode_NoError)
+            return res;
+        // type, class, ttl and rdlength
+        if (ctx->raw_len < (ctx->cursor - ctx->raw + 10))
+            return sdns_rcode_FormErr;
+        uint16_t rdlength = read_uint16_from_buffer(ctx->cursor + 8);
+        // rdata itself is checked when it's decoded but it must be in the packet
+        if (rdlength > ctx->raw_len - (ctx->cursor - ctx->raw) - 10)
+            return SDNS_ERROR_RR_SECTION_MALFORMED;
+        ctx->cursor += 10 + rdlength;
+    }
+    return sdns_rcode_NoError;
+}
+
+// reads the 12 bytes of the header from buff (caller checks the length)
+static void decode_header(char * buff, sdns_header * header){
+    char * tmp_buff = buff;
+    header->id = read_uint16_from_buffer(tmp_buff);
+    tmp_buff += 2;
+    uint16_t flags = read_uint16_from_buffer(tmp_buff);
+    tmp_buff += 2;
+    header->qr = (flags & SDNS_QR_MASK) >> 15;
+    header->opcode = (flags & SDNS_OPCODE_MASK) >> 11;
+    header->aa = (flags & SDNS_AA_MASK) >> 10;
+    header->tc = (flags & SDNS_TC_MASK) >> 9;
+    header->rd = (flags & SDNS_RD_MASK) >> 8;
+    header->ra = (flags & SDNS_RA_MASK) >> 7;
+    header->z = (flags & SDNS_Z_MASK) >> 6;
+    header->AD = (flags & SDNS_AD_MASK) >> 5;
+    header->CD = (flags & SDNS_CD_MASK) >> 4;
+    header->rcode = (flags & SDNS_RCODE_MASK);
+    header->qdcount = read_uint16_from_buffer(tmp_buff);
+    tmp_buff += 2;
+    header->ancount = read_uint16_from_buffer(tmp_buff);
+    tmp_buff += 2;
+    header->nscount = read_uint16_from_buffer(tmp_buff);
+    tmp_buff += 2;
+    header->arcount = read_uint16_from_buffer(tmp_buff);
+}
+
+int sdns_peek_header(char * buff, uint16_t buff_len, sdns_header * header){
+    if (NULL == buff || NULL == header || 0 == buff_len)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    if (buff_len < DNS_HEADER_LENGTH)
+        return SDNS_ERROR_INVALID_DNS_PACKET;
+    decode_header(buff, header);
+    return sdns_rcode_NoError;
+}
+
+int sdns_peek_question(char * buff, uint16_t buff_len, sdns_question * question, char * qname){
+    if (NULL == question)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    sdns_header header;
+    int res = sdns_peek_header(buff, buff_len, &header);
+    if (res != sdns_rcode_NoError)
+        return res;
+    if (header.qdcount == 0)
+        return SDNS_ERROR_NO_QUESTION_FOUND;
+    if (header.qdcount > 1)
+        return SDNS_ERROR_MORE_THAN_ONE_QUESTION_FOUND;
+    // a context on the stack, only raw, raw_len and cursor are used by the name decoder
+    sdns_context ctx;
+    memset(&ctx, 0x00, sizeof(sdns_context));
+    ctx.raw = buff;
+    ctx.raw_len = buff_len;
+    ctx.cursor = buff + DNS_HEADER_LENGTH;
+    res = decode_name_to_buffer(&ctx, qname, &question->qname_hash);
+    if (res != sdns_rcode_NoError)
+        return res;
+    question->qname = qname;
+    question->qname_offset = DNS_HEADER_LENGTH;
+    question->qname_len = ctx.cursor - buff - DNS_HEADER_LENGTH;
+    if (ctx.raw_len - (ctx.cursor - ctx.raw) < 4)   // we need four bytes for class and type
+        return sdns_rcode_FormErr;
+    question->qtype = read_uint16_from_buffer(ctx.cursor);
+    if (! check_if_qtype_is_valid(question->qtype))
+        return sdns_rcode_FormErr;
+    question->qclass = read_uint16_from_buffer(ctx.cursor + 2);
+    if (! check_if_qclass_is_valid(question->qclass))
+        return sdns_rcode_FormErr;
+    return sdns_rcode_NoError;
+}
+
+int sdns_scan_message(char * buff, uint16_t buff_len, sdns_message_layout * layout,
+                      sdns_rr_span * spans, uint32_t spans_len){
+    sdns_header header;
+    int res = sdns_peek_header(buff, buff_len, &header);
+    if (res != sdns_rcode_NoError)
+        return res;
+    if (header.qdcount > 1)
+        return SDNS_ERROR_MORE_THAN_ONE_QUESTION_FOUND;
+    // a context on the stack, only raw, raw_len and cursor are used by the name decoder
+    sdns_context ctx;
+    memset(&ctx, 0x00, sizeof(sdns_context));
+    ctx.raw = buff;
+    ctx.raw_len = buff_len;
+    ctx.cursor = buff + DNS_HEADER_LENGTH;
+    sdns_message_layout tmp_layout;
+    if (NULL == layout)
+        layout = &tmp_layout;
+    memset(layout, 0x00, sizeof(sdns_message_layout));
+    layout->section_offset[DNS_SECTION_QUESTION] = DNS_HEADER_LENGTH;
+    if (header.qdcount == 1){
+        res = decode_name_to_buffer(&ctx, NULL, NULL);
+        if (res != sdns_rcode_NoError)
+            return res;
+        if (ctx.raw_len - (ctx.cursor - ctx.raw) < 4)   // qtype and qclass
+            return sdns_rcode_FormErr;
+        ctx.cursor += 4;
+    }
+    uint16_t counts[4] = {0, header.ancount, header.nscount, header.arcount};
+    for (int section = DNS_SECTION_ANSWER; section <= DNS_SECTION_ADDITIONAL; ++section){
+        layout->section_offset[section] = ctx.cursor - ctx.raw;
+        for (uint16_t i = 0; i < counts[section]; ++i){
+            uint16_t offset = ctx.cursor - ctx.raw;
+            res = decode_name_to_buffer(&ctx, NULL, NULL);
+            if (res != sdns_rcode_NoError)
+                return res;
+            // type, class, ttl and rdlength
+            if (ctx.raw_len < (ctx.cursor - ctx.raw + 10))
+                return sdns_rcode_FormErr;
+            uint16_t type = read_uint16_from_buffer(ctx.cursor);
+            uint16_t rdlength = read_uint16_from_buffer(ctx.cursor + 8);
+            ctx.cursor += 10;
+            if (ctx.raw_len < (ctx.cursor - ctx.raw + rdlength))
+                return SDNS_ERROR_RR_SECTION_MALFORMED;
+            if (spans != NULL && layout->rr_count < spans_len){
+                sdns_rr_span * span = spans + layout->rr_count;
+                span->offset = offset;
+                span->rdata_offset = ctx.cursor - ctx.raw;
+                span->rdlength = rdlength;
+                span->type = type;
+                span->section = section;
+            }
+            layout->rr_count += 1;
+            ctx.cursor += rdlength;
+        }
+    }
+    layout->end = ctx.cursor - ctx.raw;
+    return sdns_rcode_NoError;
+}
+
+// skips the name at 'at' without following the pointers (we only need to know where it ends)
+static int _wire_skip_name(char * buff, uint16_t buff_len, uint32_t * at){
+    uint32_t i = *at;
+    while (i < buff_len){
+        uint8_t b = (uint8_t)buff[i];
+        if (b == 0){
+            *at = i + 1;
+            return sdns_rcode_NoError;
+        }
+        if ((b & 0xC0) == 0xC0){
+            if (i + 2 > buff_len)
+                break;
+            *at = i + 2;
+            return sdns_rcode_NoError;
+        }
+        if (b & 0xC0)
+            break;
+        i += b + 1;
+    }
+    return sdns_rcode_FormErr;
+}
+
+// walks the RRs of a packet to change them in place (sdns_patch_*)
+typedef struct {
+    char * buff;
+    uint16_t buff_len;
+    uint32_t at;            // start of the next RR
+    uint32_t left;          // number of RRs we have not seen yet
+} _wire_walk;
+
+static int _wire_walk_begin(_wire_walk * w, char * buff, uint16_t buff_len){
+    if (NULL == buff || 0 == buff_len)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    if (buff_len < DNS_HEADER_LENGTH)
+        return SDNS_ERROR_INVALID_DNS_PACKET;
+    w->buff = buff;
+    w->buff_len = buff_len;
+    w->at = DNS_HEADER_LENGTH;
+    w->left = (uint32_t)read_uint16_from_buffer(buff + 6) + read_uint16_from_buffer(buff + 8) +
+              read_uint16_from_buffer(buff + 10);
+    uint16_t qdcount = read_uint16_from_buffer(buff + 4);
+    for (uint16_t i=0; i< qdcount; ++i){
+        int res = _wire_skip_name(buff, buff_len, &w->at);
+        if (res != sdns_rcode_NoError)
+            return res;
+        w->at += 4;         // qtype and qclass
+        if (w->at > buff_len)
+            return sdns_rcode_FormErr;
+    }
+    return sdns_rcode_NoError;
+}
+
+// *fixed is the offset of the type of the next RR (class, TTL and rdlength are after it) or 0 at the end
+static int _wire_walk_next(_wire_walk * w, uint16_t * fixed){
+    *fixed = 0;
+    if (w->left == 0)
+        return sdns_rcode_NoError;
+    int res = _wire_skip_name(w->buff, w->buff_len, &w->at);
+    if (res != sdns_rcode_NoError)
+        return res;
+    if (w->at + 10 > w->buff_len)
+        return sdns_rcode_FormErr;
+    uint16_t rdlength = read_uint16_from_buffer(w->buff + w->at + 8);
+    if (w->at + 10 + rdlength > w->buff_len)
+        return SDNS_ERROR_RR_SECTION_MALFORMED;
+    *fixed = w->at;
+    w->at += 10 + rdlength;
+    w->left -= 1;
+    return sdns_rcode_NoError;
+}
+
+int sdns_patch_id(char * buff, uint16_t buff_len, uint16_t id){
+    if (NULL == buff || 0 == buff_len)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    if (buff_len < DNS_HEADER_LENGTH)
+        return SDNS_ERROR_INVALID_DNS_PACKET;
+    buff[0] = (id >> 8) & 0xFF;
+    buff[1] = id & 0xFF;
+    return sdns_rcode_NoError;
+}
+
+int sdns_patch_flags(char * buff, uint16_t buff_len, uint16_t mask, uint16_t flags){
+    if (NULL == buff || 0 == buff_len)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    if (buff_len < DNS_HEADER_LENGTH)
+        return SDNS_ERROR_INVALID_DNS_PACKET;
+    uint16_t value = (read_uint16_from_buffer(buff + 2) & ~mask) | (flags & mask);
+    buff[2] = (value >> 8) & 0xFF;
+    buff[3] = value & 0xFF;
+    return sdns_rcode_NoError;
+}
+
+int sdns_patch_ttl(char * buff, uint16_t buff_len, uint32_t elapsed, uint32_t * min_ttl){
+    _wire_walk w;
+    int res = _wire_walk_begin(&w, buff, buff_len);
+    if (res != sdns_rcode_NoError)
+        return res;
+    uint32_t min = 0xFFFFFFFF;
+    uint16_t fixed = 0;
+    while ((res = _wire_walk_next(&w, &fixed)) == sdns_rcode_NoError && fixed != 0){
+        // the TTL of OPT is the extended rcode and the flags
+        if (read_uint16_from_buffer(buff + fixed) == sdns_rr_type_OPT)
+            continue;
+        char * p = buff + fixed + 4;
+        uint32_t ttl = read_uint32_from_buffer(p);
+        ttl = ttl > elapsed?ttl - elapsed:0;
+        p[0] = (ttl >> 24) & 0xFF;
+        p[1] = (ttl >> 16) & 0xFF;
+        p[2] = (ttl >> 8) & 0xFF;
+        p[3] = ttl & 0xFF;
+        if (ttl < min)
+            min = ttl;
+    }
+    if (min_ttl != NULL)
+        *min_ttl = min == 0xFFFFFFFF?0:min;
+    return res;
+}
+
+int sdns_patch_udp_size(char * buff, uint16_t buff_len, uint16_t udp_size){
+    _wire_walk w;
+    int res = _wire_walk_begin(&w, buff, buff_len);
+    if (res != sdns_rcode_NoError)
+        return res;
+    uint16_t fixed = 0;
+    while ((res = _wire_walk_next(&w, &fixed)) == sdns_rcode_NoError && fixed != 0){
+        if (read_uint16_from_buffer(buff + fixed) == sdns_rr_type_OPT){
+            buff[fixed + 2] = (udp_size >> 8) & 0xFF;
+            buff[fixed + 3] = udp_size & 0xFF;
+            return sdns_rcode_NoError;
+        }
+    }
+    return res != sdns_rcode_NoError?res:SDNS_ERROR_NO_ADDITIONAL_FOUND;
+}
+
+int sdns_iter_begin(sdns_context * ctx, sdns_rr_iter * it){
+    if (NULL == ctx || NULL == it)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (NULL == ctx->raw || ctx->raw_len < DNS_HEADER_LENGTH)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    _wire_walk w;
+    uint32_t at = ctx->section_offset[DNS_SECTION_ANSWER];
+    if (at == 0){
+        // we don't know where the question ends
+        int res = _wire_walk_begin(&w, ctx->raw, ctx->raw_len);
+        if (res != sdns_rcode_NoError)
+            return res;
+        at = w.at;
+    }
+    it->ctx = ctx;
+    it->at = at;
+    for (int i=0; i< 3; ++i)
+        it->left[i] = read_uint16_from_buffer(ctx->raw + 6 + 2 * i);
+    return sdns_rcode_NoError;
+}
+
+int sdns_iter_next(sdns_rr_iter * it, sdns_rr_view * view){
+    if (NULL == it || NULL == view)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    int i = 0;
+    while (i < 3 && it->left[i] == 0)
+        i++;
+    if (i == 3)
+        return 0;
+    _wire_walk w = {it->ctx->raw, it->ctx->raw_len, it->at, 1};
+    uint16_t fixed = 0;
+    int res = _wire_walk_next(&w, &fixed);
+    if (res != sdns_rcode_NoError)
+        return res;
+    char * p = it->ctx->raw + fixed;
+    view->section = DNS_SECTION_ANSWER + i;
+    view->name_offset = it->at;
+    view->type = read_uint16_from_buffer(p);
+    view->class = read_uint16_from_buffer(p + 2);
+    view->ttl = read_uint32_from_buffer(p + 4);
+    view->rdlength = read_uint16_from_buffer(p + 8);
+    view->rdata = view->rdlength > 0?p + 10:NULL;
+    it->at = w.at;
+    it->left[i] -= 1;
+    return 1;
+}
+
+int sdns_view_name(sdns_context * ctx, const sdns_rr_view * view, char * name){
+    if (NULL == ctx || NULL == view || NULL == name)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (NULL == ctx->raw || view->name_offset >= ctx->raw_len)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    return decode_name_at(ctx, view->name_offset, name);
+}
+
+int sdns_view_A(const sdns_rr_view * view, uint32_t * address){
+    if (NULL == view || NULL == address || view->type != sdns_rr_type_A)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (view->rdlength != 4)
+        return SDNS_ERROR_RR_SECTION_MALFORMED;
+    *address = read_uint32_from_buffer((char*)view->rdata);
+    return sdns_rcode_NoError;
+}
+
+int sdns_view_AAAA(const sdns_rr_view * view, char * address){
+    if (NULL == view || NULL == address || view->type != sdns_rr_type_AAAA)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (view->rdlength != 16)
+        return SDNS_ERROR_RR_SECTION_MALFORMED;
+    memcpy(address, view->rdata, 16);
+    return sdns_rcode_NoError;
+}
+
+int sdns_view_target(sdns_context * ctx, const sdns_rr_view * view, char * name){
+    if (NULL == ctx || NULL == view || NULL == name)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    // where the name starts in the rdata
+    uint16_t skip = 0;
+    switch (view->type){
+        case sdns_rr_type_NS:
+        case sdns_rr_type_CNAME:
+        case sdns_rr_type_PTR:
+        case sdns_rr_type_DNAME:
+            break;
+        case sdns_rr_type_MX:
+            skip = 2;
+            break;
+        case sdns_rr_type_SRV:
+            skip = 6;
+            break;
+        default:
+            return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    }
+    if (NULL == ctx->raw || view->rdata == NULL || view->rdlength <= skip ||
+        view->rdata < ctx->raw || view->rdata + view->rdlength > ctx->raw + ctx->raw_len)
+        return SDNS_ERROR_RR_SECTION_MALFORMED;
+    return decode_name_at(ctx, view->rdata + skip - ctx->raw, name);
+}
+
 int sdns_from_wire(sdns_context * ctx){
     if (NULL == ctx)
         return SDNS_ERROR_BUFFER_IS_NULL;
@@ -1851,29 +2916,14 @@ int sdns_from_wire(sdns_context * ctx){
         return SDNS_ERROR_INVALID_DNS_PACKET;
     char * tmp_buff = ctx->raw;
     unsigned int consumed = 0;
-    ctx->msg->header.id = read_uint16_from_buffer(tmp_buff);
-    tmp_buff += 2;
-    uint16_t flags = read_uint16_from_buffer(tmp_buff);
-    tmp_buff += 2;
-    ctx->msg->header.qr = (flags & SDNS_QR_MASK) >> 15;
-    ctx->msg->header.opcode = (flags & SDNS_OPCODE_MASK) >> 11;
-    ctx->msg->header.aa = (flags & SDNS_AA_MASK) >> 10;
-    ctx->msg->header.tc = (flags & SDNS_TC_MASK) >> 9;
-    ctx->msg->header.rd = (flags & SDNS_RD_MASK) >> 8;
-    ctx->msg->header.ra = (flags & SDNS_RA_MASK) >> 7;
-    ctx->msg->header.z = (flags & SDNS_Z_MASK) >> 6;
-    ctx->msg->header.AD = (flags & SDNS_AD_MASK) >> 5;
-    ctx->msg->header.CD = (flags & SDNS_CD_MASK) >> 4;
-    ctx->msg->header.rcode = (flags & SDNS_RCODE_MASK);
-    ctx->msg->header.qdcount = read_uint16_from_buffer(tmp_buff);
-    tmp_buff += 2;
-    ctx->msg->header.ancount = read_uint16_from_buffer(tmp_buff);
-    tmp_buff += 2;
-    ctx->msg->header.nscount = read_uint16_from_buffer(tmp_buff);
-    tmp_buff += 2;
-    ctx->msg->header.arcount = read_uint16_from_buffer(tmp_buff);
-    tmp_buff += 2;
+    decode_header(tmp_buff, &ctx->msg->header);
+    tmp_buff += DNS_HEADER_LENGTH;
     consumed += DNS_HEADER_LENGTH;      // we have consumed DNS header (12 bytes)
+    ctx->cursor = tmp_buff;   // make sure we keep the cursor to know where we should start reading
+    ctx->pending = 0;
+    _name_memo_invalidate(ctx, ctx->msg->header.ancount + ctx->msg->header.nscount +
+                               ctx->msg->header.arcount >= NAME_MEMO_MIN_RRS);
+    ctx->section_offset[DNS_SECTION_AUTHORITY] = ctx->section_offset[DNS_SECTION_ADDITIONAL] = 0;
     
     // if we have a question, we need to set the question part
     if (ctx->msg->header.qdcount > 0){
@@ -1881,113 +2931,165 @@ int sdns_from_wire(sdns_context * ctx){
         if (ctx->msg->header.qdcount > 1)
            return SDNS_ERROR_MORE_THAN_ONE_QUESTION_FOUND;
         // let's parse the question section
-        ctx->cursor = tmp_buff;   // make sure we keep the cursor to know where we should start reading
         int q_result = decode_question_from_buffer(ctx);
         if (q_result != sdns_rcode_NoError){
             ERROR("Error happened in decoding question section: %d", q_result);
             return q_result;
         }
     }
-    if (ctx->msg->header.ancount > 0){
-        sdns_rr * section = NULL;
-        int an_result = decode_rr_from_buffer(ctx, &section, ctx->msg->header.ancount);
-        if (an_result != sdns_rcode_NoError){
-            ERROR("Error happend in decoding answer seciton: %d", an_result);
-            return an_result;
-        }
-        if (check_if_section_is_valid(section, DNS_SECTION_ANSWER) != 0){
-            ERROR("Error invalid section found in answer part");
-            ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
-            return SDNS_ERROR_RR_SECTION_MALFORMED;
-        }
-        ctx->msg->answer = section;
-    }else{
-        ctx->msg->answer = NULL;
+    ctx->section_offset[DNS_SECTION_ANSWER] = ctx->cursor - ctx->raw;
+    if (ctx->flags & SDNS_CTX_LAZY){
+        // the rest is decoded on demand (sdns_decode_section())
+        ctx->pending = (1 << DNS_SECTION_ANSWER) | (1 << DNS_SECTION_AUTHORITY) | (1 << DNS_SECTION_ADDITIONAL);
+        return sdns_rcode_NoError;
     }
-    if (ctx->msg->header.nscount > 0){
-        sdns_rr * section = NULL;
-        int ns_result = decode_rr_from_buffer(ctx, &section, ctx->msg->header.nscount);
-        if (ns_result != sdns_rcode_NoError){
-            ERROR("Error happend in decoding authority seciton: %d", ns_result);
-            return ns_result;
-        }
-        if (check_if_section_is_valid(section, DNS_SECTION_ANSWER) != 0){
-            ERROR("Error invalid section found in answer part");
-            ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
-            return SDNS_ERROR_RR_SECTION_MALFORMED;
-        }
-        ctx->msg->authority = section;
-    }else{
-        ctx->msg->authority = NULL;
+    for (int section = DNS_SECTION_ANSWER; section <= DNS_SECTION_ADDITIONAL; ++section){
+        int res = _decode_section(ctx, section);
+        if (res != sdns_rcode_NoError)
+            return res;
     }
-    if (ctx->msg->header.arcount > 0){
-        sdns_rr * section = NULL;
-        int ar_result = decode_rr_from_buffer(ctx, &section, ctx->msg->header.arcount);
-        if (ar_result != sdns_rcode_NoError){
-            ERROR("Error happend in decoding additional seciton: %d", ar_result);
-            // what should be free here?
-            sdns_free_message(ctx->msg);
-            ctx->msg = NULL;
-            return ar_result;
-        }
-        ctx->msg->additional = section;
-    }else{
-        ctx->msg->additional = NULL;
+    return sdns_rcode_NoError;
+}
+
+int sdns_decode_section(sdns_context * ctx, int section){
+    if (NULL == ctx || NULL == ctx->msg)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    if (section < DNS_SECTION_ANSWER || section > DNS_SECTION_ADDITIONAL)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (!(ctx->pending & (1 << section)))
+        return sdns_rcode_NoError;      // nothing to do
+    char * cursor = ctx->cursor;
+    int res = sdns_rcode_NoError;
+    // find the start of the section by skipping the previous ones
+    uint16_t counts[4] = {0, ctx->msg->header.ancount, ctx->msg->header.nscount, ctx->msg->header.arcount};
+    for (int s = DNS_SECTION_ANSWER; s < section && res == sdns_rcode_NoError; ++s){
+        if (ctx->section_offset[s + 1] != 0)
+            continue;
+        ctx->cursor = ctx->raw + ctx->section_offset[s];
+        res = _skip_section(ctx, counts[s]);
+        if (res == sdns_rcode_NoError)
+            ctx->section_offset[s + 1] = ctx->cursor - ctx->raw;
+    }
+    if (res == sdns_rcode_NoError){
+        ctx->cursor = ctx->raw + ctx->section_offset[section];
+        res = _decode_section(ctx, section);
+    }
+    ctx->cursor = cursor;
+    if (res != sdns_rcode_NoError){
+        ctx->err = res;
+        return res;
     }
+    ctx->pending &= ~(1 << section);
     return sdns_rcode_NoError;
 }
 
-static int _encode_write_section(sdns_context * ctx, dyn_buffer * db, sdns_rr * section){
-    sdns_rr * tmprr = section;
-    char buffer[260];
+// writes one RR (owner name, type, class, ttl and rdata)
+static int _encode_write_one_rr(sdns_context * ctx, dyn_buffer * db, sdns_rr * tmprr){
     char tmp_byte[10];
     int res;
-    while (tmprr){
-        memset(buffer, 0x00, 260);
-        DEBUG("encode label compressed name: %s", tmprr->name);
-        res = _encode_label_compressed(tmprr->name, db, buffer);
-        DEBUG("DONE encode label compressed name: %s", tmprr->name);
-        if (res != SDNS_ERROR_ELSIMPLE && res != SDNS_ERROR_ELCOMPRESSED){
-            ERROR("Can not compress the name of the answer section....");
+    DEBUG("encode label compressed name: %s", tmprr->name);
+    res = _encode_name(ctx, db, tmprr->name, 1);
+    if (res != sdns_rcode_NoError){
+        ERROR("Can not compress the name of the answer section....");
+        return res;
+    }
+    // write type
+    tmp_byte[0] = (tmprr->type >> 8) & 0xFF;
+    tmp_byte[1] = (tmprr->type) & 0xFF;
+    dyn_buffer_append(db, tmp_byte, 2);
+
+    // write class
+    tmp_byte[0] = (tmprr->class >> 8) & 0xFF;
+    tmp_byte[1] = (tmprr->class) & 0xFF;
+    dyn_buffer_append(db, tmp_byte, 2);
+
+    // write ttl
+    if (tmprr->type == sdns_rr_type_OPT){
+        tmp_byte[0] = (uint8_t)(tmprr->opt_ttl.extended_rcode & 0xFF);
+        tmp_byte[1] = (uint8_t)(tmprr->opt_ttl.version & 0xFF);
+        tmp_byte[2] = ((uint8_t)((tmprr->opt_ttl.DO & 0x01) << 7))  | ((uint8_t)(tmprr->opt_ttl.Z & 0x7F));
+        tmp_byte[3] = (uint8_t)(tmprr->opt_ttl.Z & 0xFF);
+        
+    }else{
+        tmp_byte[0] = (tmprr->ttl >> 24) & 0xFF;
+        tmp_byte[1] = (tmprr->ttl >> 16) & 0xFF;
+        tmp_byte[2] = (tmprr->ttl >> 8) & 0xFF;
+        tmp_byte[3] = (tmprr->ttl) & 0xFF;
+    }
+    dyn_buffer_append(db, tmp_byte, 4);
+
+    if (tmprr->decoded){
+        res = _encode_write_rr(ctx, db, tmprr);
+        if (res != sdns_rcode_NoError)
             return res;
-        }
-        dyn_buffer_append(db, buffer, res == SDNS_ERROR_ELSIMPLE?strlen(buffer)+1:strlen(buffer));
-        // write type
-        tmp_byte[0] = (tmprr->type >> 8) & 0xFF;
-        tmp_byte[1] = (tmprr->type) & 0xFF;
+    }else{
+        // it's already encoded
+        tmp_byte[0] = (tmprr->rdlength >> 8) & 0xFF;
+        tmp_byte[1] = (tmprr->rdlength) & 0xFF;
         dyn_buffer_append(db, tmp_byte, 2);
+    }
+    return sdns_rcode_NoError;
+}
 
-        // write class
-        tmp_byte[0] = (tmprr->class >> 8) & 0xFF;
-        tmp_byte[1] = (tmprr->class) & 0xFF;
-        dyn_buffer_append(db, tmp_byte, 2);
+// the size limit of the packet we are encoding (see sdns_to_wire_limit())
+typedef struct {
+    unsigned long int max;      // the RRs (but OPT) must end before this cursor of the buffer, 0 for no limit
+    int full;                   // an RRset did not fit, the next RRs (but OPT) are dropped
+    uint16_t count;             // number of RRs we wrote from the last section
+} _encode_limit;
+
+// same owner name (case-insensitive), type and class
+static int _same_rrset(sdns_rr * a, sdns_rr * b){
+    if (a->type != b->type || a->class != b->class)
+        return 0;
+    if (a->name == NULL || b->name == NULL)
+        return a->name == b->name;
+    const char * x = a->name;
+    const char * y = b->name;
+    for (; *x && *y; ++x, ++y){
+        char cx = *x >= 'A' && *x <= 'Z'?*x + 32:*x;
+        char cy = *y >= 'A' && *y <= 'Z'?*y + 32:*y;
+        if (cx != cy)
+            return 0;
+    }
+    return *x == *y;
+}
 
-        // write ttl
-        if (tmprr->type == sdns_rr_type_OPT){
-            tmp_byte[0] = (uint8_t)(tmprr->opt_ttl.extended_rcode & 0xFF);
-            tmp_byte[1] = (uint8_t)(tmprr->opt_ttl.version & 0xFF);
-            tmp_byte[2] = ((uint8_t)((tmprr->opt_ttl.DO & 0x01) << 7))  | ((uint8_t)(tmprr->opt_ttl.Z & 0x7F));
-            tmp_byte[3] = (uint8_t)(tmprr->opt_ttl.Z & 0xFF);
-            
-        }else{
-            tmp_byte[0] = (tmprr->ttl >> 24) & 0xFF;
-            tmp_byte[1] = (tmprr->ttl >> 16) & 0xFF;
-            tmp_byte[2] = (tmprr->ttl >> 8) & 0xFF;
-            tmp_byte[3] = (tmprr->ttl) & 0xFF;
+// writes the RRs of the section. with a limit, the RRset that goes beyond it is dropped completely
+// and so are all the RRs after it
+static int _encode_write_section(sdns_context * ctx, dyn_buffer * db, sdns_rr * section, _encode_limit * limit){
+    sdns_rr * tmprr = section;
+    int res;
+    sdns_rr * rrset = NULL;                 // first RR of the RRset we are writing
+    unsigned long int rrset_cursor = 0;
+    unsigned int rrset_mark = 0;
+    uint16_t rrset_count = 0;
+    limit->count = 0;
+    while (tmprr){
+        if (limit->full && tmprr->type != sdns_rr_type_OPT){
+            tmprr = tmprr->next;
+            continue;
         }
-        dyn_buffer_append(db, tmp_byte, 4);
-
-        if (tmprr->decoded){
-            res = _encode_write_rr(ctx, db, tmprr);
-            if (res != sdns_rcode_NoError){
-                // free something?
-                return res;
-            }
+        if (limit->max > 0 && (rrset == NULL || !_same_rrset(rrset, tmprr))){
+            rrset = tmprr;
+            rrset_cursor = db->cursor;
+            rrset_mark = _compress_mark(ctx);
+            rrset_count = limit->count;
+        }
+        res = _encode_write_one_rr(ctx, db, tmprr);
+        if (res != sdns_rcode_NoError)
+            return res;
+        if (limit->max > 0 && tmprr->type != sdns_rr_type_OPT &&
+            (db->cursor > limit->max || (db->fixed && db->failed))){
+            // go back to the start of the RRset
+            db->cursor = rrset_cursor;
+            if (db->fixed)
+                db->failed = 0;
+            _compress_rewind(ctx, rrset_mark);
+            limit->count = rrset_count;
+            limit->full = 1;
         }else{
-            // it's already encoded
-            tmp_byte[0] = (tmprr->rdlength >> 8) & 0xFF;
-            tmp_byte[1] = (tmprr->rdlength) & 0xFF;
-            dyn_buffer_append(db, tmp_byte, 2);
+            limit->count += 1;
         }
         // next rr
         tmprr = tmprr->next;
@@ -2007,138 +3109,759 @@ static int _encode_write_section(sdns_context * ctx, dyn_buffer * db, sdns_rr *
  * possible values for error:
  *  - -2 the user-provided buffer is not big enough
  */
-int sdns_to_wire(sdns_context * ctx){
-    if (!ctx)
-        return SDNS_ERROR_BUFFER_TOO_SHORT;
-    dyn_buffer * db = dyn_buffer_init(ctx->raw, ctx->raw_len, ctx->cursor - ctx->raw);
-    if (NULL == db)
-        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
-    char tmp_byte[8] = {0x00};
-    char tmpbuff[4] = {0};
-
-    tmp_byte[0] = (ctx->msg->header.id >> 8) & 0xFF;
-    tmp_byte[1] = (ctx->msg->header.id) & 0xFF;
-    dyn_buffer_append(db, tmp_byte, 2);
-    
-    // first 8 bits of flags
-    tmpbuff[0] = 0x00;
-    tmpbuff[0] |= ctx->msg->header.qr > 0?0b10000000:0x00;
-    tmpbuff[0] |= (ctx->msg->header.opcode << 3);
-    tmpbuff[0] |= (ctx->msg->header.aa << 2);
-    tmpbuff[0] |= (ctx->msg->header.tc << 1);
-    tmpbuff[0] |= (ctx->msg->header.rd & 0x01);
-    dyn_buffer_append(db, tmpbuff, 1);
- 
-    // second 8 bits of flags
-    tmpbuff[0] = 0x00;
-    tmpbuff[0] |= (ctx->msg->header.ra << 7);
-    tmpbuff[0] |= (ctx->msg->header.z << 6);
-    tmpbuff[0] |= (ctx->msg->header.AD << 5);
-    tmpbuff[0] |= (ctx->msg->header.CD << 4);
-    tmpbuff[0] |= (ctx->msg->header.rcode & 0x0F);
-    dyn_buffer_append(db, tmpbuff, 1);
-
-
-    tmp_byte[0] = (ctx->msg->header.qdcount >> 8) & 0xFF;
-    tmp_byte[1] = (ctx->msg->header.qdcount) & 0xFF;
-    dyn_buffer_append(db, tmp_byte, 2);
+// decodes all the names that are still views into the raw buffer
+static int _materialize_names(sdns_context * ctx){
+    sdns_rr * sections[3] = {ctx->msg->answer, ctx->msg->authority, ctx->msg->additional};
+    if (sdns_get_qname(ctx) == NULL && ctx->msg->question.qname_len > 0)
+        return ctx->err;
+    for (int i=0; i< 3; ++i){
+        for (sdns_rr * tmp = sections[i]; tmp; tmp = tmp->next){
+            if (sdns_get_rr_name(ctx, tmp) == NULL && tmp->name_len > 0)
+                return ctx->err;
+        }
+    }
+    return sdns_rcode_NoError;
+}
 
+// upper bound of the encoded name (one byte for each label length and the last zero)
+static unsigned long int _name_wire_size(char * name){
+    return name == NULL?1:strlen(name) + 2;
+}
 
-    tmp_byte[0] = (ctx->msg->header.ancount >> 8) & 0xFF;
-    tmp_byte[1] = (ctx->msg->header.ancount) & 0xFF;
-    dyn_buffer_append(db, tmp_byte, 2);
+// upper bound of the bytes _encode_write_section() writes for one RR
+static unsigned long int _rr_wire_size(sdns_rr * rr){
+    unsigned long int size = _name_wire_size(rr->name) + 10;   // type, class, ttl and rdlength
+    if (!rr->decoded)
+        return size + rr->rdlength;
+    if (rr->type == sdns_rr_type_OPT){
+        for (sdns_opt_rdata * opt = rr->opt_rdata; opt; opt = opt->next)
+            size += 4 + opt->option_length;
+        return size;
+    }
+    if (NULL == rr->psdns_rr)
+        return size;
+    switch (rr->type){
+        case sdns_rr_type_A:
+            return size + 4;
+        case sdns_rr_type_AAAA:
+            return size + 16;
+        case sdns_rr_type_NS:
+            return size + _name_wire_size(((sdns_rr_NS*)rr->psdns_rr)->NSDNAME);
+        case sdns_rr_type_PTR:
+            return size + _name_wire_size(((sdns_rr_PTR*)rr->psdns_rr)->PTRDNAME);
+        case sdns_rr_type_CNAME:
+            return size + _name_wire_size(((sdns_rr_CNAME*)rr->psdns_rr)->CNAME);
+        case sdns_rr_type_MX:
+            return size + 2 + _name_wire_size(((sdns_rr_MX*)rr->psdns_rr)->exchange);
+        case sdns_rr_type_SOA:
+            return size + 20 + _name_wire_size(((sdns_rr_SOA*)rr->psdns_rr)->mname) +
+                   _name_wire_size(((sdns_rr_SOA*)rr->psdns_rr)->rname);
+        case sdns_rr_type_SRV:
+            return size + 6 + _name_wire_size(((sdns_rr_SRV*)rr->psdns_rr)->Target);
+        case sdns_rr_type_RRSIG:
+            return size + 18 + _name_wire_size(((sdns_rr_RRSIG*)rr->psdns_rr)->signers_name) +
+                   ((sdns_rr_RRSIG*)rr->psdns_rr)->signature_len;
+        case sdns_rr_type_TXT:
+            for (sdns_rr_TXT * txt = (sdns_rr_TXT*)rr->psdns_rr; txt; txt = txt->next)
+                size += 1 + txt->character_string.len;
+            return size;
+        case sdns_rr_type_HINFO:
+            return size + 2 + ((sdns_rr_HINFO*)rr->psdns_rr)->cpu_len + ((sdns_rr_HINFO*)rr->psdns_rr)->os_len;
+        case sdns_rr_type_CAA:
+            return size + 2 + ((sdns_rr_CAA*)rr->psdns_rr)->tag_len + ((sdns_rr_CAA*)rr->psdns_rr)->value_len;
+        case sdns_rr_type_NID:
+        case sdns_rr_type_L64:
+            return size + 10;
+        case sdns_rr_type_L32:
+            return size + 6;
+    }
+    return size;
+}
 
+unsigned long int sdns_wire_size_estimate(sdns_context * ctx){
+    if (NULL == ctx || NULL == ctx->msg)
+        return 0;
+    sdns_message * msg = ctx->msg;
+    unsigned long int size = 12 + _name_wire_size(msg->question.qname) + 4;
+    if (msg->header.ancount > 0)
+        for (sdns_rr * rr = msg->answer; rr; rr = rr->next)
+            size += _rr_wire_size(rr);
+    if (msg->header.nscount > 0)
+        for (sdns_rr * rr = msg->authority; rr; rr = rr->next)
+            size += _rr_wire_size(rr);
+    if (msg->header.arcount > 0)
+        for (sdns_rr * rr = msg->additional; rr; rr = rr->next)
+            size += _rr_wire_size(rr);
+    return size;
+}
 
-    tmp_byte[0] = (ctx->msg->header.nscount >> 8) & 0xFF;
-    tmp_byte[1] = (ctx->msg->header.nscount) & 0xFF;
-    dyn_buffer_append(db, tmp_byte, 2);
+// decodes what we need before encoding the context (the sections we have not decoded yet and the names
+// in name-view mode)
+static int _prepare_to_encode(sdns_context * ctx){
+    for (int section = DNS_SECTION_ANSWER; section <= DNS_SECTION_ADDITIONAL; ++section){
+        // we are going to write over the raw buffer
+        int dres = sdns_decode_section(ctx, section);
+        if (dres != sdns_rcode_NoError)
+            return dres;
+    }
+    if (ctx->flags & SDNS_CTX_NAME_VIEW){
+        // names must be decoded before we write over the raw buffer
+        int mres = _materialize_names(ctx);
+        if (mres != sdns_rcode_NoError)
+            return mres;
+    }
+    return sdns_rcode_NoError;
+}
 
+// writes the 12 bytes of the header (one append, it's the first thing of every packet)
+static void _encode_write_header(dyn_buffer * db, sdns_header * header){
+    char tmp_byte[DNS_HEADER_LENGTH] = {0x00};
+    uint16_t counts[4] = {header->qdcount, header->ancount, header->nscount, header->arcount};
 
+    tmp_byte[0] = (header->id >> 8) & 0xFF;
+    tmp_byte[1] = (header->id) & 0xFF;
+    // first 8 bits of flags
+    tmp_byte[2] |= header->qr > 0?0b10000000:0x00;
+    tmp_byte[2] |= (header->opcode << 3);
+    tmp_byte[2] |= (header->aa << 2);
+    tmp_byte[2] |= (header->tc << 1);
+    tmp_byte[2] |= (header->rd & 0x01);
+    // second 8 bits of flags
+    tmp_byte[3] |= (header->ra << 7);
+    tmp_byte[3] |= (header->z << 6);
+    tmp_byte[3] |= (header->AD << 5);
+    tmp_byte[3] |= (header->CD << 4);
+    tmp_byte[3] |= (header->rcode & 0x0F);
+    for (int i=0; i< 4; ++i){
+        tmp_byte[4 + 2 * i] = (counts[i] >> 8) & 0xFF;
+        tmp_byte[5 + 2 * i] = counts[i] & 0xFF;
+    }
+    dyn_buffer_append(db, tmp_byte, DNS_HEADER_LENGTH);
+}
 
-    tmp_byte[0] = (ctx->msg->header.arcount >> 8) & 0xFF;
-    tmp_byte[1] = (ctx->msg->header.arcount) & 0xFF;
-    dyn_buffer_append(db, tmp_byte, 2);
+// writes the whole message to 'db'. if max_size is not 0, the packet is not longer than max_size
+static int _encode_message(sdns_context * ctx, dyn_buffer * db, unsigned long int max_size){
+    unsigned long int start = db->cursor;
+    _encode_limit limit = {0, 0, 0};
+    uint16_t count[3] = {0, 0, 0};          // RRs we wrote from answer, authority and additional
+    _compress_reset(ctx);
+    char tmp_byte[8] = {0x00};
+    _encode_write_header(db, &ctx->msg->header);
 
-    char buffer[260] = {0x00};
     int res;
     // end of writing header part
     DEBUG("let's to wire the question section....");
-    if (ctx->msg->question.qname == NULL){
-        dyn_buffer_append(db, tmpbuff + 3, 1);  // we just add 0x00 to the buffer
-    }else{
-        if (strlen(ctx->msg->question.qname) > 255){
-            dyn_buffer_free(db);
-            ctx->raw = NULL;
-            ctx->raw_len = 0;
-            ctx->err = SDNS_ERROR_HOSTNAME_TOO_LONG;
-            return SDNS_ERROR_HOSTNAME_TOO_LONG;
-        }
-        // encode the label and store it
-        memset(buffer, 0x00, 260);
-        res = _encode_label_simple(ctx->msg->question.qname, buffer);
-        if (res != SDNS_ERROR_ELSIMPLE){
-            dyn_buffer_free(db);
-            ctx->raw = NULL;
-            ctx->raw_len = 0;
-            ERROR("Encoding name for question\n");
-            ctx->err = res;
-            return res;
-        }
-        dyn_buffer_append(db, buffer, strlen(buffer)+1);
+    // a NULL qname is the root
+    struct _sdns_qname_wire * qw = ctx->qname_wire;
+    res = sdns_rcode_NoError;
+    if (_qname_wire_matches(qw, ctx->msg->question.qname))
+        _encode_qname_wire(ctx, db, qw);
+    else
+        res = _encode_name(ctx, db, ctx->msg->question.qname, 1);
+    if (res != sdns_rcode_NoError){
+        ERROR("Encoding name for question\n");
+        return res;
     }
 
     tmp_byte[0] = (ctx->msg->question.qtype >> 8) & 0xFF;
     tmp_byte[1] = (ctx->msg->question.qtype) & 0xFF;
-    dyn_buffer_append(db, tmp_byte, 2);
-
-    tmp_byte[0] = (ctx->msg->question.qclass >> 8) & 0xFF;
-    tmp_byte[1] = (ctx->msg->question.qclass) & 0xFF;
-    dyn_buffer_append(db, tmp_byte, 2);
+    tmp_byte[2] = (ctx->msg->question.qclass >> 8) & 0xFF;
+    tmp_byte[3] = (ctx->msg->question.qclass) & 0xFF;
+    dyn_buffer_append(db, tmp_byte, 4);
     // end of question section
 
+    if (max_size > 0){
+        // the OPT RR is never dropped, we keep its space from the beginning
+        unsigned long int opt_size = 0;
+        if (ctx->msg->header.arcount > 0){
+            for (sdns_rr * tmp = ctx->msg->additional; tmp; tmp = tmp->next)
+                if (tmp->type == sdns_rr_type_OPT)
+                    opt_size += _rr_wire_size(tmp);
+        }
+        if (db->failed || db->cursor + opt_size > start + max_size)
+            return SDNS_ERROR_BUFFER_IS_SMALL;
+        limit.max = start + max_size - opt_size;
+    }
+
     // let's do the answer section
     if (ctx->msg->header.ancount > 0){
         INFO("start writing answer section.....");
-        res = _encode_write_section(ctx, db, ctx->msg->answer);
-        if (res != sdns_rcode_NoError){
-            ctx->err = res;
-            dyn_buffer_free(db);
-            ctx->raw = NULL;
-            ctx->raw_len = 0;
+        res = _encode_write_section(ctx, db, ctx->msg->answer, &limit);
+        if (res != sdns_rcode_NoError)
             return res;
-        }
+        count[0] = limit.count;
     }
+    // the answer is not complete: the client has to try again with TCP
+    int truncated = limit.full;
     // let's do the authority section
     if (ctx->msg->header.nscount > 0){
         INFO("start writing authority section.....");
-        res = _encode_write_section(ctx, db, ctx->msg->authority);
-        if (res != sdns_rcode_NoError){
-            ctx->err = res;
-            dyn_buffer_free(db);
-            ctx->raw = NULL;
-            ctx->raw_len = 0;
+        res = _encode_write_section(ctx, db, ctx->msg->authority, &limit);
+        if (res != sdns_rcode_NoError)
             return res;
-        }
+        count[1] = limit.count;
     }
     // let's do the additional section
     if (ctx->msg->header.arcount > 0){
         INFO("start writing additional section.....");
-        res = _encode_write_section(ctx, db, ctx->msg->additional);
-        if (res != sdns_rcode_NoError){
-            ctx->err = res;
-            dyn_buffer_free(db);
-            ctx->raw = NULL;
-            ctx->raw_len = 0;
+        res = _encode_write_section(ctx, db, ctx->msg->additional, &limit);
+        if (res != sdns_rcode_NoError)
             return res;
+        count[2] = limit.count;
+    }
+    if (db->failed)     // no memory or no space
+        return db->fixed?SDNS_ERROR_BUFFER_IS_SMALL:SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    if (max_size > 0){
+        if (db->cursor - start > max_size)
+            return SDNS_ERROR_BUFFER_IS_SMALL;
+        // the number of RRs we really wrote
+        char * header = db->buffer + start;
+        if (truncated)
+            header[2] |= 0x02;
+        for (int i=0; i< 3; ++i){
+            header[6 + 2 * i] = (count[i] >> 8) & 0xFF;
+            header[7 + 2 * i] = count[i] & 0xFF;
         }
     }
+    return sdns_rcode_NoError;
+}
+
+int sdns_to_wire(sdns_context * ctx){
+    return sdns_to_wire_limit(ctx, 0);
+}
+
+int sdns_to_wire_limit(sdns_context * ctx, uint16_t max_size){
+    if (!ctx)
+        return SDNS_ERROR_BUFFER_TOO_SHORT;
+    int res = _prepare_to_encode(ctx);
+    if (res != sdns_rcode_NoError)
+        return res;
+    // a borrowed buffer is not ours to grow, the packet gets a new one
+    int borrowed = ctx->flags & SDNS_CTX_BORROWED;
+    dyn_buffer * db = borrowed?dyn_buffer_init(NULL, 0, 0):dyn_buffer_init(ctx->raw, ctx->raw_len, ctx->cursor - ctx->raw);
+    if (NULL == db)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    if (borrowed)
+        ctx->flags &= ~SDNS_CTX_BORROWED;
+    // allocate once for the whole packet (if it fails, we still grow while writing)
+    unsigned long int estimate = sdns_wire_size_estimate(ctx);
+    dyn_buffer_reserve(db, max_size > 0 && estimate > max_size?max_size:estimate);
+    res = _encode_message(ctx, db, max_size);
+    // the offsets of the sections were in the old buffer (sdns_iter_begin() finds them again)
+    memset(ctx->section_offset, 0x00, sizeof(ctx->section_offset));
+    if (res != sdns_rcode_NoError){
+        ctx->err = res;
+        dyn_buffer_free(db);
+        ctx->raw = NULL;
+        ctx->raw_len = 0;
+        return res;
+    }
     // we are done
     ctx->raw = db->buffer;
     ctx->raw_len = db->cursor;
-    free(db);       // we don't use dyn_buffer_free() here
+    sdns_free(db);       // we don't use dyn_buffer_free() here
+    _name_memo_invalidate(ctx, 0);
+    return 0;
+}
+
+uint16_t sdns_max_udp_response(sdns_context * query){
+    uint16_t size = 512;
+    if (NULL == query || NULL == query->msg)
+        return size;
+    if (sdns_decode_section(query, DNS_SECTION_ADDITIONAL) != sdns_rcode_NoError)
+        return size;
+    if (query->msg->header.arcount > 0){
+        for (sdns_rr * tmp = query->msg->additional; tmp; tmp = tmp->next){
+            // values below 512 are treated as 512 (RFC6891)
+            if (tmp->type == sdns_rr_type_OPT && tmp->udp_size > size)
+                return tmp->udp_size;
+        }
+    }
+    return size;
+}
+
+int sdns_to_wire_into(sdns_context * ctx, char * buff, uint16_t buff_len, uint16_t * len){
+    if (NULL == ctx || NULL == len)
+        return SDNS_ERROR_BUFFER_TOO_SHORT;
+    *len = 0;
+    if (NULL == buff)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    int res = _prepare_to_encode(ctx);
+    if (res != sdns_rcode_NoError)
+        return res;
+    dyn_buffer db;
+    dyn_buffer_init_fixed(&db, buff, buff_len);
+    res = _encode_message(ctx, &db, ctx->flags & SDNS_CTX_TRUNCATE?buff_len:0);
+    if (res != sdns_rcode_NoError){
+        ctx->err = res;
+        return res;
+    }
+    *len = db.cursor;
+    return 0;
+}
+
+// encodes the context to 'buff' with the compression table we use for the batch
+static int _batch_encode(sdns_context * ctx, struct _sdns_compress_table ** shared, char * buff,
+                         unsigned long int buff_len, unsigned long int * len){
+    struct _sdns_compress_table * own = ctx->compress;
+    if (*shared != NULL)
+        ctx->compress = *shared;
+    dyn_buffer db;
+    dyn_buffer_init_fixed(&db, buff, buff_len > 0xFFFF?0xFFFF:buff_len);
+    int res = _encode_message(ctx, &db, 0);
+    if (NULL == *shared)
+        *shared = ctx->compress;
+    else
+        ctx->compress = own;
+    *len = db.cursor;
+    return res;
+}
+
+int sdns_to_wire_batch(sdns_context ** ctx, unsigned int n, sdns_iovec * out, sdns_arena * arena){
+    if (NULL == ctx || NULL == out || NULL == arena)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    for (unsigned int i=0; i< n; ++i){
+        out[i].iov_base = NULL;
+        out[i].iov_len = 0;
+    }
+    if (n == 0)
+        return sdns_rcode_NoError;
+    // most of the responses are UDP ones, the bigger ones get their own buffer
+    unsigned long int slab_len = (unsigned long int)n * UDP_PAYLOAD_SIZE;
+    char * slab = (char*) sdns_arena_alloc(arena, slab_len);
+    if (NULL == slab)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    // one compression table for all of them: the table of the first context that has one (or creates it)
+    struct _sdns_compress_table * shared = NULL;
+    unsigned long int at = 0;
+    for (unsigned int i=0; i< n; ++i){
+        sdns_context * c = ctx[i];
+        if (NULL == c)
+            return SDNS_ERROR_BUFFER_IS_NULL;
+        int res = _prepare_to_encode(c);
+        char * buff = slab + at;
+        unsigned long int len = 0;
+        if (res == sdns_rcode_NoError)
+            res = _batch_encode(c, &shared, buff, slab_len - at, &len);
+        if (res == SDNS_ERROR_BUFFER_IS_SMALL){
+            unsigned long int estimate = sdns_wire_size_estimate(c);
+            buff = (char*) sdns_arena_alloc(arena, estimate);
+            res = NULL == buff?SDNS_ERROR_MEMORY_ALLOC_FAILED:_batch_encode(c, &shared, buff, estimate, &len);
+        }else{
+            at += len;
+        }
+        if (res != sdns_rcode_NoError){
+            c->err = res;
+            return res;
+        }
+        out[i].iov_base = buff;
+        out[i].iov_len = len;
+    }
+    return sdns_rcode_NoError;
+}
+
+// a fixed dyn_buffer on the buffer of the writer, positioned at the end of what we wrote
+static void _writer_buffer(sdns_writer * w, dyn_buffer * db){
+    dyn_buffer_init_fixed(db, w->buff, w->buff_len);
+    db->cursor = w->len;
+}
+
+// keeps what we wrote to db or forgets it (and the labels we remembered for it) on failure
+static int _writer_commit(sdns_writer * w, dyn_buffer * db, unsigned int mark, int res){
+    if (res == sdns_rcode_NoError && db->failed)
+        res = SDNS_ERROR_BUFFER_IS_SMALL;
+    if (res != sdns_rcode_NoError){
+        _compress_rewind(w->ctx, mark);
+        return res;
+    }
+    w->len = db->cursor;
+    return sdns_rcode_NoError;
+}
+
+int sdns_writer_begin(sdns_writer * w, sdns_context * ctx, char * buff, uint16_t buff_len, sdns_header * header){
+    if (NULL == w || NULL == ctx || NULL == header)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (NULL == buff)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    w->ctx = ctx;
+    w->buff = buff;
+    w->buff_len = buff_len;
+    w->len = 0;
+    w->qdcount = 0;
+    w->count[0] = w->count[1] = w->count[2] = 0;
+    w->section = DNS_SECTION_ANSWER;
+    // the counts are written by sdns_writer_end()
+    sdns_header tmp = *header;
+    tmp.qdcount = tmp.ancount = tmp.nscount = tmp.arcount = 0;
+    dyn_buffer db;
+    _writer_buffer(w, &db);
+    _encode_write_header(&db, &tmp);
+    if (db.failed)
+        return SDNS_ERROR_BUFFER_IS_SMALL;
+    w->len = db.cursor;
+    _compress_reset(ctx);
+    return sdns_rcode_NoError;
+}
+
+int sdns_writer_question(sdns_writer * w, char * qname, uint16_t qtype, uint16_t qclass){
+    if (NULL == w || NULL == w->ctx)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    // the questions come before all the RRs
+    if (w->count[0] + w->count[1] + w->count[2] > 0)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    char tmp_byte[4];
+    dyn_buffer db;
+    _writer_buffer(w, &db);
+    unsigned int mark = _compress_mark(w->ctx);
+    int res = _encode_name(w->ctx, &db, qname, 1);
+    if (res != sdns_rcode_NoError)
+        return res;
+    tmp_byte[0] = (qtype >> 8) & 0xFF;
+    tmp_byte[1] = qtype & 0xFF;
+    tmp_byte[2] = (qclass >> 8) & 0xFF;
+    tmp_byte[3] = qclass & 0xFF;
+    dyn_buffer_append(&db, tmp_byte, 4);
+    res = _writer_commit(w, &db, mark, sdns_rcode_NoError);
+    if (res == sdns_rcode_NoError)
+        w->qdcount += 1;
+    return res;
+}
+
+// writes rr to the section. if rr is not decoded, 'rdata' is written as its rdata (split to
+// character-strings of 255 bytes if 'split' is 1)
+static int _writer_add(sdns_writer * w, int section, sdns_rr * rr, char * rdata, int split){
+    if (NULL == w || NULL == w->ctx)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    // the sections are written in order
+    if (section < DNS_SECTION_ANSWER || section > DNS_SECTION_ADDITIONAL || section < w->section)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (w->count[section - 1] == 0xFFFF)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    dyn_buffer db;
+    _writer_buffer(w, &db);
+    unsigned int mark = _compress_mark(w->ctx);
+    int res = _encode_write_one_rr(w->ctx, &db, rr);
+    if (res == sdns_rcode_NoError && !rr->decoded && rr->rdlength > 0){
+        if (split){
+            char clen;
+            for (unsigned int i=0; i< rr->rdlength; i += 256){
+                clen = (char)(rr->rdlength - i > 256?255:rr->rdlength - i - 1);
+                dyn_buffer_append(&db, &clen, 1);
+                if (clen != 0)
+                    dyn_buffer_append(&db, rdata + i - i / 256, (uint8_t)clen);
+            }
+        }else{
+            dyn_buffer_append(&db, rdata, rr->rdlength);
+        }
+    }
+    res = _writer_commit(w, &db, mark, res);
+    if (res == sdns_rcode_NoError){
+        w->section = section;
+        w->count[section - 1] += 1;
+    }
+    return res;
+}
+
+static void _writer_rr(sdns_rr * rr, char * name, uint16_t type, uint32_t ttl, void * rdata){
+    memset(rr, 0x00, sizeof(sdns_rr));
+    rr->name = name;
+    rr->type = type;
+    rr->class = sdns_rr_class_IN;
+    rr->ttl = ttl;
+    rr->decoded = 1;
+    rr->psdns_rr = rdata;
+}
+
+int sdns_writer_add_A(sdns_writer * w, int section, char * name, uint32_t ttl, uint32_t address){
+    sdns_rr_A a = {address};
+    sdns_rr rr;
+    _writer_rr(&rr, name, sdns_rr_type_A, ttl, &a);
+    return _writer_add(w, section, &rr, NULL, 0);
+}
+
+int sdns_writer_add_AAAA(sdns_writer * w, int section, char * name, uint32_t ttl, char * address){
+    if (NULL == address)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    sdns_rr_AAAA aaaa = {address};
+    sdns_rr rr;
+    _writer_rr(&rr, name, sdns_rr_type_AAAA, ttl, &aaaa);
+    return _writer_add(w, section, &rr, NULL, 0);
+}
+
+int sdns_writer_add_NS(sdns_writer * w, int section, char * name, uint32_t ttl, char * nsdname){
+    if (NULL == nsdname)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    sdns_rr_NS ns = {nsdname};
+    sdns_rr rr;
+    _writer_rr(&rr, name, sdns_rr_type_NS, ttl, &ns);
+    return _writer_add(w, section, &rr, NULL, 0);
+}
+
+int sdns_writer_add_CNAME(sdns_writer * w, int section, char * name, uint32_t ttl, char * cname){
+    if (NULL == cname)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    sdns_rr_CNAME c = {cname};
+    sdns_rr rr;
+    _writer_rr(&rr, name, sdns_rr_type_CNAME, ttl, &c);
+    return _writer_add(w, section, &rr, NULL, 0);
+}
+
+int sdns_writer_add_PTR(sdns_writer * w, int section, char * name, uint32_t ttl, char * ptrdname){
+    if (NULL == ptrdname)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    sdns_rr_PTR ptr = {ptrdname};
+    sdns_rr rr;
+    _writer_rr(&rr, name, sdns_rr_type_PTR, ttl, &ptr);
+    return _writer_add(w, section, &rr, NULL, 0);
+}
+
+int sdns_writer_add_MX(sdns_writer * w, int section, char * name, uint32_t ttl, uint16_t preference, char * exchange){
+    if (NULL == exchange)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    sdns_rr_MX mx = {preference, exchange};
+    sdns_rr rr;
+    _writer_rr(&rr, name, sdns_rr_type_MX, ttl, &mx);
+    return _writer_add(w, section, &rr, NULL, 0);
+}
+
+int sdns_writer_add_SOA(sdns_writer * w, int section, char * name, uint32_t ttl, char * mname, char * rname,
+                        uint32_t expire, uint32_t minimum, uint32_t refresh, uint32_t retry, uint32_t serial){
+    if (NULL == mname || NULL == rname)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    sdns_rr_SOA soa = {mname, rname, serial, refresh, retry, expire, minimum};
+    sdns_rr rr;
+    _writer_rr(&rr, name, sdns_rr_type_SOA, ttl, &soa);
+    return _writer_add(w, section, &rr, NULL, 0);
+}
+
+int sdns_writer_add_TXT(sdns_writer * w, int section, char * name, uint32_t ttl, char * text, uint16_t text_len){
+    if (NULL == text && text_len > 0)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    // one length byte for each 255 bytes (and one for the empty text)
+    unsigned long int rdlength = text_len + (text_len == 0?1:(text_len + 254) / 255);
+    if (rdlength > 0xFFFF)
+        return SDNS_ERROR_CHARACTER_STRING_TOO_LONG;
+    sdns_rr rr;
+    _writer_rr(&rr, name, sdns_rr_type_TXT, ttl, NULL);
+    rr.decoded = 0;
+    rr.rdlength = (uint16_t)rdlength;
+    return _writer_add(w, section, &rr, text, 1);
+}
+
+int sdns_writer_add_OPT(sdns_writer * w, uint16_t udp_size, uint8_t DO){
+    sdns_rr rr;
+    _writer_rr(&rr, NULL, sdns_rr_type_OPT, 0, NULL);
+    rr.udp_size = udp_size;
+    rr.opt_ttl.DO = DO & 0x01;
+    rr.decoded = 0;
+    return _writer_add(w, DNS_SECTION_ADDITIONAL, &rr, NULL, 0);
+}
+
+int sdns_writer_add_rr(sdns_writer * w, int section, char * name, uint16_t type, uint16_t cls, uint32_t ttl,
+                       char * rdata, uint16_t rdlength){
+    if (NULL == rdata && rdlength > 0)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    sdns_rr rr;
+    _writer_rr(&rr, name, type, ttl, NULL);
+    rr.class = cls;
+    rr.decoded = 0;
+    rr.rdlength = rdlength;
+    return _writer_add(w, section, &rr, rdata, 0);
+}
+
+int sdns_writer_end(sdns_writer * w){
+    if (NULL == w || NULL == w->buff || w->len < 12)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    w->buff[4] = (w->qdcount >> 8) & 0xFF;
+    w->buff[5] = w->qdcount & 0xFF;
+    for (int i=0; i< 3; ++i){
+        w->buff[6 + 2 * i] = (w->count[i] >> 8) & 0xFF;
+        w->buff[7 + 2 * i] = w->count[i] & 0xFF;
+    }
+    return sdns_rcode_NoError;
+}
+
+sdns_template * sdns_template_create(sdns_context * ctx){
+    if (NULL == ctx || NULL == ctx->msg)
+        return NULL;
+    if (ctx->msg->header.qdcount != 1 || NULL == ctx->msg->question.qname){
+        ctx->err = SDNS_ERROR_NO_QUESTION_FOUND;
+        return NULL;
+    }
+    int res = sdns_decode_section(ctx, DNS_SECTION_ADDITIONAL);
+    if (res != sdns_rcode_NoError){
+        ctx->err = res;
+        return NULL;
+    }
+    // the OPT RR goes to the end of the packet, so we can cut it for the queries without EDNS
+    sdns_rr * opt = NULL;
+    sdns_rr * opt_prev = NULL;
+    sdns_rr * last = NULL;
+    for (sdns_rr * tmp = ctx->msg->additional; tmp; tmp = tmp->next){
+        if (tmp->type == sdns_rr_type_OPT && opt == NULL){
+            opt = tmp;
+            opt_prev = last;
+        }
+        last = tmp;
+    }
+    int moved = opt != NULL && opt != last;
+    if (moved){
+        if (opt_prev)
+            opt_prev->next = opt->next;
+        else
+            ctx->msg->additional = opt->next;
+        last->next = opt;
+        opt->next = NULL;
+        _section_index_reset(&ctx->msg->additional_index);
+    }
+    sdns_template * t = (sdns_template*) sdns_calloc(1, sizeof(sdns_template));
+    unsigned long int size = sdns_wire_size_estimate(ctx);
+    char * buff = (char*) sdns_malloc(size > 0xFFFF?0xFFFF:size);
+    uint16_t len = 0;
+    if (NULL == t || NULL == buff)
+        res = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    else
+        res = sdns_to_wire_into(ctx, buff, size > 0xFFFF?0xFFFF:size, &len);
+    if (moved){
+        // back to the order of the caller
+        last->next = NULL;
+        if (opt_prev){
+            opt->next = opt_prev->next;
+            opt_prev->next = opt;
+        }else{
+            opt->next = ctx->msg->additional;
+            ctx->msg->additional = opt;
+        }
+        _section_index_reset(&ctx->msg->additional_index);
+    }
+    if (NULL == t){
+        sdns_free(buff);
+        ctx->err = res;
+        return NULL;
+    }
+    t->raw = buff;
+    t->raw_len = len;
+    sdns_message_layout layout;
+    if (res == sdns_rcode_NoError)
+        res = sdns_scan_message(buff, len, &layout, NULL, 0);
+    sdns_rr_span * spans = NULL;
+    if (res == sdns_rcode_NoError && layout.rr_count > 0){
+        spans = (sdns_rr_span*) sdns_malloc(layout.rr_count * sizeof(sdns_rr_span));
+        t->ttl_offset = (uint16_t*) sdns_malloc(layout.rr_count * sizeof(uint16_t));
+        if (NULL == spans || NULL == t->ttl_offset)
+            res = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        else
+            res = sdns_scan_message(buff, len, NULL, spans, layout.rr_count);
+    }
+    if (res != sdns_rcode_NoError){
+        sdns_free(spans);
+        sdns_template_free(t);
+        ctx->err = res;
+        return NULL;
+    }
+    // the question is the name, qtype and qclass
+    t->qname_len = layout.section_offset[DNS_SECTION_ANSWER] - DNS_HEADER_LENGTH - 4;
+    for (uint32_t i=0; i< layout.rr_count; ++i){
+        if (spans[i].type == sdns_rr_type_OPT){
+            if (i == layout.rr_count - 1)
+                t->opt_offset = spans[i].offset;
+            continue;
+        }
+        // type, class and ttl are after the owner name
+        t->ttl_offset[t->ttl_count++] = spans[i].rdata_offset - 6;
+    }
+    sdns_free(spans);
+    return t;
+}
+
+void sdns_template_free(sdns_template * t){
+    if (NULL == t)
+        return;
+    sdns_free(t->raw);
+    sdns_free(t->ttl_offset);
+    sdns_free(t);
+}
+
+int sdns_template_set_ttl(sdns_template * t, int index, uint32_t ttl){
+    if (NULL == t || index >= (int)t->ttl_count)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    int from = index < 0?0:index;
+    int to = index < 0?t->ttl_count:index + 1;
+    for (int i=from; i< to; ++i){
+        char * p = t->raw + t->ttl_offset[i];
+        p[0] = (ttl >> 24) & 0xFF;
+        p[1] = (ttl >> 16) & 0xFF;
+        p[2] = (ttl >> 8) & 0xFF;
+        p[3] = ttl & 0xFF;
+    }
+    return sdns_rcode_NoError;
+}
+
+// start of the rdata of the OPT RR of the query or 0 if it has no OPT RR. 'at' is the end of the question
+static uint16_t _query_opt_rdata(char * query, uint16_t query_len, uint16_t at){
+    if (read_uint16_from_buffer(query + 10) == 0)
+        return 0;
+    // the usual query: OPT right after the question
+    if (read_uint16_from_buffer(query + 6) == 0 && read_uint16_from_buffer(query + 8) == 0 &&
+        query_len >= at + 11 && query[at] == 0x00 && read_uint16_from_buffer(query + at + 1) == sdns_rr_type_OPT)
+        return at + 11;
+    sdns_rr_span spans[16];
+    sdns_message_layout layout;
+    if (sdns_scan_message(query, query_len, &layout, spans, 16) != sdns_rcode_NoError)
+        return 0;
+    for (uint32_t i=0; i< layout.rr_count && i< 16; ++i)
+        if (spans[i].type == sdns_rr_type_OPT)
+            return spans[i].rdata_offset;
     return 0;
 }
 
+int sdns_template_render(sdns_template * t, char * query, uint16_t query_len, char * out, uint16_t out_len, uint16_t * len){
+    if (NULL == t || NULL == len)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    *len = 0;
+    if (NULL == query || NULL == out)
+        return SDNS_ERROR_BUFFER_IS_NULL;
+    uint16_t question_end = DNS_HEADER_LENGTH + t->qname_len + 4;
+    if (query_len < question_end)
+        return SDNS_ERROR_BUFFER_TOO_SHORT;
+    if (read_uint16_from_buffer(query + 4) != 1)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    // only standard queries (QR=0 and opcode=0), we don't answer a response
+    if ((query[2] & 0xF8) != 0)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    // the same question, only the case of the letters in the name can be different
+    uint16_t qname_end = DNS_HEADER_LENGTH + t->qname_len;
+    for (uint16_t i=DNS_HEADER_LENGTH; i< qname_end; ++i){
+        char a = query[i];
+        char b = t->raw[i];
+        if (a != b && ((a | 0x20) != (b | 0x20) || (a | 0x20) < 'a' || (a | 0x20) > 'z'))
+            return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    }
+    if (memcmp(query + qname_end, t->raw + qname_end, 4) != 0)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    uint16_t n = t->raw_len;
+    int drop_opt = t->opt_offset != 0 && _query_opt_rdata(query, query_len, question_end) == 0;
+    if (drop_opt)
+        n = t->opt_offset;
+    if (out_len < n)
+        return SDNS_ERROR_BUFFER_IS_SMALL;
+    memcpy(out, t->raw, n);
+    out[0] = query[0];
+    out[1] = query[1];
+    // RD and CD are copied from the query
+    out[2] = (out[2] & ~0x01) | (query[2] & 0x01);
+    out[3] = (out[3] & ~0x10) | (query[3] & 0x10);
+    // we answer with the name of the query
+    memcpy(out + DNS_HEADER_LENGTH, query + DNS_HEADER_LENGTH, t->qname_len);
+    if (drop_opt){
+        uint16_t arcount = read_uint16_from_buffer(out + 10) - 1;
+        out[10] = (arcount >> 8) & 0xFF;
+        out[11] = arcount & 0xFF;
+    }
+    *len = n;
+    return sdns_rcode_NoError;
+}
+
 void sdns_class_to_string(uint16_t cls, char * buff){
     if (cls == sdns_rr_class_IN)
         TO_OUTPUT(buff, "IN")
@@ -2345,7 +4068,9 @@ void sdns_rr_type_to_string(uint16_t t, char * buff){
 
 void sdns_error_string(int err, char ** err_buffer){
     if (*err_buffer == NULL){
-        *err_buffer = (char*) malloc_or_abort(256);
+        *err_buffer = (char*) sdns_malloc(256);
+        if (NULL == *err_buffer)
+            return;
         memset(*err_buffer, 0x00, 256);
     }
     if (err == SDNS_ERROR_MEMORY_ALLOC_FAILED)
@@ -2388,6 +4113,8 @@ void sdns_error_string(int err, char ** err_buffer){
         strcpy(*err_buffer, "There is no additional section in the DNS context");
     else if (err == SDNS_ERROR_ADDITIONAL_RR_OPT)
         strcpy(*err_buffer, "Additional section is OPT RR. Use other functions to fetch it");
+    else if (err == SDNS_ERROR_NO_QUESTION_FOUND)
+        strcpy(*err_buffer, "There is no question section in the DNS packet");
     else if (err == sdns_rcode_FormErr)
         strcpy(*err_buffer, "FormErr");
     else if (err == sdns_rcode_NoError)
@@ -2474,23 +4201,94 @@ int sdns_make_query(sdns_context * ctx, sdns_rr_type qtype,
     ctx->msg->question.qname = qname;
     // empty answer
     ctx->msg->answer = NULL;
-    // empty authority
+    // empty authority
+    ctx->msg->authority = NULL;
+    // empty additional section
+    ctx->msg->additional = NULL;
+
+    if (enable_edns0){      // we need to add an empty edns0 packet
+        sdns_opt_rdata * opt = NULL;
+        int res = sdns_create_edns_option(0, 0, NULL, &opt);
+        if (res != sdns_rcode_NoError){
+            ERROR("Error adding edns0 to the query packet");
+            return res;
+        }
+        res = sdns_add_edns(ctx, opt);
+        if (res != sdns_rcode_NoError){
+            sdns_free_opt_rdata(opt);
+            return res;
+        }
+    }
+    return 0;
+}
+
+int sdns_make_response(sdns_context * ctx, sdns_context * query){
+    if (NULL == ctx || NULL == query || NULL == query->msg)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    sdns_question * q = &query->msg->question;
+    if (NULL == query->raw || query->msg->header.qdcount != 1 || q->qname_len == 0 ||
+        q->qname_offset != DNS_HEADER_LENGTH || query->raw_len < DNS_HEADER_LENGTH + q->qname_len + 4)
+        return SDNS_ERROR_NO_QUESTION_FOUND;
+    // the decoder has checked the name, we only copy the names without a pointer
+    char * wire = query->raw + DNS_HEADER_LENGTH;
+    uint16_t i = 0;
+    while (i < q->qname_len && wire[i] != 0 && ((uint8_t)wire[i] & 0xC0) == 0)
+        i += (uint8_t)wire[i] + 1;
+    if (i + 1 != q->qname_len || q->qname_len > sizeof(ctx->qname_wire->wire) || wire[i] != 0)
+        return SDNS_ERROR_NO_QUESTION_FOUND;
+    char * qname = sdns_get_qname(query);
+    if (NULL == qname)
+        return SDNS_ERROR_NO_QUESTION_FOUND;
+    if (NULL == ctx->qname_wire){
+        ctx->qname_wire = (struct _sdns_qname_wire*) _ctx_malloc(ctx, sizeof(struct _sdns_qname_wire));
+        if (NULL == ctx->qname_wire)
+            return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    memcpy(ctx->qname_wire->wire, wire, q->qname_len);
+    ctx->qname_wire->len = q->qname_len;
+    // the header of a query with the values we copy from the query
+    sdns_header * query_header = &query->msg->header;
+    ctx->msg->header.id = query_header->id;
+    ctx->msg->header.qr = 1;
+    ctx->msg->header.aa = 0;
+    ctx->msg->header.ra = 0;
+    ctx->msg->header.rd = query_header->rd;
+    ctx->msg->header.rcode = 0;
+    ctx->msg->header.tc = 0;
+    ctx->msg->header.z = 0;
+    ctx->msg->header.AD = 0;
+    ctx->msg->header.CD = query_header->CD;
+    ctx->msg->header.qdcount = 1;
+    ctx->msg->header.ancount = 0;
+    ctx->msg->header.nscount = 0;
+    ctx->msg->header.arcount = 0;
+    ctx->msg->header.opcode = query_header->opcode;
+    ctx->msg->question.qclass = q->qclass;
+    ctx->msg->question.qtype = q->qtype;
+    ctx->msg->question.qname = safe_strdup(qname);
+    if (NULL == ctx->msg->question.qname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    ctx->msg->question.qname_hash = q->qname_hash;
+    ctx->msg->answer = NULL;
     ctx->msg->authority = NULL;
-    // empty additional section
     ctx->msg->additional = NULL;
 
-    if (enable_edns0){      // we need to add an empty edns0 packet
+    // the OPT RR from the wire, we don't decode the additional section of the query
+    uint16_t opt_rdata = _query_opt_rdata(query->raw, query->raw_len, DNS_HEADER_LENGTH + q->qname_len + 4);
+    if (opt_rdata != 0){
         sdns_opt_rdata * opt = NULL;
         int res = sdns_create_edns_option(0, 0, NULL, &opt);
-        if (res != sdns_rcode_NoError){
-            ERROR("Error adding edns0 to the query packet");
+        if (res != sdns_rcode_NoError)
             return res;
-        }
         res = sdns_add_edns(ctx, opt);
-        if (!res)
+        if (res != sdns_rcode_NoError){
+            sdns_free_opt_rdata(opt);
             return res;
+        }
+        // the DO bit is the first bit of the third byte of the TTL
+        ctx->msg->additional->opt_ttl.DO = (query->raw[opt_rdata - 4] & 0x80) != 0;
     }
-    return 0;
+    return sdns_rcode_NoError;
 }
 
 
@@ -2552,6 +4350,8 @@ void * sdns_decode_rr_section(sdns_context* ctx, sdns_rr * rr_section){
 sdns_rr_A * sdns_copy_rr_A(sdns_context * ctx, sdns_rr * rr){
     // assuming rr is sdns_rr_A structure, deep copy the structure
     sdns_rr_A* copy = sdns_init_rr_A(0);
+    if (NULL == copy)
+        return NULL;
     copy->address = ((sdns_rr_A*)(rr->psdns_rr))->address;
     return (void*)copy;
 }
@@ -2559,9 +4359,9 @@ sdns_rr_A * sdns_copy_rr_A(sdns_context * ctx, sdns_rr * rr){
 sdns_rr_TXT* sdns_copy_rr_TXT(sdns_context * ctx, sdns_rr * rr){
    sdns_rr_TXT * copy = sdns_init_rr_TXT(NULL, 0);
    sdns_rr_TXT * tmp = ((sdns_rr_TXT*)(rr->psdns_rr));
-   dyn_buffer * db = dyn_buffer_init(NULL, 0, 0);
+   dyn_buffer * db = NULL == copy?NULL:dyn_buffer_init(NULL, 0, 0);
    if (NULL == db){
-        free(copy);
+        sdns_free(copy);
         return NULL;
    }
    sdns_rr_TXT * copy_pointer = copy;
@@ -2571,23 +4371,47 @@ sdns_rr_TXT* sdns_copy_rr_TXT(sdns_context * ctx, sdns_rr * rr){
         dyn_buffer_append(db, tmp->character_string.content, tmp->character_string.len);
         if (tmp->next){
             copy_pointer->next = sdns_init_rr_TXT(NULL, 0);
+            if (NULL == copy_pointer->next)
+                db->failed = 1;
             copy_pointer = copy_pointer->next;
             tmp = tmp->next;
+            if (db->failed)
+                break;
             continue;
         }else{
             break;
         }
    }
-   free(db);
+   if (db->failed){
+        // the strings point to the old buffer if it could not grow, the content of the first one is not ours
+        copy->character_string.content = NULL;
+        sdns_free_rr_TXT(copy);
+        dyn_buffer_free(db);
+        return NULL;
+   }
+   // the strings point to the buffer before it grows, fix them
+   sdns_rr_TXT * fix = copy;
+   unsigned long int at = 0;
+   for (; fix; fix = fix->next){
+        fix->character_string.content = db->buffer + at;
+        at += fix->character_string.len;
+   }
+   sdns_free(db);
    return copy;
 }
 
 sdns_rr_SOA * sdns_copy_rr_SOA(sdns_context * ctx, sdns_rr * rr){
     //TODO: WE DON'T HAVE TEST FOR THIS FUNCTION
     sdns_rr_SOA * copy = sdns_init_rr_SOA(NULL, NULL, 0, 0, 0, 0, 0);
+    if (NULL == copy)
+        return NULL;
     sdns_rr_SOA * soa = (sdns_rr_SOA*)(rr->psdns_rr);
     copy->mname = safe_strdup(soa->mname);
     copy->rname = safe_strdup(soa->rname);
+    if ((NULL == copy->mname && NULL != soa->mname) || (NULL == copy->rname && NULL != soa->rname)){
+        sdns_free_rr_SOA(copy);
+        return NULL;
+    }
     copy->expire = soa->expire;
     copy->minimum = soa->minimum;
     copy->retry = soa->retry;
@@ -2599,43 +4423,74 @@ sdns_rr_SOA * sdns_copy_rr_SOA(sdns_context * ctx, sdns_rr * rr){
 
 sdns_rr_MX * sdns_copy_rr_MX(sdns_context * ctx, sdns_rr * rr){
     sdns_rr_MX * copy = sdns_init_rr_MX(0, NULL);
+    if (NULL == copy)
+        return NULL;
     sdns_rr_MX * mx = (sdns_rr_MX*)rr->psdns_rr;
     copy->preference = mx->preference;
     copy->exchange = safe_strdup(mx->exchange);
+    if (NULL == copy->exchange && NULL != mx->exchange){
+        sdns_free_rr_MX(copy);
+        return NULL;
+    }
     return copy;
 }
 
 sdns_rr_CNAME * sdns_copy_rr_CNAME(sdns_context * ctx, sdns_rr * rr){
     //TODO: WE DON'T HAVE TEST FOR THIS FUNCTION
     sdns_rr_CNAME * copy = sdns_init_rr_CNAME(NULL);
+    if (NULL == copy)
+        return NULL;
     copy->CNAME = safe_strdup(((sdns_rr_CNAME*)rr->psdns_rr)->CNAME);
+    if (NULL == copy->CNAME && NULL != ((sdns_rr_CNAME*)rr->psdns_rr)->CNAME){
+        sdns_free_rr_CNAME(copy);
+        return NULL;
+    }
     return copy;
 }
 
 sdns_rr_PTR * sdns_copy_rr_PTR(sdns_context * ctx, sdns_rr * rr){
     //TODO: WE DON'T HAVE TEST FOR THIS FUNCTION
     sdns_rr_PTR * copy = sdns_init_rr_PTR(NULL);
+    if (NULL == copy)
+        return NULL;
     copy->PTRDNAME = safe_strdup(((sdns_rr_PTR*)rr->psdns_rr)->PTRDNAME);
+    if (NULL == copy->PTRDNAME && NULL != ((sdns_rr_PTR*)rr->psdns_rr)->PTRDNAME){
+        sdns_free_rr_PTR(copy);
+        return NULL;
+    }
     return copy;
 }
 
 sdns_rr_NID * sdns_copy_rr_NID(sdns_context * ctx, sdns_rr * rr){
     //TODO: WE DONT HAVE TEST FOR THIS FUNCTION
     sdns_rr_NID * copy = sdns_init_rr_NID(0, NULL);
+    if (NULL == copy)
+        return NULL;
     copy->Preference = ((sdns_rr_NID*)rr->psdns_rr)->Preference;
-    if (((sdns_rr_NID*)rr->psdns_rr)->NodeId != NULL)
+    if (((sdns_rr_NID*)rr->psdns_rr)->NodeId != NULL){
         copy->NodeId = mem_copy(((sdns_rr_NID*)rr->psdns_rr)->NodeId, 8);
+        if (NULL == copy->NodeId){
+            sdns_free_rr_NID(copy);
+            return NULL;
+        }
+    }
     return copy;
 }
 
 sdns_rr_HINFO * sdns_copy_rr_HINFO(sdns_context * ctx, sdns_rr * rr){
     //TODO: WE DONT HAVE TEST FOR THIS FUNCTION
     sdns_rr_HINFO * copy = sdns_init_rr_HINFO(0, NULL, 0, NULL);
+    if (NULL == copy)
+        return NULL;
     sdns_rr_HINFO * tmp = (sdns_rr_HINFO *)rr->psdns_rr;
     if (tmp->cpu)
         copy->cpu = mem_copy(tmp->cpu, tmp->cpu_len);
     if (tmp->os)
         copy->os = mem_copy(tmp->os, tmp->os_len);
+    if ((tmp->cpu && NULL == copy->cpu) || (tmp->os && NULL == copy->os)){
+        sdns_free_rr_HINFO(copy);
+        return NULL;
+    }
     copy->cpu_len = tmp->cpu_len;
     copy->os_len = tmp->os_len;
     return copy;
@@ -2644,40 +4499,65 @@ sdns_rr_HINFO * sdns_copy_rr_HINFO(sdns_context * ctx, sdns_rr * rr){
 sdns_rr_URI * sdns_copy_rr_URI(sdns_context * ctx, sdns_rr * rr){
     //TODO: WE DONT HAVE TEST FOR THIS FUNCTION
     sdns_rr_URI * copy = sdns_init_rr_URI(0, 0, NULL, 0);
+    if (NULL == copy)
+        return NULL;
     sdns_rr_URI * tmp = (sdns_rr_URI*)rr->psdns_rr;
     copy->target_len = tmp->target_len;
     copy->Priority = tmp->Priority;
     copy->Weight = tmp->Weight;
-    if (tmp->Target)
+    if (tmp->Target){
         copy->Target = mem_copy(tmp->Target, tmp->target_len);
+        if (NULL == copy->Target){
+            sdns_free_rr_URI(copy);
+            return NULL;
+        }
+    }
     return copy;
 }
 
 sdns_rr_NS * sdns_copy_rr_NS(sdns_context * ctx, sdns_rr * rr){
     sdns_rr_NS * copy = sdns_init_rr_NS(NULL);
+    if (NULL == copy)
+        return NULL;
     sdns_rr_NS * tmp = (sdns_rr_NS*)rr->psdns_rr;
     copy->NSDNAME = safe_strdup(tmp->NSDNAME);
+    if (NULL == copy->NSDNAME && NULL != tmp->NSDNAME){
+        sdns_free_rr_NS(copy);
+        return NULL;
+    }
     return copy;
 }
 
 sdns_rr_SRV * sdns_copy_rr_SRV(sdns_context * ctx, sdns_rr * rr){
     sdns_rr_SRV * copy = sdns_init_rr_SRV(0, 0, 0, NULL);
+    if (NULL == copy)
+        return NULL;
     sdns_rr_SRV * tmp = (sdns_rr_SRV*)rr->psdns_rr;
     copy->Weight = tmp->Weight;
     copy->Port = tmp->Port;
     copy->Priority = tmp->Priority;
     copy->Target = safe_strdup(tmp->Target);
+    if (NULL == copy->Target && NULL != tmp->Target){
+        sdns_free_rr_SRV(copy);
+        return NULL;
+    }
     return copy;
 }
 
 sdns_rr_CAA * sdns_copy_rr_CAA(sdns_context * ctx, sdns_rr * rr){
     sdns_rr_CAA * copy = sdns_init_rr_CAA(0, NULL, 0, NULL, 0);
+    if (NULL == copy)
+        return NULL;
     sdns_rr_CAA * tmp = (sdns_rr_CAA*) rr->psdns_rr;
     copy->flag = tmp->flag;
     copy->tag_len = tmp->tag_len;
     copy->value_len = tmp->value_len;
     copy->tag = safe_strdup(tmp->tag);
     copy->value = safe_strdup(tmp->value);
+    if ((NULL == copy->tag && NULL != tmp->tag) || (NULL == copy->value && NULL != tmp->value)){
+        sdns_free_rr_CAA(copy);
+        return NULL;
+    }
     return copy;
 }
 
@@ -2731,7 +4611,9 @@ void * sdns_copy_rr_section(sdns_context * ctx, sdns_rr* rr_section){
 
 
 sdns_rr_MX * sdns_init_rr_MX(uint16_t preference, char * exchange){
-    sdns_rr_MX * mx = (sdns_rr_MX*) malloc_or_abort(sizeof(sdns_rr_MX));
+    sdns_rr_MX * mx = (sdns_rr_MX*) sdns_malloc(sizeof(sdns_rr_MX));
+    if (NULL == mx)
+        return NULL;
     mx->preference = preference;
     mx->exchange = exchange;
     return mx;
@@ -2740,14 +4622,18 @@ sdns_rr_MX * sdns_init_rr_MX(uint16_t preference, char * exchange){
 void sdns_free_rr_MX(sdns_rr_MX * mx){
     if (NULL == mx)
         return;
-    free(mx->exchange);
-    free(mx);
+    sdns_free(mx->exchange);
+    sdns_free(mx);
 }
 
 sdns_rr_MX * sdns_decode_rr_MX(sdns_context * ctx, sdns_rr * rr){
     if (NULL == ctx || NULL == rr)
         return NULL;
     sdns_rr_MX * mx = sdns_init_rr_MX(0, NULL);
+    if (NULL == mx){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     ctx->cursor = rr->rdata;
     char * qname = NULL;
     if (rr->rdlength < 2){      // we must have preference
@@ -2765,6 +4651,7 @@ sdns_rr_MX * sdns_decode_rr_MX(sdns_context * ctx, sdns_rr * rr){
     int res = decode_name(ctx, &qname);
     if (res != sdns_rcode_NoError){
         ERROR("Can not parse the exchange name of MX record: %d\n", res);
+        ctx->err = res == SDNS_ERROR_MEMORY_ALLOC_FAILED?res:sdns_rcode_FormErr;
         sdns_free_rr_MX(mx);
         return NULL;
     }
@@ -2777,6 +4664,10 @@ sdns_rr_HINFO * sdns_decode_rr_HINFO(sdns_context * ctx, sdns_rr * rr){
     if (ctx == NULL || rr == NULL)
         return NULL;
     sdns_rr_HINFO * hinfo = sdns_init_rr_HINFO(0, NULL, 0, NULL);
+    if (NULL == hinfo){
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     uint16_t rd_len = rr->rdlength;
     if (rd_len < 2){  // the minimum length of hinfo record is 2
         sdns_free_rr_HINFO(hinfo);
@@ -2793,7 +4684,12 @@ sdns_rr_HINFO * sdns_decode_rr_HINFO(sdns_context * ctx, sdns_rr * rr){
     if (hinfo->cpu_len == 0){
         hinfo->cpu = NULL;
     }else{
-        hinfo->cpu = (char*) malloc_or_abort(hinfo->cpu_len);
+        hinfo->cpu = (char*) sdns_malloc(hinfo->cpu_len);
+        if (NULL == hinfo->cpu){
+            sdns_free_rr_HINFO(hinfo);
+            ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+            return NULL;
+        }
         // copy bytes
         memcpy(hinfo->cpu, tmp + cnt, hinfo->cpu_len);
     }
@@ -2812,32 +4708,51 @@ sdns_rr_HINFO * sdns_decode_rr_HINFO(sdns_context * ctx, sdns_rr * rr){
     if (hinfo->os_len == 0){
         hinfo->os = NULL;
     }else{
-        hinfo->os = (char*) malloc_or_abort(hinfo->os_len);
+        hinfo->os = (char*) sdns_malloc(hinfo->os_len);
+        if (NULL == hinfo->os){
+            sdns_free_rr_HINFO(hinfo);
+            ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+            return NULL;
+        }
         // copy bytes
         memcpy(hinfo->os, tmp + cnt, hinfo->os_len);
     }
     return hinfo;
 }
 
-sdns_message * sdns_init_message(void){
-    sdns_message * msg = (sdns_message*) malloc_or_abort(sizeof(sdns_message));
+// sets the message to an empty one (does not free anything)
+static void _reset_message(sdns_message * msg){
     msg->question.qname = NULL;
     msg->question.qclass = 0;
-    msg->question.qname = 0;
+    msg->question.qtype = 0;
+    msg->question.qname_offset = 0;
+    msg->question.qname_len = 0;
+    msg->question.qname_hash = 0;
     msg->answer = NULL;
     msg->additional = NULL;
     msg->authority = NULL;
-    msg->header.id = 0;
-    msg->header.ancount = 0;
-    msg->header.arcount = 0;
-    msg->header.qdcount = 0;
-    msg->header.nscount = 0;
+    // all the flags too, the next message must not get the QR, TC or rcode of the last one
+    memset(&msg->header, 0x00, sizeof(sdns_header));
+    // we keep the arrays of the index for the next message
+    msg->answer_index.count = msg->authority_index.count = msg->additional_index.count = 0;
+    msg->answer_index.tail = msg->authority_index.tail = msg->additional_index.tail = NULL;
+}
+
+sdns_message * sdns_init_message(void){
+    sdns_message * msg = (sdns_message*) sdns_malloc(sizeof(sdns_message));
+    if (NULL == msg)
+        return NULL;
+    msg->answer_index.rrs = msg->authority_index.rrs = msg->additional_index.rrs = NULL;
+    msg->answer_index.cap = msg->authority_index.cap = msg->additional_index.cap = 0;
+    _reset_message(msg);
     return msg;
 }
 
 void sdns_free_rr(sdns_rr * rr){
     if (NULL == rr)
         return;
+    if (_rr_rdata_is_inline(rr))
+        return;     // inline rdata goes away with the RR
     sdns_rr_type rr_type = rr->type;
     void * tmp = rr->psdns_rr;
     if (rr_type  == sdns_rr_type_A)
@@ -2875,9 +4790,9 @@ void sdns_free_rr(sdns_rr * rr){
         sdns_opt_rdata * opt = rr->opt_rdata;
         sdns_opt_rdata * tmp = opt;
         while (opt){
-            free(opt->option_data);
+            sdns_free(opt->option_data);
             tmp = opt->next;
-            free(opt);
+            sdns_free(opt);
             opt = tmp;
         }
     }
@@ -2887,81 +4802,57 @@ void sdns_free_section(sdns_rr * rr){
     sdns_rr * sec = rr;
     sdns_rr * tmp = sec;
     while(sec){
-        free(sec->name);
         if (sec->decoded){
             // we have to free per structure
             sdns_free_rr(sec);
         }else{
             // just free the pointer
+            // we should not free it as it's part of the original memory
         }
         tmp = sec->next;
-        free(sec);
+        if (!sec->in_arena){    // the arena ones are released with the context
+            sdns_free(sec->name);
+            sdns_free(sec);
+        }
         sec = tmp;
     }
 }
 
-static void sdns_free_message(sdns_message * msg){
+// frees everything the message points to but not the message itself
+static void _clear_message(sdns_context * ctx, sdns_message * msg){
+    if (!sdns_arena_owns(ctx->arena, msg->question.qname))
+        sdns_free(msg->question.qname);
+    // when everything is in the arena, there is nothing to walk
+    if (ctx->arena == NULL || ctx->heap_rrs > 0){
+        //free all in answer section
+        if (msg->header.ancount > 0)
+            sdns_free_section(msg->answer);
+        if (msg->header.arcount > 0)
+            sdns_free_section(msg->additional);
+        if (msg->header.nscount > 0)
+            sdns_free_section(msg->authority);
+    }
+}
+
+static void sdns_free_message(sdns_context * ctx, sdns_message * msg){
     if (NULL == msg)
         return;
-    free(msg->question.qname);
-    //free all in answer section
-    if (msg->header.ancount > 0){
-        sdns_rr * sec = msg->answer;
-        sdns_rr * tmp = sec;
-        while(sec){
-            free(sec->name);
-            if (sec->decoded){
-                // we have to free per structure
-                sdns_free_rr(sec);
-            }else{
-                // just free the pointer
-                // we should not free it as it's part of the original memory
-            }
-            tmp = sec->next;
-            free(sec);
-            sec = tmp;
-        }
-    }
-    if (msg->header.arcount > 0){
-        sdns_rr * sec = msg->additional;
-        sdns_rr * tmp = sec;
-        while(sec){
-            free(sec->name);
-            if (sec->decoded){
-                // we have to free per structure
-                sdns_free_rr(sec);
-            }else{
-                // just free the pointer
-            }
-            tmp = sec->next;
-            free(sec);
-            sec = tmp;
-        }
-    }
-    if (msg->header.nscount > 0){
-        sdns_rr * sec = msg->authority;
-        sdns_rr * tmp = sec;
-        while(sec){
-            free(sec->name);
-            if (sec->decoded){
-                // we have to free per structure
-                sdns_free_rr(sec);
-            }else{
-                // just free the pointer
-            }
-            tmp = sec->next;
-            free(sec);
-            sec = tmp;
-        }
-    }
+    _clear_message(ctx, msg);
+    _ctx_free(ctx, msg->answer_index.rrs);
+    _ctx_free(ctx, msg->authority_index.rrs);
+    _ctx_free(ctx, msg->additional_index.rrs);
     // and finally
-    free(msg);
+    sdns_free(msg);
     return;
 }
 
 sdns_rr * sdns_init_rr(char * name, uint16_t type, uint16_t class, uint32_t ttl,
                        uint16_t rdlength, uint8_t decoded, void * rdata){
-    sdns_rr * rr = (sdns_rr*)malloc_or_abort(sizeof(sdns_rr));
+    uint8_t has_inline = _rr_type_is_inline(type);
+    sdns_rr * rr = (sdns_rr*)sdns_malloc(sizeof(sdns_rr) + (has_inline?sizeof(sdns_rr_inline):0));
+    if (NULL == rr)
+        return NULL;
+    rr->has_inline = has_inline;
     rr->name = name;
     rr->type = type;
     rr->class = class;
@@ -2973,9 +4864,180 @@ sdns_rr * sdns_init_rr(char * name, uint16_t type, uint16_t class, uint32_t ttl,
     else
         rr->rdata = (char*) rdata;
     rr->next = NULL;
+    rr->name_offset = 0;
+    rr->name_len = 0;
+    rr->name_hash = 0;
+    rr->in_arena = 0;
+    return rr;
+}
+
+sdns_rr * sdns_context_init_rr(sdns_context * ctx, char * name, uint16_t type, uint16_t class, uint32_t ttl,
+                               uint16_t rdlength, uint8_t decoded, void * rdata){
+    if (NULL == ctx)
+        return NULL;
+    sdns_arena * arena = _ctx_arena(ctx);
+    if (NULL == arena){
+        char * copy = safe_strdup(name);
+        if (NULL == copy && NULL != name)
+            return NULL;
+        sdns_rr * rr = sdns_init_rr(copy, type, class, ttl, rdlength, decoded, rdata);
+        if (NULL == rr)
+            sdns_free(copy);
+        return rr;
+    }
+    uint8_t has_inline = _rr_type_is_inline(type);
+    sdns_rr * rr = (sdns_rr*) sdns_arena_alloc(arena, sizeof(sdns_rr) + (has_inline?sizeof(sdns_rr_inline):0));
+    if (NULL == rr)
+        return NULL;
+    rr->has_inline = has_inline;
+    rr->name = NULL;
+    if (name != NULL && (rr->name = sdns_arena_strdup(arena, name)) == NULL)
+        return NULL;
+    rr->type = type;
+    rr->class = class;
+    rr->ttl = ttl;
+    rr->rdlength = rdlength;
+    rr->decoded = decoded;
+    if (rr->decoded)
+        rr->psdns_rr = rdata;
+    else
+        rr->rdata = (char*) rdata;
+    rr->next = NULL;
+    rr->name_offset = 0;
+    rr->name_len = 0;
+    rr->name_hash = 0;
+    rr->in_arena = 1;
     return rr;
 }
 
+void * sdns_rr_inline_rdata(sdns_rr * rr){
+    if (NULL == rr || !rr->has_inline)
+        return NULL;
+    sdns_rr_inline * fixed = (sdns_rr_inline*) (rr + 1);
+    switch (rr->type){
+        case sdns_rr_type_A:
+        case sdns_rr_type_L32:
+            break;
+        case sdns_rr_type_AAAA:
+            fixed->AAAA.address = fixed->bytes;
+            break;
+        case sdns_rr_type_L64:
+            fixed->L64.Locator64 = fixed->bytes;
+            break;
+        case sdns_rr_type_NID:
+            fixed->NID.NodeId = fixed->bytes;
+            break;
+        default:
+            return NULL;
+    }
+    rr->decoded = 1;
+    rr->psdns_rr = (void*) fixed;
+    return (void*) fixed;
+}
+
+int sdns_decode_rr_inline(sdns_context * ctx, sdns_rr * rr){
+    if (NULL == ctx || NULL == rr)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (rr->decoded)
+        return sdns_rcode_NoError;
+    if (!rr->has_inline)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    // the only valid rdlength of each type
+    uint16_t size = 0;
+    switch (rr->type){
+        case sdns_rr_type_A:
+            size = 4;
+            break;
+        case sdns_rr_type_AAAA:
+            size = 16;
+            break;
+        case sdns_rr_type_L32:
+            size = 6;
+            break;
+        case sdns_rr_type_L64:
+        case sdns_rr_type_NID:
+            size = 10;
+            break;
+        default:
+            return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    }
+    uint8_t * tmp = (uint8_t*) rr->rdata;
+    if (tmp == NULL || rr->rdlength != size)
+        return SDNS_ERROR_RR_SECTION_MALFORMED;
+    if (ctx->raw != NULL && (rr->rdata < ctx->raw || ctx->raw_len - (rr->rdata - ctx->raw) < size))
+        return SDNS_ERROR_RR_SECTION_MALFORMED;
+    sdns_rr_inline * fixed = (sdns_rr_inline*) sdns_rr_inline_rdata(rr);
+    switch (rr->type){
+        case sdns_rr_type_A:
+            fixed->A.address = ((uint32_t)tmp[0] << 24) | (tmp[1] << 16) | (tmp[2] << 8) | tmp[3];
+            break;
+        case sdns_rr_type_AAAA:
+            memcpy(fixed->bytes, tmp, 16);
+            break;
+        case sdns_rr_type_L32:
+            fixed->L32.Preference = (tmp[0] << 8) | tmp[1];
+            fixed->L32.Locator32 = ((uint32_t)tmp[2] << 24) | (tmp[3] << 16) | (tmp[4] << 8) | tmp[5];
+            break;
+        case sdns_rr_type_L64:
+            fixed->L64.Preference = (tmp[0] << 8) | tmp[1];
+            memcpy(fixed->bytes, tmp + 2, 8);
+            break;
+        default:    // NID
+            fixed->NID.Preference = (tmp[0] << 8) | tmp[1];
+            memcpy(fixed->bytes, tmp + 2, 8);
+            break;
+    }
+    return sdns_rcode_NoError;
+}
+
+char * sdns_get_rr_name(sdns_context * ctx, sdns_rr * rr){
+    if (NULL == ctx || NULL == rr)
+        return NULL;
+    if (rr->name != NULL || rr->name_len == 0)
+        return rr->name;
+    // name-view mode: decode the name from the raw buffer and cache it
+    char name[256] = {0x00};
+    int res = decode_name_at(ctx, rr->name_offset, name);
+    if (res != sdns_rcode_NoError){
+        ctx->err = res;
+        return NULL;
+    }
+    rr->name = rr->in_arena?sdns_arena_strdup(ctx->arena, name):sdns_strdup(name);
+    if (NULL == rr->name)
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    return rr->name;
+}
+
+uint64_t sdns_name_hash(const char * name){
+    if (NULL == name)
+        return 0;
+    int len = strlen(name);
+    if (len == 1 && name[0] == '.')     // root
+        return NAME_HASH_INIT;
+    uint64_t hash = _name_hash_update(NAME_HASH_INIT, name, len);
+    if (len > 0 && name[len - 1] != '.')
+        hash = (hash ^ '.') * NAME_HASH_PRIME;
+    return hash;
+}
+
+char * sdns_get_qname(sdns_context * ctx){
+    if (NULL == ctx || NULL == ctx->msg)
+        return NULL;
+    sdns_question * q = &ctx->msg->question;
+    if (q->qname != NULL || q->qname_len == 0)
+        return q->qname;
+    char qname[256] = {0x00};
+    int res = decode_name_at(ctx, q->qname_offset, qname);
+    if (res != sdns_rcode_NoError){
+        ctx->err = res;
+        return NULL;
+    }
+    q->qname = _ctx_strdup(ctx, qname);
+    if (NULL == q->qname)
+        ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    return q->qname;
+}
+
 
 int sdns_convert_type_to_int(char * type){
     // no allocation no leak
@@ -3186,41 +5248,238 @@ int sdns_convert_class_to_int(char * cls){
 
 sdns_context * sdns_init_context(void){
     sdns_message * msg = sdns_init_message();
-    sdns_context * ctx = (sdns_context*) malloc_or_abort(sizeof(sdns_context));
+    if (NULL == msg)
+        return NULL;
+    sdns_context * ctx = (sdns_context*) sdns_malloc(sizeof(sdns_context));
+    if (NULL == ctx){
+        sdns_free(msg);
+        return NULL;
+    }
     ctx->msg = msg;
     ctx->raw_len = 0;
     ctx->raw = NULL;
     ctx->cursor = NULL;
     ctx->err = 0;       // no error
+    ctx->flags = 0;
+    ctx->arena = NULL;
+    ctx->heap_rrs = 0;
+    ctx->pending = 0;
+    memset(ctx->section_offset, 0x00, sizeof(ctx->section_offset));
+    ctx->memo = NULL;
+    ctx->compress = NULL;
+    ctx->qname_wire = NULL;
+    ctx->allocator = NULL;
     return ctx;
 }
 
+int sdns_context_set_allocator(sdns_context * ctx, const sdns_allocator * allocator){
+    if (NULL == ctx)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (allocator != NULL && (NULL == allocator->malloc_fn || NULL == allocator->realloc_fn || NULL == allocator->free_fn))
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    // what we have must be freed by the allocator it came from
+    sdns_message * msg = ctx->msg;
+    if (ctx->arena != NULL || ctx->memo != NULL || ctx->compress != NULL || ctx->qname_wire != NULL)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (msg != NULL && (msg->answer_index.rrs != NULL || msg->authority_index.rrs != NULL || msg->additional_index.rrs != NULL))
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    ctx->allocator = allocator;
+    return sdns_rcode_NoError;
+}
+
 void sdns_free_context(sdns_context * ctx){
     if (NULL == ctx)
         return;
-    sdns_free_message(ctx->msg);
-    free(ctx->raw);
-    free(ctx);
+    sdns_free_message(ctx, ctx->msg);
+    sdns_arena_free(ctx->arena);
+    _ctx_free(ctx, ctx->memo);
+    _compress_free(ctx->compress);
+    _ctx_free(ctx, ctx->qname_wire);
+    if (!(ctx->flags & SDNS_CTX_BORROWED))
+        sdns_free(ctx->raw);
+    sdns_free(ctx);
+}
+
+void sdns_context_reset(sdns_context * ctx){
+    if (NULL == ctx)
+        return;
+    if (NULL == ctx->msg){
+        ctx->msg = sdns_init_message();
+    }else{
+        _clear_message(ctx, ctx->msg);
+        _reset_message(ctx->msg);
+    }
+    // keep the chunks of the arena and the raw buffer for the next packet
+    sdns_arena_reset(ctx->arena);
+    ctx->heap_rrs = 0;
+    ctx->pending = 0;
+    memset(ctx->section_offset, 0x00, sizeof(ctx->section_offset));
+    _name_memo_invalidate(ctx, 0);
+    if (ctx->qname_wire != NULL)
+        ctx->qname_wire->len = 0;
+    if (ctx->flags & SDNS_CTX_BORROWED){
+        // the next packet is in another buffer of the caller
+        ctx->raw = NULL;
+        ctx->raw_len = 0;
+    }
+    ctx->cursor = ctx->raw;
+    ctx->err = 0;
+}
+
+int sdns_context_detach(sdns_context * ctx){
+    if (NULL == ctx)
+        return SDNS_ERROR_WRONG_INPUT_PARAMETER;
+    if (!(ctx->flags & SDNS_CTX_BORROWED))
+        return sdns_rcode_NoError;
+    char * old = ctx->raw;
+    if (old != NULL){
+        char * raw = (char*) sdns_malloc(ctx->raw_len > 0?ctx->raw_len:1);
+        if (NULL == raw)
+            return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        memcpy(raw, old, ctx->raw_len);
+        // the rdata that is not decoded yet points to the raw buffer
+        sdns_rr * sections[3] = {ctx->msg->answer, ctx->msg->authority, ctx->msg->additional};
+        for (int i=0; i< 3; ++i){
+            for (sdns_rr * rr = sections[i]; rr; rr = rr->next){
+                if (!rr->decoded && rr->rdata != NULL && rr->rdata >= old && rr->rdata <= old + ctx->raw_len)
+                    rr->rdata = raw + (rr->rdata - old);
+            }
+        }
+        if (ctx->cursor != NULL)
+            ctx->cursor = raw + (ctx->cursor - old);
+        ctx->raw = raw;
+    }
+    ctx->flags &= ~SDNS_CTX_BORROWED;
+    return sdns_rcode_NoError;
+}
+
+// adds rr to the end of the index, 0 on success
+static int _section_index_push(sdns_context * ctx, sdns_section_index * idx, sdns_rr * rr){
+    if (idx->count == idx->cap){
+        uint16_t cap = idx->cap == 0?8:(idx->cap > 0x7FFF?0xFFFF:idx->cap * 2);
+        if (cap == idx->cap)
+            return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        sdns_rr ** tmp = (sdns_rr**) sdns_realloc_with(ctx->allocator, idx->rrs, cap * sizeof(sdns_rr*));
+        if (NULL == tmp)
+            return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        idx->rrs = tmp;
+        idx->cap = cap;
+    }
+    idx->rrs[idx->count++] = rr;
+    idx->tail = rr;
+    return sdns_rcode_NoError;
+}
+
+// walks the section once and indexes all the RRs, 0 on success
+static int _section_index_build(sdns_context * ctx, sdns_rr * head, sdns_section_index * idx){
+    idx->count = 0;
+    idx->tail = NULL;
+    for (sdns_rr * rr = head; rr; rr = rr->next){
+        if (_section_index_push(ctx, idx, rr) != sdns_rcode_NoError){
+            idx->count = 0;     // the index is not usable
+            return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        }
+    }
+    return sdns_rcode_NoError;
+}
+
+// 1 if the index matches the section, 0 otherwise.
+// we only compare pointers: the RRs of the index may be freed, so everything
+// that unlinks an RR must reset the index (see _section_index_reset())
+static int _section_index_valid(sdns_rr * head, sdns_section_index * idx, uint16_t count){
+    if (idx->count != count)
+        return 0;
+    if (count == 0)
+        return head == NULL;
+    return idx->rrs[0] == head;
+}
+
+// the index is not usable anymore and is built again the next time we need it
+static void _section_index_reset(sdns_section_index * idx){
+    idx->count = 0;
+    idx->tail = NULL;
+}
+
+// returns the head, the index and the header count of the section, 1 if the section is not valid
+static int _section_parts(sdns_message * msg, int section, sdns_rr *** head, sdns_section_index ** idx, uint16_t ** count){
+    if (section == DNS_SECTION_ANSWER){
+        *head = &msg->answer;
+        *idx = &msg->answer_index;
+        *count = &msg->header.ancount;
+    }else if (section == DNS_SECTION_AUTHORITY){
+        *head = &msg->authority;
+        *idx = &msg->authority_index;
+        *count = &msg->header.nscount;
+    }else if (section == DNS_SECTION_ADDITIONAL){
+        *head = &msg->additional;
+        *idx = &msg->additional_index;
+        *count = &msg->header.arcount;
+    }else{
+        return 1;
+    }
+    return 0;
+}
+
+// appends rr to the end of the section and updates the header count
+static void _section_append(sdns_context * ctx, int section, sdns_rr * rr){
+    sdns_rr ** head = NULL;
+    sdns_section_index * idx = NULL;
+    uint16_t * count = NULL;
+    _section_parts(ctx->msg, section, &head, &idx, &count);
+    if (!_section_index_valid(*head, idx, *count))
+        _section_index_build(ctx, *head, idx);
+    if (*head == NULL){   // this is the first one
+        *head = rr;
+        *count = 1;
+        idx->count = 0;
+        _section_index_push(ctx, idx, rr);
+        return;
+    }
+    if (_section_index_valid(*head, idx, *count)){
+        // push before linking, the index is not valid once the tail has a next
+        sdns_rr * tail = idx->tail;
+        if (_section_index_push(ctx, idx, rr) != sdns_rcode_NoError)
+            idx->count = 0;
+        tail->next = rr;
+    }else{
+        // the index is not usable, walk the list
+        sdns_rr * tmp = *head;
+        while (tmp->next)
+            tmp = tmp->next;
+        tmp->next = rr;
+    }
+    *count += 1;
+}
+
+sdns_rr * sdns_section_rr(sdns_context * ctx, int section, uint16_t num){
+    sdns_rr ** head = NULL;
+    sdns_section_index * idx = NULL;
+    uint16_t * count = NULL;
+    if (NULL == ctx || NULL == ctx->msg || _section_parts(ctx->msg, section, &head, &idx, &count) != 0)
+        return NULL;
+    if (num >= *count || sdns_decode_section(ctx, section) != sdns_rcode_NoError)
+        return NULL;
+    if (!_section_index_valid(*head, idx, *count))
+        _section_index_build(ctx, *head, idx);
+    if (_section_index_valid(*head, idx, *count))
+        return idx->rrs[num];
+    // we could not build the index (or the list does not match the header), walk the list
+    sdns_rr * tmp = *head;
+    for (uint16_t i = 0; tmp && i < num; ++i)
+        tmp = tmp->next;
+    return tmp;
 }
 
 int sdns_add_answer_section(sdns_context * ctx, sdns_rr * rr){
     // adds a new answer section to the current ones
     if (NULL == rr || NULL == ctx)
         return SDNS_ERROR_RR_NULL;
-    sdns_rr * tmp = ctx->msg->answer;
-    if (NULL == tmp){   // this is the first one
-        ctx->msg->answer = rr;
-        ctx->msg->header.ancount = 1;
-        return sdns_rcode_NoError;
-    }
-    // this is not the first one
-    while (tmp)
-        if (tmp->next)
-            tmp = tmp->next;
-        else
-            break;
-    tmp->next = rr;
-    ctx->msg->header.ancount += 1;
+    int res = sdns_decode_section(ctx, DNS_SECTION_ANSWER);
+    if (res != sdns_rcode_NoError)
+        return res;
+    if (!rr->in_arena || (rr->decoded && !_rr_rdata_is_inline(rr)))
+        ctx->heap_rrs += 1;
+    _section_append(ctx, DNS_SECTION_ANSWER, rr);
     return sdns_rcode_NoError;
 }
 
@@ -3228,20 +5487,12 @@ int sdns_add_authority_section(sdns_context * ctx, sdns_rr * rr){
     // adds a new authority section to the current ones
     if (NULL == rr || NULL == ctx)
         return SDNS_ERROR_RR_NULL;
-    sdns_rr * tmp = ctx->msg->authority;
-    if (NULL == tmp){   // this is the first one
-        ctx->msg->authority = rr;
-        ctx->msg->header.nscount = 1;
-        return sdns_rcode_NoError;
-    }
-    // this is not the first one
-    while (tmp)
-        if (tmp->next)
-            tmp = tmp->next;
-        else
-            break;
-    tmp->next = rr;
-    ctx->msg->header.nscount += 1;
+    int res = sdns_decode_section(ctx, DNS_SECTION_AUTHORITY);
+    if (res != sdns_rcode_NoError)
+        return res;
+    if (!rr->in_arena || (rr->decoded && !_rr_rdata_is_inline(rr)))
+        ctx->heap_rrs += 1;
+    _section_append(ctx, DNS_SECTION_AUTHORITY, rr);
     return sdns_rcode_NoError;
 }
 
@@ -3249,21 +5500,12 @@ int sdns_add_additional_section(sdns_context * ctx, sdns_rr * rr){
     // adds a new additional section to the current ones
     if (NULL == rr || NULL == ctx)
         return SDNS_ERROR_RR_NULL;
-    sdns_rr * tmp = ctx->msg->additional;
-    if (NULL == tmp){   // this is the first one
-        ctx->msg->additional = rr;
-        ctx->msg->header.arcount = 1;
-        return sdns_rcode_NoError;
-    }
-    // this is not the first one
-    // if this is OPT (type 41), we can only have one
-    while (tmp)
-        if (tmp->next)
-            tmp = tmp->next;
-        else
-            break;
-    tmp->next = rr;
-    ctx->msg->header.arcount += 1;
+    int res = sdns_decode_section(ctx, DNS_SECTION_ADDITIONAL);
+    if (res != sdns_rcode_NoError)
+        return res;
+    if (!rr->in_arena || (rr->decoded && !_rr_rdata_is_inline(rr)))
+        ctx->heap_rrs += 1;
+    _section_append(ctx, DNS_SECTION_ADDITIONAL, rr);
     return sdns_rcode_NoError;
 }
 
@@ -3273,7 +5515,9 @@ int sdns_add_additional_section(sdns_context * ctx, sdns_rr * rr){
 int sdns_create_edns_option(uint16_t opt_code, uint16_t opt_length, char * opt_data, sdns_opt_rdata** buffer){
     if (*buffer == NULL){
         // we have to allocate it
-        *buffer = (sdns_opt_rdata*)malloc_or_abort(sizeof(sdns_opt_rdata));
+        *buffer = (sdns_opt_rdata*)sdns_malloc(sizeof(sdns_opt_rdata));
+        if (NULL == *buffer)
+            return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     }
     (*buffer)->next = NULL;
     (*buffer)->option_code = opt_code;
@@ -3288,6 +5532,9 @@ int sdns_add_edns(sdns_context * ctx, sdns_opt_rdata * opt){
     // or this is the first one and we need to create the section for it
     if (NULL == ctx || NULL == opt)
         return SDNS_ERROR_RR_NULL;
+    int res = sdns_decode_section(ctx, DNS_SECTION_ADDITIONAL);
+    if (res != sdns_rcode_NoError)
+        return res;
     if (ctx->msg->header.arcount > 0){
         // we have some additional section
         // we need to check if it's opt(41) or not
@@ -3308,7 +5555,7 @@ int sdns_add_edns(sdns_context * ctx, sdns_opt_rdata * opt){
             // if the new record is an empty edns0 record, we just skip
             // this is just edns0-aware structure, we can skip it as the packet already has edns0
             if (opt->option_length == 0 && opt->option_data == NULL && opt->option_code == 0){
-                free(opt);
+                sdns_free(opt);
                 return sdns_rcode_NoError;
             }
             // if the new record has data, we need to check if the last one was empty
@@ -3320,7 +5567,7 @@ int sdns_add_edns(sdns_context * ctx, sdns_opt_rdata * opt){
                 tmp->opt_rdata = opt;
                 tmp->rdlength = 4 + opt->option_length;
                 // now free() the previous one
-                free(just_to_free);
+                sdns_free(just_to_free);
                 // we don't need to increment the header as we replaced the previous one
                 return sdns_rcode_NoError;
             }else{
@@ -3338,8 +5585,10 @@ int sdns_add_edns(sdns_context * ctx, sdns_opt_rdata * opt){
             }else{
                 new_section = sdns_init_rr(NULL, sdns_rr_type_OPT, UDP_PAYLOAD_SIZE, 0x00, opt->option_length + 4, 1, (void*)opt);
             }
-            tmp->next = new_section;
-            ctx->msg->header.arcount += 1;
+            if (NULL == new_section)    // opt still belongs to the caller
+                return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+            _section_append(ctx, DNS_SECTION_ADDITIONAL, new_section);
+            ctx->heap_rrs += 1;
         }
     }else{
         // we need to add a new section (we don't have additional section)
@@ -3352,8 +5601,10 @@ int sdns_add_edns(sdns_context * ctx, sdns_opt_rdata * opt){
             // this is a real edns0 data
             new_section = sdns_init_rr(NULL, 41, UDP_PAYLOAD_SIZE, 0x0, opt->option_length + 4, 1, (void*) opt);
         }
-        ctx->msg->additional = new_section;
-        ctx->msg->header.arcount = 1;
+        if (NULL == new_section)
+            return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        _section_append(ctx, DNS_SECTION_ADDITIONAL, new_section);
+        ctx->heap_rrs += 1;
     }
     return sdns_rcode_NoError;
 }
@@ -3364,11 +5615,17 @@ int sdns_add_edns(sdns_context * ctx, sdns_opt_rdata * opt){
 //return null on failure, a pointer to sdns_rr_OPT_EDE on success
 //the function creates a copy of the data, so user is responsible to free the extra_text if it's necessary
 sdns_opt_rdata * sdns_create_edns0_ede(uint16_t info_code, char * extra_text, uint16_t extra_text_len){
-    sdns_opt_rdata * opt = (sdns_opt_rdata *) malloc_or_abort(sizeof(sdns_opt_rdata));
+    sdns_opt_rdata * opt = (sdns_opt_rdata *) sdns_malloc(sizeof(sdns_opt_rdata));
+    if (NULL == opt)
+        return NULL;
     opt->option_code = sdns_edns0_option_code_Extended_DNS_Error;
     opt->next = NULL;
     opt->option_length = extra_text_len + 2;
-    opt->option_data = (char*) malloc_or_abort(opt->option_length);
+    opt->option_data = (char*) sdns_malloc(opt->option_length);
+    if (NULL == opt->option_data){
+        sdns_free(opt);
+        return NULL;
+    }
     opt->option_data[0] = (uint8_t)((info_code >> 8) & 0xFF);
     opt->option_data[1] = (uint8_t)(info_code & 0xFF);
     if (extra_text != NULL)
@@ -3379,11 +5636,11 @@ sdns_opt_rdata * sdns_create_edns0_ede(uint16_t info_code, char * extra_text, ui
 // this function will add NSID to the packet in edns0 part
 // nsid structure is empty but its option_code is 3
 sdns_opt_rdata * sdns_create_edns0_nsid(char * nsid, uint16_t nsid_len){
-    sdns_opt_rdata * opt = (sdns_opt_rdata *) malloc_or_abort(sizeof(sdns_opt_rdata));
-    if (nsid == NULL && nsid_len != 0){
-        sdns_free_opt_rdata(opt);
+    if (nsid == NULL && nsid_len != 0)
         return NULL;    // can not have NULL with length > 0
-    }
+    sdns_opt_rdata * opt = (sdns_opt_rdata *) sdns_malloc(sizeof(sdns_opt_rdata));
+    if (NULL == opt)
+        return NULL;
     opt->option_code = sdns_edns0_option_code_NSID;
     opt->next = NULL;
     opt->option_length = nsid_len;
@@ -3403,10 +5660,16 @@ sdns_opt_rdata * sdns_create_edns0_cookie(char * client_cookie, char * server_co
     if (client_cookie == NULL)
         return NULL;
     // len(client_cookie) = 8
-    sdns_opt_rdata * cookie = (sdns_opt_rdata*)malloc_or_abort(sizeof(sdns_opt_rdata));
+    sdns_opt_rdata * cookie = (sdns_opt_rdata*)sdns_malloc(sizeof(sdns_opt_rdata));
+    if (NULL == cookie)
+        return NULL;
     cookie->next = NULL;
     cookie->option_code = sdns_edns0_option_code_COOKIE;
-    cookie->option_data = (char*)malloc_or_abort(server_cookie_len + 8);
+    cookie->option_data = (char*)sdns_malloc(server_cookie_len + 8);
+    if (NULL == cookie->option_data){
+        sdns_free(cookie);
+        return NULL;
+    }
     cookie->option_length = server_cookie_len + 8;
     memcpy(cookie->option_data, client_cookie, 8);
     if (server_cookie_len > 0)
@@ -3415,7 +5678,9 @@ sdns_opt_rdata * sdns_create_edns0_cookie(char * client_cookie, char * server_co
 }
 
 sdns_opt_rdata * sdns_init_opt_rdata(void){
-    sdns_opt_rdata * opt = (sdns_opt_rdata*)malloc_or_abort(sizeof(sdns_opt_rdata));
+    sdns_opt_rdata * opt = (sdns_opt_rdata*)sdns_malloc(sizeof(sdns_opt_rdata));
+    if (NULL == opt)
+        return NULL;
     opt->next = NULL;
     opt->option_code = 0;
     opt->option_data = NULL;
@@ -3430,9 +5695,9 @@ void sdns_free_opt_rdata(sdns_opt_rdata * opt){
     sdns_opt_rdata * tmp = opt;
     sdns_opt_rdata * helper = NULL;
     while (tmp){
-        free(tmp->option_data);
+        sdns_free(tmp->option_data);
         helper = tmp->next;
-        free(tmp);
+        sdns_free(tmp);
         tmp = helper;
     }
     return;
@@ -3455,13 +5720,13 @@ sdns_opt_rdata * sdns_decode_rr_OPT(sdns_context * ctx, sdns_rr * rr){
         return opt;
     }
     if (rr->rdlength < 4){  // if it's > 0 then it must be atleast 4
-        free(opt);
+        sdns_free(opt);
         ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
         return NULL;
     }
     if (rr->rdata + rr->rdlength > ctx->raw + ctx->raw_len){
         // we don't have enough data in the packet
-        free(opt);
+        sdns_free(opt);
         ctx->err = SDNS_ERROR_RR_SECTION_MALFORMED;
         return NULL;
     }
@@ -3499,6 +5764,13 @@ sdns_opt_rdata * sdns_decode_rr_OPT(sdns_context * ctx, sdns_rr * rr){
                 return NULL;
             }
             tmp->option_data = mem_copy(rdata + cnt, tmp->option_length);
+            if (NULL == tmp->option_data){
+                sdns_free_opt_rdata(opt);
+                if (tmp != opt)
+                    sdns_free_opt_rdata(tmp);
+                ctx->err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+                return NULL;
+            }
             cnt += tmp->option_length;
         }
         if (opt == tmp){
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sdns_alloc.h>
+
+static void * _default_malloc(size_t size, void * userdata){
+    return malloc(size);
+}
+
+static void * _default_realloc(void * ptr, size_t size, void * userdata){
+    return realloc(ptr, size);
+}
+
+static void _default_free(void * ptr, void * userdata){
+    free(ptr);
+}
+
+static sdns_allocator _allocator = {_default_malloc, _default_realloc, _default_free, NULL};
+
+int sdns_set_allocator(sdns_malloc_fn malloc_fn, sdns_realloc_fn realloc_fn, sdns_free_fn free_fn, void * userdata){
+    if (NULL == malloc_fn && NULL == realloc_fn && NULL == free_fn){
+        _allocator.malloc_fn = _default_malloc;
+        _allocator.realloc_fn = _default_realloc;
+        _allocator.free_fn = _default_free;
+        _allocator.userdata = NULL;
+        return 0;
+    }
+    if (NULL == malloc_fn || NULL == realloc_fn || NULL == free_fn)
+        return 1;
+    _allocator.malloc_fn = malloc_fn;
+    _allocator.realloc_fn = realloc_fn;
+    _allocator.free_fn = free_fn;
+    _allocator.userdata = userdata;
+    return 0;
+}
+
+const sdns_allocator * sdns_get_allocator(void){
+    return &_allocator;
+}
+
+void * sdns_malloc_with(const sdns_allocator * allocator, size_t size){
+    if (NULL == allocator)
+        allocator = &_allocator;
+    // malloc(0) may return NULL and we use NULL for failure
+    return allocator->malloc_fn(size > 0?size:1, allocator->userdata);
+}
+
+void * sdns_realloc_with(const sdns_allocator * allocator, void * ptr, size_t size){
+    if (NULL == allocator)
+        allocator = &_allocator;
+    return allocator->realloc_fn(ptr, size > 0?size:1, allocator->userdata);
+}
+
+void sdns_free_with(const sdns_allocator * allocator, void * ptr){
+    if (NULL == ptr)
+        return;
+    if (NULL == allocator)
+        allocator = &_allocator;
+    allocator->free_fn(ptr, allocator->userdata);
+}
+
+void * sdns_malloc(size_t size){
+    return _allocator.malloc_fn(size > 0?size:1, _allocator.userdata);
+}
+
+void * sdns_calloc(size_t n, size_t size){
+    if (size != 0 && n > SIZE_MAX / size)
+        return NULL;
+    void * p = sdns_malloc(n * size);
+    if (NULL != p)
+        memset(p, 0, n * size);
+    return p;
+}
+
+void * sdns_realloc(void * ptr, size_t size){
+    return _allocator.realloc_fn(ptr, size > 0?size:1, _allocator.userdata);
+}
+
+void sdns_free(void * ptr){
+    if (NULL == ptr)
+        return;
+    _allocator.free_fn(ptr, _allocator.userdata);
+}
+
+char * sdns_strdup(const char * s){
+    if (NULL == s)
+        return NULL;
+    size_t len = strlen(s) + 1;
+    char * p = (char*) sdns_malloc(len);
+    if (NULL != p)
+        memcpy(p, s, len);
+    return p;
+}
@@ -4,6 +4,14 @@
 #include <sdns_utils.h>
 #include <stdlib.h>
 
+// frees the rr created by sdns_context_init_rr() when we could not add it to the packet
+static void _free_api_rr(sdns_rr * rr){
+    if (NULL == rr || rr->in_arena)     // arena ones are released with the context
+        return;
+    sdns_free(rr->name);
+    sdns_free(rr);
+}
+
 
 sdns_context * sdns_from_network(char * buff, uint16_t buff_len){
     if (buff == NULL || buff_len == 0)
@@ -19,8 +27,22 @@ sdns_context * sdns_from_network(char * buff, uint16_t buff_len){
     dns->raw_len = buff_len;
     int res = sdns_from_wire(dns);
     if (res != 0){
-        dns->raw = NULL;
-        dns->raw_len = 0;
+        sdns_free_context(dns);     // and the copy of the packet
+        return NULL;
+    }
+    return dns;
+}
+
+sdns_context * sdns_from_network_borrow(char * buff, uint16_t buff_len){
+    if (buff == NULL || buff_len == 0)
+        return NULL;
+    sdns_context * dns = sdns_init_context();
+    if (dns == NULL)
+        return NULL;
+    dns->flags |= SDNS_CTX_BORROWED;
+    dns->raw = buff;
+    dns->raw_len = buff_len;
+    if (sdns_from_wire(dns) != 0){
         sdns_free_context(dns);
         return NULL;
     }
@@ -42,16 +64,9 @@ char * sdns_to_network(sdns_context * dns, int * err, uint16_t * buff_len){
         *buff_len = 0;
         return NULL;
     }
-    char * new_buffer = mem_copy(dns->raw, dns->raw_len);
-    // we don't need this anymore
-    free(dns->raw);
+    // the packet is the caller's now, no need to copy it
+    char * new_buffer = dns->raw;
     dns->raw = NULL;
-
-    if (NULL == new_buffer){
-        *err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
-        *buff_len = 0;
-        return NULL;
-    }
     // we are successful
     *err  = 0;
     *buff_len = dns->raw_len;
@@ -68,14 +83,13 @@ int sdns_add_rr_answer_A(sdns_context * dns, char * name, uint32_t ttl, char * i
     if (cipv4_is_ip_valid(ip) == 0)     // zero means invalid IPv4
         return 100;     // invalid IP
     uint32_t ipaddress = cipv4_str_to_uint(ip);
-    sdns_rr_A * a  = sdns_init_rr_A(ipaddress);
-    char * section_name = safe_strdup(name); 
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_A, sdns_q_class_IN, ttl, 0, 1, (void*) a);
-    int res = sdns_add_answer_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_A, sdns_q_class_IN, ttl, 0, 1, NULL);
+    sdns_rr_A * a = (sdns_rr_A*) sdns_rr_inline_rdata(rr);
+    if (a != NULL)
+        a->address = ipaddress;
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
-        free(a);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   //success
@@ -90,14 +104,13 @@ int sdns_add_rr_additional_A(sdns_context * dns, char * name, uint32_t ttl, char
     if (cipv4_is_ip_valid(ip) == 0)     // zero means invalid IPv4
         return 100;     // invalid IP
     uint32_t ipaddress = cipv4_str_to_uint(ip);
-    sdns_rr_A * a  = sdns_init_rr_A(ipaddress);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_A, sdns_q_class_IN, ttl, 0, 1, (void*) a);
-    int res = sdns_add_additional_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_A, sdns_q_class_IN, ttl, 0, 1, NULL);
+    sdns_rr_A * a = (sdns_rr_A*) sdns_rr_inline_rdata(rr);
+    if (a != NULL)
+        a->address = ipaddress;
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
-        free(a);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   //success
@@ -111,14 +124,13 @@ int sdns_add_rr_authority_A(sdns_context * dns, char * name, uint32_t ttl, char
     if (cipv4_is_ip_valid(ip) == 0)     // zero means invalid IPv4
         return 100;     // invalid IP
     uint32_t ipaddress = cipv4_str_to_uint(ip);
-    sdns_rr_A * a  = sdns_init_rr_A(ipaddress);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_A, sdns_q_class_IN, ttl, 0, 1, (void*) a);
-    int res = sdns_add_authority_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_A, sdns_q_class_IN, ttl, 0, 1, NULL);
+    sdns_rr_A * a = (sdns_rr_A*) sdns_rr_inline_rdata(rr);
+    if (a != NULL)
+        a->address = ipaddress;
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
-        free(a);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   //success
@@ -130,15 +142,19 @@ int sdns_add_rr_answer_NS(sdns_context * dns, char * name, uint32_t ttl, char *
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_name = safe_strdup(nsname);
+    if (NULL == new_name && NULL != nsname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_NS * ns  = sdns_init_rr_NS(new_name);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_NS, sdns_q_class_IN, ttl, 0, 1, (void*) ns);
-    int res = sdns_add_answer_section(dns, rr);
+    if (NULL == ns){
+        sdns_free(new_name);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_NS, sdns_q_class_IN, ttl, 0, 1, (void*) ns);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
-        free(ns->NSDNAME);
-        free(ns);
+        _free_api_rr(rr);
+        sdns_free(ns->NSDNAME);
+        sdns_free(ns);
         return res;
     }
     return 0;   //success
@@ -148,15 +164,19 @@ int sdns_add_rr_authority_NS(sdns_context * dns, char * name, uint32_t ttl, char
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_name = safe_strdup(nsname);
+    if (NULL == new_name && NULL != nsname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_NS * ns  = sdns_init_rr_NS(new_name);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_NS, sdns_q_class_IN, ttl, 0, 1, (void*) ns);
-    int res = sdns_add_authority_section(dns, rr);
+    if (NULL == ns){
+        sdns_free(new_name);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_NS, sdns_q_class_IN, ttl, 0, 1, (void*) ns);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
-        free(ns->NSDNAME);
-        free(ns);
+        _free_api_rr(rr);
+        sdns_free(ns->NSDNAME);
+        sdns_free(ns);
         return res;
     }
     return 0;   //success
@@ -166,15 +186,19 @@ int sdns_add_rr_additional_NS(sdns_context * dns, char * name, uint32_t ttl, cha
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_name = safe_strdup(nsname);
+    if (NULL == new_name && NULL != nsname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_NS * ns  = sdns_init_rr_NS(new_name);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_NS, sdns_q_class_IN, ttl, 0, 1, (void*) ns);
-    int res = sdns_add_additional_section(dns, rr);
+    if (NULL == ns){
+        sdns_free(new_name);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_NS, sdns_q_class_IN, ttl, 0, 1, (void*) ns);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
-        free(ns->NSDNAME);
-        free(ns);
+        _free_api_rr(rr);
+        sdns_free(ns->NSDNAME);
+        sdns_free(ns);
         return res;
     }
     return 0;   //success
@@ -192,12 +216,14 @@ int sdns_add_rr_answer_TXT(sdns_context * dns, char * name, uint32_t ttl, char *
         }
     }
     sdns_rr_TXT * txt = sdns_init_rr_TXT(new_txt, text_len);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_TXT, sdns_q_class_IN, ttl, 0, 1, (void*) txt);
-    int res = sdns_add_answer_section(dns, rr);
+    if (NULL == txt){
+        sdns_free(new_txt);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_TXT, sdns_q_class_IN, ttl, 0, 1, (void*) txt);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         sdns_free_rr_TXT(txt);
         return res;
     }
@@ -216,12 +242,14 @@ int sdns_add_rr_authority_TXT(sdns_context * dns, char * name, uint32_t ttl, cha
         }
     }
     sdns_rr_TXT * txt = sdns_init_rr_TXT(new_txt, text_len);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_TXT, sdns_q_class_IN, ttl, 0, 1, (void*) txt);
-    int res = sdns_add_authority_section(dns, rr);
+    if (NULL == txt){
+        sdns_free(new_txt);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_TXT, sdns_q_class_IN, ttl, 0, 1, (void*) txt);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         sdns_free_rr_TXT(txt);
         return res;
     }
@@ -241,12 +269,14 @@ int sdns_add_rr_additional_TXT(sdns_context * dns, char * name, uint32_t ttl, ch
         }
     }
     sdns_rr_TXT * txt = sdns_init_rr_TXT(new_txt, text_len);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_TXT, sdns_q_class_IN, ttl, 0, 1, (void*) txt);
-    int res = sdns_add_additional_section(dns, rr);
+    if (NULL == txt){
+        sdns_free(new_txt);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_TXT, sdns_q_class_IN, ttl, 0, 1, (void*) txt);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         sdns_free_rr_TXT(txt);
         return res;
     }
@@ -257,6 +287,9 @@ int sdns_remove_edns(sdns_context * dns){
     // this function remove edns0 (type OPT) from a packet if exists
     if (dns == NULL)
         return SDNS_ERROR_BUFFER_IS_NULL;
+    int res = sdns_decode_section(dns, DNS_SECTION_ADDITIONAL);
+    if (res != sdns_rcode_NoError)
+        return res;
     sdns_rr* additional = dns->msg->additional;
     if (NULL == additional)    // there is nothing to remove
         return 0;
@@ -282,23 +315,26 @@ int sdns_remove_edns(sdns_context * dns){
             dns->msg->additional = tmp->next;
         }
         // now we need to free additional
-        free(additional->name);
         additional->next = NULL;
         // we need to reduce the arcount  in the header as well
         dns->msg->header.arcount -= 1;
+        // the index may still point to the RR we free
+        dns->msg->additional_index.count = 0;
+        dns->msg->additional_index.tail = NULL;
         if (additional->decoded == 1){
             sdns_opt_rdata * opt = additional->opt_rdata;
             sdns_opt_rdata * tmpopt = opt;
             while (opt){
-                free(opt->option_data);
+                sdns_free(opt->option_data);
                 tmpopt = opt->next;
-                free(opt);
+                sdns_free(opt);
                 opt = tmpopt;
             }
-            free(additional);
-        }else{
-            free(additional->rdata);
-            free(additional);
+        }
+        // rdata of a non-decoded record points to the raw buffer
+        if (!additional->in_arena){
+            sdns_free(additional->name);
+            sdns_free(additional);
         }
     }else{
         // we don't have OPT record. Let's return
@@ -319,7 +355,7 @@ sdns_context * sdns_create_query(char * name, char * type, char * cls){
     if (NULL == dns)
         return NULL;
     
-    int res = sdns_make_query(dns, new_type, new_class, strdup(name), 1);
+    int res = sdns_make_query(dns, new_type, new_class, sdns_strdup(name), 1);
     if (res != 0){
         sdns_free_context(dns);
         return NULL;
@@ -336,14 +372,22 @@ int sdns_add_rr_answer_SOA(sdns_context * dns, char * name, uint32_t ttl,  char
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_mname = safe_strdup(mname);
     char * new_rname = safe_strdup(rname);
+    if ((NULL == new_mname && NULL != mname) || (NULL == new_rname && NULL != rname)){
+        sdns_free(new_mname);
+        sdns_free(new_rname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     
     sdns_rr_SOA * soa = sdns_init_rr_SOA(new_mname, new_rname, expire, minimum, refresh, retry, serial);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_SOA, sdns_q_class_IN, ttl, 0, 1, (void*) soa);
-    int res = sdns_add_answer_section(dns, rr);
+    if (NULL == soa){
+        sdns_free(new_mname);
+        sdns_free(new_rname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_SOA, sdns_q_class_IN, ttl, 0, 1, (void*) soa);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         sdns_free_rr_SOA(soa);
         return res;
     }
@@ -359,14 +403,22 @@ int sdns_add_rr_authority_SOA(sdns_context * dns, char * name, uint32_t ttl,  ch
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_mname = safe_strdup(mname);
     char * new_rname = safe_strdup(rname);
+    if ((NULL == new_mname && NULL != mname) || (NULL == new_rname && NULL != rname)){
+        sdns_free(new_mname);
+        sdns_free(new_rname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     
     sdns_rr_SOA * soa = sdns_init_rr_SOA(new_mname, new_rname, expire, minimum, refresh, retry, serial);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_SOA, sdns_q_class_IN, ttl, 0, 1, (void*) soa);
-    int res = sdns_add_authority_section(dns, rr);
+    if (NULL == soa){
+        sdns_free(new_mname);
+        sdns_free(new_rname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_SOA, sdns_q_class_IN, ttl, 0, 1, (void*) soa);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         sdns_free_rr_SOA(soa);
         return res;
     }
@@ -381,14 +433,22 @@ int sdns_add_rr_additional_SOA(sdns_context * dns, char * name, uint32_t ttl,  c
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_mname = safe_strdup(mname);
     char * new_rname = safe_strdup(rname);
+    if ((NULL == new_mname && NULL != mname) || (NULL == new_rname && NULL != rname)){
+        sdns_free(new_mname);
+        sdns_free(new_rname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     
     sdns_rr_SOA * soa = sdns_init_rr_SOA(new_mname, new_rname, expire, minimum, refresh, retry, serial);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_SOA, sdns_q_class_IN, ttl, 0, 1, (void*) soa);
-    int res = sdns_add_additional_section(dns, rr);
+    if (NULL == soa){
+        sdns_free(new_mname);
+        sdns_free(new_rname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_SOA, sdns_q_class_IN, ttl, 0, 1, (void*) soa);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         sdns_free_rr_SOA(soa);
         return res;
     }
@@ -400,15 +460,19 @@ int sdns_add_rr_additional_SOA(sdns_context * dns, char * name, uint32_t ttl,  c
 int sdns_add_rr_answer_CNAME(sdns_context * dns, char * name, uint32_t ttl, char * cname){
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
-    char * new_cname = cname == NULL?NULL:strdup(cname);
+    char * new_cname = cname == NULL?NULL:sdns_strdup(cname);
+    if (NULL == new_cname && NULL != cname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_CNAME * cn = sdns_init_rr_CNAME(new_cname);
-    char * section_name = name == NULL?NULL:strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_CNAME, sdns_q_class_IN, ttl, 0, 1, (void*) cn);
-    int res = sdns_add_answer_section(dns, rr);
+    if (NULL == cn){
+        sdns_free(new_cname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_CNAME, sdns_q_class_IN, ttl, 0, 1, (void*) cn);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
         sdns_free_rr_CNAME(cn);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;  //success
@@ -417,15 +481,19 @@ int sdns_add_rr_answer_CNAME(sdns_context * dns, char * name, uint32_t ttl, char
 int sdns_add_rr_authority_CNAME(sdns_context * dns, char * name, uint32_t ttl, char * cname){
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
-    char * new_cname = cname == NULL?NULL:strdup(cname);
+    char * new_cname = cname == NULL?NULL:sdns_strdup(cname);
+    if (NULL == new_cname && NULL != cname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_CNAME * cn = sdns_init_rr_CNAME(new_cname);
-    char * section_name = name == NULL?NULL:strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_CNAME, sdns_q_class_IN, ttl, 0, 1, (void*) cn);
-    int res = sdns_add_authority_section(dns, rr);
+    if (NULL == cn){
+        sdns_free(new_cname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_CNAME, sdns_q_class_IN, ttl, 0, 1, (void*) cn);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
         sdns_free_rr_CNAME(cn);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;  //success
@@ -435,15 +503,19 @@ int sdns_add_rr_authority_CNAME(sdns_context * dns, char * name, uint32_t ttl, c
 int sdns_add_rr_additional_CNAME(sdns_context * dns, char * name, uint32_t ttl, char * cname){
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
-    char * new_cname = cname == NULL?NULL:strdup(cname);
+    char * new_cname = cname == NULL?NULL:sdns_strdup(cname);
+    if (NULL == new_cname && NULL != cname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_CNAME * cn = sdns_init_rr_CNAME(new_cname);
-    char * section_name = name == NULL?NULL:strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_CNAME, sdns_q_class_IN, ttl, 0, 1, (void*) cn);
-    int res = sdns_add_additional_section(dns, rr);
+    if (NULL == cn){
+        sdns_free(new_cname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_CNAME, sdns_q_class_IN, ttl, 0, 1, (void*) cn);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
         sdns_free_rr_CNAME(cn);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;  //success
@@ -455,15 +527,15 @@ int sdns_add_rr_answer_NID(sdns_context * dns, char * name, uint32_t ttl, uint16
     if (nodeid == NULL){
         return SDNS_ERROR_BUFFER_IS_NULL;
     }
-    char * new_nodeid = mem_copy(nodeid, 8);
-    sdns_rr_NID * nid = sdns_init_rr_NID(preference, new_nodeid);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_NID, sdns_q_class_IN, ttl, 0, 1, (void*) nid);
-    int res = sdns_add_answer_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_NID, sdns_q_class_IN, ttl, 0, 1, NULL);
+    sdns_rr_NID * nid = (sdns_rr_NID*) sdns_rr_inline_rdata(rr);
+    if (nid != NULL){
+        nid->Preference = preference;
+        memcpy(nid->NodeId, nodeid, 8);
+    }
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
-        sdns_free_rr_NID(nid);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -475,15 +547,15 @@ int sdns_add_rr_authority_NID(sdns_context * dns, char * name, uint32_t ttl, uin
     if (nodeid == NULL){
         return SDNS_ERROR_BUFFER_IS_NULL;
     }
-    char * new_nodeid = mem_copy(nodeid, 8);
-    sdns_rr_NID * nid = sdns_init_rr_NID(preference, new_nodeid);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_NID, sdns_q_class_IN, ttl, 0, 1, (void*) nid);
-    int res = sdns_add_authority_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_NID, sdns_q_class_IN, ttl, 0, 1, NULL);
+    sdns_rr_NID * nid = (sdns_rr_NID*) sdns_rr_inline_rdata(rr);
+    if (nid != NULL){
+        nid->Preference = preference;
+        memcpy(nid->NodeId, nodeid, 8);
+    }
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
-        sdns_free_rr_NID(nid);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -495,15 +567,15 @@ int sdns_add_rr_additional_NID(sdns_context * dns, char * name, uint32_t ttl, ui
     if (nodeid == NULL){
         return SDNS_ERROR_BUFFER_IS_NULL;
     }
-    char * new_nodeid = mem_copy(nodeid, 8);
-    sdns_rr_NID * nid = sdns_init_rr_NID(preference, new_nodeid);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_NID, sdns_q_class_IN, ttl, 0, 1, (void*) nid);
-    int res = sdns_add_additional_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_NID, sdns_q_class_IN, ttl, 0, 1, NULL);
+    sdns_rr_NID * nid = (sdns_rr_NID*) sdns_rr_inline_rdata(rr);
+    if (nid != NULL){
+        nid->Preference = preference;
+        memcpy(nid->NodeId, nodeid, 8);
+    }
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
-        sdns_free_rr_NID(nid);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -517,14 +589,22 @@ int sdns_add_rr_answer_CAA(sdns_context * dns, char * name, uint32_t ttl, uint8_
     }
     char * new_tag = safe_strdup(tag);
     char * new_value = value == NULL?NULL:safe_strdup(value);
+    if (NULL == new_tag || (NULL == new_value && NULL != value)){
+        sdns_free(new_tag);
+        sdns_free(new_value);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     sdns_rr_CAA * caa = sdns_init_rr_CAA(flag, new_tag, strlen(tag), new_value, new_value == NULL?0:strlen(new_value));
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_CAA, sdns_q_class_IN, ttl, 0, 1, (void*) caa);
-    int res = sdns_add_answer_section(dns, rr);
+    if (NULL == caa){
+        sdns_free(new_tag);
+        sdns_free(new_value);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_CAA, sdns_q_class_IN, ttl, 0, 1, (void*) caa);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
         sdns_free_rr_CAA(caa);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -538,14 +618,22 @@ int sdns_add_rr_authority_CAA(sdns_context * dns, char * name, uint32_t ttl, uin
     }
     char * new_tag = safe_strdup(tag);
     char * new_value = value == NULL?NULL:safe_strdup(value);
+    if (NULL == new_tag || (NULL == new_value && NULL != value)){
+        sdns_free(new_tag);
+        sdns_free(new_value);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     sdns_rr_CAA * caa = sdns_init_rr_CAA(flag, new_tag, strlen(tag), new_value, new_value == NULL?0:strlen(new_value));
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_CAA, sdns_q_class_IN, ttl, 0, 1, (void*) caa);
-    int res = sdns_add_authority_section(dns, rr);
+    if (NULL == caa){
+        sdns_free(new_tag);
+        sdns_free(new_value);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_CAA, sdns_q_class_IN, ttl, 0, 1, (void*) caa);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
         sdns_free_rr_CAA(caa);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -559,14 +647,22 @@ int sdns_add_rr_additional_CAA(sdns_context * dns, char * name, uint32_t ttl, ui
     }
     char * new_tag = safe_strdup(tag);
     char * new_value = value == NULL?NULL:safe_strdup(value);
+    if (NULL == new_tag || (NULL == new_value && NULL != value)){
+        sdns_free(new_tag);
+        sdns_free(new_value);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     sdns_rr_CAA * caa = sdns_init_rr_CAA(flag, new_tag, strlen(tag), new_value, new_value == NULL?0:strlen(new_value));
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_CAA, sdns_q_class_IN, ttl, 0, 1, (void*) caa);
-    int res = sdns_add_additional_section(dns, rr);
+    if (NULL == caa){
+        sdns_free(new_tag);
+        sdns_free(new_value);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_CAA, sdns_q_class_IN, ttl, 0, 1, (void*) caa);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
         sdns_free_rr_CAA(caa);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -577,14 +673,18 @@ int sdns_add_rr_answer_MX(sdns_context * dns, char * name, uint32_t ttl, uint16_
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_exchange = safe_strdup(exchange);
+    if (NULL == new_exchange && NULL != exchange)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_MX * mx = sdns_init_rr_MX(preference, new_exchange);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_MX, sdns_q_class_IN, ttl, 0, 1, (void*) mx);
-    int res = sdns_add_answer_section(dns, rr);
+    if (NULL == mx){
+        sdns_free(new_exchange);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_MX, sdns_q_class_IN, ttl, 0, 1, (void*) mx);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
         sdns_free_rr_MX(mx);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0; // success
@@ -595,14 +695,18 @@ int sdns_add_rr_authority_MX(sdns_context * dns, char * name, uint32_t ttl, uint
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_exchange = safe_strdup(exchange);
+    if (NULL == new_exchange && NULL != exchange)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_MX * mx = sdns_init_rr_MX(preference, new_exchange);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_MX, sdns_q_class_IN, ttl, 0, 1, (void*) mx);
-    int res = sdns_add_authority_section(dns, rr);
+    if (NULL == mx){
+        sdns_free(new_exchange);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_MX, sdns_q_class_IN, ttl, 0, 1, (void*) mx);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
         sdns_free_rr_MX(mx);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0; // success
@@ -613,14 +717,18 @@ int sdns_add_rr_additional_MX(sdns_context * dns, char * name, uint32_t ttl, uin
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_exchange = safe_strdup(exchange);
+    if (NULL == new_exchange && NULL != exchange)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_MX * mx = sdns_init_rr_MX(preference, new_exchange);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_MX, sdns_q_class_IN, ttl, 0, 1, (void*) mx);
-    int res = sdns_add_additional_section(dns, rr);
+    if (NULL == mx){
+        sdns_free(new_exchange);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_MX, sdns_q_class_IN, ttl, 0, 1, (void*) mx);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
         sdns_free_rr_MX(mx);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0; // success
@@ -631,14 +739,18 @@ int sdns_add_rr_answer_PTR(sdns_context * dns, char * name, uint32_t ttl, char *
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_ptrdname = safe_strdup(ptrdname);
+    if (NULL == new_ptrdname && NULL != ptrdname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_PTR * ptr = sdns_init_rr_PTR(new_ptrdname);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_PTR, sdns_q_class_IN, ttl, 0, 1, (void*)ptr);
-    int res = sdns_add_answer_section(dns, rr);
+    if (NULL == ptr){
+        sdns_free(new_ptrdname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_PTR, sdns_q_class_IN, ttl, 0, 1, (void*)ptr);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
         sdns_free_rr_PTR(ptr);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -649,14 +761,18 @@ int sdns_add_rr_authority_PTR(sdns_context * dns, char * name, uint32_t ttl, cha
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_ptrdname = safe_strdup(ptrdname);
+    if (NULL == new_ptrdname && NULL != ptrdname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_PTR * ptr = sdns_init_rr_PTR(new_ptrdname);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_PTR, sdns_q_class_IN, ttl, 0, 1, (void*)ptr);
-    int res = sdns_add_authority_section(dns, rr);
+    if (NULL == ptr){
+        sdns_free(new_ptrdname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_PTR, sdns_q_class_IN, ttl, 0, 1, (void*)ptr);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
         sdns_free_rr_PTR(ptr);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -667,14 +783,18 @@ int sdns_add_rr_additional_PTR(sdns_context * dns, char * name, uint32_t ttl, ch
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_ptrdname = safe_strdup(ptrdname);
+    if (NULL == new_ptrdname && NULL != ptrdname)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_PTR * ptr = sdns_init_rr_PTR(new_ptrdname);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_PTR, sdns_q_class_IN, ttl, 0, 1, (void*)ptr);
-    int res = sdns_add_additional_section(dns, rr);
+    if (NULL == ptr){
+        sdns_free(new_ptrdname);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_PTR, sdns_q_class_IN, ttl, 0, 1, (void*)ptr);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
         sdns_free_rr_PTR(ptr);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -686,14 +806,18 @@ int sdns_add_rr_answer_SRV(sdns_context * dns, char * name, uint32_t ttl,
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_target = safe_strdup(target);
+    if (NULL == new_target && NULL != target)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_SRV * srv = sdns_init_rr_SRV(priority, weight, port, new_target);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_SRV, sdns_q_class_IN, ttl, 0, 1, (void*)srv);
-    int res = sdns_add_answer_section(dns, rr);
+    if (NULL == srv){
+        sdns_free(new_target);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_SRV, sdns_q_class_IN, ttl, 0, 1, (void*)srv);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
         sdns_free_rr_SRV(srv);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -705,14 +829,18 @@ int sdns_add_rr_authority_SRV(sdns_context * dns, char * name, uint32_t ttl,
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_target = safe_strdup(target);
+    if (NULL == new_target && NULL != target)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_SRV * srv = sdns_init_rr_SRV(priority, weight, port, new_target);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_SRV, sdns_q_class_IN, ttl, 0, 1, (void*)srv);
-    int res = sdns_add_authority_section(dns, rr);
+    if (NULL == srv){
+        sdns_free(new_target);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_SRV, sdns_q_class_IN, ttl, 0, 1, (void*)srv);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
         sdns_free_rr_SRV(srv);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -724,14 +852,18 @@ int sdns_add_rr_additional_SRV(sdns_context * dns, char * name, uint32_t ttl,
     if (NULL == dns)
         return SDNS_ERROR_BUFFER_IS_NULL;
     char * new_target = safe_strdup(target);
+    if (NULL == new_target && NULL != target)
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     sdns_rr_SRV * srv = sdns_init_rr_SRV(priority, weight, port, new_target);
-    char * section_name = safe_strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_SRV, sdns_q_class_IN, ttl, 0, 1, (void*)srv);
-    int res = sdns_add_additional_section(dns, rr);
+    if (NULL == srv){
+        sdns_free(new_target);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_SRV, sdns_q_class_IN, ttl, 0, 1, (void*)srv);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
         sdns_free_rr_SRV(srv);
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -751,14 +883,22 @@ int sdns_add_rr_answer_HINFO(sdns_context * dns, char * name, uint32_t ttl,
         new_cpu = mem_copy(cpu, cpu_len);
     if (os_len > 0 && os != NULL)
         new_os = mem_copy(os, os_len);
+    if ((cpu_len > 0 && NULL == new_cpu) || (os_len > 0 && NULL == new_os)){
+        sdns_free(new_cpu);
+        sdns_free(new_os);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     
     sdns_rr_HINFO * hinfo  = sdns_init_rr_HINFO(cpu_len, new_cpu, os_len, new_os);
-    char * section_name = name == NULL?NULL:strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_HINFO, sdns_q_class_IN, ttl, 0, 1, (void*) hinfo);
-    int res = sdns_add_answer_section(dns, rr);
+    if (NULL == hinfo){
+        sdns_free(new_cpu);
+        sdns_free(new_os);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_HINFO, sdns_q_class_IN, ttl, 0, 1, (void*) hinfo);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         sdns_free_rr_HINFO(hinfo);
         return res;
     }
@@ -779,14 +919,22 @@ int sdns_add_rr_authority_HINFO(sdns_context * dns, char * name, uint32_t ttl,
         new_cpu = mem_copy(cpu, cpu_len);
     if (os_len > 0 && os != NULL)
         new_os = mem_copy(os, os_len);
+    if ((cpu_len > 0 && NULL == new_cpu) || (os_len > 0 && NULL == new_os)){
+        sdns_free(new_cpu);
+        sdns_free(new_os);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     
     sdns_rr_HINFO * hinfo  = sdns_init_rr_HINFO(cpu_len, new_cpu, os_len, new_os);
-    char * section_name = name == NULL?NULL:strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_HINFO, sdns_q_class_IN, ttl, 0, 1, (void*) hinfo);
-    int res = sdns_add_authority_section(dns, rr);
+    if (NULL == hinfo){
+        sdns_free(new_cpu);
+        sdns_free(new_os);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_HINFO, sdns_q_class_IN, ttl, 0, 1, (void*) hinfo);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         sdns_free_rr_HINFO(hinfo);
         return res;
     }
@@ -808,17 +956,25 @@ int sdns_add_rr_additional_HINFO(sdns_context * dns, char * name, uint32_t ttl,
         new_cpu = mem_copy(cpu, cpu_len);
     if (os_len > 0 && os != NULL)
         new_os = mem_copy(os, os_len);
+    if ((cpu_len > 0 && NULL == new_cpu) || (os_len > 0 && NULL == new_os)){
+        sdns_free(new_cpu);
+        sdns_free(new_os);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     
     sdns_rr_HINFO * hinfo  = sdns_init_rr_HINFO(cpu_len, new_cpu, os_len, new_os);
+    if (NULL == hinfo){
+        sdns_free(new_cpu);
+        sdns_free(new_os);
+        return SDNS_ERROR_MEMORY_ALLOC_FAILED;
+    }
     if (name == NULL){
         return SDNS_ERROR_BUFFER_IS_NULL;
     }
-    char * section_name = name == NULL?NULL:strdup(name);
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_HINFO, sdns_q_class_IN, ttl, 0, 1, (void*) hinfo);
-    int res = sdns_add_additional_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_HINFO, sdns_q_class_IN, ttl, 0, 1, (void*) hinfo);
+    int res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
+        _free_api_rr(rr);
         sdns_free_rr_HINFO(hinfo);
         return res;
     }
@@ -833,15 +989,13 @@ int sdns_add_rr_answer_AAAA(sdns_context * dns, char * name, uint32_t ttl, const
     }
     if (name == NULL)
         return SDNS_ERROR_BUFFER_IS_NULL;
-    char * section_name = name == NULL?NULL:strdup(name);
-    sdns_rr_AAAA * aaaa = sdns_init_rr_AAAA((char*) mem_copy((char*)ipv6_parsed, 16));
-    
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_AAAA, sdns_q_class_IN, ttl, 0, 1, (void*)aaaa);
-    res = sdns_add_answer_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_AAAA, sdns_q_class_IN, ttl, 0, 1, NULL);
+    sdns_rr_AAAA * aaaa = (sdns_rr_AAAA*) sdns_rr_inline_rdata(rr);
+    if (aaaa != NULL)
+        memcpy(aaaa->address, ipv6_parsed, 16);
+    res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_answer_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
-        sdns_free_rr_AAAA(aaaa);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -855,14 +1009,13 @@ int sdns_add_rr_authority_AAAA(sdns_context * dns, char * name, uint32_t ttl, co
     }
     if (name == NULL)
         return SDNS_ERROR_BUFFER_IS_NULL;
-    char * section_name = name == NULL?NULL:strdup(name);
-    sdns_rr_AAAA * aaaa = sdns_init_rr_AAAA((char*) mem_copy((char*)ipv6_parsed, 16));
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_AAAA, sdns_q_class_IN, ttl, 0, 1, (void*)aaaa);
-    res = sdns_add_authority_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_AAAA, sdns_q_class_IN, ttl, 0, 1, NULL);
+    sdns_rr_AAAA * aaaa = (sdns_rr_AAAA*) sdns_rr_inline_rdata(rr);
+    if (aaaa != NULL)
+        memcpy(aaaa->address, ipv6_parsed, 16);
+    res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_authority_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
-        sdns_free_rr_AAAA(aaaa);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -876,14 +1029,13 @@ int sdns_add_rr_additional_AAAA(sdns_context * dns, char * name, uint32_t ttl, c
     }
     if (name == NULL)
         return SDNS_ERROR_BUFFER_IS_NULL;
-    char * section_name = name == NULL?NULL:strdup(name);
-    sdns_rr_AAAA * aaaa = sdns_init_rr_AAAA((char*) mem_copy((char*)ipv6_parsed, 16));
-    sdns_rr * rr = sdns_init_rr(section_name, sdns_rr_type_AAAA, sdns_q_class_IN, ttl, 0, 1, (void*)aaaa);
-    res = sdns_add_additional_section(dns, rr);
+    sdns_rr * rr = sdns_context_init_rr(dns, name, sdns_rr_type_AAAA, sdns_q_class_IN, ttl, 0, 1, NULL);
+    sdns_rr_AAAA * aaaa = (sdns_rr_AAAA*) sdns_rr_inline_rdata(rr);
+    if (aaaa != NULL)
+        memcpy(aaaa->address, ipv6_parsed, 16);
+    res = NULL == rr?SDNS_ERROR_MEMORY_ALLOC_FAILED:sdns_add_additional_section(dns, rr);
     if (res != 0){
-        free(rr->name);
-        free(rr);
-        sdns_free_rr_AAAA(aaaa);
+        _free_api_rr(rr);
         return res;
     }
     return 0;   // success
@@ -905,20 +1057,20 @@ int sdns_add_cookie(sdns_context * dns, char * client_cookie, char * server_cook
     if (server_cookie != NULL){
         server_mem = hex2mem(server_cookie);
         if (server_mem == NULL){
-            free(client_mem);
+            sdns_free(client_mem);
             return SDNS_ERROR_INVALID_HEX_VALUE;
         }
     }
     sdns_opt_rdata * opt = sdns_create_edns0_cookie(client_mem, server_mem, (int)(server_len/2));
     if (opt == NULL){
-        free(server_mem);
-        free(client_mem);
+        sdns_free(server_mem);
+        sdns_free(client_mem);
         return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     }
     int res = sdns_add_edns(dns, opt);
     // free memory as the library copy them internally
-    free(client_mem);
-    free(server_mem);
+    sdns_free(client_mem);
+    sdns_free(server_mem);
     if (res == 0){
         return res;
     }
@@ -935,6 +1087,8 @@ int sdns_add_nsid(sdns_context * dns, char * nsid){
         if (NULL == nsid_opt)
             return SDNS_ERROR_MEMORY_ALLOC_FAILED;
         int res = sdns_add_edns(dns, nsid_opt);
+        if (res != 0)
+            sdns_free_opt_rdata(nsid_opt);
         return res;
     }
     // we have some value for NSID!
@@ -950,7 +1104,7 @@ int sdns_add_nsid(sdns_context * dns, char * nsid){
         return SDNS_ERROR_INVALID_HEX_VALUE;
     sdns_opt_rdata * nsid_opt = sdns_create_edns0_nsid(nsid_data, (int)(nsid_len/2));
     if (NULL == nsid_opt){
-        free(nsid_data);
+        sdns_free(nsid_data);
         return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     }
     int res = sdns_add_edns(dns, nsid_opt);
@@ -966,7 +1120,7 @@ int sdns_set_do(sdns_context * dns, uint8_t do_bit){
     if (NULL == dns || dns->msg == NULL)
         return SDNS_ERROR_BUFFER_IS_NULL;
     // you can only set do if edns0 is enabled
-    if (dns->msg->additional == NULL)
+    if (sdns_decode_section(dns, DNS_SECTION_ADDITIONAL) != sdns_rcode_NoError || dns->msg->additional == NULL)
         return 1;
     sdns_rr * additional = dns->msg->additional;
     while (additional){
@@ -1051,10 +1205,10 @@ int sdns_add_ede(sdns_context * dns, uint16_t ede_code, char * ede_text){
     }
     sdns_opt_rdata * opt = sdns_create_edns0_ede(ede_code, text_mem, ede_text == NULL?0:strlen(ede_text));
     if (NULL == opt){
-        free(text_mem);
+        sdns_free(text_mem);
         return SDNS_ERROR_MEMORY_ALLOC_FAILED;
     }
-    free(text_mem);
+    sdns_free(text_mem);
     int res = sdns_add_edns(dns, opt);
     if (res != 0){
         sdns_free_opt_rdata(opt);
@@ -1076,6 +1230,8 @@ char * sdns_get_value_nsid(sdns_context * dns, int * err, uint16_t *nsid_len){
     }
     *err = SDNS_ERROR_NSID_NOT_FOUND;
     char * result = NULL;   // this is what we return
+    if (sdns_decode_section(dns, DNS_SECTION_ADDITIONAL) != sdns_rcode_NoError)
+        return NULL;
 
     sdns_rr * tmp = dns->msg->additional;
     do{
@@ -1104,8 +1260,8 @@ char * sdns_get_value_nsid(sdns_context * dns, int * err, uint16_t *nsid_len){
            }
            // tmp_opt referes to NSID
            result = tmp_opt->option_data == NULL?NULL:mem_copy(tmp_opt->option_data, tmp_opt->option_length);
-           *err = tmp_opt->option_data == NULL?SDNS_ERROR_NSID_NOT_FOUND:0;
-           *nsid_len = tmp_opt->option_data == NULL?0:tmp_opt->option_length;
+           *err = tmp_opt->option_data == NULL?SDNS_ERROR_NSID_NOT_FOUND:(NULL == result?SDNS_ERROR_MEMORY_ALLOC_FAILED:0);
+           *nsid_len = NULL == result?0:tmp_opt->option_length;
            break;
         }
        if (tmp->decoded == 0)
@@ -1129,6 +1285,8 @@ char * sdns_get_value_cookie_client(sdns_context * dns, int * err){
     }
     *err = SDNS_ERROR_CLIENT_COOKIE_NOT_FOUND;
     char * result = NULL;   // this is what we return
+    if (sdns_decode_section(dns, DNS_SECTION_ADDITIONAL) != sdns_rcode_NoError)
+        return NULL;
 
     sdns_rr * tmp = dns->msg->additional;
     do{
@@ -1161,7 +1319,7 @@ char * sdns_get_value_cookie_client(sdns_context * dns, int * err){
                 break;
            }
            result = tmp_opt->option_data == NULL?NULL:mem_copy(tmp_opt->option_data, 8);    // exactly 8 bytes
-           *err = tmp_opt->option_data == NULL?SDNS_ERROR_CLIENT_COOKIE_NOT_FOUND:0;
+           *err = tmp_opt->option_data == NULL?SDNS_ERROR_CLIENT_COOKIE_NOT_FOUND:(NULL == result?SDNS_ERROR_MEMORY_ALLOC_FAILED:0);
            break;
         }
        if (tmp->decoded == 0)
@@ -1177,27 +1335,24 @@ sdns_rr * sdns_get_answer(sdns_context * dns, int * err, uint16_t num){
         *err = SDNS_ERROR_BUFFER_IS_NULL;
         return NULL;
     }
-    if (num + 1 > dns->msg->header.ancount || dns->msg->answer == NULL){
+    // sdns_section_rr() decodes the section if it's pending (SDNS_CTX_LAZY)
+    if (num + 1 > dns->msg->header.ancount){
         *err = SDNS_ERROR_NO_ANSWER_FOUND;
         return NULL;
     }
-    sdns_rr * tmp = NULL;
-    sdns_rr * answer = dns->msg->answer;
-    uint16_t cnt = 0;
-    while(answer){
-        tmp = answer;
-        if (cnt >= num)
-            break;
-        cnt++;
-        answer = answer->next;
-    }
+    sdns_rr * tmp = sdns_section_rr(dns, DNS_SECTION_ANSWER, num);
     if (tmp == NULL){  // there is no answer numero 'num+1'
         *err = SDNS_ERROR_NO_ANSWER_FOUND;
         return NULL;
     }
     // tmp points the the right answer
-    char * name = safe_strdup(tmp->name);
-    sdns_rr * result = sdns_init_rr(name, tmp->type, tmp->class, tmp->ttl, tmp->rdlength, 1, NULL);
+    char * name = safe_strdup(sdns_get_rr_name(dns, tmp));
+    sdns_rr * result = NULL == name?NULL:sdns_init_rr(name, tmp->type, tmp->class, tmp->ttl, tmp->rdlength, 1, NULL);
+    if (NULL == result){
+        sdns_free(name);
+        *err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     void * rdata = NULL;
     if (tmp->decoded){
         rdata = sdns_copy_rr_section(dns, tmp);
@@ -1206,8 +1361,8 @@ sdns_rr * sdns_get_answer(sdns_context * dns, int * err, uint16_t num){
     }
     if (rdata == NULL){
         // we can not decode it
-        free(result->name);
-        free(result);
+        sdns_free(result->name);
+        sdns_free(result);
         *err = SDNS_ERROR_CAN_NOT_READ_SECTION;
         return NULL;
     }
@@ -1221,27 +1376,24 @@ sdns_rr * sdns_get_authority(sdns_context * dns, int * err, uint16_t num){
         *err = SDNS_ERROR_BUFFER_IS_NULL;
         return NULL;
     }
-    if (num + 1 > dns->msg->header.nscount || dns->msg->authority == NULL){
+    // sdns_section_rr() decodes the section if it's pending (SDNS_CTX_LAZY)
+    if (num + 1 > dns->msg->header.nscount){
         *err = SDNS_ERROR_NO_AUTHORITY_FOUND;
         return NULL;
     }
-    sdns_rr * tmp = NULL;
-    sdns_rr * authority = dns->msg->authority;
-    uint16_t cnt = 0;
-    while(authority){
-        tmp = authority;
-        if (cnt >= num)
-            break;
-        cnt++;
-        authority = authority->next;
-    }
+    sdns_rr * tmp = sdns_section_rr(dns, DNS_SECTION_AUTHORITY, num);
     if (tmp == NULL){  // there is no authority numero 'num+1'
         *err = SDNS_ERROR_NO_AUTHORITY_FOUND;
         return NULL;
     }
     // tmp points the the right authority
-    char * name = safe_strdup(tmp->name);
-    sdns_rr * result = sdns_init_rr(name, tmp->type, tmp->class, tmp->ttl, tmp->rdlength, 1, NULL);
+    char * name = safe_strdup(sdns_get_rr_name(dns, tmp));
+    sdns_rr * result = NULL == name?NULL:sdns_init_rr(name, tmp->type, tmp->class, tmp->ttl, tmp->rdlength, 1, NULL);
+    if (NULL == result){
+        sdns_free(name);
+        *err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     void * rdata = NULL;
     if (tmp->decoded){
         rdata = sdns_copy_rr_section(dns, tmp);
@@ -1250,8 +1402,8 @@ sdns_rr * sdns_get_authority(sdns_context * dns, int * err, uint16_t num){
     }
     if (rdata == NULL){
         // we can not decode it
-        free(result->name);
-        free(result);
+        sdns_free(result->name);
+        sdns_free(result);
         *err = SDNS_ERROR_CAN_NOT_READ_SECTION;
         return NULL;
     }
@@ -1266,20 +1418,12 @@ sdns_rr * sdns_get_additional(sdns_context * dns, int * err, uint16_t num){
         *err = SDNS_ERROR_BUFFER_IS_NULL;
         return NULL;
     }
-    if (num + 1 > dns->msg->header.arcount || dns->msg->additional == NULL){
+    // sdns_section_rr() decodes the section if it's pending (SDNS_CTX_LAZY)
+    if (num + 1 > dns->msg->header.arcount){
         *err = SDNS_ERROR_NO_ADDITIONAL_FOUND;
         return NULL;
     }
-    sdns_rr * tmp = NULL;
-    sdns_rr * additional = dns->msg->additional;
-    uint16_t cnt = 0;
-    while(additional){
-        tmp = additional;
-        if (cnt >= num)
-            break;
-        cnt++;
-        additional = additional->next;
-    }
+    sdns_rr * tmp = sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, num);
     if (tmp == NULL){  // there is no additional numero 'num+1'
         *err = SDNS_ERROR_NO_ADDITIONAL_FOUND;
         return NULL;
@@ -1292,8 +1436,13 @@ sdns_rr * sdns_get_additional(sdns_context * dns, int * err, uint16_t num){
         *err = SDNS_ERROR_ADDITIONAL_RR_OPT;
         return NULL;
     }
-    char * name = safe_strdup(tmp->name);
-    sdns_rr * result = sdns_init_rr(name, tmp->type, tmp->class, tmp->ttl, tmp->rdlength, 1, NULL);
+    char * name = safe_strdup(sdns_get_rr_name(dns, tmp));
+    sdns_rr * result = NULL == name?NULL:sdns_init_rr(name, tmp->type, tmp->class, tmp->ttl, tmp->rdlength, 1, NULL);
+    if (NULL == result){
+        sdns_free(name);
+        *err = SDNS_ERROR_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
     void * rdata = NULL;
     if (tmp->decoded){
         rdata = sdns_copy_rr_section(dns, tmp);
@@ -1302,8 +1451,8 @@ sdns_rr * sdns_get_additional(sdns_context * dns, int * err, uint16_t num){
     }
     if (rdata == NULL){
         // we can not decode it
-        free(result->name);
-        free(result);
+        sdns_free(result->name);
+        sdns_free(result);
         *err = SDNS_ERROR_CAN_NOT_READ_SECTION;
         return NULL;
     }
@@ -1315,19 +1464,42 @@ sdns_rr * sdns_get_additional(sdns_context * dns, int * err, uint16_t num){
 sdns_question * sdns_get_question(sdns_context * dns){
     if (NULL == dns)
         return NULL;
-    if (dns->msg->question.qname == NULL)
+    char * qname = sdns_get_qname(dns);
+    if (qname == NULL)
         return NULL;
-    sdns_question * q = (sdns_question*) malloc_or_abort(sizeof(sdns_question));
-    q->qname = safe_strdup(dns->msg->question.qname);
+    sdns_question * q = (sdns_question*) sdns_malloc(sizeof(sdns_question));
+    if (NULL == q)
+        return NULL;
+    q->qname = safe_strdup(qname);
+    if (NULL == q->qname){
+        sdns_free(q);
+        return NULL;
+    }
     q->qclass = dns->msg->question.qclass;
     q->qtype = dns->msg->question.qtype;
+    q->qname_offset = 0;
+    q->qname_len = 0;
+    q->qname_hash = dns->msg->question.qname_hash;
     return q;
 }
 
 sdns_context * sdns_create_response_from_query(sdns_context * query){
     if (NULL == query)
         return NULL;
+    if (query->raw != NULL){
+        sdns_context * dns = sdns_init_context();
+        if (NULL == dns)
+            return NULL;
+        int res = sdns_make_response(dns, query);
+        if (res == sdns_rcode_NoError)
+            return dns;
+        sdns_free_context(dns);
+        if (res == SDNS_ERROR_MEMORY_ALLOC_FAILED)
+            return NULL;
+        // not the question we can copy, the slow path
+    }
     int with_edns0 = 0;
+    sdns_decode_section(query, DNS_SECTION_ADDITIONAL);
     sdns_rr * tmp = query->msg->additional;
     if (tmp == NULL){
         with_edns0 = 0;
@@ -1341,15 +1513,20 @@ sdns_context * sdns_create_response_from_query(sdns_context * query){
         }
     }
     sdns_context * dns = sdns_init_context();
-
+    if (NULL == dns)
+        return NULL;
     int res = sdns_make_query(dns, query->msg->question.qtype, query->msg->question.qclass,
-                              safe_strdup(query->msg->question.qname), with_edns0);
+                              safe_strdup(sdns_get_qname(query)), with_edns0);
     if (res != 0){
         sdns_free_context(dns);
         return NULL;
     }
+    // the same header as sdns_make_response()
     dns->msg->header.qr = 1;
     dns->msg->header.id = query->msg->header.id;
+    dns->msg->header.rd = query->msg->header.rd;
+    dns->msg->header.CD = query->msg->header.CD;
+    dns->msg->header.opcode = query->msg->header.opcode;
     return dns;
 }
 
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sdns_arena.h>
+
+// all the allocations are aligned to this value
+#define ARENA_ALIGN sizeof(void*)
+
+static sdns_arena_chunk * _arena_new_chunk(sdns_arena * arena, unsigned long int len){
+    sdns_arena_chunk * c = (sdns_arena_chunk*) sdns_malloc_with(arena->allocator, sizeof(sdns_arena_chunk) + len);
+    if (NULL == c)
+        return NULL;
+    c->next = NULL;
+    c->len = len;
+    c->used = 0;
+    return c;
+}
+
+sdns_arena * sdns_arena_init(unsigned long int chunk_size){
+    return sdns_arena_init_with(chunk_size, NULL);
+}
+
+sdns_arena * sdns_arena_init_with(unsigned long int chunk_size, const sdns_allocator * allocator){
+    sdns_arena * arena = (sdns_arena*) sdns_malloc_with(allocator, sizeof(sdns_arena));
+    if (NULL == arena)
+        return NULL;
+    arena->allocator = allocator;
+    arena->chunk_size = chunk_size == 0?SDNS_ARENA_CHUNK_SIZE:chunk_size;
+    arena->chunks = _arena_new_chunk(arena, arena->chunk_size);
+    if (NULL == arena->chunks){
+        sdns_free_with(allocator, arena);
+        return NULL;
+    }
+    arena->current = arena->chunks;
+    return arena;
+}
+
+void * sdns_arena_alloc(sdns_arena * arena, unsigned long int size){
+    if (NULL == arena)
+        return NULL;
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    sdns_arena_chunk * c = arena->current;
+    // the chunks after 'current' are left from the last reset, reuse them first
+    while (c->len - c->used < size){
+        if (c->next == NULL){
+            unsigned long int len = size > arena->chunk_size?size:arena->chunk_size;
+            c->next = _arena_new_chunk(arena, len);
+            if (NULL == c->next)
+                return NULL;
+        }
+        c = c->next;
+    }
+    arena->current = c;
+    void * p = c->data + c->used;
+    c->used += size;
+    return p;
+}
+
+char * sdns_arena_strdup(sdns_arena * arena, const char * s){
+    if (NULL == s)
+        return NULL;
+    unsigned long int len = strlen(s) + 1;
+    char * p = (char*) sdns_arena_alloc(arena, len);
+    if (NULL == p)
+        return NULL;
+    memcpy(p, s, len);
+    return p;
+}
+
+int sdns_arena_owns(sdns_arena * arena, const void * p){
+    if (NULL == arena || NULL == p)
+        return 0;
+    for (sdns_arena_chunk * c = arena->chunks; c; c = c->next){
+        if ((const char*)p >= c->data && (const char*)p < c->data + c->len)
+            return 1;
+    }
+    return 0;
+}
+
+void sdns_arena_reset(sdns_arena * arena){
+    if (NULL == arena)
+        return;
+    for (sdns_arena_chunk * c = arena->chunks; c; c = c->next)
+        c->used = 0;
+    arena->current = arena->chunks;
+}
+
+void sdns_arena_free(sdns_arena * arena){
+    if (NULL == arena)
+        return;
+    sdns_arena_chunk * c = arena->chunks;
+    sdns_arena_chunk * tmp = c;
+    while (c){
+        tmp = c->next;
+        sdns_free_with(arena->allocator, c);
+        c = tmp;
+    }
+    sdns_free_with(arena->allocator, arena);
+}
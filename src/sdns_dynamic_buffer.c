@@ -2,46 +2,73 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sdns_dynamic_buffer.h>
+#include <sdns_alloc.h>
 
 dyn_buffer * dyn_buffer_init(char * buff, unsigned long int len, unsigned long int cursor){
     int we_allocated = 0;
     if (NULL == buff){
-        buff = (char*) malloc(DEFAULT_BUFFER_LENGTH);
+        buff = (char*) sdns_malloc(DEFAULT_BUFFER_LENGTH);
         if (buff == NULL)
             return NULL;
         len = 128;
         we_allocated = 1;
     }
-    dyn_buffer * d = (dyn_buffer*) malloc(sizeof(dyn_buffer));
+    dyn_buffer * d = (dyn_buffer*) sdns_malloc(sizeof(dyn_buffer));
     if (NULL == d){
         if (we_allocated)
-            free(buff);
+            sdns_free(buff);
         return NULL;
     }
     d->buffer = buff;
     d->len = len;
     d->cursor = cursor;
+    d->fixed = 0;
+    d->failed = 0;
     return d;
 }
 
+void dyn_buffer_init_fixed(dyn_buffer * ctx, char * buff, unsigned long int len){
+    ctx->buffer = buff;
+    ctx->len = len;
+    ctx->cursor = 0;
+    ctx->fixed = 1;
+    ctx->failed = 0;
+}
+
+// resize the buffer to new_len bytes. 0 on success, fail otherwise
+static int _dyn_buffer_resize(dyn_buffer * ctx, unsigned long int new_len){
+    if (ctx->fixed)
+        return 1;
+    char * tmp = (char*) sdns_realloc(ctx->buffer, new_len);
+    if (NULL == tmp)
+        return 1;
+    ctx->buffer = tmp;
+    ctx->len = new_len;
+    return 0;
+}
+
+int dyn_buffer_reserve(dyn_buffer * ctx, unsigned long int len){
+    if (ctx->len - ctx->cursor >= len)
+        return 0;
+    return _dyn_buffer_resize(ctx, ctx->cursor + len);
+}
+
 // append the given data with length data_len to the buffer context, allocate more if necessary
 // 0 on success, fail otherwise
 int dyn_buffer_append(dyn_buffer * ctx, char * data, unsigned long int data_len){
     unsigned long int remain = ctx->len - ctx->cursor;
     if (remain < data_len){
-        // we don't have space, allocate more
-        unsigned to_alloc = data_len - remain + 1;
-        char * tmp = (char*) realloc(ctx->buffer, ctx->len + to_alloc);
-        if (NULL == tmp)
+        // we don't have space, double the size so many small appends don't realloc each time
+        unsigned long int new_len = ctx->len * 2;
+        if (new_len < ctx->cursor + data_len)
+            new_len = ctx->cursor + data_len;
+        if (_dyn_buffer_resize(ctx, new_len) != 0){
+            ctx->failed = 1;
             return 1;
-        ctx->buffer = tmp;
-        ctx->len = ctx->len + to_alloc;
-        memcpy(ctx->buffer + ctx->cursor, data, data_len);
-        ctx->cursor += data_len;
-    }else{
-        memcpy(ctx->buffer + ctx->cursor, data, data_len);
-        ctx->cursor += data_len;
+        }
     }
+    memcpy(ctx->buffer + ctx->cursor, data, data_len);
+    ctx->cursor += data_len;
     return 0;
 }
 
@@ -49,9 +76,9 @@ int dyn_buffer_append(dyn_buffer * ctx, char * data, unsigned long int data_len)
 void dyn_buffer_free(dyn_buffer * ctx){
     if (NULL == ctx)
         return;
-    free(ctx->buffer);
+    sdns_free(ctx->buffer);
     ctx->buffer = NULL;
-    free(ctx);
+    sdns_free(ctx);
     ctx = NULL;
 }
 
@@ -64,7 +91,7 @@ void dyn_buffer_reset(dyn_buffer * ctx){
 
 // copy the buffer and return a pointer to the new memory
 char * dyn_buffer_copy(dyn_buffer * ctx){
-    char * tmp = (char *) malloc(ctx->cursor);
+    char * tmp = (char *) sdns_malloc(ctx->cursor);
     if (NULL == tmp)
         return NULL;
     memcpy(tmp, ctx->buffer, ctx->cursor);
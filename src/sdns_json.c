@@ -150,14 +150,14 @@ json_t * sdns_json_header(sdns_context * ctx){
             break;
         if (json_object_set_new(header, "flags", flags) != 0)
             break;
-        free(error_buffer);
+        sdns_free(error_buffer);
         return header;
     }
     // if we are here there is an error
     json_decref(header);
     if (NULL != flags)
         json_decref(flags);
-    free(error_buffer);
+    sdns_free(error_buffer);
     return NULL;
 }
 
@@ -175,7 +175,7 @@ json_t* sdns_json_question(sdns_context * ctx){
     json_t * question = json_object();
     if (NULL == question)
         return NULL;
-    if (json_object_set_new(question, "qname", json_string(ctx->msg->question.qname)) != 0){
+    if (json_object_set_new(question, "qname", json_string(sdns_get_qname(ctx))) != 0){
         json_decref(question);
         return NULL;
     }
@@ -196,6 +196,7 @@ json_t * sdns_json_answer(sdns_context * ctx){
     json_t * answers = json_array();
     if (NULL == answers)
         return NULL;
+    sdns_decode_section(ctx, DNS_SECTION_ANSWER);
     sdns_rr * tmp = ctx->msg->answer;
     if (tmp == NULL){
         return answers;
@@ -207,7 +208,7 @@ json_t * sdns_json_answer(sdns_context * ctx){
         if (NULL == tmp_answer)
             return answers;
         
-        if (json_object_set_new(tmp_answer, "name", json_string(tmp->name)) != 0){
+        if (json_object_set_new(tmp_answer, "name", json_string(sdns_get_rr_name(ctx, tmp))) != 0){
             json_decref(tmp_answer);
             return answers;
         }
@@ -255,6 +256,7 @@ json_t * sdns_json_authority(sdns_context * ctx){
     json_t * authorities = json_array();
     if (NULL == authorities)
         return NULL;
+    sdns_decode_section(ctx, DNS_SECTION_AUTHORITY);
     sdns_rr * tmp = ctx->msg->authority;
     if (tmp == NULL){
         return authorities;
@@ -266,7 +268,7 @@ json_t * sdns_json_authority(sdns_context * ctx){
         if (NULL == tmp_authority)
             return authorities;
         
-        if (json_object_set_new(tmp_authority, "name", json_string(tmp->name)) != 0){
+        if (json_object_set_new(tmp_authority, "name", json_string(sdns_get_rr_name(ctx, tmp))) != 0){
             json_decref(tmp_authority);
             return authorities;
         }
@@ -315,6 +317,7 @@ json_t * sdns_json_additional(sdns_context * ctx){
     json_t * additionals = json_array();
     if (NULL == additionals)
         return NULL;
+    sdns_decode_section(ctx, DNS_SECTION_ADDITIONAL);
     sdns_rr * tmp = ctx->msg->additional;
     if (tmp == NULL){
         return additionals;
@@ -344,7 +347,7 @@ json_t * sdns_json_additional(sdns_context * ctx){
         if (NULL == tmp_additional)
             return additionals;
 
-        if (json_object_set_new(tmp_additional, "name", json_string(tmp->name)) != 0){
+        if (json_object_set_new(tmp_additional, "name", json_string(sdns_get_rr_name(ctx, tmp))) != 0){
             json_decref(tmp_additional);
             return additionals;
         }
@@ -462,7 +465,7 @@ json_t * sdns_json_rr_AAAA(sdns_context * ctx, sdns_rr *rr){
     if (NULL == aaaa->address){return NULL;}
     char * ip_str = ipv6_mem_to_str(aaaa->address);
     json_t * addr = json_string(ip_str);
-    free(ip_str);
+    sdns_free(ip_str);
     if (rr->decoded == 0)
         sdns_free_rr_AAAA(aaaa);
     json_t * obj = json_object();
@@ -656,10 +659,10 @@ json_t * sdns_json_rr_HINFO(sdns_context * ctx, sdns_rr *rr){
             if (rr->decoded == 0)
                 sdns_free_rr_HINFO(hinfo);
             json_decref(obj);
-            free(cpu);
+            sdns_free(cpu);
             return NULL;
         }
-        free(cpu);
+        sdns_free(cpu);
     }else{
         if (json_object_set_new(obj, "cpu", json_string("")) != 0){
             if (rr->decoded == 0)
@@ -674,10 +677,10 @@ json_t * sdns_json_rr_HINFO(sdns_context * ctx, sdns_rr *rr){
             if (rr->decoded == 0)
                 sdns_free_rr_HINFO(hinfo);
             json_decref(obj);
-            free(os);
+            sdns_free(os);
             return NULL;
         }
-        free(os);
+        sdns_free(os);
     }else{
         if (json_object_set_new(obj, "os", json_string("")) != 0){
             if (rr->decoded == 0)
@@ -740,7 +743,12 @@ json_t * sdns_json_rr_TXT(sdns_context * ctx, sdns_rr *rr){
         to_allocate += tmp->character_string.len;
         tmp = tmp->next;
     }
-    char * txt_mem = (char*) malloc_or_abort(to_allocate > rr->rdlength?to_allocate:rr->rdlength);
+    char * txt_mem = (char*) sdns_malloc(to_allocate > rr->rdlength?to_allocate:rr->rdlength);
+    if (NULL == txt_mem){
+        if (rr->decoded == 0)
+            sdns_free_rr_TXT(txt);
+        return NULL;
+    }
     int cnt = 0;
     tmp = txt;  // reset tmp
     while (tmp){
@@ -753,7 +761,7 @@ json_t * sdns_json_rr_TXT(sdns_context * ctx, sdns_rr *rr){
     if (rr->decoded == 0)
         sdns_free_rr_TXT(txt);
     json_t * t = json_stringn(txt_mem, cnt);
-    free(txt_mem);
+    sdns_free(txt_mem);
     if (t == NULL){
         return NULL;
     }
@@ -846,10 +854,10 @@ json_t * sdns_json_rr_RRSIG(sdns_context * ctx, sdns_rr *rr){
         if (rr->decoded == 0)
             sdns_free_rr_RRSIG(rrsig);
         json_decref(obj);
-        free(sig);
+        sdns_free(sig);
         return NULL;
     }
-    free(sig);
+    sdns_free(sig);
     if (rr->decoded == 0)
         sdns_free_rr_RRSIG(rrsig);
     return obj;
@@ -881,10 +889,10 @@ json_t * sdns_json_rr_NID(sdns_context * ctx, sdns_rr * rr){
             if (rr->decoded == 0)
                 sdns_free_rr_NID(nid);
             json_decref(obj);
-            free(tmp);
+            sdns_free(tmp);
             return NULL;
         }
-        free(tmp);
+        sdns_free(tmp);
     }else{
         json_decref(obj);
         if (rr->decoded == 0)
@@ -954,15 +962,15 @@ json_t * sdns_json_rr_L64(sdns_context * ctx, sdns_rr * rr){
         if (json_object_set_new(obj, "locator64", json_string(locator64)) != 0){
             if (rr->decoded == 0)
                 sdns_free_rr_L64(l64);
-            free(locator64);
+            sdns_free(locator64);
             json_decref(obj);
             return NULL;
         }
-        free(locator64);
+        sdns_free(locator64);
     }else{
         if (rr->decoded == 0)
             sdns_free_rr_L64(l64);
-        free(locator64);
+        sdns_free(locator64);
         json_decref(obj);
         return NULL;
     }
@@ -1156,7 +1164,7 @@ json_t * sdns_json_rr_OPT(sdns_context * ctx, sdns_rr *rr){
     json_t * ttl = json_object();
     if (ttl == NULL)
         goto exit_clean_arr;
-    char * name = rr->name;
+    char * name = sdns_get_rr_name(ctx, rr);
     int json_op_result = -1;
     json_op_result = json_object_set_new(obj, "name", name == NULL?json_null():json_string(name));
     if (json_op_result != 0)
@@ -1188,7 +1196,7 @@ json_t * sdns_json_rr_OPT(sdns_context * ctx, sdns_rr *rr){
                 goto exit_clean_ttl;
             }
             json_op_result += json_object_set_new(rdata_element, "option_data", json_stringn(to_hex, opt->option_length * 2));
-            free(to_hex);
+            sdns_free(to_hex);
         }else{
             json_op_result += json_object_set_new(rdata_element, "option_data", json_null());
         }
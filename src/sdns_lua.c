@@ -366,7 +366,7 @@ static int l_sdns_to_network(lua_State * L){
     }
     //hex_dump(buff, 0, bufflen);
     lua_pushlstring(L, buff, bufflen);
-    free(buff);
+    sdns_free(buff);
     return 1;
 }
 
@@ -1683,7 +1683,7 @@ static int l_sdns_add_nsid(lua_State * L){
     char * new_nsid = len==0?NULL:mem2hex((char*)nsid, len);
 
     int res = sdns_add_nsid(*dns, new_nsid);
-    free(new_nsid);
+    sdns_free(new_nsid);
     if (res == 0){
         lua_pushinteger(L, 0);
         return 1;
@@ -1712,7 +1712,7 @@ static int l_sdns_get_value_nsid(lua_State * L){
     char * errpointer = errbuffer;
     nsid = sdns_get_value_nsid(*dns, &err, &nsid_len);
     if (err != 0){
-        free(nsid);    // it's null anyway
+        sdns_free(nsid);    // it's null anyway
         lua_pushnil(L);
         sdns_error_string(err, &errpointer);
         lua_pushstring(L, errbuffer);
@@ -1720,7 +1720,7 @@ static int l_sdns_get_value_nsid(lua_State * L){
     }
     // now err = 0
     lua_pushlstring(L, nsid, nsid_len);
-    free(nsid);
+    sdns_free(nsid);
     return 1;
 }
 
@@ -2136,7 +2136,9 @@ static int create_rdata_table(lua_State * L, sdns_rr * answer){
             len += tmp->character_string.len;
             tmp = tmp->next;
         }
-        char * data = malloc_or_abort(len);
+        char * data = sdns_malloc(len);
+        if (NULL == data)
+            return luaL_error(L, "can not allocate memory");
         //printf("need a buffer of length:%ld\n", len);
         memset(data, 0, len);
         tmp = (sdns_rr_TXT*)answer->psdns_rr;   // reset
@@ -2150,7 +2152,7 @@ static int create_rdata_table(lua_State * L, sdns_rr * answer){
         }
         lua_pushlstring(L, data, len -1);
         lua_settable(L, -3);
-        free(data);
+        sdns_free(data);
         return 0;
     }
     if (answer->type == sdns_rr_type_CNAME){
@@ -2424,8 +2426,8 @@ static int l_sdns_get_question(lua_State * L){
     sdns_rr_type_to_string(q->qtype, type_rr_class);
     lua_pushstring(L, type_rr_class);
     lua_settable(L, -3);
-    free(q->qname);
-    free(q);
+    sdns_free(q->qname);
+    sdns_free(q);
     return 1;
 }
 
@@ -14,7 +14,7 @@ static inline int human_readible(int c){
 /*
 static char * make_human_readible(char * data, size_t len){
     // returns a new memory address that has the human readable version of 'data'
-    char * mem = malloc_or_abort(len);
+    char * mem = sdns_malloc(len);
     for (int i=0; i<len; ++i){
         mem[i] = human_readible(data[i]);
     }
@@ -33,7 +33,7 @@ void sdns_neat_print_dns(sdns_context * ctx){
     }
 
     fprintf(stdout, "** DNS ANSWER SECTION\n");
-    if (ctx->msg->header.ancount > 0){
+    if (ctx->msg->header.ancount > 0 && sdns_decode_section(ctx, DNS_SECTION_ANSWER) == sdns_rcode_NoError){
         sdns_rr * tmp = ctx->msg->answer;
         do{
             sdns_neat_print_rr(ctx, tmp);
@@ -41,7 +41,7 @@ void sdns_neat_print_dns(sdns_context * ctx){
         }while(tmp);
     }
     fprintf(stdout, "** DNS AUTHORITY SECTION\n");
-    if (ctx->msg->header.nscount > 0){
+    if (ctx->msg->header.nscount > 0 && sdns_decode_section(ctx, DNS_SECTION_AUTHORITY) == sdns_rcode_NoError){
         sdns_rr * tmp = ctx->msg->authority;
         do{
             sdns_neat_print_rr(ctx, tmp);
@@ -49,7 +49,7 @@ void sdns_neat_print_dns(sdns_context * ctx){
         }while(tmp);
     }
     fprintf(stdout, "** DNS ADDITIONAL SECTION\n");
-    if (ctx->msg->header.arcount > 0){
+    if (ctx->msg->header.arcount > 0 && sdns_decode_section(ctx, DNS_SECTION_ADDITIONAL) == sdns_rcode_NoError){
         sdns_rr * tmp = ctx->msg->additional;
         do{
             sdns_neat_print_rr(ctx, tmp);
@@ -63,7 +63,7 @@ void sdns_neat_print_question(sdns_context * ctx){
     char buff_class[20] = {0x00};
     sdns_rr_type_to_string(ctx->msg->question.qtype, buff_type);
     sdns_class_to_string(ctx->msg->question.qclass, buff_class);
-    fprintf(stdout, "\t%s\t%s\t%s\n", ctx->msg->question.qname, buff_class, buff_type);
+    fprintf(stdout, "\t%s\t%s\t%s\n", sdns_get_qname(ctx), buff_class, buff_type);
 }
 
 void sdns_neat_print_header(sdns_context * ctx){
@@ -86,13 +86,14 @@ void sdns_neat_print_header(sdns_context * ctx){
     fprintf(stdout, "  ancount: %d,", ctx->msg->header.ancount);
     fprintf(stdout, "  arcount: %d,", ctx->msg->header.arcount);
     fprintf(stdout, "  nscount: %d\n", ctx->msg->header.nscount);
-    free(error_buffer);
+    sdns_free(error_buffer);
 }
 
 
 void sdns_neat_print_rr(sdns_context * ctx, sdns_rr * rr){
     if (NULL == rr)
         return;
+    sdns_get_rr_name(ctx, rr);     // make sure rr->name is decoded (name-view mode)
     if (rr->type == sdns_rr_type_A)
         return sdns_neat_print_rr_A(ctx, rr);
     if (rr->type == sdns_rr_type_NS)
@@ -253,10 +254,10 @@ void sdns_neat_print_rr_AAAA(sdns_context * ctx, sdns_rr * rr){
     sdns_class_to_string(rr->class, buff_class);
     char * ip_str = ipv6_mem_to_str(aaaa->address);
     fprintf(stdout, "\t%s\t%u\t%s\t%s\t%s\n",
-           rr->name, rr->ttl, buff_class, buff_type, ip_str);
+           rr->name, rr->ttl, buff_class, buff_type, ip_str == NULL?"":ip_str);
     if (rr->decoded == 0)
         sdns_free_rr_AAAA(aaaa);
-    free(ip_str);
+    sdns_free(ip_str);
 }
 
 
@@ -571,8 +572,8 @@ void sdns_neat_print_rr_L64(sdns_context * ctx, sdns_rr * rr){
     char * locator64 = mem2hex(l64->Locator64, 8);
     fprintf(stdout, "\t%s\t%u\t%s\t%s\t %d %s\n",
            rr->name, rr->ttl, buff_class, buff_type,
-           l64->Preference, locator64);
-    free(locator64);
+           l64->Preference, locator64 == NULL?"":locator64);
+    sdns_free(locator64);
     if (rr->decoded == 0)
         sdns_free_rr_L64(l64);
 }
@@ -3,20 +3,14 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <time.h>
-
-void * malloc_or_abort(size_t n){
-    void * p = malloc(n);
-    if (NULL == p){
-        fprintf(stderr, "Can not allocate %ld bytes of memory...aborting...\n", n);
-        abort();    // Is it a good idea to call it in library?....I guess not!
-    }
-    return p;
-}
+#include <sdns_alloc.h>
 
 char * ipv6_mem_to_str(char * mem){
     // mem must be exactly 16 bytes
     // the returned string is null terminated
-    char * addr = (char*) malloc_or_abort(40); // max possible length of AAAA(no double dot)
+    char * addr = (char*) sdns_malloc(40); // max possible length of AAAA(no double dot)
+    if (NULL == addr)
+        return NULL;
     addr[39] = '\0';
     int j = 1;
     int l = 0;
@@ -42,7 +36,7 @@ int safe_strcase_equal(const char * a, const char * b){
 }
 
 char * safe_strdup(const char * s){
-    return s==NULL?NULL:strdup(s);
+    return s==NULL?NULL:sdns_strdup(s);
 }
 
 unsigned long int cstr_len(const char * str){
@@ -207,7 +201,9 @@ char * hex2mem(char * hexdata){
         return NULL;
     if (hexdata_len % 2 != 0)
         return NULL;
-    char * mem = (char *) malloc_or_abort((int)(hexdata_len / 2));
+    char * mem = (char *) sdns_malloc((int)(hexdata_len / 2));
+    if (NULL == mem)
+        return NULL;
     char * pos = hexdata;
     for (int i=0; i< (int)(hexdata_len/2); ++i){
         sscanf(pos, "%2hhx", &(mem[i]));
@@ -223,7 +219,9 @@ char * mem2hex(char * mem, unsigned int mem_len){
         return NULL;
     if (mem_len == 0)
         return NULL;
-    char * result = (char *) malloc_or_abort(mem_len * 2 + 1); // one more for automatic NULL character
+    char * result = (char *) sdns_malloc(mem_len * 2 + 1); // one more for automatic NULL character
+    if (NULL == result)
+        return NULL;
     unsigned int j=0;
     for (unsigned int i=0; i< mem_len; ++i){
         sprintf(result + j, "%02x", (uint8_t)mem[i]);
@@ -246,8 +244,8 @@ char * timestr_from_timestamp(uint32_t ts){
     tif = gmtime(&raw_time);
     sprintf(timestr, "%d-%02d-%02d %02d:%02d:%02d UTC", tif->tm_year + 1900,
             tif->tm_mon + 1, tif->tm_mday, tif->tm_hour, tif->tm_min, tif->tm_sec);
-    free(tif);
-    return strdup(timestr);
+    // tif is the static buffer of gmtime(), it must not be freed
+    return sdns_strdup(timestr);
 }
 
 //from https://opensource.apple.com/source/Libc/Libc-825.25/string/FreeBSD/memmem.c.auto.html
@@ -281,7 +279,9 @@ void * memmem(const void *l, size_t l_len, const void *s, size_t s_len){
 //allocate memory and copy data into allocated memory and return the address
 //caller is responsible for freeing the allocated memory
 char * mem_copy(char * data, unsigned long int len){
-    char * tmp = (char *) malloc_or_abort(len);
+    char * tmp = (char *) sdns_malloc(len);
+    if (NULL == tmp)
+        return NULL;
     memcpy(tmp, data, len);
     return tmp;
 }
@@ -374,7 +374,9 @@ int hex_dump(const char * buffer, unsigned long int offset,unsigned long int len
     int x = 0;
     int read = 0;
     uint8_t ch = 0;
-    int * data = (int*)malloc_or_abort(16 * sizeof(int));
+    int * data = (int*)sdns_malloc(16 * sizeof(int));
+    if (NULL == data)
+        return 1;
     unsigned int mov = offset;
     while (read < len){
         ch = buffer[mov++];
@@ -487,7 +489,7 @@ int hex_dump(const char * buffer, unsigned long int offset,unsigned long int len
         // should never happen since we handle it inside the loop
     }
     printf("\n");
-    free(data);
+    sdns_free(data);
     return 0; 
 }
 
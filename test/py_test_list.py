@@ -334,3 +334,140 @@ def func_test_invalid_pointer_compression(data):
     return 0;
 # end def
 
+
+def func_test_name_view(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_arena(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_context_reset(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_section_index(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_peek(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_lazy(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_scan(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_name_memo(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_name_hash(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_compress(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_wire_size(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_to_wire_into(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_truncate(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_writer(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_template(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_reflect(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_batch(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_patch(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_borrow(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_iter(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_inline(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_txt_spans(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
+
+
+def func_test_alloc(data):
+    assert(data.strip() == "success")
+    return 0
+# end def
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the allocator of the library (sdns_set_allocator() and sdns_context_set_allocator()).
+ * compile and run:
+ * gcc -g -Werror test_alloc.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+// counts the allocations and fails after 'fail_after' of them (-1 never fails)
+typedef struct {
+    long live;
+    long calls;
+    long fail_after;
+} counter;
+
+static void * count_malloc(size_t size, void * userdata){
+    counter * c = (counter*) userdata;
+    if (c->fail_after >= 0 && c->calls >= c->fail_after)
+        return NULL;
+    c->calls++;
+    void * p = malloc(size);
+    if (p != NULL)
+        c->live++;
+    return p;
+}
+
+static void * count_realloc(void * ptr, size_t size, void * userdata){
+    counter * c = (counter*) userdata;
+    if (c->fail_after >= 0 && c->calls >= c->fail_after)
+        return NULL;
+    c->calls++;
+    void * p = realloc(ptr, size);
+    if (p != NULL && ptr == NULL)
+        c->live++;
+    return p;
+}
+
+static void count_free(void * ptr, void * userdata){
+    counter * c = (counter*) userdata;
+    c->live--;
+    free(ptr);
+}
+
+// builds a response, parses it and builds the response of the parsed one. 0 if everything worked
+static int round_trip(void){
+    sdns_context * dns = sdns_create_query("example.com", "TXT", "IN");
+    if (NULL == dns)
+        return 1;
+    dns->msg->header.qr = 1;
+    char text[300];
+    memset(text, 'x', sizeof(text));
+    if (sdns_add_rr_answer_TXT(dns, "example.com", 300, text, sizeof(text)) != 0 ||
+        sdns_add_rr_answer_MX(dns, "example.com", 300, 10, "mail.example.com") != 0 ||
+        sdns_add_rr_authority_NS(dns, "example.com", 300, "ns1.example.com") != 0 ||
+        sdns_add_rr_additional_A(dns, "ns1.example.com", 300, "1.2.3.4") != 0 ||
+        sdns_add_rr_additional_AAAA(dns, "ns1.example.com", 300, "2001:db8::1") != 0 ||
+        sdns_add_ede(dns, 18, "prohibited") != 0){
+        sdns_free_context(dns);
+        return 1;
+    }
+    int err = 0;
+    uint16_t len = 0;
+    char * raw = sdns_to_network(dns, &err, &len);
+    sdns_free_context(dns);
+    if (NULL == raw)
+        return 1;
+    sdns_context * parsed = sdns_from_network(raw, len);
+    sdns_free(raw);
+    if (NULL == parsed)
+        return 1;
+    int res = 0;
+    for (uint16_t i=0; i< 2 && res == 0; ++i){
+        sdns_rr * rr = sdns_get_answer(parsed, &err, i);
+        if (NULL == rr)
+            res = 1;
+        sdns_free_section(rr);
+    }
+    sdns_rr * rr = sdns_get_authority(parsed, &err, 0);
+    if (NULL == rr)
+        res = 1;
+    sdns_free_section(rr);
+    sdns_context * response = res == 0?sdns_create_response_from_query(parsed):NULL;
+    sdns_free_context(parsed);
+    if (NULL == response)
+        return 1;
+    if (sdns_add_rr_answer_CNAME(response, "example.com", 60, "www.example.com") != 0 || sdns_to_wire(response) != 0)
+        res = 1;
+    sdns_free_context(response);
+    return res;
+}
+
+int test1(){
+    // every allocation goes through our functions and all of them are freed
+    counter c = {0, 0, -1};
+    assert(sdns_set_allocator(count_malloc, NULL, count_free, &c) == 1);
+    assert(sdns_get_allocator()->userdata == NULL);
+    assert(sdns_set_allocator(count_malloc, count_realloc, count_free, &c) == 0);
+    assert(sdns_get_allocator()->userdata == &c);
+    assert(round_trip() == 0);
+    assert(c.calls > 0);
+    assert(c.live == 0);
+    assert(sdns_set_allocator(NULL, NULL, NULL, NULL) == 0);
+    assert(sdns_get_allocator()->userdata == NULL);
+    assert(round_trip() == 0);
+    assert(c.live == 0);
+    return 0;
+}
+
+int test2(){
+    // no allocation can crash the library or leak memory, we just get an error
+    counter c = {0, 0, -1};
+    assert(sdns_set_allocator(count_malloc, count_realloc, count_free, &c) == 0);
+    assert(round_trip() == 0);
+    long total = c.calls;
+    long failed = 0;
+    for (long n=0; n< total; ++n){
+        c.calls = 0;
+        c.fail_after = n;
+        failed += round_trip();
+        assert(c.live == 0);
+    }
+    // a few of them are only caches (e.g., the compression table), we work without them
+    assert(failed > total / 2);
+    c.calls = 0;
+    c.fail_after = total;
+    assert(round_trip() == 0);
+    assert(sdns_set_allocator(NULL, NULL, NULL, NULL) == 0);
+    return 0;
+}
+
+int test3(){
+    // the arena and the tables of one context come from its own allocator
+    counter c = {0, 0, -1};
+    sdns_allocator allocator = {count_malloc, count_realloc, count_free, &c};
+    sdns_context * dns = sdns_create_query("example.com", "A", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    assert(sdns_add_rr_answer_A(dns, "example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_answer_MX(dns, "example.com", 300, 10, "mail.example.com") == 0);
+    int err = 0;
+    uint16_t len = 0;
+    char * raw = sdns_to_network(dns, &err, &len);
+    assert(raw != NULL);
+    // it already has the indexes and the compression table
+    assert(sdns_context_set_allocator(dns, &allocator) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    sdns_free_context(dns);
+
+    sdns_context * ctx = sdns_init_context();
+    assert(ctx != NULL);
+    sdns_allocator broken = {count_malloc, NULL, count_free, &c};
+    assert(sdns_context_set_allocator(ctx, &broken) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_context_set_allocator(ctx, &allocator) == 0);
+    ctx->flags |= SDNS_CTX_ARENA;
+    ctx->raw = raw;
+    ctx->raw_len = len;
+    assert(sdns_from_wire(ctx) == 0);
+    assert(sdns_section_rr(ctx, DNS_SECTION_ANSWER, 1) != NULL);
+    assert(c.calls > 0 && c.live > 0);
+    assert(ctx->arena != NULL && ctx->arena->allocator == &allocator);
+    char buff[512];
+    uint16_t out_len = 0;
+    assert(sdns_to_wire_into(ctx, buff, sizeof(buff), &out_len) == 0);
+    assert(out_len > DNS_HEADER_LENGTH && ctx->compress != NULL);
+    long calls = c.calls;
+    sdns_context_reset(ctx);
+    ctx->raw = raw;
+    ctx->raw_len = len;
+    assert(sdns_from_wire(ctx) == 0);
+    assert(c.calls == calls);     // everything is reused
+    sdns_free_context(ctx);
+    assert(c.live == 0);
+    return 0;
+}
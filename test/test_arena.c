@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the per-context arena (SDNS_CTX_ARENA).
+ * compile and run:
+ * gcc -g -Werror test_arena.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+// dig soa @1.1.1.1 google.com
+static char soa_packet[] = {
+  0x96, 0xca, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01,
+  0x00, 0x00, 0x00, 0x01, 0x06, 0x67, 0x6f, 0x6f,
+  0x67, 0x6c, 0x65, 0x03, 0x63, 0x6f, 0x6d, 0x00,
+  0x00, 0x06, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06,
+  0x00, 0x01, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x26,
+  0x03, 0x6e, 0x73, 0x31, 0xc0, 0x0c, 0x09, 0x64,
+  0x6e, 0x73, 0x2d, 0x61, 0x64, 0x6d, 0x69, 0x6e,
+  0xc0, 0x0c, 0x26, 0xdf, 0xe8, 0x03, 0x00, 0x00,
+  0x03, 0x84, 0x00, 0x00, 0x03, 0x84, 0x00, 0x00,
+  0x07, 0x08, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+  0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00
+};
+
+int test1(){
+    // all the records and names of a parsed packet come from the arena
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_ARENA;
+    dns->raw = soa_packet;
+    dns->raw_len = sizeof(soa_packet);
+    assert(sdns_from_wire(dns) == 0);
+    assert(dns->arena != NULL);
+    assert(dns->heap_rrs == 0);
+    assert(strcmp(dns->msg->question.qname, "google.com.") == 0);
+    assert(sdns_arena_owns(dns->arena, dns->msg->question.qname));
+    sdns_rr * answer = dns->msg->answer;
+    assert(answer->in_arena == 1);
+    assert(sdns_arena_owns(dns->arena, answer));
+    assert(strcmp(answer->name, "google.com.") == 0);
+    assert(sdns_arena_owns(dns->arena, answer->name));
+    assert(dns->msg->additional->in_arena == 1);
+    assert(dns->msg->additional->type == sdns_rr_type_OPT);
+    // records we get from the API are owned by the caller (heap)
+    int err = 0;
+    sdns_rr * a = sdns_get_answer(dns, &err, 0);
+    assert(err == 0 && a != NULL);
+    assert(a->in_arena == 0);
+    assert(strcmp(((sdns_rr_SOA*)a->psdns_rr)->mname, "ns1.google.com.") == 0);
+    sdns_free_section(a);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // arena together with the name-view mode
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_ARENA | SDNS_CTX_NAME_VIEW;
+    dns->raw = soa_packet;
+    dns->raw_len = sizeof(soa_packet);
+    assert(sdns_from_wire(dns) == 0);
+    assert(dns->msg->answer->name == NULL);
+    char * name = sdns_get_rr_name(dns, dns->msg->answer);
+    assert(name != NULL && strcmp(name, "google.com.") == 0);
+    assert(sdns_arena_owns(dns->arena, name));
+    char * qname = sdns_get_qname(dns);
+    assert(qname != NULL && strcmp(qname, "google.com.") == 0);
+    assert(sdns_arena_owns(dns->arena, qname));
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test3(){
+    // building a packet with the arena enabled
+    sdns_context * dns = sdns_create_query("google.com", "A", "IN");
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_ARENA;
+    assert(sdns_add_rr_answer_A(dns, "google.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_additional_TXT(dns, "google.com", 300, "hello", 5) == 0);
+    assert(dns->msg->answer->in_arena == 1);
+    assert(sdns_arena_owns(dns->arena, dns->msg->answer->name));
+    // typed rdata is on the heap so the records are tracked (the rdata of A is inline)
+    assert(dns->heap_rrs == 2);     // OPT of the query + TXT
+    assert(sdns_add_edns(dns, sdns_create_edns0_nsid(NULL, 0)) == 0);
+    assert(sdns_remove_edns(dns) == 0);
+    assert(sdns_to_wire(dns) == 0);
+    sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.ancount == 1);
+    assert(strcmp(parsed->msg->answer->name, "google.com.") == 0);
+    sdns_free_context(parsed);
+    sdns_free_context(dns);
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <sys/uio.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests encoding many contexts to one buffer (sdns_to_wire_batch()).
+ * compile and run:
+ * gcc -g -Werror test_batch.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+#define BATCH 40
+
+static sdns_context * make_response(int i){
+    char name[64];
+    sprintf(name, "host%d.example.com", i);
+    sdns_context * dns = sdns_create_query(name, "A", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    dns->msg->header.id = i;
+    for (int j=0; j< i % 4; ++j)
+        assert(sdns_add_rr_answer_A(dns, name, 300, "10.0.0.1") == 0);
+    if (i % 3 == 0)
+        assert(sdns_add_rr_authority_NS(dns, "example.com", 3600, "ns1.example.com") == 0);
+    if (i % 5 == 0)
+        assert(sdns_add_rr_answer_TXT(dns, name, 60, "some text", 9) == 0);
+    return dns;
+}
+
+int test1(){
+    // the same bytes as sdns_to_wire_into(), one packet after the other
+    assert(sizeof(sdns_iovec) == sizeof(struct iovec));
+    assert(offsetof(sdns_iovec, iov_len) == offsetof(struct iovec, iov_len));
+    sdns_context * ctx[BATCH];
+    sdns_iovec out[BATCH];
+    for (int i=0; i< BATCH; ++i)
+        ctx[i] = make_response(i);
+    sdns_arena * arena = sdns_arena_init(4096);
+    assert(arena != NULL);
+    for (int round=0; round< 2; ++round){
+        assert(sdns_to_wire_batch(ctx, BATCH, out, arena) == 0);
+        for (int i=0; i< BATCH; ++i){
+            char buff[512];
+            uint16_t len = 0;
+            assert(sdns_to_wire_into(ctx[i], buff, sizeof(buff), &len) == 0);
+            assert(out[i].iov_len == len);
+            assert(memcmp(out[i].iov_base, buff, len) == 0);
+            if (i > 0)
+                assert((char*)out[i].iov_base == (char*)out[i - 1].iov_base + out[i - 1].iov_len);
+            assert(ctx[i]->raw == NULL);
+        }
+        sdns_arena_reset(arena);
+    }
+    assert(sdns_to_wire_batch(ctx, 0, out, arena) == 0);
+    // the contexts can still be used alone
+    assert(sdns_to_wire(ctx[7]) == 0);
+    sdns_context * parsed = sdns_from_network(ctx[7]->raw, ctx[7]->raw_len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.ancount == 3);
+    sdns_free_context(parsed);
+    for (int i=0; i< BATCH; ++i)
+        sdns_free_context(ctx[i]);
+    sdns_arena_free(arena);
+    return 0;
+}
+
+int test2(){
+    // the first context we can't encode stops the batch
+    sdns_context * ctx[4];
+    sdns_iovec out[4];
+    for (int i=0; i< 4; ++i)
+        ctx[i] = make_response(i);
+    char big[70];
+    memset(big, 'a', sizeof(big));
+    big[69] = '\0';
+    assert(sdns_add_rr_answer_CNAME(ctx[2], "example.com", 300, big) == 0);
+    sdns_arena * arena = sdns_arena_init(4096);
+    assert(arena != NULL);
+    assert(sdns_to_wire_batch(ctx, 4, out, arena) == SDNS_ERROR_LABEL_MAX_63);
+    assert(ctx[2]->err == SDNS_ERROR_LABEL_MAX_63);
+    assert(out[0].iov_base != NULL && out[1].iov_base != NULL);
+    assert(out[2].iov_base == NULL && out[2].iov_len == 0);
+    assert(out[3].iov_base == NULL && out[3].iov_len == 0);
+    sdns_context * parsed = sdns_from_network(out[1].iov_base, out[1].iov_len);
+    assert(parsed != NULL);
+    assert(strcmp(parsed->msg->question.qname, "host1.example.com.") == 0);
+    sdns_free_context(parsed);
+
+    // a packet bigger than its space in the buffer
+    char text[1000];
+    memset(text, 't', sizeof(text));
+    assert(sdns_add_rr_answer_TXT(ctx[3], "example.com", 300, text, sizeof(text)) == 0);
+    assert(sdns_add_rr_answer_TXT(ctx[3], "example.com", 300, text, sizeof(text)) == 0);
+    assert(sdns_to_wire_batch(ctx + 3, 1, out, arena) == 0);
+    assert(out[0].iov_len > UDP_PAYLOAD_SIZE);
+    parsed = sdns_from_network(out[0].iov_base, out[0].iov_len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.ancount == 5);
+    sdns_free_context(parsed);
+
+    assert(sdns_to_wire_batch(NULL, 4, out, arena) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_to_wire_batch(ctx, 4, NULL, arena) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_to_wire_batch(ctx, 4, out, NULL) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    for (int i=0; i< 4; ++i)
+        sdns_free_context(ctx[i]);
+    sdns_arena_free(arena);
+    return 0;
+}
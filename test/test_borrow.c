@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the contexts that borrow the buffer of the caller (SDNS_CTX_BORROWED).
+ * compile and run:
+ * gcc -g -Werror test_borrow.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static char * make_response(uint16_t * len){
+    sdns_context * dns = sdns_create_query("www.example.com", "A", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    assert(sdns_add_rr_answer_A(dns, "www.example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 3600, "ns1.example.com") == 0);
+    int err = 0;
+    char * raw = sdns_to_network(dns, &err, len);
+    assert(err == 0 && raw != NULL);
+    sdns_free_context(dns);
+    return raw;
+}
+
+int test1(){
+    // the context reads the buffer of the caller and does not free it
+    uint16_t len = 0;
+    char * raw = make_response(&len);
+    sdns_context * dns = sdns_from_network_borrow(raw, len);
+    assert(dns != NULL);
+    assert(dns->raw == raw && dns->raw_len == len);
+    assert(dns->flags & SDNS_CTX_BORROWED);
+    assert(strcmp(dns->msg->question.qname, "www.example.com.") == 0);
+    sdns_rr_A * a = sdns_decode_rr_A(dns, sdns_section_rr(dns, DNS_SECTION_ANSWER, 0));
+    assert(a != NULL && a->address == 0x01020304);
+    sdns_free_rr_A(a);
+    sdns_free_context(dns);
+
+    // a broken packet
+    assert(sdns_from_network_borrow(raw, 20) == NULL);
+    assert(sdns_from_network_borrow(NULL, len) == NULL);
+    free(raw);
+    return 0;
+}
+
+int test2(){
+    // after sdns_context_detach() the buffer of the caller is not used anymore
+    uint16_t len = 0;
+    char * raw = make_response(&len);
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_BORROWED | SDNS_CTX_LAZY;
+    dns->raw = raw;
+    dns->raw_len = len;
+    assert(sdns_from_wire(dns) == 0);
+    sdns_rr * rr = sdns_section_rr(dns, DNS_SECTION_ANSWER, 0);
+    assert(rr != NULL && rr->decoded == 0);
+    assert(sdns_context_detach(dns) == 0);
+    assert(!(dns->flags & SDNS_CTX_BORROWED));
+    assert(dns->raw != raw && memcmp(dns->raw, raw, len) == 0);
+    memset(raw, 0xff, len);
+    free(raw);
+    // the rdata we have and the section we have not decoded yet
+    sdns_rr_A * a = sdns_decode_rr_A(dns, rr);
+    assert(a != NULL && a->address == 0x01020304);
+    sdns_free_rr_A(a);
+    rr = sdns_section_rr(dns, DNS_SECTION_AUTHORITY, 0);
+    assert(rr != NULL && rr->type == sdns_rr_type_NS);
+    sdns_rr_NS * ns = sdns_decode_rr_NS(dns, rr);
+    assert(ns != NULL && strcmp(ns->NSDNAME, "ns1.example.com.") == 0);
+    sdns_free_rr_NS(ns);
+    assert(sdns_context_detach(dns) == 0);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test3(){
+    // the buffer of the caller is not written by sdns_to_wire() and sdns_context_reset() drops it
+    uint16_t len = 0;
+    char * raw = make_response(&len);
+    char * copy = malloc(len);
+    assert(copy != NULL);
+    memcpy(copy, raw, len);
+    sdns_context * dns = sdns_from_network_borrow(raw, len);
+    assert(dns != NULL);
+    dns->msg->header.id = 0x7777;
+    assert(sdns_to_wire(dns) == 0);
+    assert(dns->raw != raw);
+    assert(!(dns->flags & SDNS_CTX_BORROWED));
+    assert(memcmp(raw, copy, len) == 0);
+    sdns_free_context(dns);
+
+    dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_BORROWED;
+    for (int i=0; i< 3; ++i){
+        sdns_context_reset(dns);
+        assert(dns->raw == NULL);
+        dns->raw = raw;
+        dns->raw_len = len;
+        assert(sdns_from_wire(dns) == 0);
+        assert(dns->msg->header.ancount == 1);
+    }
+    sdns_free_context(dns);
+    assert(memcmp(raw, copy, len) == 0);
+    free(copy);
+    free(raw);
+    return 0;
+}
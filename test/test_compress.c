@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the compression of the names in sdns_to_wire().
+ * compile and run:
+ * gcc -g -Werror test_compress.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+int test4(void);
+int test5(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    assert(test4() == 0);
+    assert(test5() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static char * find(char * buff, int len, char * what, int what_len){
+    for (int i=0; i + what_len <= len; ++i){
+        if (memcmp(buff + i, what, what_len) == 0)
+            return buff + i;
+    }
+    return NULL;
+}
+
+static int count(char * buff, int len, char * what, int what_len){
+    int cnt = 0;
+    for (int i=0; i + what_len <= len; ++i){
+        if (memcmp(buff + i, what, what_len) == 0)
+            cnt++;
+    }
+    return cnt;
+}
+
+int test1(){
+    // names in the owner and in the rdata of NS, MX, CNAME and SOA
+    sdns_context * dns = sdns_create_query("www.example.com", "A", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    assert(sdns_add_rr_answer_CNAME(dns, "www.example.com", 300, "web.example.com") == 0);
+    assert(sdns_add_rr_answer_A(dns, "web.example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 300, "ns1.example.com") == 0);
+    assert(sdns_add_rr_authority_SOA(dns, "example.com", 300, "ns1.example.com", "hostmaster.example.com",
+                                     1, 2, 3, 4, 5) == 0);
+    assert(sdns_add_rr_additional_MX(dns, "example.com", 300, 10, "mail.example.com") == 0);
+    assert(sdns_to_wire(dns) == 0);
+    // every name is written once
+    assert(count(dns->raw, dns->raw_len, "\x07" "example\x03" "com", 12) == 1);
+    assert(count(dns->raw, dns->raw_len, "\x03" "web", 4) == 1);
+    assert(count(dns->raw, dns->raw_len, "\x03" "ns1", 4) == 1);
+    assert(sdns_scan_message(dns->raw, dns->raw_len, NULL, NULL, 0) == sdns_rcode_NoError);
+
+    sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+    assert(parsed != NULL);
+    int err = 0;
+    sdns_rr * rr = sdns_get_answer(parsed, &err, 0);
+    assert(err == 0 && rr != NULL);
+    assert(strcmp(rr->name, "www.example.com.") == 0);
+    assert(strcmp(((sdns_rr_CNAME*)rr->psdns_rr)->CNAME, "web.example.com.") == 0);
+    sdns_free_section(rr);
+    rr = sdns_get_answer(parsed, &err, 1);
+    assert(err == 0 && rr != NULL);
+    assert(strcmp(rr->name, "web.example.com.") == 0);
+    sdns_free_section(rr);
+    rr = sdns_get_authority(parsed, &err, 0);
+    assert(err == 0 && rr != NULL);
+    assert(strcmp(rr->name, "example.com.") == 0);
+    assert(strcmp(((sdns_rr_NS*)rr->psdns_rr)->NSDNAME, "ns1.example.com.") == 0);
+    sdns_free_section(rr);
+    rr = sdns_get_authority(parsed, &err, 1);
+    assert(err == 0 && rr != NULL);
+    assert(strcmp(((sdns_rr_SOA*)rr->psdns_rr)->mname, "ns1.example.com.") == 0);
+    assert(strcmp(((sdns_rr_SOA*)rr->psdns_rr)->rname, "hostmaster.example.com.") == 0);
+    assert(((sdns_rr_SOA*)rr->psdns_rr)->serial == 5);
+    sdns_free_section(rr);
+    sdns_rr * mx = sdns_section_rr(parsed, DNS_SECTION_ADDITIONAL, 0);
+    if (mx->type != sdns_rr_type_MX)
+        mx = sdns_section_rr(parsed, DNS_SECTION_ADDITIONAL, 1);
+    assert(mx != NULL && mx->type == sdns_rr_type_MX);
+    sdns_rr_MX * rr_mx = sdns_decode_rr_MX(parsed, mx);
+    assert(rr_mx != NULL);
+    assert(rr_mx->preference == 10);
+    assert(strcmp(rr_mx->exchange, "mail.example.com.") == 0);
+    sdns_free_rr_MX(rr_mx);
+    sdns_free_context(parsed);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // the same bytes inside a TXT record are not a name we can point to
+    sdns_context * dns = sdns_create_query("foo.org", "A", "IN");
+    assert(dns != NULL);
+    assert(sdns_add_rr_answer_TXT(dns, "foo.org", 300, "\x07" "example\x03" "com\x00", 13) == 0);
+    assert(sdns_add_rr_answer_A(dns, "example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_answer_A(dns, "www.example.com", 300, "1.2.3.5") == 0);
+    assert(sdns_to_wire(dns) == 0);
+    assert(count(dns->raw, dns->raw_len, "\x07" "example\x03" "com\x00", 13) == 2);
+    sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+    assert(parsed != NULL);
+    assert(strcmp(sdns_section_rr(parsed, DNS_SECTION_ANSWER, 1)->name, "example.com.") == 0);
+    assert(strcmp(sdns_section_rr(parsed, DNS_SECTION_ANSWER, 2)->name, "www.example.com.") == 0);
+    // www.example.com. points to the A record, not to the TXT
+    char * www = find(dns->raw, dns->raw_len, "\x03" "www", 4);
+    assert(www != NULL);
+    uint16_t target = (((uint8_t)www[4] & 0x3F) << 8) | (uint8_t)www[5];
+    assert(target == sdns_section_rr(parsed, DNS_SECTION_ANSWER, 1)->name_offset);
+    sdns_free_context(parsed);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test3(){
+    // many records and pointers to every offset (256 has a zero byte in the pointer)
+    char name[64];
+    char alias[64];
+    int pointer_256 = 0;
+    for (int pad=1; pad<= 40; ++pad){
+        sdns_context * dns = sdns_create_query("example.com", "A", "IN");
+        assert(dns != NULL);
+        char txt[64];
+        memset(txt, 'x', pad);
+        assert(sdns_add_rr_answer_TXT(dns, "example.com", 300, txt, pad) == 0);
+        for (int i=0; i< 150; ++i){
+            sprintf(name, "host%d.example.com", i);
+            sprintf(alias, "alias%d.example.com", i);
+            assert(sdns_add_rr_answer_A(dns, name, 300, "1.2.3.4") == 0);
+            assert(sdns_add_rr_answer_CNAME(dns, alias, 300, name) == 0);
+        }
+        assert(sdns_to_wire(dns) == 0);
+        if (find(dns->raw, dns->raw_len, "\xc1\x00", 2) != NULL)
+            pointer_256 = 1;
+        sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+        assert(parsed != NULL);
+        assert(parsed->msg->header.ancount == 301);
+        for (int i=0; i< 150; ++i){
+            sprintf(name, "host%d.example.com.", i);
+            sprintf(alias, "alias%d.example.com.", i);
+            assert(strcmp(sdns_section_rr(parsed, DNS_SECTION_ANSWER, 1 + 2 * i)->name, name) == 0);
+            sdns_rr * rr = sdns_section_rr(parsed, DNS_SECTION_ANSWER, 2 + 2 * i);
+            assert(strcmp(rr->name, alias) == 0);
+            sdns_rr_CNAME * cname = sdns_decode_rr_CNAME(parsed, rr);
+            assert(cname != NULL);
+            assert(strcmp(cname->CNAME, name) == 0);
+            sdns_free_rr_CNAME(cname);
+        }
+        sdns_free_context(parsed);
+        sdns_free_context(dns);
+    }
+    assert(pointer_256 == 1);
+    return 0;
+}
+
+// the bytes of the name written by sdns_writer_question() after the header
+static int encode(char * name, char * out){
+    sdns_context * ctx = sdns_init_context();
+    assert(ctx != NULL);
+    char buff[512];
+    sdns_header header = {0};
+    sdns_writer w;
+    assert(sdns_writer_begin(&w, ctx, buff, sizeof(buff), &header) == 0);
+    int res = sdns_writer_question(&w, name, sdns_rr_type_A, sdns_q_class_IN);
+    if (res == 0)
+        memcpy(out, buff + DNS_HEADER_LENGTH, w.len - DNS_HEADER_LENGTH - 4);
+    sdns_free_context(ctx);
+    return res;
+}
+
+int test4(){
+    // how the names are encoded
+    char out[512];
+    assert(encode("www.example.com", out) == 0);
+    assert(memcmp(out, "\x03www\x07" "example\x03" "com", 17) == 0);
+    assert(encode("www.example.com...", out) == 0);
+    assert(memcmp(out, "\x03www\x07" "example\x03" "com", 17) == 0);
+    assert(encode("", out) == 0 && out[0] == 0);
+    assert(encode(".", out) == 0 && out[0] == 0);
+    assert(encode("..", out) == 0 && out[0] == 0);
+    assert(encode(NULL, out) == 0 && out[0] == 0);
+    assert(encode("a..com", out) == SDNS_ERROR_WRONG_LABEL_SPECIFIED);
+    assert(encode(".com", out) == SDNS_ERROR_WRONG_LABEL_SPECIFIED);
+    // labels are at most 63 bytes, the last one as well
+    char name[300];
+    memset(name, 'a', 63);
+    strcpy(name + 63, ".com");
+    assert(encode(name, out) == 0);
+    assert(out[0] == 63 && out[64] == 3);
+    memset(name, 'a', 64);
+    strcpy(name + 64, ".com");
+    assert(encode(name, out) == SDNS_ERROR_LABEL_MAX_63);
+    strcpy(name, "com.");
+    memset(name + 4, 'a', 64);
+    name[68] = '\0';
+    assert(encode(name, out) == SDNS_ERROR_LABEL_MAX_63);
+    // 255 bytes on the wire: 3 x (1 + 63) + 1 + 61 + 1
+    char * p = name;
+    for (int i=0; i< 4; ++i){
+        int l = i < 3?63:61;
+        memset(p, 'a' + i, l);
+        p += l;
+        *p++ = '.';
+    }
+    *p = '\0';
+    assert(encode(name, out) == 0);
+    assert(out[254] == 0);
+    p[-1] = 'e';
+    p[0] = '\0';
+    assert(encode(name, out) == SDNS_ERROR_HOSTNAME_TOO_LONG);
+    return 0;
+}
+
+int test5(){
+    // the names of SRV and RRSIG are not compressed, SOA can point to its own mname
+    sdns_context * dns = sdns_create_query("example.com", "SRV", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    assert(sdns_add_rr_answer_SRV(dns, "_sip._tcp.example.com", 300, 1, 2, 5060, "sip.example.com") == 0);
+    assert(sdns_add_rr_authority_SOA(dns, "example.com", 300, "ns1.example.net", "hostmaster.example.net",
+                                     1, 2, 3, 4, 5) == 0);
+    assert(sdns_to_wire(dns) == 0);
+    assert(count(dns->raw, dns->raw_len, "\x03sip\x07" "example\x03" "com\x00", 17) == 1);
+    // hostmaster points to the example.net of ns1.example.net
+    char * ns1 = find(dns->raw, dns->raw_len, "\x03ns1", 4);
+    assert(ns1 != NULL);
+    char pointer[3] = {0x0a, 0xc0, 0x00};
+    pointer[2] = ns1 - dns->raw + 4;
+    char * hostmaster = find(dns->raw, dns->raw_len, "\x0ahostmaster", 11);
+    assert(hostmaster != NULL);
+    assert(hostmaster[11] == pointer[1] && hostmaster[12] == pointer[2]);
+
+    sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+    assert(parsed != NULL);
+    sdns_rr * rr = sdns_section_rr(parsed, DNS_SECTION_ANSWER, 0);
+    assert(rr->type == sdns_rr_type_SRV);
+    assert(rr->rdlength == 6 + 17);
+    sdns_rr_SRV * srv = sdns_decode_rr_SRV(parsed, rr);
+    assert(srv != NULL);
+    assert(srv->Port == 5060);
+    assert(strcmp(srv->Target, "sip.example.com.") == 0);
+    sdns_free_rr_SRV(srv);
+    int err = 0;
+    rr = sdns_get_authority(parsed, &err, 0);
+    assert(err == 0 && rr != NULL);
+    assert(strcmp(((sdns_rr_SOA*)rr->psdns_rr)->rname, "hostmaster.example.net.") == 0);
+    assert(((sdns_rr_SOA*)rr->psdns_rr)->minimum == 2);
+    sdns_free_section(rr);
+    sdns_free_context(parsed);
+    sdns_free_context(dns);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests reusing one context for many packets (sdns_context_reset).
+ * compile and run:
+ * gcc -g -Werror test_context_reset.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+// dig soa @1.1.1.1 google.com
+static char soa_packet[] = {
+  0x96, 0xca, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01,
+  0x00, 0x00, 0x00, 0x01, 0x06, 0x67, 0x6f, 0x6f,
+  0x67, 0x6c, 0x65, 0x03, 0x63, 0x6f, 0x6d, 0x00,
+  0x00, 0x06, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06,
+  0x00, 0x01, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x26,
+  0x03, 0x6e, 0x73, 0x31, 0xc0, 0x0c, 0x09, 0x64,
+  0x6e, 0x73, 0x2d, 0x61, 0x64, 0x6d, 0x69, 0x6e,
+  0xc0, 0x0c, 0x26, 0xdf, 0xe8, 0x03, 0x00, 0x00,
+  0x03, 0x84, 0x00, 0x00, 0x03, 0x84, 0x00, 0x00,
+  0x07, 0x08, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+  0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00
+};
+
+static char a_packet[] = {
+    0x7f, 0x76, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x00,
+    0x05, 'y','a','h','o','o', 0x03, 'c','o','m', 0x00,
+    0x00, 0x01, 0x00, 0x01,
+    0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x06, 0xd7,
+    0x00, 0x04, 0x4a, 0x06, 0xe7, 0x15,
+    0x03, 'w', 'w', 'w', 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+    0x00, 0x00, 0x06, 0xd7, 0x00, 0x04, 0x62, 0x89, 0x0b, 0xa4
+};
+
+static int parse_both(sdns_context * dns){
+    for (int i=0; i< 10; ++i){
+        sdns_context_reset(dns);
+        dns->raw = i % 2 == 0?soa_packet:a_packet;
+        dns->raw_len = i % 2 == 0?sizeof(soa_packet):sizeof(a_packet);
+        assert(sdns_from_wire(dns) == 0);
+        if (i % 2 == 0){
+            assert(dns->msg->header.id == 0x96ca);
+            assert(dns->msg->header.ancount == 1);
+            assert(dns->msg->answer->type == sdns_rr_type_SOA);
+            assert(strcmp(dns->msg->question.qname, "google.com.") == 0);
+        }else{
+            assert(dns->msg->header.id == 0x7f76);
+            assert(dns->msg->header.ancount == 2);
+            assert(dns->msg->header.arcount == 0);
+            assert(dns->msg->additional == NULL);
+            assert(strcmp(dns->msg->answer->next->name, "www.yahoo.com.") == 0);
+        }
+        dns->raw = NULL;
+    }
+    return 0;
+}
+
+int test1(){
+    // without the arena
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    sdns_message * msg = dns->msg;
+    assert(parse_both(dns) == 0);
+    // the message structure is reused
+    assert(dns->msg == msg);
+    // nothing of the header is left from the last response (QR, RD and RA are set in it)
+    assert(dns->msg->header.qr == 1 && dns->msg->header.ra == 1);
+    sdns_context_reset(dns);
+    sdns_header empty;
+    memset(&empty, 0x00, sizeof(empty));
+    assert(memcmp(&dns->msg->header, &empty, sizeof(empty)) == 0);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // with the arena, the chunks are reused for the next packet
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_ARENA;
+    assert(parse_both(dns) == 0);
+    sdns_arena * arena = dns->arena;
+    sdns_arena_chunk * chunk = arena->chunks;
+    assert(chunk->next == NULL);
+    assert(parse_both(dns) == 0);
+    assert(dns->arena == arena && arena->chunks == chunk);
+    assert(chunk->next == NULL);
+    // a reset context can also be used to build a packet
+    sdns_context_reset(dns);
+    assert(dns->msg->question.qname == NULL && dns->msg->answer == NULL);
+    assert(sdns_make_query(dns, sdns_rr_type_A, sdns_q_class_IN, strdup("google.com"), 0) == 0);
+    assert(sdns_to_wire(dns) == 0);
+    assert(dns->raw != NULL && dns->raw_len == 28);
+    sdns_free_context(dns);
+    return 0;
+}
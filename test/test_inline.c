@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the inline rdata of the fixed-size RRs (sdns_rr_inline_rdata() and sdns_decode_rr_inline()).
+ * compile and run:
+ * gcc -g -Werror test_inline.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static char ipv6[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01};
+static char node[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+int test1(){
+    // the builders of the API keep the rdata in the RR, with or without the arena
+    for (int arena=0; arena< 2; ++arena){
+        sdns_context * dns = sdns_create_query("example.com", "A", "IN");
+        assert(dns != NULL);
+        if (arena)
+            dns->flags |= SDNS_CTX_ARENA;
+        dns->msg->header.qr = 1;
+        assert(sdns_add_rr_answer_A(dns, "example.com", 300, "1.2.3.4") == 0);
+        assert(sdns_add_rr_answer_AAAA(dns, "example.com", 300, "2001:db8::1") == 0);
+        assert(sdns_add_rr_authority_NID(dns, "example.com", 300, 10, node) == 0);
+        assert(sdns_add_rr_additional_A(dns, "ns.example.com", 300, "1.2.3.53") == 0);
+        for (uint16_t i=0; i< 2; ++i){
+            sdns_rr * rr = sdns_section_rr(dns, DNS_SECTION_ANSWER, i);
+            assert(rr->decoded == 1 && rr->has_inline == 1 && rr->psdns_rr == (void*) (rr + 1));
+        }
+        assert(((sdns_rr_A*)sdns_section_rr(dns, DNS_SECTION_ANSWER, 0)->psdns_rr)->address == 0x01020304);
+        if (arena)
+            assert(dns->heap_rrs == 1);     // only the OPT of the query
+        int err = 0;
+        uint16_t len = 0;
+        char * raw = sdns_to_network(dns, &err, &len);
+        assert(err == 0 && raw != NULL);
+        sdns_free_context(dns);
+
+        // decoding them again without a new structure
+        dns = sdns_from_network(raw, len);
+        assert(dns != NULL);
+        sdns_rr * rr = sdns_section_rr(dns, DNS_SECTION_ANSWER, 0);
+        assert(rr->decoded == 0 && rr->has_inline == 1);
+        assert(sdns_decode_rr_inline(dns, rr) == 0);
+        assert(rr->decoded == 1 && ((sdns_rr_A*)rr->psdns_rr)->address == 0x01020304);
+        assert(sdns_decode_rr_inline(dns, rr) == 0);
+        rr = sdns_section_rr(dns, DNS_SECTION_ANSWER, 1);
+        assert(sdns_decode_rr_inline(dns, rr) == 0);
+        assert(memcmp(((sdns_rr_AAAA*)rr->psdns_rr)->address, ipv6, 16) == 0);
+        rr = sdns_section_rr(dns, DNS_SECTION_AUTHORITY, 0);
+        assert(sdns_decode_rr_inline(dns, rr) == 0);
+        sdns_rr_NID * nid = (sdns_rr_NID*) rr->psdns_rr;
+        assert(nid->Preference == 10 && memcmp(nid->NodeId, node, 8) == 0);
+        // the decoded RRs are encoded as they are
+        sdns_context_reset(dns);
+        sdns_context * copy = sdns_from_network(raw, len);
+        assert(copy != NULL);
+        sdns_rr * sections[] = {copy->msg->answer, copy->msg->authority, copy->msg->additional};
+        for (int i=0; i< 3; ++i)
+            for (sdns_rr * r = sections[i]; r; r = r->next)
+                if (r->type != sdns_rr_type_OPT)
+                    assert(sdns_decode_rr_inline(copy, r) == 0);
+        char buff[512];
+        uint16_t copy_len = 0;
+        assert(sdns_to_wire_into(copy, buff, sizeof(buff), &copy_len) == 0);
+        assert(copy_len == len && memcmp(buff, raw, len) == 0);
+        sdns_free_context(copy);
+        sdns_free_context(dns);
+        free(raw);
+    }
+    return 0;
+}
+
+int test2(){
+    // L32 and L64 made by hand and the RRs that can't be inline
+    sdns_context * dns = sdns_create_query("example.com", "A", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    sdns_rr * rr = sdns_context_init_rr(dns, "example.com", sdns_rr_type_L32, sdns_q_class_IN, 60, 0, 0, NULL);
+    sdns_rr_L32 * l32 = (sdns_rr_L32*) sdns_rr_inline_rdata(rr);
+    assert(l32 != NULL && rr->decoded == 1);
+    l32->Preference = 5;
+    l32->Locator32 = 0x0a000001;
+    assert(sdns_add_answer_section(dns, rr) == 0);
+    rr = sdns_context_init_rr(dns, "example.com", sdns_rr_type_L64, sdns_q_class_IN, 60, 0, 0, NULL);
+    sdns_rr_L64 * l64 = (sdns_rr_L64*) sdns_rr_inline_rdata(rr);
+    assert(l64 != NULL && l64->Locator64 == ((sdns_rr_inline*) (rr + 1))->bytes);
+    l64->Preference = 6;
+    memcpy(l64->Locator64, node, 8);
+    assert(sdns_add_answer_section(dns, rr) == 0);
+    assert(sdns_add_rr_answer_MX(dns, "example.com", 60, 10, "mail.example.com") == 0);
+    // only the fixed-size RRs have the room
+    assert(sdns_section_rr(dns, DNS_SECTION_ANSWER, 2)->has_inline == 0);
+    assert(sdns_rr_inline_rdata(sdns_section_rr(dns, DNS_SECTION_ANSWER, 2)) == NULL);
+    assert(sdns_rr_inline_rdata(NULL) == NULL);
+    assert(sdns_to_wire(dns) == 0);
+    sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+    assert(parsed != NULL);
+    sdns_free_context(dns);
+
+    rr = sdns_section_rr(parsed, DNS_SECTION_ANSWER, 0);
+    assert(sdns_decode_rr_inline(parsed, rr) == 0);
+    l32 = (sdns_rr_L32*) rr->psdns_rr;
+    assert(l32->Preference == 5 && l32->Locator32 == 0x0a000001);
+    rr = sdns_section_rr(parsed, DNS_SECTION_ANSWER, 1);
+    assert(sdns_decode_rr_inline(parsed, rr) == 0);
+    l64 = (sdns_rr_L64*) rr->psdns_rr;
+    assert(l64->Preference == 6 && memcmp(l64->Locator64, node, 8) == 0);
+    rr = sdns_section_rr(parsed, DNS_SECTION_ANSWER, 2);
+    assert(sdns_decode_rr_inline(parsed, rr) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(rr->decoded == 0);
+    assert(sdns_decode_rr_inline(NULL, rr) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    sdns_free_context(parsed);
+
+    // a broken rdata is not decoded
+    char rdata[3] = {1, 2, 3};
+    sdns_context * ctx = sdns_init_context();
+    assert(ctx != NULL);
+    rr = sdns_init_rr(NULL, sdns_rr_type_A, sdns_q_class_IN, 60, 3, 0, rdata);
+    assert(sdns_decode_rr_inline(ctx, rr) == SDNS_ERROR_RR_SECTION_MALFORMED);
+    assert(rr->decoded == 0 && rr->rdata == rdata);
+    free(rr);
+    sdns_free_context(ctx);
+    return 0;
+}
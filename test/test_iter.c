@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests reading the RRs of the raw buffer without decoding them (sdns_iter_* and sdns_view_*).
+ * compile and run:
+ * gcc -g -Werror test_iter.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static char ipv6[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01};
+
+static char * make_response(uint16_t * len){
+    sdns_context * dns = sdns_create_query("www.example.com", "A", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    assert(sdns_add_rr_answer_CNAME(dns, "www.example.com", 300, "web.example.com") == 0);
+    assert(sdns_add_rr_answer_A(dns, "web.example.com", 200, "1.2.3.4") == 0);
+    assert(sdns_add_rr_answer_AAAA(dns, "web.example.com", 100, "2001:db8::1") == 0);
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 3600, "ns1.example.com") == 0);
+    assert(sdns_add_rr_additional_MX(dns, "example.com", 60, 10, "mail.example.com") == 0);
+    int err = 0;
+    char * raw = sdns_to_network(dns, &err, len);
+    assert(err == 0 && raw != NULL);
+    sdns_free_context(dns);
+    return raw;
+}
+
+int test1(){
+    // all the RRs in order, the same values as the decoded ones
+    uint16_t len = 0;
+    char * raw = make_response(&len);
+    sdns_context * dns = sdns_from_network(raw, len);
+    assert(dns != NULL);
+    free(raw);
+    int sections[] = {DNS_SECTION_ANSWER, DNS_SECTION_ANSWER, DNS_SECTION_ANSWER, DNS_SECTION_AUTHORITY,
+                      DNS_SECTION_ADDITIONAL, DNS_SECTION_ADDITIONAL};
+    uint16_t types[] = {sdns_rr_type_CNAME, sdns_rr_type_A, sdns_rr_type_AAAA, sdns_rr_type_NS,
+                        sdns_rr_type_OPT, sdns_rr_type_MX};
+    char * names[] = {"www.example.com.", "web.example.com.", "web.example.com.", "example.com.", "", "example.com."};
+    char * targets[] = {"web.example.com.", NULL, NULL, "ns1.example.com.", NULL, "mail.example.com."};
+    uint32_t ttls[] = {300, 200, 100, 3600, 0, 60};
+    char name[SDNS_NAME_BUFFER_SIZE];
+    sdns_rr_iter it;
+    sdns_rr_view rr;
+    assert(sdns_iter_begin(dns, &it) == 0);
+    int n = 0;
+    int res = 0;
+    while ((res = sdns_iter_next(&it, &rr)) == 1){
+        assert(n < 6);
+        assert(rr.section == sections[n]);
+        assert(rr.type == types[n]);
+        assert(rr.ttl == ttls[n]);
+        assert(sdns_view_name(dns, &rr, name) == 0);
+        assert(strcmp(name, names[n]) == 0);
+        if (targets[n] != NULL){
+            assert(sdns_view_target(dns, &rr, name) == 0);
+            assert(strcmp(name, targets[n]) == 0);
+        }else{
+            assert(sdns_view_target(dns, &rr, name) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+        }
+        uint32_t ip = 0;
+        char ip6[16];
+        if (rr.type == sdns_rr_type_A){
+            assert(sdns_view_A(&rr, &ip) == 0);
+            assert(ip == 0x01020304);
+        }else{
+            assert(sdns_view_A(&rr, &ip) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+        }
+        if (rr.type == sdns_rr_type_AAAA){
+            assert(sdns_view_AAAA(&rr, ip6) == 0);
+            assert(memcmp(ip6, ipv6, 16) == 0);
+        }else{
+            assert(sdns_view_AAAA(&rr, ip6) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+        }
+        if (rr.type == sdns_rr_type_OPT){
+            assert(rr.class == UDP_PAYLOAD_SIZE);
+            assert(rr.rdata == NULL && rr.rdlength == 0);
+        }else{
+            // the same rdata as the decoded RR
+            sdns_rr * decoded = sdns_section_rr(dns, rr.section, n == 5?1:(n < 3?n:0));
+            assert(decoded->type == rr.type && decoded->rdlength == rr.rdlength);
+        }
+        n++;
+    }
+    assert(res == 0 && n == 6);
+    assert(sdns_iter_next(&it, &rr) == 0);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // nothing is decoded with SDNS_CTX_LAZY and SDNS_CTX_NAME_VIEW
+    uint16_t len = 0;
+    char * raw = make_response(&len);
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_LAZY | SDNS_CTX_NAME_VIEW | SDNS_CTX_BORROWED;
+    dns->raw = raw;
+    dns->raw_len = len;
+    assert(sdns_from_wire(dns) == 0);
+    sdns_rr_iter it;
+    sdns_rr_view rr;
+    assert(sdns_iter_begin(dns, &it) == 0);
+    int n = 0;
+    uint32_t ip = 0;
+    while (sdns_iter_next(&it, &rr) == 1){
+        if (rr.type == sdns_rr_type_A)
+            assert(sdns_view_A(&rr, &ip) == 0);
+        n++;
+    }
+    assert(n == 6 && ip == 0x01020304);
+    assert(dns->msg->answer == NULL && dns->msg->additional == NULL);
+    assert(dns->pending != 0);
+    sdns_free_context(dns);
+
+    // the last RR is not complete (the lazy parser has only read the question)
+    dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_LAZY | SDNS_CTX_BORROWED;
+    dns->raw = raw;
+    dns->raw_len = len - 1;
+    assert(sdns_from_wire(dns) == 0);
+    assert(sdns_iter_begin(dns, &it) == 0);
+    int res = 0;
+    n = 0;
+    while ((res = sdns_iter_next(&it, &rr)) == 1)
+        n++;
+    assert(res == SDNS_ERROR_RR_SECTION_MALFORMED && n == 5);
+    sdns_free_context(dns);
+
+    // the packet we write has a longer question, the iterator must not use the offsets of the old one
+    dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_BORROWED;
+    dns->raw = raw;
+    dns->raw_len = len;
+    assert(sdns_from_wire(dns) == 0);
+    assert(dns->section_offset[DNS_SECTION_ANSWER] == DNS_HEADER_LENGTH + 17 + 4);
+    free(dns->msg->question.qname);
+    dns->msg->question.qname = strdup("a.much.longer.name.example.com");
+    assert(sdns_to_wire(dns) == 0 && dns->raw != raw);
+    assert(sdns_iter_begin(dns, &it) == 0);
+    assert(it.at == DNS_HEADER_LENGTH + 32 + 4);
+    char name[SDNS_NAME_BUFFER_SIZE];
+    assert(sdns_iter_next(&it, &rr) == 1 && rr.type == sdns_rr_type_CNAME);
+    assert(sdns_view_name(dns, &rr, name) == 0 && strcmp(name, "www.example.com.") == 0);
+    sdns_free_context(dns);
+
+    // no raw buffer
+    dns = sdns_create_query("example.com", "A", "IN");
+    assert(dns != NULL);
+    assert(sdns_iter_begin(dns, &it) == SDNS_ERROR_BUFFER_IS_NULL);
+    assert(sdns_iter_begin(NULL, &it) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    sdns_free_context(dns);
+    free(raw);
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests lazy parsing of the sections (SDNS_CTX_LAZY).
+ * compile and run:
+ * gcc -g -Werror test_lazy.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+// dig soa @1.1.1.1 google.com
+static char soa_packet[] = {
+  0x96, 0xca, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01,
+  0x00, 0x00, 0x00, 0x01, 0x06, 0x67, 0x6f, 0x6f,
+  0x67, 0x6c, 0x65, 0x03, 0x63, 0x6f, 0x6d, 0x00,
+  0x00, 0x06, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06,
+  0x00, 0x01, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x26,
+  0x03, 0x6e, 0x73, 0x31, 0xc0, 0x0c, 0x09, 0x64,
+  0x6e, 0x73, 0x2d, 0x61, 0x64, 0x6d, 0x69, 0x6e,
+  0xc0, 0x0c, 0x26, 0xdf, 0xe8, 0x03, 0x00, 0x00,
+  0x03, 0x84, 0x00, 0x00, 0x03, 0x84, 0x00, 0x00,
+  0x07, 0x08, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+  0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00
+};
+
+int test1(){
+    // only the header and the question are decoded by sdns_from_wire()
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_LAZY;
+    dns->raw = soa_packet;
+    dns->raw_len = sizeof(soa_packet);
+    assert(sdns_from_wire(dns) == 0);
+    assert(strcmp(dns->msg->question.qname, "google.com.") == 0);
+    assert(dns->msg->header.ancount == 1 && dns->msg->header.arcount == 1);
+    assert(dns->msg->answer == NULL && dns->msg->additional == NULL);
+    assert(dns->section_offset[DNS_SECTION_ANSWER] == 28);
+
+    // the answer section is skipped to find the additional section
+    sdns_rr * opt = sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 0);
+    assert(opt != NULL && opt->type == sdns_rr_type_OPT);
+    assert(dns->msg->answer == NULL);
+    assert(dns->section_offset[DNS_SECTION_AUTHORITY] == 78);
+    assert(dns->section_offset[DNS_SECTION_ADDITIONAL] == 78);
+
+    int err = 0;
+    sdns_rr * soa = sdns_get_answer(dns, &err, 0);
+    assert(err == 0 && soa != NULL);
+    assert(strcmp(((sdns_rr_SOA*)soa->psdns_rr)->rname, "dns-admin.google.com.") == 0);
+    sdns_free_section(soa);
+    assert(dns->msg->answer != NULL && dns->msg->answer->type == sdns_rr_type_SOA);
+    assert(dns->pending == (1 << DNS_SECTION_AUTHORITY));
+    assert(sdns_decode_section(dns, DNS_SECTION_AUTHORITY) == 0);
+    assert(dns->pending == 0 && dns->msg->authority == NULL);
+    assert(sdns_decode_section(dns, DNS_SECTION_QUESTION) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // errors of the sections show up when we decode them
+    char packet_bytes[sizeof(soa_packet)];
+    memcpy(packet_bytes, soa_packet, sizeof(soa_packet));
+    packet_bytes[78] = 0xc0;     // name of OPT is a forward pointer
+    packet_bytes[79] = 0x60;
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_LAZY | SDNS_CTX_ARENA;
+    dns->raw = packet_bytes;
+    dns->raw_len = sizeof(packet_bytes);
+    assert(sdns_from_wire(dns) == 0);
+    assert(sdns_section_rr(dns, DNS_SECTION_ANSWER, 0) != NULL);
+    assert(sdns_decode_section(dns, DNS_SECTION_ADDITIONAL) != 0);
+    assert(dns->err != 0);
+    assert(sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 0) == NULL);
+    assert(dns->pending & (1 << DNS_SECTION_ADDITIONAL));
+    // the context can be reused after reset
+    sdns_context_reset(dns);
+    dns->raw = soa_packet;
+    dns->raw_len = sizeof(soa_packet);
+    assert(sdns_from_wire(dns) == 0);
+    assert(sdns_decode_section(dns, DNS_SECTION_ADDITIONAL) == 0);
+    assert(dns->msg->additional->type == sdns_rr_type_OPT);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+
+    // rdlength of the answer goes past the end of the packet (and the offset wraps to 12)
+    char * big = (char*) calloc(65535, 1);
+    assert(big != NULL);
+    memcpy(big, soa_packet, 28);
+    big[7] = 1;     // ancount
+    big[9] = 1;     // nscount
+    big[11] = 0;    // arcount
+    char answer[] = {0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0xff, 0xe4};
+    memcpy(big + 28, answer, sizeof(answer));
+    dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_LAZY;
+    dns->raw = big;
+    dns->raw_len = 65535;
+    assert(sdns_from_wire(dns) == 0);
+    assert(sdns_decode_section(dns, DNS_SECTION_AUTHORITY) == SDNS_ERROR_RR_SECTION_MALFORMED);
+    assert(dns->msg->authority == NULL);
+    assert(sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 0) == NULL);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    free(big);
+    return 0;
+}
+
+int test3(){
+    // the pending sections are decoded before we write the packet
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_LAZY;
+    dns->raw = (char*) malloc(sizeof(soa_packet));
+    memcpy(dns->raw, soa_packet, sizeof(soa_packet));
+    dns->raw_len = sizeof(soa_packet);
+    assert(sdns_from_wire(dns) == 0);
+    assert(sdns_add_rr_answer_A(dns, "google.com", 30, "1.2.3.4") == 0);
+    assert(dns->msg->header.ancount == 2);
+    assert(dns->msg->answer->type == sdns_rr_type_SOA);
+    assert(dns->msg->answer->next->type == sdns_rr_type_A);
+    assert(sdns_to_wire(dns) == 0);
+    assert(dns->pending == 0);
+    assert(dns->msg->additional != NULL);
+    sdns_free_context(dns);
+    return 0;
+}
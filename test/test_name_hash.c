@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the hash of the names computed while decoding (SDNS_CTX_NAME_HASH).
+ * compile and run:
+ * gcc -g -Werror test_name_hash.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+int test4(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    assert(test4() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+// WwW.ExAmple.COM with one answer for the qname and one for abc.example.com
+static char packet[] = {
+    0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x00,
+    0x03, 'W', 'w', 'W', 0x07, 'E', 'x', 'A', 'm', 'p', 'l', 'e', 0x03, 'C', 'O', 'M', 0x00,
+    0x00, 0x01, 0x00, 0x01,
+    0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 0x01, 0x02, 0x03, 0x04,
+    0x03, 'a', 'b', 'c', 0xc0, 0x10, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04,
+    0x01, 0x02, 0x03, 0x05
+};
+
+int test1(){
+    // the hash does not depend on the case or the trailing dot
+    uint64_t h = sdns_name_hash("www.example.com.");
+    assert(h != 0);
+    assert(sdns_name_hash("WWW.Example.Com.") == h);
+    assert(sdns_name_hash("www.example.com") == h);
+    assert(sdns_name_hash("www.example.org.") != h);
+    assert(sdns_name_hash("www.example.com.a") != h);
+    assert(sdns_name_hash(".") == sdns_name_hash(""));
+    assert(sdns_name_hash(NULL) == 0);
+
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_NAME_HASH;
+    dns->raw = packet;
+    dns->raw_len = sizeof(packet);
+    assert(sdns_from_wire(dns) == 0);
+    assert(dns->msg->question.qname_hash == h);
+    assert(dns->msg->answer->name_hash == h);
+    assert(dns->msg->answer->next->name_hash == sdns_name_hash("abc.example.com"));
+    dns->raw = NULL;
+    sdns_free_context(dns);
+
+    // nothing without the flag
+    dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->raw = packet;
+    dns->raw_len = sizeof(packet);
+    assert(sdns_from_wire(dns) == 0);
+    assert(dns->msg->question.qname_hash == 0);
+    assert(dns->msg->answer->name_hash == 0);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // in name-view mode we get the hash without the names
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_NAME_HASH | SDNS_CTX_NAME_VIEW;
+    dns->raw = packet;
+    dns->raw_len = sizeof(packet);
+    assert(sdns_from_wire(dns) == 0);
+    assert(dns->msg->question.qname == NULL);
+    assert(dns->msg->question.qname_hash == sdns_name_hash("www.example.com."));
+    assert(dns->msg->answer->next->name == NULL);
+    assert(dns->msg->answer->next->name_hash == sdns_name_hash("abc.example.com."));
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test3(){
+    // the names that come from the memo of the decoded names have the same hash
+    char big[512];
+    memcpy(big, packet, 33);
+    int len = 33;
+    for (int i=0; i< 12; ++i){   // all the names are in the first 256 bytes
+        char rr[] = {0x01, 'A' + i, 0xc0, i == 0?0x10:len - 18, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c,
+                     0x00, 0x04, 0x01, 0x02, 0x03, i};
+        memcpy(big + len, rr, sizeof(rr));
+        len += sizeof(rr);
+    }
+    big[7] = 12;
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_NAME_HASH;
+    dns->raw = big;
+    dns->raw_len = len;
+    assert(sdns_from_wire(dns) == 0);
+    int cnt = 0;
+    for (sdns_rr * rr = dns->msg->answer; rr; rr = rr->next){
+        assert(rr->name_hash == sdns_name_hash(rr->name));
+        cnt++;
+    }
+    assert(cnt == 12);
+    assert(strcmp(sdns_section_rr(dns, DNS_SECTION_ANSWER, 2)->name, "C.B.A.ExAmple.COM.") == 0);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test4(){
+    // peeking always gives the hash
+    sdns_question q;
+    char qname[SDNS_NAME_BUFFER_SIZE];
+    assert(sdns_peek_question(packet, sizeof(packet), &q, qname) == sdns_rcode_NoError);
+    assert(q.qname_hash == sdns_name_hash("www.example.com."));
+    assert(sdns_peek_question(packet, sizeof(packet), &q, NULL) == sdns_rcode_NoError);
+    assert(q.qname_hash == sdns_name_hash("www.example.com."));
+    // root
+    char root[] = {0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                   0x00, 0x00, 0x02, 0x00, 0x01};
+    assert(sdns_peek_question(root, sizeof(root), &q, qname) == sdns_rcode_NoError);
+    assert(q.qname_hash == sdns_name_hash("."));
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the memo of the decoded names (compression pointers to the names we have already seen).
+ * compile and run:
+ * gcc -g -Werror test_name_memo.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+// dig soa @1.1.1.1 google.com
+static char soa_packet[] = {
+  0x96, 0xca, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01,
+  0x00, 0x00, 0x00, 0x01, 0x06, 0x67, 0x6f, 0x6f,
+  0x67, 0x6c, 0x65, 0x03, 0x63, 0x6f, 0x6d, 0x00,
+  0x00, 0x06, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06,
+  0x00, 0x01, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x26,
+  0x03, 0x6e, 0x73, 0x31, 0xc0, 0x0c, 0x09, 0x64,
+  0x6e, 0x73, 0x2d, 0x61, 0x64, 0x6d, 0x69, 0x6e,
+  0xc0, 0x0c, 0x26, 0xdf, 0xe8, 0x03, 0x00, 0x00,
+  0x03, 0x84, 0x00, 0x00, 0x03, 0x84, 0x00, 0x00,
+  0x07, 0x08, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+  0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00
+};
+
+// same layout as soa_packet with different names
+static char soa_packet2[] = {
+  0x96, 0xca, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01,
+  0x00, 0x00, 0x00, 0x01, 0x06, 'y', 'a', 'n',
+  'd', 'e', 'x', 0x03, 'n', 'e', 't', 0x00,
+  0x00, 0x06, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06,
+  0x00, 0x01, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x26,
+  0x03, 'd', 'n', 's', 0xc0, 0x13, 0x09, 'h',
+  'o', 's', 't', 'm', 'a', 's', 't', 'e',
+  0xc0, 0x0c, 0x26, 0xdf, 0xe8, 0x03, 0x00, 0x00,
+  0x03, 0x84, 0x00, 0x00, 0x03, 0x84, 0x00, 0x00,
+  0x07, 0x08, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+  0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00
+};
+
+// www.example.com with 10 A records and one NS record with a compressed name in rdata
+static int make_packet(char * packet){
+    char header[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x0b,
+        0x00, 0x00, 0x00, 0x00,
+        0x03, 'w', 'w', 'w', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00,
+        0x00, 0x01, 0x00, 0x01
+    };
+    memcpy(packet, header, sizeof(header));
+    int len = sizeof(header);
+    for (int i=0; i< 10; ++i){
+        char rr[] = {0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 0x01, 0x02, 0x03, i};
+        memcpy(packet + len, rr, sizeof(rr));
+        len += sizeof(rr);
+    }
+    char ns[] = {0xc0, 0x10, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x06,
+                 0x03, 'n', 's', '1', 0xc0, 0x10};
+    memcpy(packet + len, ns, sizeof(ns));
+    len += sizeof(ns);
+    return len;
+}
+
+int test1(){
+    // many names pointing to the same name and rdata names decoded after parsing
+    char packet[512];
+    int len = make_packet(packet);
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->raw = packet;
+    dns->raw_len = len;
+    assert(sdns_from_wire(dns) == 0);
+    assert(strcmp(dns->msg->question.qname, "www.example.com.") == 0);
+    sdns_rr * rr = dns->msg->answer;
+    for (int i=0; i< 10; ++i){
+        assert(rr != NULL);
+        assert(strcmp(rr->name, "www.example.com.") == 0);
+        rr = rr->next;
+    }
+    assert(strcmp(rr->name, "example.com.") == 0);
+    sdns_rr_NS * rr_ns = sdns_decode_rr_NS(dns, rr);
+    assert(rr_ns != NULL);
+    assert(strcmp(rr_ns->NSDNAME, "ns1.example.com.") == 0);
+    sdns_free_rr_NS(rr_ns);
+    // and again, now everything comes from the memo
+    rr_ns = sdns_decode_rr_NS(dns, rr);
+    assert(rr_ns != NULL);
+    assert(strcmp(rr_ns->NSDNAME, "ns1.example.com.") == 0);
+    sdns_free_rr_NS(rr_ns);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+
+    // same in name-view mode where the names are only validated while parsing
+    dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_NAME_VIEW;
+    dns->raw = packet;
+    dns->raw_len = len;
+    assert(sdns_from_wire(dns) == 0);
+    assert(strcmp(sdns_get_qname(dns), "www.example.com.") == 0);
+    assert(strcmp(sdns_get_rr_name(dns, dns->msg->answer->next), "www.example.com.") == 0);
+    assert(strcmp(sdns_get_rr_name(dns, sdns_section_rr(dns, 1, 10)), "example.com.") == 0);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // a suffix we already know is still rejected if it's not valid for the new name
+    char packet[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x04,
+        0x00, 0x00, 0x00, 0x04,
+        0x01, 'a', 0x00, 0x00, 0x01, 0x00, 0x01,                               // question at 12
+        0xc0, 0x0c, 0x00, 0x0a, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04,
+        0x01, 'x', 0xc0, 0x31,                                                  // NULL rdata at 31: x + pointer to 49
+        0xc0, 0x0c, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x02,
+        0xc0, 0x1f,                                                             // NS rdata at 47: pointer to 31
+        0x01, 'z', 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04,
+        0x01, 0x02, 0x03, 0x04,                                                 // z. at 49
+        0xc0, 0x1f, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04,
+        0x01, 0x02, 0x03, 0x05,                                                 // x.z. at 66
+        // enough records to have the memo
+        0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 0x01, 0x02, 0x03, 0x06,
+        0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 0x01, 0x02, 0x03, 0x07,
+        0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 0x01, 0x02, 0x03, 0x08,
+        0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 0x01, 0x02, 0x03, 0x09
+    };
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->raw = packet;
+    dns->raw_len = sizeof(packet);
+    assert(sdns_from_wire(dns) == 0);
+    assert(strcmp(dns->msg->answer->next->next->next->name, "x.z.") == 0);
+    // "x.z." is known at 31, but the name at 47 can not jump to 49
+    sdns_rr_NS * rr_ns = sdns_decode_rr_NS(dns, dns->msg->answer->next);
+    assert(rr_ns == NULL);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test3(){
+    // the names of the last packet are forgotten after reset
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    // a big message first, so we have the memo
+    char packet[512];
+    dns->raw = packet;
+    dns->raw_len = make_packet(packet);
+    assert(sdns_from_wire(dns) == 0);
+    dns->raw = NULL;
+    for (int i=0; i< 4; ++i){
+        sdns_context_reset(dns);
+        dns->raw = i % 2 == 0?soa_packet:soa_packet2;
+        dns->raw_len = sizeof(soa_packet);
+        assert(sdns_from_wire(dns) == 0);
+        sdns_rr_SOA * soa = sdns_decode_rr_SOA(dns, dns->msg->answer);
+        assert(soa != NULL);
+        if (i % 2 == 0){
+            assert(strcmp(dns->msg->question.qname, "google.com.") == 0);
+            assert(strcmp(soa->mname, "ns1.google.com.") == 0);
+            assert(strcmp(soa->rname, "dns-admin.google.com.") == 0);
+        }else{
+            assert(strcmp(dns->msg->question.qname, "yandex.net.") == 0);
+            assert(strcmp(soa->mname, "dns.net.") == 0);
+            assert(strcmp(soa->rname, "hostmaste.yandex.net.") == 0);
+        }
+        sdns_free_rr_SOA(soa);
+        dns->raw = NULL;
+    }
+    sdns_free_context(dns);
+    return 0;
+}
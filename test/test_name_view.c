@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests parsing in name-view mode (SDNS_CTX_NAME_VIEW).
+ * compile and run:
+ * gcc -g -Werror test_name_view.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+int test1(){
+    // names are not allocated but we can get them on request
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_NAME_VIEW;
+    // dig soa @1.1.1.1 google.com
+    char packet_bytes[] = {
+      0x96, 0xca, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01,
+      0x00, 0x00, 0x00, 0x01, 0x06, 0x67, 0x6f, 0x6f,
+      0x67, 0x6c, 0x65, 0x03, 0x63, 0x6f, 0x6d, 0x00,
+      0x00, 0x06, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06,
+      0x00, 0x01, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x26,
+      0x03, 0x6e, 0x73, 0x31, 0xc0, 0x0c, 0x09, 0x64,
+      0x6e, 0x73, 0x2d, 0x61, 0x64, 0x6d, 0x69, 0x6e,
+      0xc0, 0x0c, 0x26, 0xdf, 0xe8, 0x03, 0x00, 0x00,
+      0x03, 0x84, 0x00, 0x00, 0x03, 0x84, 0x00, 0x00,
+      0x07, 0x08, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+      0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00
+    };
+    dns->raw = packet_bytes;
+    dns->raw_len = sizeof(packet_bytes);
+    assert(sdns_from_wire(dns) == 0);
+    assert(dns->msg->question.qname == NULL);
+    assert(dns->msg->question.qname_offset == 12);
+    assert(dns->msg->question.qname_len == 12);
+    assert(dns->msg->answer->name == NULL);
+    assert(dns->msg->answer->name_offset == 28);
+    assert(dns->msg->answer->name_len == 2);
+    assert(dns->msg->additional->name == NULL);
+    assert(dns->msg->additional->name_len == 1);
+
+    char * qname = sdns_get_qname(dns);
+    assert(qname != NULL);
+    assert(strcmp(qname, "google.com.") == 0);
+    char * name = sdns_get_rr_name(dns, dns->msg->answer);
+    assert(name != NULL);
+    assert(strcmp(name, "google.com.") == 0);
+    // the second call returns the cached name
+    assert(sdns_get_rr_name(dns, dns->msg->answer) == name);
+    assert(strcmp(sdns_get_rr_name(dns, dns->msg->additional), "") == 0);
+
+    // rdata decoding is not affected by the name-view mode
+    sdns_rr_SOA * soa = sdns_decode_rr_SOA(dns, dns->msg->answer);
+    assert(soa);
+    assert(strcmp(soa->mname, "ns1.google.com.") == 0);
+    assert(strcmp(soa->rname, "dns-admin.google.com.") == 0);
+    sdns_free_rr_SOA(soa);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // the API functions materialize the names themselves
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_NAME_VIEW;
+    char packet_bytes[] = {
+        0x7f, 0x76, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02,
+        0x00, 0x00, 0x00, 0x00,
+        0x05, 'y','a','h','o','o', 0x03, 'c','o','m', 0x00,
+        0x00, 0x01, 0x00, 0x01,
+        0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x06, 0xd7,
+        0x00, 0x04, 0x4a, 0x06, 0xe7, 0x15,
+        0x03, 'w', 'w', 'w', 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x06, 0xd7, 0x00, 0x04, 0x62, 0x89, 0x0b, 0xa4
+    };
+    dns->raw = packet_bytes;
+    dns->raw_len = sizeof(packet_bytes);
+    assert(sdns_from_wire(dns) == 0);
+    int err = 0;
+    sdns_rr * a = sdns_get_answer(dns, &err, 1);
+    assert(err == 0 && a != NULL);
+    assert(strcmp(a->name, "www.yahoo.com.") == 0);
+    assert(((sdns_rr_A*)a->psdns_rr)->address == 0x62890ba4);
+    sdns_free_section(a);
+    sdns_question * q = sdns_get_question(dns);
+    assert(q != NULL);
+    assert(strcmp(q->qname, "yahoo.com.") == 0);
+    free(q->qname);
+    free(q);
+    // the first answer has never been asked for
+    assert(dns->msg->answer->name == NULL);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test3(){
+    // names are still validated in name-view mode
+    sdns_context * dns = sdns_init_context();
+    assert(dns != NULL);
+    dns->flags |= SDNS_CTX_NAME_VIEW;
+    char packet_bytes[] = {
+        0x7f, 0x76, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x00,
+        0x05, 'y','a','h','o','o', 0x03, 'c','o','m', 0x00,
+        0x00, 0x01, 0x00, 0x01,
+        0xc0, 0x1d, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x06, 0xd7,   // forward pointer
+        0x00, 0x04, 0x4a, 0x06, 0xe7, 0x15
+    };
+    dns->raw = packet_bytes;
+    dns->raw_len = sizeof(packet_bytes);
+    assert(sdns_from_wire(dns) == SDNS_ERROR_ILLEGAL_COMPRESSION);
+    dns->raw = NULL;
+    sdns_free_context(dns);
+    return 0;
+}
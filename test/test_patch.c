@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests changing a packet in place (sdns_patch_*).
+ * compile and run:
+ * gcc -g -Werror test_patch.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static char * make_response(int edns, uint16_t * len){
+    sdns_context * dns = sdns_create_query("www.example.com", "A", "IN");
+    assert(dns != NULL);
+    if (!edns)
+        assert(sdns_remove_edns(dns) == 0);
+    else
+        dns->msg->additional->opt_ttl.DO = 1;
+    dns->msg->header.qr = 1;
+    dns->msg->header.aa = 1;
+    dns->msg->header.id = 0x1111;
+    assert(sdns_add_rr_answer_A(dns, "www.example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_answer_A(dns, "www.example.com", 300, "1.2.3.5") == 0);
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 3600, "ns1.example.com") == 0);
+    assert(sdns_add_rr_additional_A(dns, "ns1.example.com", 100, "1.2.3.53") == 0);
+    int err = 0;
+    char * raw = sdns_to_network(dns, &err, len);
+    assert(err == 0 && raw != NULL);
+    sdns_free_context(dns);
+    return raw;
+}
+
+int test1(){
+    // the same packet as if we decoded, changed and encoded it again
+    uint16_t len = 0;
+    char * raw = make_response(1, &len);
+    assert(sdns_patch_id(raw, len, 0xabcd) == 0);
+    assert(sdns_patch_flags(raw, len, SDNS_RA_MASK | SDNS_AA_MASK | SDNS_TC_MASK, SDNS_RA_MASK | SDNS_TC_MASK) == 0);
+    uint32_t min_ttl = 1;
+    assert(sdns_patch_ttl(raw, len, 150, &min_ttl) == 0);
+    assert(min_ttl == 0);
+    assert(sdns_patch_udp_size(raw, len, 4096) == 0);
+
+    sdns_context * dns = sdns_from_network(raw, len);
+    assert(dns != NULL);
+    assert(dns->msg->header.id == 0xabcd);
+    assert(dns->msg->header.qr == 1 && dns->msg->header.rd == 1);
+    assert(dns->msg->header.ra == 1 && dns->msg->header.tc == 1 && dns->msg->header.aa == 0);
+    assert(sdns_section_rr(dns, DNS_SECTION_ANSWER, 0)->ttl == 150);
+    assert(sdns_section_rr(dns, DNS_SECTION_ANSWER, 1)->ttl == 150);
+    assert(sdns_section_rr(dns, DNS_SECTION_AUTHORITY, 0)->ttl == 3450);
+    sdns_rr * opt = NULL;
+    for (sdns_rr * rr = dns->msg->additional; rr; rr = rr->next){
+        if (rr->type == sdns_rr_type_OPT)
+            opt = rr;
+        else
+            assert(rr->ttl == 0);
+    }
+    // the TTL of OPT is the DO bit (as it is on the wire)
+    assert(opt != NULL && opt->udp_size == 4096 && opt->ttl == 0x8000);
+    sdns_free_context(dns);
+
+    assert(sdns_patch_ttl(raw, len, 3000, &min_ttl) == 0);
+    assert(min_ttl == 0);
+    assert(sdns_patch_ttl(raw, len, 0, NULL) == 0);
+    dns = sdns_from_network(raw, len);
+    assert(dns != NULL);
+    assert(sdns_section_rr(dns, DNS_SECTION_AUTHORITY, 0)->ttl == 450);
+    sdns_free_context(dns);
+    free(raw);
+
+    // the smallest TTL of the packet
+    raw = make_response(0, &len);
+    assert(sdns_patch_ttl(raw, len, 40, &min_ttl) == 0);
+    assert(min_ttl == 60);
+    free(raw);
+    return 0;
+}
+
+int test2(){
+    // packets we can't change
+    uint16_t len = 0;
+    char * raw = make_response(0, &len);
+    assert(sdns_patch_udp_size(raw, len, 4096) == SDNS_ERROR_NO_ADDITIONAL_FOUND);
+    // the last RR is not complete
+    uint32_t min_ttl = 0;
+    assert(sdns_patch_ttl(raw, len - 1, 1, &min_ttl) == SDNS_ERROR_RR_SECTION_MALFORMED);
+    assert(sdns_patch_ttl(raw, len - 12, 1, &min_ttl) == sdns_rcode_FormErr);
+    assert(sdns_patch_ttl(raw, 11, 1, &min_ttl) == SDNS_ERROR_INVALID_DNS_PACKET);
+    assert(sdns_patch_ttl(NULL, len, 1, &min_ttl) == SDNS_ERROR_BUFFER_IS_NULL);
+    assert(sdns_patch_id(raw, 11, 1) == SDNS_ERROR_INVALID_DNS_PACKET);
+    assert(sdns_patch_flags(NULL, len, SDNS_RA_MASK, 0) == SDNS_ERROR_BUFFER_IS_NULL);
+    free(raw);
+
+    // no RRs at all
+    sdns_context * dns = sdns_create_query("example.com", "A", "IN");
+    assert(dns != NULL);
+    assert(sdns_remove_edns(dns) == 0);
+    assert(sdns_to_wire(dns) == 0);
+    min_ttl = 1;
+    assert(sdns_patch_ttl(dns->raw, dns->raw_len, 10, &min_ttl) == 0);
+    assert(min_ttl == 0);
+    assert(sdns_patch_udp_size(dns->raw, dns->raw_len, 512) == SDNS_ERROR_NO_ADDITIONAL_FOUND);
+    sdns_free_context(dns);
+    return 0;
+}
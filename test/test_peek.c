@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests sdns_peek_header() and sdns_peek_question().
+ * compile and run:
+ * gcc -g -Werror test_peek.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+int test1(){
+    // dig soa @1.1.1.1 google.com
+    char packet_bytes[] = {
+      0x96, 0xca, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01,
+      0x00, 0x00, 0x00, 0x01, 0x06, 0x67, 0x6f, 0x6f,
+      0x67, 0x6c, 0x65, 0x03, 0x63, 0x6f, 0x6d, 0x00,
+      0x00, 0x06, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06,
+      0x00, 0x01, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x26,
+      0x03, 0x6e, 0x73, 0x31, 0xc0, 0x0c, 0x09, 0x64,
+      0x6e, 0x73, 0x2d, 0x61, 0x64, 0x6d, 0x69, 0x6e,
+      0xc0, 0x0c, 0x26, 0xdf, 0xe8, 0x03, 0x00, 0x00,
+      0x03, 0x84, 0x00, 0x00, 0x03, 0x84, 0x00, 0x00,
+      0x07, 0x08, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+      0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00
+    };
+    sdns_header header;
+    assert(sdns_peek_header(packet_bytes, sizeof(packet_bytes), &header) == 0);
+    assert(header.id == 0x96ca);
+    assert(header.qr == 1 && header.rd == 1 && header.ra == 1 && header.rcode == 0);
+    assert(header.qdcount == 1 && header.ancount == 1 && header.nscount == 0 && header.arcount == 1);
+
+    sdns_question q;
+    char qname[SDNS_NAME_BUFFER_SIZE];
+    assert(sdns_peek_question(packet_bytes, sizeof(packet_bytes), &q, qname) == 0);
+    assert(q.qname == qname);
+    assert(strcmp(qname, "google.com.") == 0);
+    assert(q.qtype == sdns_rr_type_SOA && q.qclass == sdns_q_class_IN);
+    assert(q.qname_offset == 12 && q.qname_len == 12);
+    // without a name buffer
+    assert(sdns_peek_question(packet_bytes, sizeof(packet_bytes), &q, NULL) == 0);
+    assert(q.qname == NULL && q.qname_len == 12);
+    // the rest of the packet is not needed
+    assert(sdns_peek_question(packet_bytes, 28, &q, qname) == 0);
+    assert(sdns_peek_question(packet_bytes, 27, &q, qname) == sdns_rcode_FormErr);
+    assert(sdns_peek_header(packet_bytes, 11, &header) == SDNS_ERROR_INVALID_DNS_PACKET);
+    return 0;
+}
+
+int test2(){
+    // invalid questions
+    char packet_bytes[] = {
+        0x7f, 0x76, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0x05, 'y','a','h','o','o', 0xc0, 0x0c,      // pointer to itself
+        0x00, 0x01, 0x00, 0x01
+    };
+    sdns_question q;
+    char qname[SDNS_NAME_BUFFER_SIZE];
+    assert(sdns_peek_question(packet_bytes, sizeof(packet_bytes), &q, qname) == SDNS_ERROR_ILLEGAL_COMPRESSION);
+    packet_bytes[5] = 0x00;     // qdcount = 0
+    assert(sdns_peek_question(packet_bytes, sizeof(packet_bytes), &q, qname) == SDNS_ERROR_NO_QUESTION_FOUND);
+    packet_bytes[5] = 0x02;     // qdcount = 2
+    assert(sdns_peek_question(packet_bytes, sizeof(packet_bytes), &q, qname) == SDNS_ERROR_MORE_THAN_ONE_QUESTION_FOUND);
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the response made from the wire of the query (sdns_make_response()).
+ * compile and run:
+ * gcc -g -Werror test_reflect.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static char * make_query(char * qname, int edns, int DO, uint16_t * len){
+    sdns_context * dns = sdns_create_query(qname, "AAAA", "IN");
+    assert(dns != NULL);
+    if (!edns)
+        assert(sdns_remove_edns(dns) == 0);
+    else
+        dns->msg->additional->opt_ttl.DO = DO;
+    dns->msg->header.id = 0x4321;
+    dns->msg->header.CD = 1;
+    int err = 0;
+    char * raw = sdns_to_network(dns, &err, len);
+    assert(err == 0 && raw != NULL);
+    sdns_free_context(dns);
+    return raw;
+}
+
+int test1(){
+    // the question is copied from the wire and the names of the RRs point to it
+    uint16_t qlen = 0;
+    char * raw = make_query("WwW.Example.COM", 1, 1, &qlen);
+    sdns_context * query = sdns_from_network(raw, qlen);
+    assert(query != NULL);
+    sdns_context * response = sdns_create_response_from_query(query);
+    assert(response != NULL);
+    assert(response->msg->header.qr == 1);
+    assert(response->msg->header.id == 0x4321);
+    assert(response->msg->header.rd == 1);
+    assert(response->msg->header.CD == 1);
+    assert(response->msg->question.qtype == sdns_rr_type_AAAA);
+    assert(strcmp(response->msg->question.qname, "WwW.Example.COM.") == 0);
+    assert(strcmp(sdns_get_qname(response), "WwW.Example.COM.") == 0);
+    assert(response->msg->header.arcount == 1);
+    assert(response->msg->additional->type == sdns_rr_type_OPT);
+    assert(response->msg->additional->opt_ttl.DO == 1);
+    sdns_free_context(query);
+
+    assert(sdns_add_rr_answer_CNAME(response, "WwW.Example.COM", 300, "web.Example.COM") == 0);
+    assert(sdns_to_wire(response) == 0);
+    // header, question and the owner name of the answer
+    assert(memcmp(response->raw + DNS_HEADER_LENGTH, raw + DNS_HEADER_LENGTH, 17 + 4) == 0);
+    assert((uint8_t)response->raw[33] == 0xc0 && response->raw[34] == 12);
+    // "web" and a pointer to "Example.COM" of the question
+    assert(response->raw[45] == 3 && (uint8_t)response->raw[49] == 0xc0 && response->raw[50] == 16);
+    sdns_context * parsed = sdns_from_network(response->raw, response->raw_len);
+    assert(parsed != NULL);
+    assert(strcmp(parsed->msg->question.qname, "WwW.Example.COM.") == 0);
+    assert(parsed->msg->header.ancount == 1 && parsed->msg->header.arcount == 1);
+    sdns_rr * opt = sdns_section_rr(parsed, DNS_SECTION_ADDITIONAL, 0);
+    // the decoder keeps the TTL as it is on the wire (DO is 0x8000)
+    assert(opt->type == sdns_rr_type_OPT && (opt->ttl & 0x8000) != 0);
+    sdns_free_context(parsed);
+    sdns_free_context(response);
+    free(raw);
+    return 0;
+}
+
+int test2(){
+    // no EDNS, a lazy query, changing the name and reusing the context
+    uint16_t qlen = 0;
+    char * raw = make_query("example.com", 0, 0, &qlen);
+    sdns_context * query = sdns_init_context();
+    assert(query != NULL);
+    query->flags |= SDNS_CTX_LAZY;
+    query->raw = raw;
+    query->raw_len = qlen;
+    assert(sdns_from_wire(query) == 0);
+    sdns_context * response = sdns_init_context();
+    assert(sdns_make_response(response, query) == 0);
+    assert(response->msg->header.arcount == 0 && response->msg->additional == NULL);
+    assert(sdns_to_wire(response) == 0);
+    assert(response->raw_len == qlen);
+    assert(memcmp(response->raw + 2, raw + 2, qlen - 2) != 0);
+    assert(memcmp(response->raw + 4, raw + 4, qlen - 4) == 0);
+
+    sdns_free_context(response);
+
+    // a new name is encoded from the text
+    response = sdns_init_context();
+    assert(sdns_make_response(response, query) == 0);
+    free(response->msg->question.qname);
+    response->msg->question.qname = strdup("www.example.org");
+    assert(sdns_to_wire(response) == 0);
+    sdns_context * parsed = sdns_from_network(response->raw, response->raw_len);
+    assert(parsed != NULL);
+    assert(strcmp(parsed->msg->question.qname, "www.example.org.") == 0);
+    sdns_free_context(parsed);
+
+    // the same context for the next response
+    sdns_context_reset(response);
+    free(raw);
+    raw = make_query("a.example.com", 1, 0, &qlen);
+    sdns_context * query2 = sdns_from_network(raw, qlen);
+    assert(query2 != NULL);
+    assert(sdns_make_response(response, query2) == 0);
+    assert(response->msg->additional->opt_ttl.DO == 0);
+    assert(sdns_to_wire(response) == 0);
+    assert(memcmp(response->raw + DNS_HEADER_LENGTH, raw + DNS_HEADER_LENGTH, 15 + 4) == 0);
+    sdns_free_context(query2);
+    sdns_free_context(response);
+    query->raw = NULL;
+    sdns_free_context(query);
+    free(raw);
+    return 0;
+}
+
+int test3(){
+    // queries without their raw bytes use the old way
+    sdns_context * query = sdns_create_query("example.com", "MX", "IN");
+    assert(query != NULL);
+    sdns_context * response = sdns_init_context();
+    assert(sdns_make_response(response, query) == SDNS_ERROR_NO_QUESTION_FOUND);
+    assert(sdns_make_response(NULL, query) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_make_response(response, NULL) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    sdns_free_context(response);
+    // the header is the same as the one from the wire
+    query->msg->header.rd = 0;
+    query->msg->header.CD = 1;
+    query->msg->header.opcode = 2;
+    response = sdns_create_response_from_query(query);
+    assert(response != NULL);
+    assert(response->msg->header.qr == 1);
+    assert(response->msg->header.rd == 0 && response->msg->header.CD == 1);
+    assert(response->msg->header.opcode == 2);
+    assert(response->msg->header.arcount == 1);
+    assert(strcmp(response->msg->question.qname, "example.com") == 0);
+    assert(sdns_to_wire(response) == 0);
+    sdns_free_context(response);
+    sdns_free_context(query);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the structural validator (sdns_scan_message).
+ * compile and run:
+ * gcc -g -Werror test_scan.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+int test1(){
+    // dig soa @1.1.1.1 google.com
+    char packet_bytes[] = {
+      0x96, 0xca, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01,
+      0x00, 0x00, 0x00, 0x01, 0x06, 0x67, 0x6f, 0x6f,
+      0x67, 0x6c, 0x65, 0x03, 0x63, 0x6f, 0x6d, 0x00,
+      0x00, 0x06, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06,
+      0x00, 0x01, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x26,
+      0x03, 0x6e, 0x73, 0x31, 0xc0, 0x0c, 0x09, 0x64,
+      0x6e, 0x73, 0x2d, 0x61, 0x64, 0x6d, 0x69, 0x6e,
+      0xc0, 0x0c, 0x26, 0xdf, 0xe8, 0x03, 0x00, 0x00,
+      0x03, 0x84, 0x00, 0x00, 0x03, 0x84, 0x00, 0x00,
+      0x07, 0x08, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+      0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00
+    };
+    sdns_message_layout layout;
+    sdns_rr_span spans[4];
+    assert(sdns_scan_message(packet_bytes, sizeof(packet_bytes), &layout, spans, 4) == 0);
+    assert(layout.section_offset[DNS_SECTION_QUESTION] == 12);
+    assert(layout.section_offset[DNS_SECTION_ANSWER] == 28);
+    assert(layout.section_offset[DNS_SECTION_AUTHORITY] == 78);
+    assert(layout.section_offset[DNS_SECTION_ADDITIONAL] == 78);
+    assert(layout.end == sizeof(packet_bytes));
+    assert(layout.rr_count == 2);
+    assert(spans[0].offset == 28 && spans[0].rdata_offset == 40 && spans[0].rdlength == 38);
+    assert(spans[0].type == sdns_rr_type_SOA && spans[0].section == DNS_SECTION_ANSWER);
+    assert(spans[1].offset == 78 && spans[1].rdlength == 0);
+    assert(spans[1].type == sdns_rr_type_OPT && spans[1].section == DNS_SECTION_ADDITIONAL);
+    // a small table or no table at all
+    memset(spans, 0x00, sizeof(spans));
+    assert(sdns_scan_message(packet_bytes, sizeof(packet_bytes), &layout, spans, 1) == 0);
+    assert(layout.rr_count == 2 && spans[1].offset == 0);
+    assert(sdns_scan_message(packet_bytes, sizeof(packet_bytes), NULL, NULL, 0) == 0);
+    // the rdata of SOA is out of the buffer
+    assert(sdns_scan_message(packet_bytes, 77, NULL, NULL, 0) == SDNS_ERROR_RR_SECTION_MALFORMED);
+    assert(sdns_scan_message(packet_bytes, 80, NULL, NULL, 0) == sdns_rcode_FormErr);
+    return 0;
+}
+
+int test2(){
+    char packet_bytes[] = {
+      0xb0, 0xf2, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02,
+      0x00, 0x00, 0x00, 0x01, 0x08, 0x75, 0x72, 0x6c,
+      0x61, 0x62, 0x75, 0x73, 0x65, 0x03, 0x63, 0x6f,
+      0x6d, 0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c,
+      0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0xd5,
+      0x00, 0x04, 0xbc, 0x72, 0x60, 0x03, 0xc0, 0x0c,
+      0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0xd5,
+      0x00, 0x04, 0xbc, 0x72, 0x61, 0x03, 0x00, 0x00,
+      0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x0a, 0x00, 0x03, 0x00, 0x06, 0x36, 0x30, 0x39,
+      0x6d, 0x35, 0x36
+    };
+    assert(sdns_scan_message(packet_bytes, sizeof(packet_bytes), NULL, NULL, 0) == 0);
+    // the last byte of the OPT rdata is missing
+    assert(sdns_scan_message(packet_bytes, sizeof(packet_bytes) - 1, NULL, NULL, 0) == SDNS_ERROR_RR_SECTION_MALFORMED);
+    // second answer points to itself
+    packet_bytes[47] = 0x2e;
+    assert(sdns_scan_message(packet_bytes, sizeof(packet_bytes), NULL, NULL, 0) == SDNS_ERROR_ILLEGAL_COMPRESSION);
+    packet_bytes[47] = 0x0c;
+    // label longer than 63
+    packet_bytes[12] = 0x48;
+    assert(sdns_scan_message(packet_bytes, sizeof(packet_bytes), NULL, NULL, 0) != 0);
+    return 0;
+}
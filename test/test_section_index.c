@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the index of the sections (sdns_section_rr).
+ * compile and run:
+ * gcc -g -Werror test_section_index.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+int test4(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    assert(test4() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+int test1(){
+    // build a big response and parse it again
+    sdns_context * dns = sdns_create_query("cdn.example.com", "A", "IN");
+    assert(dns != NULL);
+    char ip[20] = {0x00};
+    for (int i=0; i< 300; ++i){
+        sprintf(ip, "10.0.%d.%d", i / 256, i % 256);
+        assert(sdns_add_rr_answer_A(dns, "cdn.example.com", 300, ip) == 0);
+    }
+    assert(dns->msg->header.ancount == 300);
+    for (int i=0; i< 300; ++i){
+        sdns_rr * rr = sdns_section_rr(dns, DNS_SECTION_ANSWER, i);
+        assert(rr != NULL);
+        assert(((sdns_rr_A*)rr->psdns_rr)->address == (uint32_t)(0x0a000000 | i));
+    }
+    assert(sdns_section_rr(dns, DNS_SECTION_ANSWER, 300) == NULL);
+    assert(sdns_section_rr(dns, DNS_SECTION_AUTHORITY, 0) == NULL);
+    assert(sdns_section_rr(dns, DNS_SECTION_QUESTION, 0) == NULL);
+    assert(sdns_to_wire(dns) == 0);
+
+    sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.ancount == 300);
+    int err = 0;
+    for (int i=299; i>= 0; --i){
+        sdns_rr * a = sdns_get_answer(parsed, &err, i);
+        assert(err == 0 && a != NULL);
+        assert(((sdns_rr_A*)a->psdns_rr)->address == (uint32_t)(0x0a000000 | i));
+        sdns_free_section(a);
+    }
+    assert(sdns_get_answer(parsed, &err, 300) == NULL);
+    assert(err == SDNS_ERROR_NO_ANSWER_FOUND);
+    sdns_rr * opt = sdns_section_rr(parsed, DNS_SECTION_ADDITIONAL, 0);
+    assert(opt != NULL && opt->type == sdns_rr_type_OPT);
+    sdns_free_context(parsed);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // the index follows the changes of the sections
+    sdns_context * dns = sdns_create_query("google.com", "A", "IN");
+    assert(dns != NULL);
+    assert(sdns_add_rr_additional_TXT(dns, "google.com", 300, "one", 3) == 0);
+    assert(sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 0)->type == sdns_rr_type_OPT);
+    assert(sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 1)->type == sdns_rr_type_TXT);
+    // removing the first one
+    assert(sdns_remove_edns(dns) == 0);
+    assert(dns->msg->header.arcount == 1);
+    assert(sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 0)->type == sdns_rr_type_TXT);
+    assert(sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 1) == NULL);
+    // sdns_add_edns() links the OPT record itself
+    assert(sdns_add_edns(dns, sdns_create_edns0_nsid(NULL, 0)) == 0);
+    assert(sdns_add_rr_additional_TXT(dns, "google.com", 300, "two", 3) == 0);
+    assert(dns->msg->header.arcount == 3);
+    assert(sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 1)->type == sdns_rr_type_OPT);
+    sdns_rr * last = sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 2);
+    assert(last->type == sdns_rr_type_TXT && last->next == NULL);
+    assert(dns->msg->additional->next->next == last);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test3(){
+    // appending keeps the index in sync, nothing is rebuilt
+    sdns_context * dns = sdns_create_query("cdn.example.com", "A", "IN");
+    assert(dns != NULL);
+    char ip[20] = {0x00};
+    sdns_rr * first = NULL;
+    for (int i=0; i< 100; ++i){
+        sprintf(ip, "10.0.0.%d", i);
+        assert(sdns_add_rr_answer_A(dns, "cdn.example.com", 300, ip) == 0);
+        if (i == 0){
+            first = dns->msg->answer;
+            assert(dns->msg->answer_index.count == 1);
+        }
+        sdns_rr * last = dns->msg->answer;
+        while (last->next)
+            last = last->next;
+        assert(dns->msg->answer_index.count == dns->msg->header.ancount);
+        assert(dns->msg->answer_index.tail == last);
+        assert(dns->msg->answer_index.rrs[0] == first);
+    }
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test4(){
+    // removing the OPT RR that is the tail of the index and adding it again
+    sdns_context * dns = sdns_create_query("example.com", "A", "IN");
+    assert(dns != NULL);
+    assert(sdns_remove_edns(dns) == 0);
+    assert(sdns_add_rr_additional_A(dns, "ns.example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_edns(dns, sdns_create_edns0_nsid(NULL, 0)) == 0);
+    sdns_rr * opt = sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 1);
+    assert(opt != NULL && opt->type == sdns_rr_type_OPT);
+    assert(dns->msg->additional_index.tail == opt);
+    assert(sdns_remove_edns(dns) == 0);
+    assert(dns->msg->header.arcount == 1);
+    assert(sdns_add_edns(dns, sdns_create_edns0_nsid(NULL, 0)) == 0);
+    assert(dns->msg->header.arcount == 2);
+    opt = sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 1);
+    assert(opt != NULL && opt->type == sdns_rr_type_OPT && opt == dns->msg->additional->next);
+    assert(dns->msg->additional_index.count == 2 && dns->msg->additional_index.tail == opt);
+    sdns_free_context(dns);
+    return 0;
+}
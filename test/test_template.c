@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the response templates (sdns_template_*).
+ * compile and run:
+ * gcc -g -Werror test_template.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+// OPT is the first RR of the additional section (sdns_create_query() adds it)
+static sdns_context * make_response(void){
+    sdns_context * dns = sdns_create_query("www.example.com", "A", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    dns->msg->header.aa = 1;
+    dns->msg->header.rd = 0;
+    assert(sdns_add_rr_answer_A(dns, "www.example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_answer_A(dns, "www.example.com", 300, "1.2.3.5") == 0);
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 3600, "ns1.example.com") == 0);
+    assert(sdns_add_rr_additional_A(dns, "ns1.example.com", 3600, "1.2.3.53") == 0);
+    return dns;
+}
+
+static char * make_query(char * qname, char * qtype, uint16_t id, int edns, uint16_t * len){
+    sdns_context * dns = sdns_create_query(qname, qtype, "IN");
+    assert(dns != NULL);
+    if (!edns)
+        assert(sdns_remove_edns(dns) == 0);
+    dns->msg->header.id = id;
+    int err = 0;
+    char * raw = sdns_to_network(dns, &err, len);
+    assert(err == 0 && raw != NULL);
+    sdns_free_context(dns);
+    return raw;
+}
+
+int test1(){
+    // the same packet as sdns_to_wire() with the ID and the name of the query
+    sdns_context * dns = make_response();
+    sdns_template * t = sdns_template_create(dns);
+    assert(t != NULL);
+    assert(t->ttl_count == 4);
+    assert(t->opt_offset > 0);
+    // the context is not changed
+    assert(dns->msg->additional->type == sdns_rr_type_OPT);
+    assert(dns->msg->header.arcount == 2);
+    assert(sdns_section_rr(dns, DNS_SECTION_ADDITIONAL, 1)->type == sdns_rr_type_A);
+
+    uint16_t qlen = 0;
+    char * query = make_query("WwW.ExAmple.COM", "A", 0xbeef, 1, &qlen);
+    char out[512];
+    uint16_t len = 0;
+    assert(sdns_template_render(t, query, qlen, out, sizeof(out), &len) == 0);
+    assert(len == t->raw_len);
+    dns->msg->header.id = 0xbeef;
+    dns->msg->header.rd = 1;
+    assert(sdns_to_wire(dns) == 0);
+    assert(dns->raw_len == len);
+    // the name is the only difference (the OPT RR is not in the same place)
+    assert(memcmp(out, dns->raw, DNS_HEADER_LENGTH) == 0);
+    assert(memcmp(out + DNS_HEADER_LENGTH, query + DNS_HEADER_LENGTH, 17 + 4) == 0);
+
+    sdns_context * parsed = sdns_from_network(out, len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.id == 0xbeef);
+    assert(parsed->msg->header.rd == 1);
+    assert(parsed->msg->header.aa == 1);
+    assert(strcmp(parsed->msg->question.qname, "WwW.ExAmple.COM.") == 0);
+    assert(parsed->msg->header.ancount == 2);
+    assert(strcmp(sdns_section_rr(parsed, DNS_SECTION_ANSWER, 1)->name, "WwW.ExAmple.COM.") == 0);
+    assert(strcmp(sdns_section_rr(parsed, DNS_SECTION_ADDITIONAL, 0)->name, "ns1.ExAmple.COM.") == 0);
+    assert(sdns_section_rr(parsed, DNS_SECTION_ADDITIONAL, 1)->type == sdns_rr_type_OPT);
+    sdns_free_context(parsed);
+    free(query);
+    sdns_template_free(t);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // TTLs and queries without EDNS
+    sdns_context * dns = make_response();
+    sdns_template * t = sdns_template_create(dns);
+    assert(t != NULL);
+    sdns_free_context(dns);
+    assert(sdns_template_set_ttl(t, -1, 60) == 0);
+    assert(sdns_template_set_ttl(t, 2, 7200) == 0);
+    assert(sdns_template_set_ttl(t, 4, 10) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+
+    uint16_t qlen = 0;
+    char * query = make_query("www.example.com", "A", 7, 0, &qlen);
+    char out[512];
+    uint16_t len = 0;
+    assert(sdns_template_render(t, query, qlen, out, sizeof(out), &len) == 0);
+    assert(len == t->opt_offset);
+    assert(len == t->raw_len - 11);
+    sdns_context * parsed = sdns_from_network(out, len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.arcount == 1);
+    assert(parsed->msg->header.rd == 1);
+    uint32_t ttls[] = {60, 60, 7200, 60};
+    for (int i=0; i< 4; ++i){
+        sdns_rr * rr = i < 2?sdns_section_rr(parsed, DNS_SECTION_ANSWER, i):
+                       sdns_section_rr(parsed, i == 2?DNS_SECTION_AUTHORITY:DNS_SECTION_ADDITIONAL, 0);
+        assert(rr != NULL && rr->type != sdns_rr_type_OPT);
+        assert(rr->ttl == ttls[i]);
+    }
+    sdns_free_context(parsed);
+    free(query);
+    sdns_template_free(t);
+    return 0;
+}
+
+int test3(){
+    // queries the template does not answer and bad parameters
+    sdns_context * dns = make_response();
+    sdns_template * t = sdns_template_create(dns);
+    assert(t != NULL);
+    char out[512];
+    uint16_t len = 1;
+    uint16_t qlen = 0;
+    char * names[] = {"www.example.org", "ww.example.com", "wwx.example.com", "www.example.com.a"};
+    for (int i=0; i< 4; ++i){
+        char * query = make_query(names[i], "A", 1, 1, &qlen);
+        assert(sdns_template_render(t, query, qlen, out, sizeof(out), &len) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+        assert(len == 0);
+        free(query);
+    }
+    char * query = make_query("www.example.com", "AAAA", 1, 1, &qlen);
+    assert(sdns_template_render(t, query, qlen, out, sizeof(out), &len) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    free(query);
+    query = make_query("www.example.com", "A", 1, 1, &qlen);
+    // a response or another opcode with the same question
+    query[2] |= 0x80;
+    assert(sdns_template_render(t, query, qlen, out, sizeof(out), &len) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    query[2] = (query[2] & 0x07) | (2 << 3);
+    assert(sdns_template_render(t, query, qlen, out, sizeof(out), &len) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    query[2] &= 0x07;
+    assert(sdns_template_render(t, query, 20, out, sizeof(out), &len) == SDNS_ERROR_BUFFER_TOO_SHORT);
+    assert(sdns_template_render(t, query, qlen, out, t->raw_len - 1, &len) == SDNS_ERROR_BUFFER_IS_SMALL);
+    assert(sdns_template_render(t, query, qlen, NULL, sizeof(out), &len) == SDNS_ERROR_BUFFER_IS_NULL);
+    assert(sdns_template_render(t, query, qlen, out, t->raw_len, &len) == 0);
+    free(query);
+    sdns_template_free(t);
+    sdns_template_free(NULL);
+
+    // the type and class are compared as they are (65 and 97 only differ in 0x20)
+    sdns_context * https = sdns_create_query("www.example.com", "HTTPS", "IN");
+    assert(https != NULL);
+    https->msg->header.qr = 1;
+    assert(sdns_add_rr_answer_A(https, "www.example.com", 300, "1.2.3.4") == 0);
+    t = sdns_template_create(https);
+    assert(t != NULL);
+    sdns_free_context(https);
+    query = make_query("www.example.com", "HTTPS", 1, 1, &qlen);
+    assert(sdns_template_render(t, query, qlen, out, sizeof(out), &len) == 0);
+    assert(query[DNS_HEADER_LENGTH + 17] == 0 && query[DNS_HEADER_LENGTH + 18] == sdns_rr_type_HTTPS);
+    query[DNS_HEADER_LENGTH + 18] |= 0x20;
+    assert(sdns_template_render(t, query, qlen, out, sizeof(out), &len) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(len == 0);
+    free(query);
+    sdns_template_free(t);
+
+    // a context without a question
+    sdns_context * empty = sdns_init_context();
+    assert(empty != NULL);
+    assert(sdns_template_create(empty) == NULL);
+    assert(empty->err == SDNS_ERROR_NO_QUESTION_FOUND);
+    sdns_free_context(empty);
+    assert(sdns_template_create(NULL) == NULL);
+    sdns_free_context(dns);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests encoding a context into a buffer of the caller (sdns_to_wire_into).
+ * compile and run:
+ * gcc -g -Werror test_to_wire_into.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static sdns_context * make_response(void){
+    sdns_context * dns = sdns_create_query("www.example.com", "A", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    assert(sdns_add_rr_answer_CNAME(dns, "www.example.com", 300, "web.example.com") == 0);
+    assert(sdns_add_rr_answer_A(dns, "web.example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_answer_A(dns, "web.example.com", 300, "1.2.3.5") == 0);
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 300, "ns1.example.com") == 0);
+    assert(sdns_add_rr_additional_TXT(dns, "example.com", 300, "hello", 5) == 0);
+    return dns;
+}
+
+int test1(){
+    // the same bytes as sdns_to_wire()
+    sdns_context * dns = make_response();
+    char buff[1024];
+    uint16_t len = 0;
+    assert(sdns_to_wire_into(dns, buff, sizeof(buff), &len) == 0);
+    assert(len > 12);
+    assert(dns->raw == NULL);
+    assert(len <= sdns_wire_size_estimate(dns));
+    assert(sdns_to_wire(dns) == 0);
+    assert(dns->raw_len == len);
+    assert(memcmp(dns->raw, buff, len) == 0);
+    sdns_free_context(dns);
+
+    sdns_context * parsed = sdns_from_network(buff, len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.ancount == 3);
+    assert(strcmp(sdns_section_rr(parsed, DNS_SECTION_ANSWER, 2)->name, "web.example.com.") == 0);
+    sdns_free_context(parsed);
+
+    // bad parameters
+    dns = make_response();
+    assert(sdns_to_wire_into(NULL, buff, sizeof(buff), &len) != 0);
+    assert(sdns_to_wire_into(dns, buff, sizeof(buff), NULL) != 0);
+    assert(sdns_to_wire_into(dns, NULL, sizeof(buff), &len) == SDNS_ERROR_BUFFER_IS_NULL);
+    assert(len == 0);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // a small buffer is an error and nothing is written after its end
+    sdns_context * dns = make_response();
+    char buff[1024];
+    uint16_t need = 0;
+    assert(sdns_to_wire_into(dns, buff, sizeof(buff), &need) == 0);
+    char small[1024];
+    for (uint16_t cap=0; cap< need; ++cap){
+        memset(small, 0x5a, sizeof(small));
+        uint16_t len = 1;
+        assert(sdns_to_wire_into(dns, small, cap, &len) == SDNS_ERROR_BUFFER_IS_SMALL);
+        assert(len == 0);
+        assert(dns->err == SDNS_ERROR_BUFFER_IS_SMALL);
+        for (int i=cap; i< sizeof(small); ++i)
+            assert(small[i] == 0x5a);
+    }
+    uint16_t len = 0;
+    assert(sdns_to_wire_into(dns, small, need, &len) == 0);
+    assert(len == need);
+    assert(memcmp(small, buff, len) == 0);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test3(){
+    // one buffer for many contexts and sdns_to_network() still gives its own buffer
+    char buff[512];
+    for (int i=0; i< 10; ++i){
+        sdns_context * dns = sdns_create_query(i % 2 == 0?"google.com":"example.org", "A", "IN");
+        assert(dns != NULL);
+        uint16_t len = 0;
+        assert(sdns_to_wire_into(dns, buff, sizeof(buff), &len) == 0);
+        int err = 0;
+        uint16_t net_len = 0;
+        char * net = sdns_to_network(dns, &err, &net_len);
+        assert(err == 0 && net != NULL);
+        assert(net_len == len);
+        assert(memcmp(net, buff, len) == 0);
+        assert(dns->raw == NULL);
+        free(net);
+        sdns_free_context(dns);
+    }
+    return 0;
+}
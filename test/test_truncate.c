@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests encoding with a size limit (sdns_to_wire_limit).
+ * compile and run:
+ * gcc -g -Werror test_truncate.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+int test4(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    assert(test4() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static uint16_t count_of(char * raw, int i){
+    return ((uint8_t)raw[6 + 2 * i] << 8) | (uint8_t)raw[7 + 2 * i];
+}
+
+// answer: one RRset of 'answers' A records. authority: 2 NS. additional: 'glue' A records with different names
+static sdns_context * make_response(int with_edns, int answers, int glue){
+    sdns_context * dns = sdns_create_query("www.example.com", "A", "IN");
+    assert(dns != NULL);
+    if (!with_edns)
+        assert(sdns_remove_edns(dns) == 0);
+    dns->msg->header.qr = 1;
+    char ip[20];
+    char name[64];
+    for (int i=0; i< answers; ++i){
+        sprintf(ip, "10.0.%d.%d", i / 256, i % 256);
+        assert(sdns_add_rr_answer_A(dns, "www.example.com", 300, ip) == 0);
+    }
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 300, "ns1.example.com") == 0);
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 300, "ns2.example.com") == 0);
+    for (int i=0; i< glue; ++i){
+        sprintf(name, "glue%d.example.com", i);
+        sprintf(ip, "10.1.%d.%d", i / 256, i % 256);
+        assert(sdns_add_rr_additional_A(dns, name, 300, ip) == 0);
+    }
+    return dns;
+}
+
+int test1(){
+    // the answer does not fit: TC and nothing from the RRset
+    sdns_context * query = sdns_create_query("www.example.com", "A", "IN");
+    assert(query != NULL);
+    assert(sdns_max_udp_response(query) == 1232);
+    assert(sdns_remove_edns(query) == 0);
+    assert(sdns_max_udp_response(query) == 512);
+    assert(sdns_max_udp_response(NULL) == 512);
+
+    sdns_context * dns = make_response(0, 40, 0);
+    assert(sdns_to_wire_limit(dns, sdns_max_udp_response(query)) == 0);
+    assert(dns->raw_len <= 512);
+    assert(dns->raw[2] & 0x02);
+    assert(count_of(dns->raw, 0) == 0);
+    assert(count_of(dns->raw, 1) == 0);
+    assert(count_of(dns->raw, 2) == 0);
+    sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.tc == 1);
+    assert(strcmp(parsed->msg->question.qname, "www.example.com.") == 0);
+    sdns_free_context(parsed);
+    // the message is not changed
+    assert(dns->msg->header.ancount == 40);
+    assert(dns->msg->header.tc == 0);
+    sdns_free_context(dns);
+    sdns_free_context(query);
+    return 0;
+}
+
+int test2(){
+    // the answer fits, the additional section is cut at an RRset and OPT is kept
+    sdns_context * dns = make_response(1, 10, 60);
+    unsigned long int full_len;
+    assert(sdns_to_wire(dns) == 0);
+    full_len = dns->raw_len;
+    assert(full_len > 512);
+    free(dns->raw);
+    dns->raw = NULL;
+    dns->cursor = NULL;
+    dns->raw_len = 0;
+
+    assert(sdns_to_wire_limit(dns, 512) == 0);
+    assert(dns->raw_len <= 512);
+    assert((dns->raw[2] & 0x02) == 0);
+    assert(count_of(dns->raw, 0) == 10);
+    assert(count_of(dns->raw, 1) == 2);
+    uint16_t arcount = count_of(dns->raw, 2);
+    assert(arcount > 1 && arcount < 61);
+    sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+    assert(parsed != NULL);
+    int opt = 0;
+    int i = 0;
+    char name[64];
+    for (sdns_rr * rr = parsed->msg->additional; rr; rr = rr->next){
+        if (rr->type == sdns_rr_type_OPT){
+            opt++;
+            continue;
+        }
+        sprintf(name, "glue%d.example.com.", i++);
+        assert(strcmp(rr->name, name) == 0);
+    }
+    assert(opt == 1);
+    assert(i == arcount - 1);
+    sdns_free_context(parsed);
+
+    // a big limit is the same as no limit
+    free(dns->raw);
+    dns->raw = NULL;
+    dns->cursor = NULL;
+    dns->raw_len = 0;
+    assert(sdns_to_wire_limit(dns, 65535) == 0);
+    assert(dns->raw_len == full_len);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test3(){
+    // authority does not fit: additional goes as well, no TC
+    sdns_context * dns = make_response(0, 28, 5);
+    assert(sdns_to_wire_limit(dns, 512) == 0);
+    assert(dns->raw_len <= 512);
+    assert((dns->raw[2] & 0x02) == 0);
+    assert(count_of(dns->raw, 0) == 28);
+    assert(count_of(dns->raw, 1) == 0);
+    assert(count_of(dns->raw, 2) == 0);
+    sdns_context * parsed = sdns_from_network(dns->raw, dns->raw_len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.ancount == 28);
+    sdns_free_context(parsed);
+    sdns_free_context(dns);
+
+    // every limit gives a valid packet
+    dns = make_response(1, 10, 60);
+    for (int max=70; max< 1500; max += 7){
+        assert(sdns_to_wire_limit(dns, max) == 0);
+        assert(dns->raw_len <= max);
+        parsed = sdns_from_network(dns->raw, dns->raw_len);
+        assert(parsed != NULL);
+        for (int i=1; i<= 3; ++i){
+            int cnt = 0;
+            for (sdns_rr * rr = sdns_section_rr(parsed, i, 0); rr; rr = rr->next)
+                cnt++;
+            assert(cnt == count_of(dns->raw, i - 1));
+        }
+        sdns_free_context(parsed);
+        free(dns->raw);
+        dns->raw = NULL;
+        dns->cursor = NULL;
+        dns->raw_len = 0;
+    }
+    sdns_free_context(dns);
+
+    // no space even for the question
+    dns = make_response(1, 1, 0);
+    assert(sdns_to_wire_limit(dns, 20) == SDNS_ERROR_BUFFER_IS_SMALL);
+    assert(dns->raw == NULL);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test4(){
+    // a buffer of the caller with SDNS_CTX_TRUNCATE
+    char buff[512];
+    char other[512];
+    uint16_t len = 0;
+    sdns_context * dns = make_response(1, 10, 60);
+    assert(sdns_to_wire_into(dns, buff, sizeof(buff), &len) == SDNS_ERROR_BUFFER_IS_SMALL);
+    dns->flags |= SDNS_CTX_TRUNCATE;
+    for (int i=0; i< 3; ++i){
+        assert(sdns_to_wire_into(dns, i == 1?other:buff, sizeof(buff), &len) == 0);
+        assert(len <= sizeof(buff));
+    }
+    assert(memcmp(buff, other, len) == 0);
+    assert(sdns_to_wire_limit(dns, sizeof(buff)) == 0);
+    assert(dns->raw_len == len);
+    assert(memcmp(dns->raw, buff, len) == 0);
+    sdns_context * parsed = sdns_from_network(buff, len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.ancount == 10);
+    sdns_free_context(parsed);
+    sdns_free_context(dns);
+    return 0;
+}
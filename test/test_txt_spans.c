@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests reading TXT records without the linked-list (sdns_txt_spans(), sdns_view_TXT() and sdns_txt_join()).
+ * compile and run:
+ * gcc -g -Werror test_txt_spans.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static char text[600];
+
+static void fill_text(void){
+    for (int i=0; i< (int)sizeof(text); ++i)
+        text[i] = 'a' + i % 26;
+}
+
+static char * make_response(uint16_t * len){
+    fill_text();
+    sdns_context * dns = sdns_create_query("example.com", "TXT", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    assert(sdns_add_rr_answer_TXT(dns, "example.com", 300, "v=spf1 -all", 11) == 0);
+    assert(sdns_add_rr_answer_TXT(dns, "example.com", 300, text, sizeof(text)) == 0);
+    int err = 0;
+    char * raw = sdns_to_network(dns, &err, len);
+    assert(err == 0 && raw != NULL);
+    sdns_free_context(dns);
+    return raw;
+}
+
+int test1(){
+    // the same strings as sdns_decode_rr_TXT()
+    uint16_t len = 0;
+    char * raw = make_response(&len);
+    sdns_context * dns = sdns_from_network(raw, len);
+    assert(dns != NULL);
+    sdns_txt_span spans[4];
+    uint16_t count = 0;
+    sdns_rr * rr = sdns_section_rr(dns, DNS_SECTION_ANSWER, 1);
+    assert(sdns_txt_spans(dns, rr, spans, 4, &count) == 0);
+    assert(count == 3);
+    sdns_rr_TXT * txt = sdns_decode_rr_TXT(dns, rr);
+    assert(txt != NULL);
+    uint16_t i = 0;
+    for (sdns_rr_TXT * t = txt; t; t = t->next, ++i){
+        assert(i < count);
+        assert(spans[i].len == t->character_string.len);
+        assert(memcmp(rr->rdata + spans[i].offset, t->character_string.content, spans[i].len) == 0);
+    }
+    assert(i == count);
+    sdns_free_rr_TXT(txt);
+    // counting and a short table
+    assert(sdns_txt_spans(dns, rr, NULL, 0, &count) == SDNS_ERROR_BUFFER_TOO_SHORT && count == 3);
+    assert(sdns_txt_spans(dns, rr, spans, 1, &count) == SDNS_ERROR_BUFFER_TOO_SHORT && count == 3);
+    assert(spans[0].offset == 1 && spans[0].len == 255);
+
+    // joined
+    char buff[1024];
+    uint16_t joined = 0;
+    assert(sdns_txt_join(dns, rr, buff, sizeof(buff), &joined) == 0);
+    assert(joined == sizeof(text) && memcmp(buff, text, joined) == 0 && buff[joined] == '\0');
+    assert(sdns_txt_join(dns, rr, buff, sizeof(text), &joined) == SDNS_ERROR_BUFFER_TOO_SHORT);
+    assert(joined == sizeof(text));
+    rr = sdns_section_rr(dns, DNS_SECTION_ANSWER, 0);
+    assert(sdns_txt_join(dns, rr, buff, rr->rdlength, &joined) == 0);
+    assert(strcmp(buff, "v=spf1 -all") == 0);
+
+    // the views of the iterator
+    sdns_rr_iter it;
+    sdns_rr_view view;
+    assert(sdns_iter_begin(dns, &it) == 0);
+    int n = 0;
+    while (sdns_iter_next(&it, &view) == 1){
+        if (view.type != sdns_rr_type_TXT){
+            assert(sdns_view_TXT(&view, spans, 4, &count) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+            continue;
+        }
+        assert(sdns_view_TXT(&view, spans, 4, &count) == 0);
+        assert(count == (n == 0?1:3));
+        assert(spans[count - 1].offset + spans[count - 1].len == view.rdlength);
+        n++;
+    }
+    assert(n == 2);
+    sdns_free_context(dns);
+    free(raw);
+    return 0;
+}
+
+int test2(){
+    // decoded RRs, broken rdata and wrong parameters
+    fill_text();
+    sdns_context * dns = sdns_create_query("example.com", "TXT", "IN");
+    assert(dns != NULL);
+    assert(sdns_add_rr_answer_TXT(dns, "example.com", 300, text, sizeof(text)) == 0);
+    sdns_rr * rr = dns->msg->answer;
+    char buff[1024];
+    uint16_t joined = 0;
+    assert(sdns_txt_join(dns, rr, buff, sizeof(buff), &joined) == 0);
+    assert(joined == sizeof(text) && memcmp(buff, text, joined) == 0);
+    uint16_t count = 0;
+    sdns_txt_span spans[4];
+    assert(sdns_txt_spans(dns, rr, spans, 4, &count) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    sdns_free_context(dns);
+
+    char rdata[] = {3, 'a', 'b', 'c', 5, 'd'};
+    sdns_context * ctx = sdns_init_context();
+    assert(ctx != NULL);
+    rr = sdns_init_rr(NULL, sdns_rr_type_TXT, sdns_q_class_IN, 60, sizeof(rdata), 0, rdata);
+    assert(sdns_txt_spans(ctx, rr, spans, 4, &count) == SDNS_ERROR_RR_SECTION_MALFORMED);
+    assert(sdns_txt_join(ctx, rr, buff, sizeof(buff), &joined) == SDNS_ERROR_RR_SECTION_MALFORMED);
+    rr->rdlength = 4;
+    assert(sdns_txt_spans(ctx, rr, spans, 4, &count) == 0 && count == 1);
+    assert(sdns_txt_join(ctx, rr, buff, sizeof(buff), &joined) == 0 && joined == 3);
+    assert(strcmp(buff, "abc") == 0);
+    rr->rdlength = 0;
+    assert(sdns_txt_spans(ctx, rr, spans, 4, &count) == SDNS_ERROR_RR_SECTION_MALFORMED);
+    // a decoded RR with more strings than an rdata can have
+    static sdns_rr_TXT chain[260];
+    for (int i=0; i< 260; ++i){
+        chain[i].character_string.len = 255;
+        chain[i].character_string.content = text;
+        chain[i].next = i < 259?&chain[i + 1]:NULL;
+    }
+    rr->decoded = 1;
+    rr->psdns_rr = (void*) chain;
+    assert(sdns_txt_join(ctx, rr, buff, sizeof(buff), &joined) == SDNS_ERROR_CHARACTER_STRING_TOO_LONG);
+    rr->decoded = 0;
+    rr->psdns_rr = NULL;
+    rr->type = sdns_rr_type_A;
+    assert(sdns_txt_spans(ctx, rr, spans, 4, &count) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_txt_spans(NULL, rr, spans, 4, &count) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    free(rr);
+    sdns_free_context(ctx);
+    return 0;
+}
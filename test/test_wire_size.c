@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <sdns_dynamic_buffer.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests the size estimate of sdns_to_wire() and the growth of dyn_buffer.
+ * compile and run:
+ * gcc -g -Werror test_wire_size.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+int test1(){
+    // the estimate is never smaller than the packet
+    assert(sdns_wire_size_estimate(NULL) == 0);
+    sdns_context * dns = sdns_create_query("example.com", "A", "IN");
+    assert(dns != NULL);
+    unsigned long int empty = sdns_wire_size_estimate(dns);
+    assert(empty > 0);
+    dns->msg->header.qr = 1;
+    assert(sdns_add_rr_answer_A(dns, "example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_answer_AAAA(dns, "example.com", 300, "2001:db8::1") == 0);
+    assert(sdns_add_rr_answer_CNAME(dns, "www.example.com", 300, "example.com") == 0);
+    assert(sdns_add_rr_answer_PTR(dns, "4.3.2.1.in-addr.arpa", 300, "example.com.") == 0);
+    assert(sdns_add_rr_answer_TXT(dns, "example.com", 300, "some text", 9) == 0);
+    assert(sdns_add_rr_answer_SRV(dns, "_sip._tcp.example.com", 300, 1, 2, 5060, "sip.example.com") == 0);
+    assert(sdns_add_rr_answer_HINFO(dns, "example.com", 300, "linux", 5, "x86", 3) == 0);
+    assert(sdns_add_rr_answer_CAA(dns, "example.com", 300, 0, "issue", "ca.example.net") == 0);
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 300, "ns1.example.com") == 0);
+    assert(sdns_add_rr_authority_SOA(dns, "example.com", 300, "ns1.example.com", "hostmaster.example.com",
+                                     1, 2, 3, 4, 5) == 0);
+    assert(sdns_add_rr_additional_MX(dns, "example.com", 300, 10, "mail.example.com") == 0);
+    unsigned long int estimate = sdns_wire_size_estimate(dns);
+    assert(estimate > empty);
+    assert(sdns_to_wire(dns) == 0);
+    assert(dns->raw_len <= estimate);
+    sdns_free_context(dns);
+
+    // with little compression, the estimate is close
+    dns = sdns_create_query("example.com", "A", "IN");
+    assert(dns != NULL);
+    char name[64];
+    for (int i=0; i< 100; ++i){
+        sprintf(name, "host%d.example%d.com", i, i);
+        assert(sdns_add_rr_answer_A(dns, name, 300, "1.2.3.4") == 0);
+    }
+    estimate = sdns_wire_size_estimate(dns);
+    assert(sdns_to_wire(dns) == 0);
+    assert(dns->raw_len <= estimate);
+    assert(dns->raw_len + 10 * 100 >= estimate);
+    sdns_free_context(dns);
+    return 0;
+}
+
+int test2(){
+    // one byte at a time
+    dyn_buffer * db = dyn_buffer_init(NULL, 0, 0);
+    assert(db != NULL);
+    int reallocs = 0;
+    char * last = db->buffer;
+    for (int i=0; i< 5000; ++i){
+        char c = (char)(i & 0xFF);
+        assert(dyn_buffer_append(db, &c, 1) == 0);
+        if (db->buffer != last || i == 0){
+            reallocs++;
+            last = db->buffer;
+        }
+    }
+    assert(db->cursor == 5000);
+    assert(reallocs < 20);
+    for (int i=0; i< 5000; ++i)
+        assert(db->buffer[i] == (char)(i & 0xFF));
+    // nothing moves after reserve
+    assert(dyn_buffer_reserve(db, 10000) == 0);
+    assert(db->len - db->cursor >= 10000);
+    last = db->buffer;
+    char data[100] = {0x00};
+    for (int i=0; i< 100; ++i)
+        assert(dyn_buffer_append(db, data, sizeof(data)) == 0);
+    assert(db->buffer == last);
+    assert(db->cursor == 15000);
+    assert(dyn_buffer_reserve(db, 0) == 0);
+    dyn_buffer_free(db);
+    return 0;
+}
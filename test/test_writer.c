@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sdns.h>
+#include <sdns_api.h>
+#include <time.h>
+#include <assert.h>
+/*
+ * Tests writing a packet directly to a buffer (sdns_writer_*).
+ * compile and run:
+ * gcc -g -Werror test_writer.c -I../include -L../bin -lsdns -o test && valgrind -s --leak-check=full ./test
+ */
+
+// list of test functions
+int test1(void);
+int test2(void);
+int test3(void);
+
+
+int main(int argc, char ** argv){
+    assert(test1() == 0);
+    assert(test2() == 0);
+    assert(test3() == 0);
+    fprintf(stdout, "success\n");
+    return 0;
+}
+
+static char ipv6[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01};
+
+// the same response with the message API
+static sdns_context * make_response(char * text, uint16_t text_len){
+    sdns_context * dns = sdns_create_query("www.example.com", "A", "IN");
+    assert(dns != NULL);
+    dns->msg->header.qr = 1;
+    dns->msg->header.aa = 1;
+    assert(sdns_add_rr_answer_CNAME(dns, "www.example.com", 300, "web.example.com") == 0);
+    assert(sdns_add_rr_answer_A(dns, "web.example.com", 300, "1.2.3.4") == 0);
+    assert(sdns_add_rr_answer_AAAA(dns, "web.example.com", 300, "2001:db8::1") == 0);
+    assert(sdns_add_rr_answer_TXT(dns, "web.example.com", 300, text, text_len) == 0);
+    assert(sdns_add_rr_authority_NS(dns, "example.com", 300, "ns1.example.com") == 0);
+    assert(sdns_add_rr_authority_SOA(dns, "example.com", 300, "ns1.example.com", "hostmaster.example.com",
+                                     1, 2, 3, 4, 5) == 0);
+    assert(sdns_add_rr_additional_MX(dns, "example.com", 300, 10, "mail.example.com") == 0);
+    return dns;
+}
+
+static int write_response(sdns_writer * w, sdns_context * ctx, sdns_header * header, char * buff, uint16_t len,
+                          char * text, uint16_t text_len){
+    assert(sdns_writer_begin(w, ctx, buff, len, header) == 0);
+    assert(sdns_writer_question(w, "www.example.com", sdns_rr_type_A, sdns_q_class_IN) == 0);
+    assert(sdns_writer_add_CNAME(w, DNS_SECTION_ANSWER, "www.example.com", 300, "web.example.com") == 0);
+    assert(sdns_writer_add_A(w, DNS_SECTION_ANSWER, "web.example.com", 300, 0x01020304) == 0);
+    assert(sdns_writer_add_AAAA(w, DNS_SECTION_ANSWER, "web.example.com", 300, ipv6) == 0);
+    assert(sdns_writer_add_TXT(w, DNS_SECTION_ANSWER, "web.example.com", 300, text, text_len) == 0);
+    assert(sdns_writer_add_NS(w, DNS_SECTION_AUTHORITY, "example.com", 300, "ns1.example.com") == 0);
+    assert(sdns_writer_add_SOA(w, DNS_SECTION_AUTHORITY, "example.com", 300, "ns1.example.com",
+                               "hostmaster.example.com", 1, 2, 3, 4, 5) == 0);
+    assert(sdns_writer_add_OPT(w, 1232, 0) == 0);
+    assert(sdns_writer_add_MX(w, DNS_SECTION_ADDITIONAL, "example.com", 300, 10, "mail.example.com") == 0);
+    return sdns_writer_end(w);
+}
+
+int test1(){
+    // the same bytes as sdns_to_wire()
+    char text[600];
+    memset(text, 't', sizeof(text));
+    uint16_t sizes[] = {0, 5, 300, 600};
+    for (int i=0; i< 4; ++i){
+        sdns_context * dns = make_response(text, sizes[i]);
+        assert(sdns_to_wire(dns) == 0);
+        sdns_context * ctx = sdns_init_context();
+        assert(ctx != NULL);
+        char buff[2048];
+        sdns_writer w;
+        assert(write_response(&w, ctx, &dns->msg->header, buff, sizeof(buff), text, sizes[i]) == 0);
+        assert(w.len == dns->raw_len);
+        assert(memcmp(buff, dns->raw, w.len) == 0);
+
+        sdns_context * parsed = sdns_from_network(buff, w.len);
+        assert(parsed != NULL);
+        assert(parsed->msg->header.qdcount == 1);
+        assert(parsed->msg->header.ancount == 4);
+        assert(parsed->msg->header.nscount == 2);
+        assert(parsed->msg->header.arcount == 2);
+        assert(strcmp(parsed->msg->question.qname, "www.example.com.") == 0);
+        sdns_rr * rr = sdns_section_rr(parsed, DNS_SECTION_ANSWER, 1);
+        assert(strcmp(rr->name, "web.example.com.") == 0);
+        sdns_rr_A * a = sdns_decode_rr_A(parsed, rr);
+        assert(a != NULL);
+        assert(a->address == 0x01020304);
+        sdns_free_rr_A(a);
+        sdns_free_context(parsed);
+
+        // the context can be used for the next packet
+        char again[2048];
+        assert(write_response(&w, ctx, &dns->msg->header, again, sizeof(again), text, sizes[i]) == 0);
+        assert(w.len == dns->raw_len);
+        assert(memcmp(again, buff, w.len) == 0);
+        sdns_free_context(ctx);
+        sdns_free_context(dns);
+    }
+    return 0;
+}
+
+int test2(){
+    // a record that does not fit is not written and the packet is still valid
+    sdns_context * ctx = sdns_init_context();
+    assert(ctx != NULL);
+    sdns_header header = {0};
+    header.id = 0x1234;
+    header.qr = 1;
+    // header and question (29 bytes), 10 records of 22 bytes and 20 bytes that are left
+    char buff[269];
+    char name[64];
+    sdns_writer w;
+    assert(sdns_writer_begin(&w, ctx, buff, sizeof(buff), &header) == 0);
+    assert(sdns_writer_question(&w, "example.com", sdns_rr_type_A, sdns_q_class_IN) == 0);
+    int res = 0;
+    int written = 0;
+    while (res == 0){
+        sprintf(name, "host%d.example.com", written);
+        res = sdns_writer_add_A(&w, DNS_SECTION_ANSWER, name, 300, 0x0a000000 + written);
+        if (res == 0)
+            written++;
+    }
+    assert(res == SDNS_ERROR_BUFFER_IS_SMALL);
+    assert(written == 10);
+    assert(w.count[0] == written);
+    uint16_t len = w.len;
+    // a smaller record still fits
+    assert(sdns_writer_add_A(&w, DNS_SECTION_ANSWER, "example.com", 300, 0x01010101) == 0);
+    assert(w.len == len + 16);
+    assert(sdns_writer_end(&w) == 0);
+    assert(w.len <= sizeof(buff));
+    sdns_context * parsed = sdns_from_network(buff, w.len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.id == 0x1234);
+    assert(parsed->msg->header.qr == 1);
+    assert(parsed->msg->header.ancount == written + 1);
+    for (int i=0; i< written; ++i){
+        sprintf(name, "host%d.example.com.", i);
+        assert(strcmp(sdns_section_rr(parsed, DNS_SECTION_ANSWER, i)->name, name) == 0);
+    }
+    assert(strcmp(sdns_section_rr(parsed, DNS_SECTION_ANSWER, written)->name, "example.com.") == 0);
+    sdns_free_context(parsed);
+
+    // not even the header
+    assert(sdns_writer_begin(&w, ctx, buff, 11, &header) == SDNS_ERROR_BUFFER_IS_SMALL);
+    sdns_free_context(ctx);
+    return 0;
+}
+
+int test3(){
+    // wrong order and bad parameters
+    sdns_context * ctx = sdns_init_context();
+    assert(ctx != NULL);
+    sdns_header header = {0};
+    char buff[512];
+    sdns_writer w;
+    assert(sdns_writer_begin(NULL, ctx, buff, sizeof(buff), &header) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_writer_begin(&w, NULL, buff, sizeof(buff), &header) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_writer_begin(&w, ctx, NULL, sizeof(buff), &header) == SDNS_ERROR_BUFFER_IS_NULL);
+    assert(sdns_writer_begin(&w, ctx, buff, sizeof(buff), &header) == 0);
+    assert(sdns_writer_add_NS(&w, DNS_SECTION_AUTHORITY, "example.com", 300, "ns.example.com") == 0);
+    assert(sdns_writer_question(&w, "example.com", sdns_rr_type_A, sdns_q_class_IN) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_writer_add_A(&w, DNS_SECTION_ANSWER, "example.com", 300, 1) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_writer_add_A(&w, 0, "example.com", 300, 1) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_writer_add_A(&w, DNS_SECTION_QUESTION, "example.com", 300, 1) == SDNS_ERROR_WRONG_INPUT_PARAMETER);
+    assert(sdns_writer_add_CNAME(&w, DNS_SECTION_ADDITIONAL, "example.com", 300, NULL) == SDNS_ERROR_BUFFER_IS_NULL);
+    // a name longer than 255 characters
+    char big[300];
+    memset(big, 'a', sizeof(big));
+    big[299] = '\0';
+    uint16_t len = w.len;
+    assert(sdns_writer_add_CNAME(&w, DNS_SECTION_ADDITIONAL, "example.com", 300, big) != 0);
+    assert(w.len == len);
+    // a record with its rdata
+    char rdata[] = {0x00, 0x0a, 0x04, 'm', 'a', 'i', 'l', 0xc0, 0x0c};
+    assert(sdns_writer_add_rr(&w, DNS_SECTION_ADDITIONAL, "example.com", sdns_rr_type_MX, sdns_rr_class_IN,
+                              60, rdata, sizeof(rdata)) == 0);
+    assert(sdns_writer_end(&w) == 0);
+    assert(w.count[0] == 0 && w.count[1] == 1 && w.count[2] == 1);
+    sdns_context * parsed = sdns_from_network(buff, w.len);
+    assert(parsed != NULL);
+    assert(parsed->msg->header.qdcount == 0);
+    sdns_rr * rr = sdns_section_rr(parsed, DNS_SECTION_ADDITIONAL, 0);
+    assert(rr->type == sdns_rr_type_MX);
+    sdns_rr_MX * mx = sdns_decode_rr_MX(parsed, rr);
+    assert(mx != NULL);
+    assert(mx->preference == 10);
+    assert(strcmp(mx->exchange, "mail.example.com.") == 0);
+    sdns_free_rr_MX(mx);
+    sdns_free_context(parsed);
+    sdns_free_context(ctx);
+    return 0;
+}